@@ -34,9 +34,12 @@
 
 #include <boost/uuid/uuid.hpp>
 #include <map>
+#include <memory>
 #include <vector>
 
 namespace BIBS {
+class ExogenousInput;
+class IChoicePolicy;
 /**
  * The interface for an agent in the simulation.
  */
@@ -128,6 +131,23 @@ private:
    */
   std::map<const IAgent *, double> friends;
 
+  /**
+   * The rule choosing the behaviour to perform, or nullptr for
+   * defaultChoicePolicy.
+   */
+  std::shared_ptr<const IChoicePolicy> choicePolicy;
+
+  /**
+   * The external signals added to the utilities, or nullptr.
+   */
+  std::shared_ptr<const ExogenousInput> exogenous;
+
+  /**
+   * The behaviour index in exogenous of each behaviour, which may be shared
+   * with other agents.
+   */
+  std::shared_ptr<const std::map<const IBehaviour *, size_t>> exogenousIndices;
+
   /**
    * The time deltas.
    */
@@ -212,6 +232,13 @@ public:
    */
   virtual void setFriendWeight(const IAgent *a, double w);
 
+  /**
+   * Gets the weights of relationship between this agent and all its friends.
+   *
+   * @return The map from friend to weight.
+   */
+  const std::map<const IAgent *, double> &friendWeights() const;
+
   /**
    * The amount the activation of b changes (multiplicative) at each time step.
    *
@@ -231,6 +258,13 @@ public:
    */
   virtual void setTimeDelta(const IBelief *b, const double td);
 
+  /**
+   * Gets all the time deltas.
+   *
+   * @return The map from belief to time delta.
+   */
+  const std::map<const IBelief *, double> &timeDeltas() const;
+
   /**
    * Updates the activation of the belief at time t.
    *
@@ -242,7 +276,8 @@ public:
   virtual void updateActivation(const sim_time_t t, const IBelief *b) override;
 
   /**
-   * Choose and perform an action from the provided set of all actions at time t
+   * Choose and perform an action from the provided set of all actions at time
+   * t, with the choice policy of the agent.
    *
    * @param t The time.
    * @param bs The behaviours.
@@ -250,6 +285,49 @@ public:
   virtual void perform(const sim_time_t t,
                        const std::vector<const IBehaviour *> &bs) override;
 
+  /**
+   * Sets the rule choosing the behaviour to perform.
+   *
+   * @param p The policy, or nullptr for defaultChoicePolicy.
+   */
+  void setChoicePolicy(std::shared_ptr<const IChoicePolicy> p);
+
+  /**
+   * Sets the external signals returned by environment.
+   *
+   * @param input The input, or nullptr for none.
+   * @param behaviours The behaviours, in the order of the behaviour indices
+   *   of the input.
+   * @exception std::invalid_argument If the input affects a behaviour not
+   *   in behaviours.
+   */
+  void setExogenousInput(std::shared_ptr<const ExogenousInput> input,
+                         const std::vector<const IBehaviour *> &behaviours);
+
+  /**
+   * Sets the external signals returned by environment, with the behaviour
+   * indices of the input made once by indexBehaviours and shared between
+   * agents.
+   *
+   * @param input The input, or nullptr for none.
+   * @param indices The behaviour index in the input of each behaviour.
+   * @exception std::invalid_argument If there is an input but no indices,
+   *   or the input affects a behaviour not in indices.
+   */
+  void setExogenousInput(
+      std::shared_ptr<const ExogenousInput> input,
+      std::shared_ptr<const std::map<const IBehaviour *, size_t>> indices);
+
+  /**
+   * Makes the behaviour indices of an exogenous input.
+   *
+   * @param behaviours The behaviours, in the order of the behaviour indices
+   *   of the input.
+   * @return The index of each behaviour.
+   */
+  static std::shared_ptr<const std::map<const IBehaviour *, size_t>>
+  indexBehaviours(const std::vector<const IBehaviour *> &behaviours);
+
 protected:
   /**
    * Calculates and returns the value of observing behaviour relevant to belief
@@ -336,7 +414,7 @@ protected:
 
   /**
    * Gets the impetus to perform a behaviour due to the environment of this
-   * agent.
+   * agent: the exogenous input for the behaviour, if one is set, or 0.
    *
    * @param b The behaviour.
    * @param t The time.
@@ -354,6 +432,19 @@ protected:
    * @return t The utility.
    */
   virtual double utility(const IBehaviour *b, const sim_time_t t) const;
+
+  /**
+   * Gets the uniform random number in [0, 1) given to the choice policy at
+   * time t. With the default policy, behaviour k is chosen if the number,
+   * scaled by the total positive utility, falls in its share of the
+   * cumulative positive utility, taken in the order the behaviours are
+   * given. It is only called if the policy needs a number for the
+   * utilities; see IChoicePolicy::needsUniform.
+   *
+   * @param t The time.
+   * @return The random number.
+   */
+  virtual double choiceUniform(const sim_time_t t) const;
 };
 } // namespace BIBS
 
@@ -0,0 +1,357 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      beliefnetwork.hpp
+ * @brief     Header of beliefnetwork.cpp
+ * @date      Sun Oct 18 19:21:08 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains a set of beliefs whose relationships are stored in
+ * dense matrices, so that whole matrices can be installed in one pass
+ * rather than by one map insert per relationship.
+ */
+
+#ifndef BIBS_BELIEFNETWORK_H
+#define BIBS_BELIEFNETWORK_H
+
+#include "bibs/behaviour.hpp"
+#include "bibs/belief.hpp"
+#include "bibs/lookup.hpp"
+#include "bibs/scenario.hpp"
+
+#include <boost/uuid/uuid.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace BIBS {
+class BeliefNetwork;
+
+/**
+ * A belief of a BeliefNetwork. Its relationships are a row of the matrices
+ * of the network.
+ */
+class NetworkBelief : public IBelief {
+  friend class BeliefNetwork;
+
+private:
+  /**
+   * The network.
+   */
+  BeliefNetwork *network;
+
+  /**
+   * The index of the belief in the network.
+   */
+  index_t row;
+
+  /**
+   * Create a new NetworkBelief.
+   *
+   * @param name The name of the belief.
+   * @param uuid The UUID of the belief.
+   * @param network The network.
+   * @param row The index of the belief in the network.
+   */
+  NetworkBelief(const std::string name, const boost::uuids::uuid uuid,
+                BeliefNetwork *network, index_t row);
+
+public:
+  /**
+   * The index of the belief in its network.
+   *
+   * @return The index.
+   */
+  index_t index() const;
+
+  /**
+   * The relationship between beliefs.
+   *
+   * @param b2 The other belief.
+   * @returns The relationship between this belief and b2, given that you
+   *   already hold this.
+   * @exception std::out_of_range If b2 is not in the network, or the
+   *   relationship is not set.
+   */
+  double beliefRelationship(const IBelief *b2) const override;
+
+  /**
+   * Set the relationship between beliefs.
+   *
+   * @param b2 The other belief.
+   * @param value The relationship between this belief and b2, given that you
+   *   already hold this.
+   * @exception std::out_of_range If b2 is not in the network.
+   */
+  void setBeliefRelationship(const IBelief *b2, const double value) override;
+
+  /**
+   * Gets the Observed Behaviour Relationship.
+   *
+   * @param beh The behaviour.
+   * @return The Observed Behaviour Relationship.
+   * @exception std::out_of_range If beh is not in the network, or the
+   *   relationship is not set.
+   */
+  double observedBehaviourRelationship(const IBehaviour *beh) const override;
+
+  /**
+   * Sets the Observed Behaviour Relationship.
+   *
+   * @param beh The behaviour.
+   * @param value The new value of the relationship.
+   * @exception std::out_of_range If beh is not in the network.
+   */
+  void setObservedBehaviourRelationship(const IBehaviour *beh,
+                                        const double value) override;
+
+  /**
+   * Gets the Performing Behaviour Relationship.
+   *
+   * @param beh The behaviour.
+   * @return The Performing Behaviour Relationship.
+   * @exception std::out_of_range If beh is not in the network, or the
+   *   relationship is not set.
+   */
+  double performingBehaviourRelationship(const IBehaviour *beh) const override;
+
+  /**
+   * Sets the Performing Behaviour Relationship.
+   *
+   * @param beh The behaviour.
+   * @param value The new value of the relationship.
+   * @exception std::out_of_range If beh is not in the network.
+   */
+  void setPerformingBehaviourRelationship(const IBehaviour *beh,
+                                          const double value) override;
+};
+
+/**
+ * A set of beliefs and behaviours, with the relationships between them in
+ * dense row-major matrices, laid out as in Scenario.
+ *
+ * Relationships start unset, and getting an unset relationship throws
+ * std::out_of_range, as for Belief. A matrix can be installed whole, from a
+ * dense array, from triplets, or in compressed sparse row form; the entries
+ * absent from a sparse matrix are 0.
+ */
+class BeliefNetwork {
+public:
+  /**
+   * A matrix of relationships.
+   */
+  enum class Relationship {
+    /** IBelief::beliefRelationship, [belief][belief]. */
+    belief,
+    /** IBelief::observedBehaviourRelationship, [belief][behaviour]. */
+    observed,
+    /** IBelief::performingBehaviourRelationship, [belief][behaviour]. */
+    performing
+  };
+
+  /**
+   * An entry of a sparse matrix.
+   */
+  class Triplet {
+  public:
+    index_t row;
+    index_t column;
+    double value;
+  };
+
+private:
+  /**
+   * The beliefs.
+   */
+  std::vector<std::unique_ptr<NetworkBelief>> beliefs;
+
+  /**
+   * The behaviours.
+   */
+  std::vector<const IBehaviour *> behaviours;
+
+  /**
+   * The index of the behaviours by UUID.
+   */
+  UuidIndex behaviourUuids;
+
+  /**
+   * The matrices, indexed by Relationship.
+   */
+  std::vector<double> matrices[3];
+
+  /**
+   * Gets a matrix.
+   *
+   * @param r The relationship.
+   * @return The matrix.
+   */
+  std::vector<double> &matrix(Relationship r);
+
+  /**
+   * The number of columns of a matrix.
+   *
+   * @param r The relationship.
+   * @return The number of columns.
+   */
+  size_t nColumns(Relationship r) const;
+
+public:
+  /**
+   * Creates a network, with every relationship unset.
+   *
+   * @param names The names of the beliefs to create.
+   * @param behaviours The behaviours, which must outlive the network.
+   * @exception std::invalid_argument If a behaviour is repeated.
+   */
+  BeliefNetwork(const std::vector<std::string> &names,
+                std::vector<const IBehaviour *> behaviours);
+
+  BeliefNetwork(const BeliefNetwork &) = delete;
+  BeliefNetwork &operator=(const BeliefNetwork &) = delete;
+
+  /**
+   * The number of beliefs.
+   *
+   * @return The number of beliefs.
+   */
+  size_t nBeliefs() const;
+
+  /**
+   * The number of behaviours.
+   *
+   * @return The number of behaviours.
+   */
+  size_t nBehaviours() const;
+
+  /**
+   * Gets a belief.
+   *
+   * @param i The index of the belief.
+   * @return The belief.
+   * @exception std::out_of_range If i is out of range.
+   */
+  NetworkBelief *belief(index_t i) const;
+
+  /**
+   * Gets the beliefs, in order of their index.
+   *
+   * @return The beliefs.
+   */
+  std::vector<IBelief *> getBeliefs() const;
+
+  /**
+   * Gets the index of a belief.
+   *
+   * @param b The belief.
+   * @return The index.
+   * @exception std::out_of_range If b is not in the network.
+   */
+  index_t beliefIndex(const IBelief *b) const;
+
+  /**
+   * Gets the index of a behaviour.
+   *
+   * @param beh The behaviour.
+   * @return The index.
+   * @exception std::out_of_range If beh is not in the network.
+   */
+  index_t behaviourIndex(const IBehaviour *beh) const;
+
+  /**
+   * Gets a relationship.
+   *
+   * @param r The relationship.
+   * @param row The index of the belief.
+   * @param column The index of the other belief, or of the behaviour.
+   * @return The value.
+   * @exception std::out_of_range If the relationship is not set.
+   */
+  double get(Relationship r, index_t row, index_t column) const;
+
+  /**
+   * Sets a relationship.
+   *
+   * @param r The relationship.
+   * @param row The index of the belief.
+   * @param column The index of the other belief, or of the behaviour.
+   * @param value The value.
+   * @exception std::out_of_range If row or column is out of range.
+   */
+  void set(Relationship r, index_t row, index_t column, double value);
+
+  /**
+   * Sets a whole matrix from a dense row-major array.
+   *
+   * @param r The relationship.
+   * @param values The values.
+   * @exception std::invalid_argument If values has the wrong size.
+   */
+  void setDense(Relationship r, const std::vector<double> &values);
+
+  /**
+   * Sets a whole matrix from triplets. Absent entries are 0; if an entry is
+   * repeated, the last value is kept.
+   *
+   * @param r The relationship.
+   * @param triplets The entries.
+   * @exception std::out_of_range If an entry is out of range.
+   */
+  void setTriplets(Relationship r, const std::vector<Triplet> &triplets);
+
+  /**
+   * Sets a whole matrix in compressed sparse row form: the entries of row i
+   * are columns[offsets[i]] to columns[offsets[i + 1] - 1], with the values
+   * in the same order. Absent entries are 0.
+   *
+   * @param r The relationship.
+   * @param offsets The offset of the first entry of each row, with a final
+   *   entry for the end.
+   * @param columns The columns.
+   * @param values The values.
+   * @exception std::invalid_argument If the arrays are inconsistent.
+   * @exception std::out_of_range If a column is out of range.
+   */
+  void setCsr(Relationship r, const std::vector<uint64_t> &offsets,
+              const std::vector<index_t> &columns,
+              const std::vector<double> &values);
+
+  /**
+   * Gets a whole matrix. Unset entries are NaN.
+   *
+   * @param r The relationship.
+   * @return The matrix.
+   */
+  const std::vector<double> &getMatrix(Relationship r) const;
+
+  /**
+   * Copies the relationships into a scenario with the same numbers of
+   * beliefs and behaviours.
+   *
+   * @param s The scenario.
+   * @exception std::invalid_argument If the numbers differ.
+   * @exception std::out_of_range If a relationship is not set.
+   */
+  void copyTo(Scenario &s) const;
+};
+} // namespace BIBS
+
+#endif // BIBS_BELIEFNETWORK_H
@@ -0,0 +1,238 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      bibs_c.h
+ * @brief     Header of bibs_c.cpp
+ * @date      Sun Oct 18 14:05:37 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains a C API for embedding the simulation. Its calls work
+ * on whole arrays, so that the cost of a call is amortised over many
+ * elements.
+ *
+ * Matrices are dense and row-major: belief relationships are
+ * [belief][belief], observed and performing relationships are
+ * [belief][behaviour], and time deltas and activations are
+ * [agent][belief]. Agents, beliefs and behaviours are numbered from 0.
+ *
+ * Every function other than the destructors and bibs_last_error returns a
+ * bibs_status. On failure, a message is available from bibs_last_error on
+ * the same thread.
+ */
+
+#ifndef BIBS_BIBS_C_H
+#define BIBS_BIBS_C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * The status of a call.
+ */
+typedef enum bibs_status {
+  /** The call succeeded. */
+  BIBS_OK = 0,
+  /** An argument was invalid, e.g. a null pointer or a wrong size. */
+  BIBS_INVALID_ARGUMENT = 1,
+  /** An index, agent or time was out of range. */
+  BIBS_OUT_OF_RANGE = 2,
+  /** Memory could not be allocated. */
+  BIBS_NO_MEMORY = 3,
+  /** Any other error. */
+  BIBS_ERROR = 4
+} bibs_status;
+
+/**
+ * A scenario: the relationships, time deltas and friendships of the agents.
+ */
+typedef struct bibs_scenario bibs_scenario;
+
+/**
+ * A simulation of a scenario.
+ */
+typedef struct bibs_simulation bibs_simulation;
+
+/**
+ * Gets the message of the last error on this thread.
+ *
+ * @return The message, or an empty string if there has been no error. It is
+ *   valid until the next call on this thread.
+ */
+const char *bibs_last_error(void);
+
+/**
+ * Creates a scenario.
+ *
+ * @param nAgents The number of agents.
+ * @param nBeliefs The number of beliefs.
+ * @param nBehaviours The number of behaviours.
+ * @param beliefRelationships The belief relationships, nBeliefs * nBeliefs,
+ *   or NULL for zeros.
+ * @param observedRelationships The observed relationships,
+ *   nBeliefs * nBehaviours, or NULL for zeros.
+ * @param performingRelationships The performing relationships,
+ *   nBeliefs * nBehaviours, or NULL for zeros.
+ * @param timeDeltas The time deltas, nAgents * nBeliefs, or NULL for zeros.
+ * @param out The scenario.
+ * @return The status.
+ */
+bibs_status bibs_scenario_create(uint32_t nAgents, uint32_t nBeliefs,
+                                 uint32_t nBehaviours,
+                                 const double *beliefRelationships,
+                                 const double *observedRelationships,
+                                 const double *performingRelationships,
+                                 const double *timeDeltas,
+                                 bibs_scenario **out);
+
+/**
+ * Sets the friendships of a scenario, replacing any already set. Edge e
+ * means that agent from[e] observes agent to[e] with weight weights[e].
+ *
+ * @param scenario The scenario.
+ * @param nEdges The number of edges.
+ * @param from The agents observing, nEdges.
+ * @param to The agents observed, nEdges.
+ * @param weights The weights, nEdges.
+ * @return The status.
+ */
+bibs_status bibs_scenario_set_edges(bibs_scenario *scenario, size_t nEdges,
+                                    const uint32_t *from, const uint32_t *to,
+                                    const double *weights);
+
+/**
+ * Sets the time deltas of a scenario.
+ *
+ * @param scenario The scenario.
+ * @param timeDeltas The time deltas, nAgents * nBeliefs.
+ * @return The status.
+ */
+bibs_status bibs_scenario_set_time_deltas(bibs_scenario *scenario,
+                                          const double *timeDeltas);
+
+/**
+ * Destroys a scenario. Simulations created from it are unaffected.
+ *
+ * @param scenario The scenario, or NULL.
+ */
+void bibs_scenario_destroy(bibs_scenario *scenario);
+
+/**
+ * Creates a simulation of a scenario at time 0. Later changes to the
+ * scenario do not affect the simulation.
+ *
+ * @param scenario The scenario.
+ * @param activations The activations at time 0, nAgents * nBeliefs.
+ * @param performed The behaviours performed at time 0, nAgents, or NULL for
+ *   them to be chosen.
+ * @param seed The seed.
+ * @param recordHistory Nonzero to keep every tick, zero to keep only the
+ *   latest.
+ * @param out The simulation.
+ * @return The status.
+ */
+bibs_status bibs_simulation_create(const bibs_scenario *scenario,
+                                   const double *activations,
+                                   const uint32_t *performed, uint64_t seed,
+                                   int recordHistory, bibs_simulation **out);
+
+/**
+ * Sets the number of threads used by a simulation.
+ *
+ * @param simulation The simulation.
+ * @param nThreads The number of threads, or 0 for the number of hardware
+ *   threads.
+ * @return The status.
+ */
+bibs_status bibs_simulation_set_threads(bibs_simulation *simulation,
+                                        size_t nThreads);
+
+/**
+ * Runs a simulation.
+ *
+ * @param simulation The simulation.
+ * @param nTicks The number of ticks to run.
+ * @return The status.
+ */
+bibs_status bibs_simulation_run(bibs_simulation *simulation, uint32_t nTicks);
+
+/**
+ * Gets the time of a simulation.
+ *
+ * @param simulation The simulation.
+ * @param out The time.
+ * @return The status.
+ */
+bibs_status bibs_simulation_time(const bibs_simulation *simulation,
+                                 uint32_t *out);
+
+/**
+ * Copies the activations at a tick.
+ *
+ * @param simulation The simulation.
+ * @param t The tick.
+ * @param out The activations, nAgents * nBeliefs.
+ * @param length The length of out.
+ * @return The status.
+ */
+bibs_status bibs_simulation_activations(const bibs_simulation *simulation,
+                                        uint32_t t, double *out,
+                                        size_t length);
+
+/**
+ * Copies the behaviours performed at a tick.
+ *
+ * @param simulation The simulation.
+ * @param t The tick.
+ * @param out The behaviours, nAgents.
+ * @param length The length of out.
+ * @return The status.
+ */
+bibs_status bibs_simulation_performed(const bibs_simulation *simulation,
+                                      uint32_t t, uint32_t *out,
+                                      size_t length);
+
+/**
+ * Copies the share of agents performing each behaviour at a tick.
+ *
+ * @param simulation The simulation.
+ * @param t The tick.
+ * @param out The shares, nBehaviours.
+ * @param length The length of out.
+ * @return The status.
+ */
+bibs_status bibs_simulation_behaviour_shares(const bibs_simulation *simulation,
+                                             uint32_t t, double *out,
+                                             size_t length);
+
+/**
+ * Destroys a simulation.
+ *
+ * @param simulation The simulation, or NULL.
+ */
+void bibs_simulation_destroy(bibs_simulation *simulation);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BIBS_BIBS_C_H
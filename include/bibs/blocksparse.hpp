@@ -0,0 +1,214 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      blocksparse.hpp
+ * @brief     Header of blocksparse.cpp
+ * @date      Sun Oct 18 20:31:55 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains sparse forms of the relationship matrices, and the
+ * kernels multiplying them by the activations of many agents at once.
+ *
+ * Belief spaces made of topical clusters give belief relationships which
+ * are block-diagonal with a few links between blocks. In block sparse row
+ * (BSR) form only the blocks with a non-zero entry are stored, each as a
+ * small dense matrix, so the kernel runs fixed-size dense loops and skips
+ * the empty blocks. The compressed sparse row (CSR) form stores single
+ * entries, and is kept as the scalar reference.
+ */
+
+#ifndef BIBS_BLOCKSPARSE_H
+#define BIBS_BLOCKSPARSE_H
+
+#include "bibs/scenario.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * A matrix in block sparse row form.
+ *
+ * The rows and columns are split into blocks of blockSize (the last padded
+ * with zeros). The blocks of block row i are values[blockOffsets[i] *
+ * blockSize^2] onwards, each column-major, in columns blockColumns[
+ * blockOffsets[i]] to blockColumns[blockOffsets[i + 1] - 1].
+ */
+class BlockSparseMatrix {
+private:
+  /**
+   * The number of rows.
+   */
+  size_t nRows;
+
+  /**
+   * The number of columns.
+   */
+  size_t nColumns;
+
+  /**
+   * The size of the blocks.
+   */
+  size_t blockSize;
+
+  /**
+   * The offset of the first block of each block row, with a final entry for
+   * the end.
+   */
+  std::vector<uint64_t> blockOffsets;
+
+  /**
+   * The block column of each block.
+   */
+  std::vector<index_t> blockColumns;
+
+  /**
+   * The entries of the blocks.
+   */
+  std::vector<double> values;
+
+public:
+  /**
+   * Creates a matrix from a dense one, keeping the blocks which have a
+   * non-zero entry.
+   *
+   * @param dense The matrix, row-major.
+   * @param nRows The number of rows.
+   * @param nColumns The number of columns.
+   * @param blockSize The size of the blocks.
+   * @exception std::invalid_argument If dense has the wrong size, or
+   *   blockSize is 0.
+   */
+  BlockSparseMatrix(const std::vector<double> &dense, size_t nRows,
+                    size_t nColumns, size_t blockSize);
+
+  /**
+   * The number of rows.
+   *
+   * @return The number of rows.
+   */
+  size_t getNRows() const;
+
+  /**
+   * The number of columns.
+   *
+   * @return The number of columns.
+   */
+  size_t getNColumns() const;
+
+  /**
+   * The size of the blocks.
+   *
+   * @return The size of the blocks.
+   */
+  size_t getBlockSize() const;
+
+  /**
+   * The number of blocks stored.
+   *
+   * @return The number of blocks.
+   */
+  size_t nBlocks() const;
+
+  /**
+   * Multiplies vectors by the matrix: y[v] = A x[v] for each vector v.
+   *
+   * @param x The vectors, each of nColumns, contiguous.
+   * @param y Set to the products, each of nRows, contiguous.
+   * @param nVectors The number of vectors.
+   */
+  void multiply(const double *x, double *y, size_t nVectors) const;
+};
+
+/**
+ * A matrix in compressed sparse row form.
+ */
+class CsrMatrix {
+private:
+  /**
+   * The number of rows.
+   */
+  size_t nRows;
+
+  /**
+   * The number of columns.
+   */
+  size_t nColumns;
+
+  /**
+   * The offset of the first entry of each row, with a final entry for the
+   * end.
+   */
+  std::vector<uint64_t> offsets;
+
+  /**
+   * The column of each entry.
+   */
+  std::vector<index_t> columns;
+
+  /**
+   * The value of each entry.
+   */
+  std::vector<double> values;
+
+public:
+  /**
+   * Creates a matrix from a dense one, keeping the non-zero entries.
+   *
+   * @param dense The matrix, row-major.
+   * @param nRows The number of rows.
+   * @param nColumns The number of columns.
+   * @exception std::invalid_argument If dense has the wrong size.
+   */
+  CsrMatrix(const std::vector<double> &dense, size_t nRows, size_t nColumns);
+
+  /**
+   * The number of entries stored.
+   *
+   * @return The number of entries.
+   */
+  size_t nNonZeros() const;
+
+  /**
+   * Multiplies vectors by the matrix: y[v] = A x[v] for each vector v.
+   *
+   * @param x The vectors, each of nColumns, contiguous.
+   * @param y Set to the products, each of nRows, contiguous.
+   * @param nVectors The number of vectors.
+   */
+  void multiply(const double *x, double *y, size_t nVectors) const;
+};
+
+/**
+ * Multiplies vectors by a dense matrix: y[v] = A x[v] for each vector v.
+ *
+ * @param a The matrix, row-major.
+ * @param nRows The number of rows.
+ * @param nColumns The number of columns.
+ * @param x The vectors, each of nColumns, contiguous.
+ * @param y Set to the products, each of nRows, contiguous.
+ * @param nVectors The number of vectors.
+ */
+void denseMultiply(const double *a, size_t nRows, size_t nColumns,
+                   const double *x, double *y, size_t nVectors);
+} // namespace BIBS
+
+#endif // BIBS_BLOCKSPARSE_H
@@ -0,0 +1,222 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      builder.hpp
+ * @brief     Header of builder.cpp
+ * @date      Sun Oct 18 23:20:52 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains ScenarioBuilder, which builds the per-agent parts of
+ * a scenario (time deltas, friends, activations and Agents) on many
+ * threads.
+ *
+ * Each agent is built by a function of its index and a random number
+ * generator of its own, and written to storage allocated beforehand, so the
+ * result is the same for any number of threads.
+ */
+
+#ifndef BIBS_BUILDER_H
+#define BIBS_BUILDER_H
+
+#include "bibs/agent.hpp"
+#include "bibs/belief.hpp"
+#include "bibs/digest.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * The random numbers of one agent: a SplitMix64 generator seeded from the
+ * seed of the builder, the step of the build and the agent.
+ *
+ * It meets the requirements of UniformRandomBitGenerator, so it can be
+ * used with the distributions of <random>.
+ */
+class AgentRandom {
+private:
+  /**
+   * The state.
+   */
+  uint64_t state;
+
+public:
+  typedef uint64_t result_type;
+
+  /**
+   * Create a new AgentRandom.
+   *
+   * @param seed The seed.
+   * @param step The step of the build.
+   * @param agent The agent.
+   */
+  AgentRandom(uint64_t seed, uint64_t step, index_t agent)
+      : state(mix64(mix64(mix64(seed) ^ step) ^ agent)) {}
+
+  static constexpr result_type min() { return 0; }
+
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  /**
+   * The next random number.
+   *
+   * @return The number.
+   */
+  result_type operator()() {
+    state += 0x9e3779b97f4a7c15ULL;
+    return mix64(state);
+  }
+
+  /**
+   * The next random number, uniform in [0, 1).
+   *
+   * @return The number.
+   */
+  double uniform() { return static_cast<double>((*this)() >> 11) * 0x1.0p-53; }
+};
+
+/**
+ * Builds the per-agent parts of a Scenario in parallel.
+ *
+ * The relationships, which do not depend on the number of agents, are set
+ * directly on getScenario. The functions given to the builder are called
+ * concurrently for different agents, so they must only write to their
+ * arguments.
+ */
+class ScenarioBuilder {
+public:
+  /**
+   * A function filling a row of values of an agent: fn(agent, random,
+   * values), where values has nBeliefs entries.
+   */
+  typedef std::function<void(index_t, AgentRandom &, double *)> RowFunction;
+
+  /**
+   * A function giving the friends of an agent: fn(agent, random, friends,
+   * weights), which appends to the empty friends and weights.
+   */
+  typedef std::function<void(index_t, AgentRandom &, std::vector<index_t> &,
+                             std::vector<double> &)>
+      FriendFunction;
+
+private:
+  /**
+   * The scenario being built.
+   */
+  Scenario scenario;
+
+  /**
+   * The seed of the random numbers of the agents.
+   */
+  uint64_t seed;
+
+  /**
+   * The threads to build on, or nullptr.
+   */
+  ThreadPool *threads;
+
+public:
+  /**
+   * Create a new ScenarioBuilder, with all relationships and time deltas 0,
+   * and no friends.
+   *
+   * @param nAgents The number of agents.
+   * @param nBeliefs The number of beliefs.
+   * @param nBehaviours The number of behaviours.
+   * @param seed The seed of the random numbers of the agents.
+   * @param threads The threads to build on, or nullptr to build on the
+   *   calling thread.
+   */
+  ScenarioBuilder(size_t nAgents, size_t nBeliefs, size_t nBehaviours,
+                  uint64_t seed = 0, ThreadPool *threads = nullptr);
+
+  /**
+   * Gets the scenario being built.
+   *
+   * @return The scenario.
+   */
+  Scenario &getScenario();
+
+  /**
+   * Sets the time deltas of every agent.
+   *
+   * @param fn The function filling the time deltas of an agent.
+   */
+  void setTimeDeltas(const RowFunction &fn);
+
+  /**
+   * Replaces the friendship graph. The friends of each agent keep the order
+   * in which fn gives them. If an exception is thrown, the graph is
+   * unchanged.
+   *
+   * @param fn The function giving the friends of an agent.
+   * @exception std::invalid_argument If fn gives different numbers of
+   *   friends and weights.
+   * @exception std::out_of_range If a friend is out of range.
+   */
+  void setFriends(const FriendFunction &fn);
+
+  /**
+   * Creates the activations of every agent.
+   *
+   * @param fn The function filling the activations of an agent.
+   * @return The activations, row-major [agent][belief].
+   */
+  std::vector<double> activations(const RowFunction &fn) const;
+
+  /**
+   * Finishes the scenario, leaving the builder with an empty scenario.
+   *
+   * @return The scenario.
+   * @exception std::invalid_argument If the scenario is inconsistent.
+   */
+  Scenario build();
+
+  /**
+   * Creates the Agents of a scenario, with activations at time 0, in
+   * parallel. Each Agent has a UUID drawn from the seed, its time deltas
+   * and its friends; repeated friends have their weights summed.
+   *
+   * @param scenario The scenario.
+   * @param activations The activations at time 0, row-major
+   *   [agent][belief].
+   * @param beliefs The beliefs.
+   * @param seed The seed of the UUIDs.
+   * @param threads The threads to build on, or nullptr.
+   * @return The agents.
+   * @exception std::invalid_argument If the activations or beliefs are the
+   *   wrong size.
+   */
+  static std::vector<std::unique_ptr<Agent>>
+  agents(const Scenario &scenario, const std::vector<double> &activations,
+         const std::vector<const IBelief *> &beliefs, uint64_t seed = 0,
+         ThreadPool *threads = nullptr);
+};
+} // namespace BIBS
+
+#endif // BIBS_BUILDER_H
@@ -0,0 +1,159 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      choice.hpp
+ * @brief     Header of choice.cpp
+ * @date      Sun Oct 18 19:47:31 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains the rules by which agents choose a behaviour from
+ * their utilities.
+ *
+ * A policy chooses for a chunk of agents at once, from a row-major matrix of
+ * utilities and one uniform random number per agent, so the inner loops run
+ * over contiguous memory and can be vectorised by the compiler.
+ */
+
+#ifndef BIBS_CHOICE_H
+#define BIBS_CHOICE_H
+
+#include "bibs/scenario.hpp"
+
+#include <cstddef>
+#include <memory>
+
+namespace BIBS {
+
+/**
+ * The interface for a rule choosing behaviours from utilities.
+ */
+class IChoicePolicy {
+public:
+  virtual ~IChoicePolicy() {}
+
+  /**
+   * Chooses a behaviour for each of a chunk of agents.
+   *
+   * @param utilities The utilities, row-major [agent][behaviour].
+   * @param uniforms A uniform random number in [0, 1) for each agent.
+   * @param n The number of agents.
+   * @param nBehaviours The number of behaviours, at least 1.
+   * @param chosen Set to the index of the behaviour chosen by each agent.
+   */
+  virtual void choose(const double *utilities, const double *uniforms,
+                      size_t n, size_t nBehaviours, index_t *chosen) const = 0;
+
+  /**
+   * Whether choosing for an agent with these utilities uses its uniform
+   * random number, so that a caller drawing numbers one agent at a time
+   * can skip the draw when it does not.
+   *
+   * @param utilities The utilities of the agent.
+   * @param nBehaviours The number of behaviours, at least 1.
+   * @return Whether the uniform is used; true unless overridden.
+   */
+  virtual bool needsUniform(const double *utilities,
+                            size_t nBehaviours) const;
+};
+
+/**
+ * The behaviour with the greatest utility; the first if there is a tie.
+ */
+class ArgmaxPolicy : public IChoicePolicy {
+public:
+  void choose(const double *utilities, const double *uniforms, size_t n,
+              size_t nBehaviours, index_t *chosen) const override;
+
+  bool needsUniform(const double *utilities,
+                    size_t nBehaviours) const override;
+};
+
+/**
+ * A behaviour with probability proportional to its utility, among those
+ * with positive utility. If at most one behaviour has positive utility, the
+ * behaviour with the greatest utility. This is the rule of Agent::perform.
+ */
+class ProportionalPolicy : public IChoicePolicy {
+public:
+  void choose(const double *utilities, const double *uniforms, size_t n,
+              size_t nBehaviours, index_t *chosen) const override;
+
+  /**
+   * Whether more than one behaviour has positive utility.
+   */
+  bool needsUniform(const double *utilities,
+                    size_t nBehaviours) const override;
+};
+
+/**
+ * A behaviour with probability proportional to exp(utility / temperature).
+ */
+class SoftmaxPolicy : public IChoicePolicy {
+private:
+  /**
+   * The temperature.
+   */
+  double temperature;
+
+public:
+  /**
+   * Creates a policy.
+   *
+   * @param temperature The temperature.
+   * @exception std::invalid_argument If temperature is not positive.
+   */
+  explicit SoftmaxPolicy(double temperature);
+
+  void choose(const double *utilities, const double *uniforms, size_t n,
+              size_t nBehaviours, index_t *chosen) const override;
+};
+
+/**
+ * A behaviour uniformly at random with probability epsilon, else the
+ * behaviour with the greatest utility.
+ */
+class EpsilonGreedyPolicy : public IChoicePolicy {
+private:
+  /**
+   * The probability of exploring.
+   */
+  double epsilon;
+
+public:
+  /**
+   * Creates a policy.
+   *
+   * @param epsilon The probability of choosing at random.
+   * @exception std::invalid_argument If epsilon is not in [0, 1].
+   */
+  explicit EpsilonGreedyPolicy(double epsilon);
+
+  void choose(const double *utilities, const double *uniforms, size_t n,
+              size_t nBehaviours, index_t *chosen) const override;
+};
+
+/**
+ * Gets the policy used when none is given: a ProportionalPolicy.
+ *
+ * @return The policy.
+ */
+std::shared_ptr<const IChoicePolicy> defaultChoicePolicy();
+} // namespace BIBS
+
+#endif // BIBS_CHOICE_H
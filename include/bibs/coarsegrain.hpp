@@ -0,0 +1,315 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      coarsegrain.hpp
+ * @brief     Header of coarsegrain.cpp
+ * @date      Sun Oct 18 10:02:17 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains the coarse-graining of communities of agents into
+ * super-agents, which are simulated using a MeanFieldSimulation, and the
+ * refinement of communities back into individual agents.
+ */
+
+#ifndef BIBS_COARSEGRAIN_H
+#define BIBS_COARSEGRAIN_H
+
+#include "bibs/agent.hpp"
+#include "bibs/behaviour.hpp"
+#include "bibs/belief.hpp"
+#include "bibs/bibs.hpp"
+#include "bibs/meanfield.hpp"
+#include "bibs/simulation.hpp"
+
+#include <boost/uuid/uuid.hpp>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * Detects densely connected communities of agents by (weighted) label
+ * propagation.
+ *
+ * Friendships are treated as undirected, with the absolute value of the
+ * friend weight. Friends which are not in agents are ignored. The result is
+ * deterministic.
+ *
+ * @param agents The agents.
+ * @param maxIterations The maximum number of passes over the agents.
+ * @return The community of each agent, numbered from 0 in order of first
+ *   appearance.
+ */
+std::vector<size_t> detectCommunities(const std::vector<const Agent *> &agents,
+                                      size_t maxIterations = 20);
+
+/**
+ * An agent of a refined community in a CoarseGrainedSimulation.
+ *
+ * The agent observes its refined friends individually, and the friends in
+ * communities which are not refined through the behaviour shares of their
+ * super-agents.
+ */
+class RefinedAgent : public Agent {
+protected:
+  /**
+   * The mean-field simulation of the super-agents.
+   */
+  const MeanFieldSimulation *meanField;
+
+  /**
+   * The time of the mean-field simulation's time 0.
+   */
+  sim_time_t t0;
+
+  /**
+   * The total friend weight given to the agents in each community which are
+   * not observed individually.
+   */
+  std::vector<double> communityWeights;
+
+  /**
+   * Calculates and returns the value of observing behaviour relevant to belief
+   * b at time t.
+   *
+   * This is Agent::observed plus the expected value of observing the
+   * super-agents, weighted by the community weights.
+   *
+   * @param b The belief.
+   * @param t The time.
+   * @return The value of observing relevant behaviour.
+   */
+  double observed(const IBelief *b, const sim_time_t t) const override;
+
+public:
+  /**
+   * Create a new RefinedAgent.
+   *
+   * @param uuid The UUID of the agent.
+   * @param activationMap The activation from time -> (belief -> activation).
+   * @param meanField The mean-field simulation of the super-agents.
+   * @param t0 The time of the mean-field simulation's time 0.
+   */
+  RefinedAgent(const boost::uuids::uuid uuid,
+               const std::map<sim_time_t, std::map<const IBelief *, double>>
+                   activationMap,
+               const MeanFieldSimulation *meanField, sim_time_t t0);
+
+  /**
+   * Gets the total friend weight given to the agents in community c which are
+   * not observed individually.
+   *
+   * @param c The community.
+   * @return The weight.
+   */
+  double communityWeight(size_t c) const;
+
+  /**
+   * Sets the total friend weight given to the agents in community c which are
+   * not observed individually.
+   *
+   * @param c The community.
+   * @param w The weight.
+   */
+  void setCommunityWeight(size_t c, double w);
+};
+
+/**
+ * A simulation in which communities of agents are collapsed into super-agents.
+ *
+ * Each community becomes a cohort of a MeanFieldSimulation, carrying the mean
+ * and variance of its members' activations, the mean of their time deltas,
+ * and the mean total friend weight they give to each other community. The
+ * cost of a tick therefore scales with the number of communities.
+ *
+ * Communities of interest can be refined back into individual agents (as
+ * RefinedAgent) at any time, after which they are simulated with the same
+ * update equations as Agent.
+ */
+class CoarseGrainedSimulation : public ISimulation {
+protected:
+  /**
+   * The original agents.
+   */
+  std::vector<const Agent *> agents;
+
+  /**
+   * The beliefs in the simulation.
+   */
+  std::vector<const IBelief *> beliefs;
+
+  /**
+   * The behaviours in the simulation.
+   */
+  std::vector<const IBehaviour *> behaviours;
+
+  /**
+   * The community of each agent.
+   */
+  std::vector<size_t> communities;
+
+  /**
+   * The indices of the agents in each community.
+   */
+  std::vector<std::vector<size_t>> members;
+
+  /**
+   * Map from original agent to its index in agents.
+   */
+  std::map<const IAgent *, size_t> agentIndex;
+
+  /**
+   * The time at which the agents were coarse-grained.
+   */
+  sim_time_t t0;
+
+  /**
+   * The simulation of the super-agents.
+   */
+  MeanFieldSimulation meanField;
+
+  /**
+   * The refined agent for each agent, or nullptr if it is not refined.
+   */
+  std::vector<std::unique_ptr<RefinedAgent>> refined;
+
+  /**
+   * Whether each community is refined.
+   */
+  std::vector<bool> refinedCommunities;
+
+  /**
+   * Random number generator, used to sample the activations of agents
+   * refined after t0.
+   */
+  std::mt19937_64 eng;
+
+  /**
+   * Sets the shares of the super-agent of a refined community at time t from
+   * its refined agents.
+   *
+   * @param t The time.
+   * @param c The community.
+   */
+  void updateRefinedShares(sim_time_t t, size_t c);
+
+public:
+  /**
+   * Create a new coarse-grained simulation.
+   *
+   * @param agents The agents.
+   * @param beliefs The beliefs.
+   * @param behaviours The behaviours.
+   * @param communities The community of each agent (e.g. from
+   *   detectCommunities), numbered from 0.
+   * @param t0 The time at which to take the activations of the agents.
+   * @param nQuadrature The number of quadrature samples per community per
+   *   tick used for the choice rule.
+   * @param seed The seed of the simulation.
+   * @exception std::invalid_argument If communities is not the same size as
+   *   agents.
+   * @exception std::out_of_range If an agent has no activation or time delta
+   *   for a belief, or a relationship is not defined.
+   */
+  CoarseGrainedSimulation(std::vector<const Agent *> agents,
+                          std::vector<const IBelief *> beliefs,
+                          std::vector<const IBehaviour *> behaviours,
+                          std::vector<size_t> communities, sim_time_t t0 = 0,
+                          size_t nQuadrature = 64, unsigned seed = 0);
+
+  /**
+   * The number of communities.
+   *
+   * @return The number of communities.
+   */
+  size_t nCommunities() const;
+
+  /**
+   * The latest time simulated.
+   *
+   * @return The time.
+   */
+  sim_time_t time() const;
+
+  /**
+   * Gets the simulation of the super-agents.
+   *
+   * Its time 0 is t0 of this simulation.
+   *
+   * @return The mean-field simulation.
+   */
+  const MeanFieldSimulation &getMeanField() const;
+
+  /**
+   * Gets the share of the agents in a community performing a behaviour at a
+   * time.
+   *
+   * @param t The time.
+   * @param c The community.
+   * @param b The behaviour.
+   * @return The share.
+   * @exception std::out_of_range If the time, community or behaviour is not
+   *   found.
+   */
+  double behaviourShare(sim_time_t t, size_t c, const IBehaviour *b) const;
+
+  /**
+   * Refines a community back into individual agents, from the latest time
+   * simulated.
+   *
+   * If this is t0, the agents start with their original activations.
+   * Otherwise, their activations are sampled from the distribution of the
+   * community's super-agent.
+   *
+   * @param c The community.
+   * @exception std::out_of_range If the community is not found.
+   */
+  void refine(size_t c);
+
+  /**
+   * Whether a community has been refined.
+   *
+   * @param c The community.
+   * @return Whether the community has been refined.
+   * @exception std::out_of_range If the community is not found.
+   */
+  bool isRefined(size_t c) const;
+
+  /**
+   * Gets the refined agent of an original agent.
+   *
+   * @param a The original agent.
+   * @return The refined agent.
+   * @exception std::out_of_range If the agent is not found, or not refined.
+   */
+  const RefinedAgent *refinedAgent(const Agent *a) const;
+
+  /**
+   * Run the simulation for n days, from the latest time simulated.
+   *
+   * @param nDays the number of days.
+   */
+  void run(sim_time_t nDays) override;
+};
+} // namespace BIBS
+
+#endif // BIBS_COARSEGRAIN_H
@@ -0,0 +1,111 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      digest.hpp
+ * @brief     Header of digest.cpp
+ * @date      Sun Oct 18 15:37:04 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains digests of the state of a simulation, to check
+ * cheaply that two engines agree.
+ *
+ * The digest of an agent mixes its index, the behaviour it performed and its
+ * activations, each rounded to a multiple of a quantum, so that rounding
+ * differences between engines are unlikely to change it. They still can, if
+ * an activation lies close to the boundary between two multiples, so a
+ * digest mismatch is a reason to look closer, not proof that an engine is
+ * wrong. The digest of a state is the sum (mod 2^64) of the digests of its
+ * agents, so it can be computed in any order and in parallel.
+ */
+
+#ifndef BIBS_DIGEST_H
+#define BIBS_DIGEST_H
+
+#include "bibs/scenario.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace BIBS {
+/**
+ * The default quantum to which activations are rounded in digests.
+ */
+constexpr double digestQuantum = 0x1.0p-32;
+
+/**
+ * The finaliser of SplitMix64.
+ *
+ * @param x The value to mix.
+ * @return The mixed value.
+ */
+inline uint64_t mix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/**
+ * Gets the digest of an agent.
+ *
+ * @param agent The index of the agent.
+ * @param performed The index of the behaviour it performed.
+ * @param activations Its activations, nBeliefs.
+ * @param nBeliefs The number of beliefs.
+ * @param quantum The quantum to which activations are rounded.
+ * @return The digest.
+ */
+uint64_t agentDigest(index_t agent, index_t performed,
+                     const double *activations, size_t nBeliefs,
+                     double quantum = digestQuantum);
+
+/**
+ * Gets the digest of agents [begin, end) of a state.
+ *
+ * @param activations The activations, row-major [agent][belief].
+ * @param performed The index of the behaviour performed by each agent.
+ * @param nBeliefs The number of beliefs.
+ * @param begin The first agent.
+ * @param end One past the last agent.
+ * @param quantum The quantum to which activations are rounded.
+ * @return The sum of the digests of the agents.
+ */
+uint64_t stateDigest(const std::vector<double> &activations,
+                     const std::vector<index_t> &performed, size_t nBeliefs,
+                     size_t begin, size_t end,
+                     double quantum = digestQuantum);
+
+/**
+ * Gets the digest of each agent of a state.
+ *
+ * @param activations The activations, row-major [agent][belief].
+ * @param performed The index of the behaviour performed by each agent.
+ * @param nBeliefs The number of beliefs.
+ * @param quantum The quantum to which activations are rounded.
+ * @return The digest of each agent.
+ * @exception std::invalid_argument If the sizes do not match.
+ */
+std::vector<uint64_t> agentDigests(const std::vector<double> &activations,
+                                   const std::vector<index_t> &performed,
+                                   size_t nBeliefs,
+                                   double quantum = digestQuantum);
+} // namespace BIBS
+
+#endif // BIBS_DIGEST_H
@@ -0,0 +1,402 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      ensemble.hpp
+ * @brief     Header of ensemble.cpp
+ * @date      Mon Oct 19 09:12:37 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains Ensemble, which runs replicates of one or more
+ * scenarios and summarises metrics of them, with two ways of reducing the
+ * variance of the summaries: common random numbers across the scenarios,
+ * and antithetic pairs of replicates. The replicates can be run in waves
+ * until the confidence intervals of the chosen metrics are narrow enough.
+ */
+
+#ifndef BIBS_ENSEMBLE_H
+#define BIBS_ENSEMBLE_H
+
+#include "bibs/bibs.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/vectorised.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * A summary of an estimate from an Ensemble.
+ */
+struct EnsembleSummary {
+  /**
+   * The number of replicates.
+   */
+  size_t nReplicates = 0;
+
+  /**
+   * The number of replicates in each independent unit: 2 for antithetic
+   * pairs, otherwise 1.
+   */
+  size_t unitSize = 1;
+
+  /**
+   * The estimate.
+   */
+  double mean = 0.0;
+
+  /**
+   * The standard error of the estimate.
+   */
+  double standardError = 0.0;
+
+  /**
+   * The number of independent replicates which would give the same standard
+   * error. It is larger than nReplicates if the variance reduction works.
+   */
+  double effectiveSampleSize = 0.0;
+
+  /**
+   * The half-width of the normal confidence interval.
+   *
+   * @param z The quantile of the standard normal, e.g. 1.96 for 95%.
+   * @return z times the standard error.
+   */
+  double halfWidth(double z = 1.96) const;
+
+  /**
+   * The number of replicates, sampled in the same way, needed for a
+   * confidence interval of the given half-width.
+   *
+   * @param target The half-width wanted.
+   * @param z The quantile of the standard normal.
+   * @return The number of replicates, a multiple of unitSize, which may be
+   *   fewer than nReplicates.
+   * @exception std::invalid_argument If the target is not positive.
+   */
+  size_t replicatesFor(double target, double z = 1.96) const;
+};
+
+/**
+ * A target half-width of the confidence interval of the mean of a metric
+ * of an arm, for Ensemble::runUntil.
+ */
+struct EnsembleTarget {
+  /**
+   * The arm.
+   */
+  size_t arm = 0;
+
+  /**
+   * The metric.
+   */
+  size_t metric = 0;
+
+  /**
+   * The half-width wanted.
+   */
+  double halfWidth = 0.0;
+};
+
+/**
+ * Replicates of one or more scenarios ("arms"), which differ only in the
+ * random numbers used to choose behaviours, and metrics of each.
+ *
+ * Each replicate is a copy of a simulation of its arm at time 0 with a
+ * stream of its own, so the replicates of an arm share the state at time 0
+ * and diverge from time 1. Replicate r of an arm depends only on the seed,
+ * the sampling and r, so the results are the same for any number of
+ * threads and the replicates can be added in any number of calls to run.
+ *
+ * With common random numbers, replicate r of every arm uses the same
+ * stream, so a difference between arms is not swamped by the noise of
+ * sampling behaviours. With antithetic sampling, replicates 2m and 2m + 1
+ * use the same stream and the second uses 1 - u for each uniform u.
+ */
+class Ensemble {
+public:
+  /**
+   * Accumulates a metric of one replicate as it runs, since the replicates
+   * keep only their latest frame.
+   */
+  class Accumulator {
+  public:
+    virtual ~Accumulator() {}
+
+    /**
+     * Observes the replicate at time 0 and after each tick.
+     *
+     * @param sim The replicate.
+     */
+    virtual void observe(const VectorisedSimulation &sim) {}
+
+    /**
+     * Gets the value of the metric at the end of the run.
+     *
+     * @param sim The replicate.
+     * @return The value.
+     */
+    virtual double finish(const VectorisedSimulation &sim) = 0;
+  };
+
+  /**
+   * A metric, which makes a new accumulator for each replicate. It is
+   * called from many threads at once.
+   */
+  typedef std::function<std::unique_ptr<Accumulator>()> Metric;
+
+  /**
+   * How the replicates of an arm are sampled.
+   */
+  enum class Sampling {
+    /**
+     * Each replicate has a stream of its own.
+     */
+    independent,
+
+    /**
+     * The replicates are antithetic pairs.
+     */
+    antithetic
+  };
+
+private:
+  /**
+   * The simulation of each arm at time 0.
+   */
+  std::vector<VectorisedSimulation> origins;
+
+  /**
+   * The metrics.
+   */
+  std::vector<Metric> metrics;
+
+  /**
+   * The number of days each replicate is run for.
+   */
+  sim_time_t nDays;
+
+  /**
+   * How the replicates are sampled.
+   */
+  Sampling sampling;
+
+  /**
+   * Whether replicate r of every arm uses the same stream.
+   */
+  bool commonRandomNumbers;
+
+  /**
+   * The threads to run the replicates on, or nullptr.
+   */
+  ThreadPool *threads;
+
+  /**
+   * The metrics of each replicate, [arm][metric][replicate].
+   */
+  std::vector<std::vector<std::vector<double>>> values;
+
+  /**
+   * The number of replicates in each independent unit: 2 for antithetic
+   * pairs, otherwise 1.
+   */
+  size_t unitSize() const;
+
+  /**
+   * Summarises paired values (one per replicate) of a metric of the arms,
+   * given the coefficient of each arm.
+   *
+   * @param coefficients The coefficient of each arm.
+   * @param metric The metric.
+   * @return The summary of the linear combination.
+   */
+  EnsembleSummary combine(const std::vector<double> &coefficients,
+                          size_t metric) const;
+
+public:
+  /**
+   * Create a new Ensemble, with no replicates.
+   *
+   * @param scenarios The scenario of each arm, which must have the same
+   *   numbers of agents, behaviours and beliefs.
+   * @param activations The activations at time 0, row-major
+   *   [agent][belief], for every arm.
+   * @param metrics The metrics.
+   * @param nDays The number of days each replicate is run for.
+   * @param seed The seed.
+   * @param sampling How the replicates are sampled.
+   * @param commonRandomNumbers Whether replicate r of every arm uses the
+   *   same stream.
+   * @param threads The threads to run the replicates on, or nullptr.
+   * @exception std::invalid_argument If there are no arms, or the arms do
+   *   not match, or there are no metrics.
+   */
+  Ensemble(const std::vector<std::shared_ptr<const Scenario>> &scenarios,
+           const std::vector<double> &activations, std::vector<Metric> metrics,
+           sim_time_t nDays, uint64_t seed = 0,
+           Sampling sampling = Sampling::independent,
+           bool commonRandomNumbers = true, ThreadPool *threads = nullptr);
+
+  /**
+   * Create a new Ensemble of one metric, with no replicates.
+   *
+   * @see Ensemble(const std::vector<std::shared_ptr<const Scenario>> &,
+   *   const std::vector<double> &, std::vector<Metric>, sim_time_t,
+   *   uint64_t, Sampling, bool, ThreadPool *)
+   */
+  Ensemble(const std::vector<std::shared_ptr<const Scenario>> &scenarios,
+           const std::vector<double> &activations, Metric metric,
+           sim_time_t nDays, uint64_t seed = 0,
+           Sampling sampling = Sampling::independent,
+           bool commonRandomNumbers = true, ThreadPool *threads = nullptr);
+
+  /**
+   * A metric of the state of a replicate at the end of its run only.
+   *
+   * @param f The metric of the replicate, which is called from many threads
+   *   at once.
+   * @return The metric.
+   */
+  static Metric atEnd(std::function<double(const VectorisedSimulation &)> f);
+
+  /**
+   * The share of agents performing a behaviour at the end of the run.
+   *
+   * @param k The behaviour.
+   * @return The metric.
+   */
+  static Metric finalShare(index_t k);
+
+  /**
+   * The first time at which the share of agents performing a behaviour is
+   * greatest.
+   *
+   * @param k The behaviour.
+   * @return The metric.
+   */
+  static Metric peakTime(index_t k);
+
+  /**
+   * Runs more replicates of every arm.
+   *
+   * @param nReplicates The number of replicates to add.
+   * @exception std::invalid_argument If the sampling is antithetic and
+   *   nReplicates is odd.
+   */
+  void run(size_t nReplicates);
+
+  /**
+   * Runs replicates in waves until the confidence interval of every target
+   * is narrow enough, or there are maxReplicates.
+   *
+   * Each wave is a multiple of waveSize, large enough for the targets if
+   * the standard errors so far are right, but no larger than the
+   * replicates already run, so that a poor early estimate does not
+   * overshoot by much.
+   *
+   * @param targets The targets.
+   * @param waveSize The smallest wave, e.g. the number of threads. It is
+   *   rounded up to a multiple of 2 for antithetic sampling.
+   * @param maxReplicates The most replicates to run in all.
+   * @param z The quantile of the standard normal, e.g. 1.96 for 95%.
+   * @return Whether every target is met.
+   * @exception std::invalid_argument If there are no targets, a target is
+   *   not positive, or waveSize is 0.
+   * @exception std::out_of_range If the arm or metric of a target is not
+   *   found.
+   */
+  bool runUntil(const std::vector<EnsembleTarget> &targets, size_t waveSize,
+                size_t maxReplicates = std::numeric_limits<size_t>::max(),
+                double z = 1.96);
+
+  /**
+   * Whether the confidence interval of every target is narrow enough.
+   *
+   * @param targets The targets.
+   * @param z The quantile of the standard normal.
+   * @return Whether every target is met.
+   * @exception std::out_of_range If the arm or metric of a target is not
+   *   found.
+   */
+  bool met(const std::vector<EnsembleTarget> &targets,
+           double z = 1.96) const;
+
+  /**
+   * The number of arms.
+   *
+   * @return The number of arms.
+   */
+  size_t nArms() const;
+
+  /**
+   * The number of metrics.
+   *
+   * @return The number of metrics.
+   */
+  size_t nMetrics() const;
+
+  /**
+   * The number of replicates of each arm.
+   *
+   * @return The number of replicates.
+   */
+  size_t nReplicates() const;
+
+  /**
+   * Gets a metric of each replicate of an arm.
+   *
+   * @param arm The arm.
+   * @param metric The metric.
+   * @return The values, in order of replicate.
+   * @exception std::out_of_range If the arm or metric is not found.
+   */
+  const std::vector<double> &getValues(size_t arm, size_t metric = 0) const;
+
+  /**
+   * Summarises the mean of a metric of an arm.
+   *
+   * @param arm The arm.
+   * @param metric The metric.
+   * @return The summary.
+   * @exception std::out_of_range If the arm or metric is not found.
+   */
+  EnsembleSummary summary(size_t arm, size_t metric = 0) const;
+
+  /**
+   * Summarises the difference between the means of a metric of two arms.
+   * The effective sample size is relative to independent replicates of the
+   * two arms.
+   *
+   * @param a The first arm.
+   * @param b The second arm, which is subtracted.
+   * @param metric The metric.
+   * @return The summary.
+   * @exception std::out_of_range If an arm or the metric is not found.
+   */
+  EnsembleSummary difference(size_t a, size_t b, size_t metric = 0) const;
+};
+
+} // namespace BIBS
+
+#endif
@@ -0,0 +1,198 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      exogenous.hpp
+ * @brief     Header of exogenous.cpp
+ * @date      Sun Oct 18 22:10:37 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains ExogenousInput, external per-tick signals (news
+ * intensity, prices, weather) added to the utilities of the behaviours
+ * they affect, read from a memory-mapped file so that long series need not
+ * fit in memory.
+ *
+ * The file starts with a header (the 8 bytes "BIBSEXOG", then the version,
+ * the number of columns and the number of ticks as little-endian uint32,
+ * uint32 and uint64), followed by the behaviour affected by each column as
+ * uint32, padded with zeros to a multiple of 8 bytes, and then the values
+ * as doubles, row-major [tick][column].
+ */
+
+#ifndef BIBS_EXOGENOUS_H
+#define BIBS_EXOGENOUS_H
+
+#include "bibs/bibs.hpp"
+#include "bibs/mapping.hpp"
+#include "bibs/scenario.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * A tick-indexed series of vectors, each added to the utilities of a set of
+ * behaviours, read from a memory-mapped file.
+ *
+ * The value of column c at time t is added to the utility of behaviour
+ * getBehaviours()[c] for every agent. The mapping is read sequentially, and
+ * prefetch asks the kernel to read a few ticks ahead of the simulation.
+ */
+class ExogenousInput {
+public:
+  /**
+   * The default number of ticks read ahead.
+   */
+  static constexpr size_t defaultLookahead = 4;
+
+private:
+  /**
+   * The file.
+   */
+  ReadOnlyMapping mapping;
+
+  /**
+   * The number of ticks.
+   */
+  size_t nTicks = 0;
+
+  /**
+   * The behaviour affected by each column.
+   */
+  std::vector<index_t> behaviours;
+
+  /**
+   * The column of each behaviour up to the largest affected, or nColumns()
+   * if it is not affected.
+   */
+  std::vector<size_t> columns;
+
+  /**
+   * The values, row-major [tick][column], within the mapping.
+   */
+  const double *values = nullptr;
+
+  /**
+   * The number of ticks read ahead.
+   */
+  size_t lookahead;
+
+  /**
+   * The size of a page.
+   */
+  size_t pageSize;
+
+public:
+  /**
+   * Maps an exogenous input file.
+   *
+   * @param path The path of the file.
+   * @param lookahead The number of ticks after the current one to prefetch.
+   * @exception std::system_error If the file cannot be opened or mapped.
+   * @exception std::runtime_error If the file is not an exogenous input
+   *   file, is of an unknown version, is truncated, or affects a behaviour
+   *   twice.
+   */
+  explicit ExogenousInput(const std::string &path,
+                          size_t lookahead = defaultLookahead);
+
+  ExogenousInput(const ExogenousInput &) = delete;
+
+  ExogenousInput &operator=(const ExogenousInput &) = delete;
+
+  /**
+   * Writes an exogenous input file.
+   *
+   * @param path The path of the file.
+   * @param behaviours The behaviour affected by each column.
+   * @param values The values, row-major [tick][column].
+   * @exception std::invalid_argument If the values are not a whole number of
+   *   ticks, or a behaviour is affected twice.
+   * @exception std::system_error If the file cannot be written.
+   */
+  static void write(const std::string &path,
+                    const std::vector<index_t> &behaviours,
+                    const std::vector<double> &values);
+
+  /**
+   * Gets the number of ticks.
+   *
+   * @return The number of ticks.
+   */
+  size_t getNTicks() const;
+
+  /**
+   * The number of columns.
+   *
+   * @return The number of columns.
+   */
+  size_t nColumns() const;
+
+  /**
+   * Gets the behaviour affected by each column.
+   *
+   * @return The behaviours.
+   */
+  const std::vector<index_t> &getBehaviours() const;
+
+  /**
+   * Gets the values at a time.
+   *
+   * @param t The time.
+   * @return The nColumns() values at time t, valid while this is.
+   * @exception std::out_of_range If there is no tick t.
+   */
+  const double *row(sim_time_t t) const;
+
+  /**
+   * Gets the value added to the utility of a behaviour at a time.
+   *
+   * @param t The time.
+   * @param behaviour The behaviour.
+   * @return The value, or 0 if the behaviour is not affected.
+   * @exception std::out_of_range If there is no tick t.
+   */
+  double impetus(sim_time_t t, index_t behaviour) const;
+
+  /**
+   * Asks the kernel to read ticks t to t + lookahead into memory, without
+   * waiting for them.
+   *
+   * @param t The time.
+   */
+  void prefetch(sim_time_t t) const;
+
+  /**
+   * Adds the values at a time to the utilities of n agents.
+   *
+   * @param t The time.
+   * @param utilities The utilities, row-major [agent][behaviour].
+   * @param n The number of agents.
+   * @param nBehaviours The number of behaviours.
+   * @exception std::out_of_range If there is no tick t, or a behaviour is
+   *   not less than nBehaviours.
+   */
+  void apply(sim_time_t t, double *utilities, size_t n,
+             size_t nBehaviours) const;
+};
+} // namespace BIBS
+
+#endif // BIBS_EXOGENOUS_H
@@ -0,0 +1,510 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      fileoutput.hpp
+ * @brief     Header of fileoutput.cpp
+ * @date      Sun Oct 18 18:12:40 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains a history sink writing to a file through
+ * asynchronous backends: io_uring, with a fixed set of registered buffers,
+ * or a thread calling pwrite when io_uring is not available.
+ *
+ * The file starts with a header (the 8 bytes "BIBSHIST", then the version,
+ * the number of beliefs and the number of agents as little-endian uint32,
+ * uint32 and uint64), followed by a record per tick: the tick as uint32, 4
+ * bytes of padding, the activations as doubles, row-major [agent][belief],
+ * and the performed behaviours as uint32.
+ */
+
+#ifndef BIBS_FILEOUTPUT_H
+#define BIBS_FILEOUTPUT_H
+
+#include "bibs/bibs.hpp"
+#include "bibs/output.hpp"
+#include "bibs/scenario.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * An asynchronous writer of large, aligned buffers to a file.
+ *
+ * The backend owns a fixed set of buffers, aligned for O_DIRECT. A buffer is
+ * acquired, filled, and submitted; it is free again once written.
+ */
+class IWriteBackend {
+public:
+  /**
+   * The alignment of buffers, offsets and lengths for O_DIRECT.
+   */
+  static constexpr size_t alignment = 4096;
+
+  virtual ~IWriteBackend() {}
+
+  /**
+   * The name of the backend.
+   *
+   * @return The name.
+   */
+  virtual const char *name() const = 0;
+
+  /**
+   * The size of each buffer.
+   *
+   * @return The size in bytes.
+   */
+  virtual size_t bufferSize() const = 0;
+
+  /**
+   * Gets a free buffer, waiting for a write to finish if there is none.
+   *
+   * @return The buffer.
+   * @exception std::system_error If a write failed.
+   */
+  virtual char *acquire() = 0;
+
+  /**
+   * Submits a write of an acquired buffer, without waiting for it.
+   *
+   * @param buffer The buffer.
+   * @param length The number of bytes to write.
+   * @param offset The offset in the file.
+   */
+  virtual void submit(char *buffer, size_t length, uint64_t offset) = 0;
+
+  /**
+   * Waits for every submitted write to finish.
+   *
+   * @exception std::system_error If a write failed.
+   */
+  virtual void wait() = 0;
+};
+
+/**
+ * The aligned buffers of a backend.
+ */
+class AlignedBuffers {
+private:
+  /**
+   * The memory of the buffers, contiguous.
+   */
+  std::unique_ptr<char, void (*)(void *)> memory;
+
+public:
+  /**
+   * The size of each buffer.
+   */
+  const size_t size;
+
+  /**
+   * The number of buffers.
+   */
+  const size_t count;
+
+  /**
+   * Allocates buffers.
+   *
+   * @param count The number of buffers.
+   * @param size The size of each buffer, rounded up to the alignment.
+   * @exception std::invalid_argument If count or size is 0.
+   */
+  AlignedBuffers(size_t count, size_t size);
+
+  /**
+   * Gets a buffer.
+   *
+   * @param i The index of the buffer.
+   * @return The buffer.
+   */
+  char *get(size_t i) const;
+
+  /**
+   * Gets the index of a buffer.
+   *
+   * @param buffer The buffer.
+   * @return The index.
+   */
+  size_t indexOf(const char *buffer) const;
+};
+
+/**
+ * A backend submitting writes through io_uring, with its buffers registered
+ * with the kernel if it allows.
+ */
+class IoUringBackend : public IWriteBackend {
+private:
+  class Ring;
+
+  /**
+   * The ring.
+   */
+  std::unique_ptr<Ring> ring;
+
+  /**
+   * The buffers.
+   */
+  AlignedBuffers buffers;
+
+  /**
+   * The file.
+   */
+  int fd;
+
+  /**
+   * The buffers which are free.
+   */
+  std::vector<size_t> free;
+
+  /**
+   * The number of writes in flight.
+   */
+  size_t inFlight = 0;
+
+  /**
+   * The first error.
+   */
+  int error = 0;
+
+  /**
+   * The write of each buffer: what is left to write, and where.
+   */
+  struct Write {
+    size_t done;
+    size_t length;
+    uint64_t offset;
+  };
+  std::vector<Write> writes;
+
+  /**
+   * Queues the rest of the write of a buffer.
+   *
+   * @param i The index of the buffer.
+   */
+  void queue(size_t i);
+
+  /**
+   * Handles the completed writes, waiting for at least one if asked.
+   *
+   * @param wait Whether to wait.
+   */
+  void reap(bool wait);
+
+  /**
+   * Throws the first error, if any.
+   */
+  void check() const;
+
+public:
+  /**
+   * Creates a backend.
+   *
+   * @param fd The file, which must outlive the backend.
+   * @param nBuffers The number of buffers.
+   * @param bufferSize The size of each buffer.
+   * @exception std::system_error If io_uring cannot be set up.
+   */
+  IoUringBackend(int fd, size_t nBuffers, size_t bufferSize);
+
+  ~IoUringBackend();
+
+  IoUringBackend(const IoUringBackend &) = delete;
+  IoUringBackend &operator=(const IoUringBackend &) = delete;
+
+  /**
+   * Whether the buffers are registered with the kernel.
+   *
+   * @return Whether they are.
+   */
+  bool registered() const;
+
+  /**
+   * Whether io_uring can be used on this system: whether rings can be set
+   * up and the kernel supports IORING_OP_WRITE, which it reports through
+   * IORING_REGISTER_PROBE.
+   *
+   * @return Whether it can.
+   */
+  static bool available();
+
+  const char *name() const override;
+  size_t bufferSize() const override;
+  char *acquire() override;
+  void submit(char *buffer, size_t length, uint64_t offset) override;
+  void wait() override;
+};
+
+/**
+ * A backend calling pwrite on a thread of its own.
+ */
+class PwriteBackend : public IWriteBackend {
+private:
+  /**
+   * The buffers.
+   */
+  AlignedBuffers buffers;
+
+  /**
+   * The file.
+   */
+  int fd;
+
+  /**
+   * Protects the members below.
+   */
+  std::mutex mutex;
+
+  /**
+   * Signals a change to the members below.
+   */
+  std::condition_variable changed;
+
+  /**
+   * The buffers which are free.
+   */
+  std::vector<size_t> free;
+
+  /**
+   * A write waiting for the thread.
+   */
+  struct Write {
+    size_t buffer;
+    size_t length;
+    uint64_t offset;
+  };
+  std::deque<Write> pending;
+
+  /**
+   * The number of writes submitted and not finished.
+   */
+  size_t inFlight = 0;
+
+  /**
+   * Whether the thread should stop.
+   */
+  bool stopping = false;
+
+  /**
+   * The first error.
+   */
+  int error = 0;
+
+  /**
+   * The thread.
+   */
+  std::thread thread;
+
+  /**
+   * The body of the thread.
+   */
+  void run();
+
+public:
+  /**
+   * Creates a backend.
+   *
+   * @param fd The file, which must outlive the backend.
+   * @param nBuffers The number of buffers.
+   * @param bufferSize The size of each buffer.
+   */
+  PwriteBackend(int fd, size_t nBuffers, size_t bufferSize);
+
+  ~PwriteBackend();
+
+  PwriteBackend(const PwriteBackend &) = delete;
+  PwriteBackend &operator=(const PwriteBackend &) = delete;
+
+  const char *name() const override;
+  size_t bufferSize() const override;
+  char *acquire() override;
+  void submit(char *buffer, size_t length, uint64_t offset) override;
+  void wait() override;
+};
+
+/**
+ * A history sink writing to a file. Use it with a HistoryWriter, so that
+ * the simulation does not wait for it.
+ */
+class FileHistorySink : public IHistorySink {
+public:
+  /**
+   * The backend to write with.
+   */
+  enum class Backend {
+    /** io_uring if available and it can be set up, else pwrite. */
+    automatic,
+    /** io_uring. */
+    ioUring,
+    /** pwrite on a thread. */
+    pwrite
+  };
+
+  /**
+   * The options of the sink.
+   */
+  struct Options {
+    /**
+     * The backend.
+     */
+    Backend backend = Backend::automatic;
+
+    /**
+     * Whether to bypass the page cache with O_DIRECT. If the file system
+     * does not support it, the page cache is used.
+     */
+    bool direct = false;
+
+    /**
+     * The number of buffers.
+     */
+    size_t nBuffers = 8;
+
+    /**
+     * The size of each buffer.
+     */
+    size_t bufferSize = 4 << 20;
+  };
+
+private:
+  /**
+   * The number of agents.
+   */
+  size_t nAgents;
+
+  /**
+   * The number of beliefs.
+   */
+  size_t nBeliefs;
+
+  /**
+   * The file.
+   */
+  int fd = -1;
+
+  /**
+   * Whether the file was opened with O_DIRECT.
+   */
+  bool direct = false;
+
+  /**
+   * The backend.
+   */
+  std::unique_ptr<IWriteBackend> backend;
+
+  /**
+   * The buffer being filled, or nullptr.
+   */
+  char *buffer = nullptr;
+
+  /**
+   * The number of bytes in the buffer.
+   */
+  size_t used = 0;
+
+  /**
+   * The offset in the file of the buffer.
+   */
+  uint64_t offset = 0;
+
+  /**
+   * Appends bytes to the file.
+   *
+   * @param data The bytes.
+   * @param n The number of bytes.
+   */
+  void append(const void *data, size_t n);
+
+public:
+  /**
+   * Creates a file and writes its header.
+   *
+   * @param path The path of the file.
+   * @param nAgents The number of agents.
+   * @param nBeliefs The number of beliefs.
+   * @param options The options.
+   * @exception std::system_error If the file or backend cannot be created.
+   */
+  FileHistorySink(const std::string &path, size_t nAgents, size_t nBeliefs,
+                  const Options &options);
+
+  /**
+   * Creates a file with the default options and writes its header.
+   *
+   * @param path The path of the file.
+   * @param nAgents The number of agents.
+   * @param nBeliefs The number of beliefs.
+   * @exception std::system_error If the file or backend cannot be created.
+   */
+  FileHistorySink(const std::string &path, size_t nAgents, size_t nBeliefs);
+
+  /**
+   * Closes the file, ignoring errors.
+   */
+  ~FileHistorySink();
+
+  FileHistorySink(const FileHistorySink &) = delete;
+  FileHistorySink &operator=(const FileHistorySink &) = delete;
+
+  void write(sim_time_t t, const std::vector<double> &activations,
+             const std::vector<index_t> &performed) override;
+
+  /**
+   * Writes what is buffered, waits for it, and closes the file.
+   *
+   * @exception std::system_error If a write failed.
+   */
+  void close();
+
+  /**
+   * The name of the backend.
+   *
+   * @return The name.
+   */
+  const char *backendName() const;
+
+  /**
+   * Whether the page cache is bypassed.
+   *
+   * @return Whether it is.
+   */
+  bool isDirect() const;
+
+  /**
+   * Reads a file written by a FileHistorySink.
+   *
+   * @param path The path of the file.
+   * @return The ticks.
+   * @exception std::system_error If the file cannot be read.
+   * @exception std::runtime_error If the file is not a history file.
+   */
+  static std::vector<MemoryHistorySink::Tick> read(const std::string &path);
+};
+} // namespace BIBS
+
+#endif // BIBS_FILEOUTPUT_H
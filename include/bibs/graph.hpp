@@ -0,0 +1,367 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      graph.hpp
+ * @brief     Header of graph.cpp
+ * @date      Sun Oct 18 21:24:40 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains CompressedGraph, a friendship graph stored in a few
+ * bytes per edge, for networks too large to hold in compressed sparse row
+ * form.
+ *
+ * The friends of each agent are sorted, and each is stored as the gap from
+ * the previous one. The friends are grouped into blocks, and the gaps of a
+ * block are bit-packed with the width of the largest, so networks with
+ * locality take a byte or two per friend rather than the four of an
+ * index_t. Unlike variable-length integers, fixed-width gaps can be read
+ * without first reading the ones before them, which keeps the decoding
+ * close to the speed of an uncompressed graph. A skip index gives the
+ * first friend, width and byte offset of each block, so a block can be
+ * decoded without the ones before it.
+ *
+ * Weights take 8 bytes per edge as doubles, more than the gaps, so they are
+ * stored once if every edge or every edge of each agent has the same
+ * weight, and may otherwise be stored as floats or quantised to 16 bits.
+ */
+
+#ifndef BIBS_GRAPH_H
+#define BIBS_GRAPH_H
+
+#include "bibs/scenario.hpp"
+
+#include <algorithm>
+#include <boost/endian/conversion.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace BIBS {
+
+class ThreadPool;
+
+/**
+ * A friendship graph with bit-packed gaps between sorted friends.
+ *
+ * The friends of agent i are edges edgeOffsets[i] to edgeOffsets[i + 1] - 1,
+ * in blocks blockOffsets[i] to blockOffsets[i + 1] - 1 of up to blockSize
+ * edges. Block k starts with friend blockFirst[k], and the gaps to its other
+ * friends are packed in blockWidths[k] bits each, least significant bit
+ * first, from bytes[blockBytes[k]].
+ *
+ * If every edge has the same weight, only that weight is stored, and if
+ * the friends of each agent have the same weight, only the weight of each
+ * agent is. Otherwise the weight of each edge is stored with a
+ * WeightEncoding.
+ */
+class CompressedGraph {
+public:
+  /**
+   * The default number of edges in a block.
+   */
+  static constexpr size_t defaultBlockSize = 64;
+
+  /**
+   * How the weight of each edge is stored, if the weights of the friends of
+   * an agent differ.
+   */
+  enum class WeightEncoding {
+    /**
+     * As a double, in 8 bytes.
+     */
+    exact,
+
+    /**
+     * As a float, in 4 bytes, with a relative error of at most 2^-24.
+     */
+    single,
+
+    /**
+     * As one of 65536 evenly spaced values from the least to the greatest
+     * weight of the agent, in 2 bytes, with an error of at most 1/131070 of
+     * the range.
+     */
+    quantised
+  };
+
+private:
+  /**
+   * The number of agents.
+   */
+  size_t nAgents;
+
+  /**
+   * The maximum number of edges in a block.
+   */
+  size_t blockSize;
+
+  /**
+   * The offset of the first edge of each agent, with nAgents + 1 entries.
+   */
+  std::vector<uint64_t> edgeOffsets;
+
+  /**
+   * The offset of the first block of each agent, with nAgents + 1 entries.
+   */
+  std::vector<uint64_t> blockOffsets;
+
+  /**
+   * The offset of the gaps of each block, with nBlocks + 1 entries.
+   */
+  std::vector<uint64_t> blockBytes;
+
+  /**
+   * The first friend of each block.
+   */
+  std::vector<index_t> blockFirst;
+
+  /**
+   * The number of bits of each gap of each block.
+   */
+  std::vector<uint8_t> blockWidths;
+
+  /**
+   * The bit-packed gaps, followed by 8 bytes of padding so that every gap
+   * can be read with a single 8-byte load.
+   */
+  std::vector<uint8_t> bytes;
+
+  /**
+   * How the weights are stored if they differ.
+   */
+  WeightEncoding encoding;
+
+  /**
+   * The weight of each edge, if they differ and are exact.
+   */
+  std::vector<double> weights;
+
+  /**
+   * The weight of each edge, if they differ and are single.
+   */
+  std::vector<float> singleWeights;
+
+  /**
+   * The weight of each edge in steps from the least weight of the agent, if
+   * they differ and are quantised.
+   */
+  std::vector<uint16_t> quantisedWeights;
+
+  /**
+   * The weight of the friends of each agent, if it is the same for each
+   * agent, or the least weight of each agent if the weights are quantised.
+   */
+  std::vector<double> agentWeights;
+
+  /**
+   * The step between the quantised weights of each agent.
+   */
+  std::vector<double> weightSteps;
+
+  /**
+   * The weight of every edge, if it is the same for every edge.
+   */
+  double weight = 0.0;
+
+  /**
+   * Reads the 8 bytes from bit of p, shifted so that bit is the least
+   * significant. The 32 bits of a gap are always within them.
+   */
+  static uint64_t readBits(const uint8_t *p, uint64_t bit) {
+    uint64_t word;
+    std::memcpy(&word, p + (bit >> 3), sizeof(word));
+    return boost::endian::little_to_native(word) >> (bit & 7);
+  }
+
+  /**
+   * Calls fn(edge, friend) for each friend of an agent, in order of index.
+   *
+   * @param i The agent.
+   * @param fn The function.
+   */
+  template <class F> void forEachEdge(index_t i, F fn) const {
+    const uint64_t endEdge = edgeOffsets[i + 1];
+    uint64_t e = edgeOffsets[i];
+    for (uint64_t k = blockOffsets[i]; k < blockOffsets[i + 1]; ++k) {
+      const uint64_t blockEnd = std::min<uint64_t>(e + blockSize, endEdge);
+      const uint8_t *p = bytes.data() + blockBytes[k];
+      const unsigned width = blockWidths[k];
+      const uint64_t mask = (uint64_t(1) << width) - 1;
+      index_t j = blockFirst[k];
+      uint64_t bit = 0;
+      fn(e, j);
+      for (++e; e < blockEnd; ++e, bit += width) {
+        j += static_cast<index_t>(readBits(p, bit) & mask);
+        fn(e, j);
+      }
+    }
+  }
+
+public:
+  /**
+   * Creates a CompressedGraph from an edge list, in which agent from[e]
+   * gives weight weights[e] to agent to[e].
+   *
+   * The friends of each agent are sorted by index; friends with the same
+   * index keep the order in which they are given.
+   *
+   * @param nAgents The number of agents.
+   * @param from The observing agents.
+   * @param to The observed agents.
+   * @param weights The weights.
+   * @param blockSize The maximum number of edges in a block.
+   * @param threads The threads to sort and encode the agents on, or nullptr
+   *   to use the calling thread.
+   * @param encoding How the weights are stored if they differ.
+   * @exception std::invalid_argument If the vectors are different sizes, the
+   *   block size is 0, or the weights are quantised and one is not finite.
+   * @exception std::out_of_range If an agent is out of range.
+   */
+  CompressedGraph(size_t nAgents, const std::vector<index_t> &from,
+                  const std::vector<index_t> &to,
+                  const std::vector<double> &weights,
+                  size_t blockSize = defaultBlockSize,
+                  ThreadPool *threads = nullptr,
+                  WeightEncoding encoding = WeightEncoding::exact);
+
+  /**
+   * Creates a CompressedGraph from the friendship graph of a scenario.
+   *
+   * @param scenario The scenario.
+   * @param blockSize The maximum number of edges in a block.
+   * @param threads The threads to sort and encode the agents on, or nullptr
+   *   to use the calling thread.
+   * @param encoding How the weights are stored if they differ.
+   * @return The graph.
+   * @exception std::invalid_argument If the block size is 0, or the weights
+   *   are quantised and one is not finite.
+   */
+  static CompressedGraph
+  fromScenario(const Scenario &scenario, size_t blockSize = defaultBlockSize,
+               ThreadPool *threads = nullptr,
+               WeightEncoding encoding = WeightEncoding::exact);
+
+  /**
+   * Gets the number of agents.
+   *
+   * @return The number of agents.
+   */
+  size_t getNAgents() const;
+
+  /**
+   * Gets the maximum number of edges in a block.
+   *
+   * @return The block size.
+   */
+  size_t getBlockSize() const;
+
+  /**
+   * The number of edges.
+   *
+   * @return The number of edges.
+   */
+  size_t nEdges() const;
+
+  /**
+   * The number of blocks.
+   *
+   * @return The number of blocks.
+   */
+  size_t nBlocks() const;
+
+  /**
+   * The number of friends of an agent.
+   *
+   * @param i The agent.
+   * @return The number of friends.
+   */
+  size_t degree(index_t i) const;
+
+  /**
+   * Whether the edges have different weights.
+   *
+   * @return true if a weight is stored for each agent or edge.
+   */
+  bool isWeighted() const;
+
+  /**
+   * Gets how the weights are stored if they differ.
+   *
+   * @return The encoding.
+   */
+  WeightEncoding getWeightEncoding() const;
+
+  /**
+   * The number of bytes taken by the graph, excluding the object itself.
+   *
+   * @return The number of bytes.
+   */
+  size_t memoryBytes() const;
+
+  /**
+   * Calls fn(friend, weight) for each friend of an agent, in order of
+   * index.
+   *
+   * @param i The agent.
+   * @param fn The function.
+   */
+  template <class F> void forEachFriend(index_t i, F fn) const {
+    if (!weights.empty()) {
+      forEachEdge(i, [&](uint64_t e, index_t j) { fn(j, weights[e]); });
+    } else if (!singleWeights.empty()) {
+      forEachEdge(i, [&](uint64_t e, index_t j) {
+        fn(j, static_cast<double>(singleWeights[e]));
+      });
+    } else if (!quantisedWeights.empty()) {
+      const double least = agentWeights[i];
+      const double step = weightSteps[i];
+      forEachEdge(i, [&](uint64_t e, index_t j) {
+        fn(j, least + step * quantisedWeights[e]);
+      });
+    } else {
+      const double w = agentWeights.empty() ? weight : agentWeights[i];
+      forEachEdge(i, [&](uint64_t, index_t j) { fn(j, w); });
+    }
+  }
+
+  /**
+   * Whether an agent has a friend, found by a binary search of the skip
+   * index and the decoding of one block.
+   *
+   * @param i The agent.
+   * @param j The possible friend.
+   * @return true if j is a friend of i.
+   */
+  bool hasFriend(index_t i, index_t j) const;
+
+  /**
+   * Decodes the graph to an edge list, in order of the observing agent and
+   * then of the friend.
+   *
+   * @param from Set to the observing agents.
+   * @param to Set to the observed agents.
+   * @param weights Set to the weights.
+   */
+  void toEdges(std::vector<index_t> &from, std::vector<index_t> &to,
+               std::vector<double> &weights) const;
+};
+} // namespace BIBS
+
+#endif // BIBS_GRAPH_H
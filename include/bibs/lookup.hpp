@@ -0,0 +1,251 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      lookup.hpp
+ * @brief     Header of lookup.cpp
+ * @date      Sun Oct 18 18:54:12 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains hash indices from the UUIDs and names of agents,
+ * beliefs and behaviours to their dense indices, so that external
+ * references resolve in O(1).
+ *
+ * An index is split into shards by the high bits of the hash of each key.
+ * The keys are partitioned into the shards in parallel, and each shard, an
+ * open-addressing table, is then built by a task of its own.
+ */
+
+#ifndef BIBS_LOOKUP_H
+#define BIBS_LOOKUP_H
+
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+
+#include <boost/uuid/uuid.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * The table shared by the indices of UUIDs and of names. It stores the hash
+ * of every key and, per shard, the dense indices; the keys themselves are
+ * kept by the subclass.
+ */
+class HashIndex {
+public:
+  /**
+   * Returned by find if there is no such key.
+   */
+  static constexpr index_t notFound = std::numeric_limits<index_t>::max();
+
+  /**
+   * Returned by find if more than one object has the key.
+   */
+  static constexpr index_t ambiguous = notFound - 1;
+
+protected:
+  /**
+   * The hash of each key, by dense index.
+   */
+  std::vector<uint64_t> hashes;
+
+  /**
+   * The slots of the shards, each an open-addressing table with linear
+   * probing: the dense index, or notFound if empty.
+   */
+  std::vector<std::vector<index_t>> shards;
+
+  /**
+   * The number of high bits of the hash selecting the shard.
+   */
+  unsigned shardBits = 0;
+
+  /**
+   * Whether the key of each index (the first with the key) is shared with
+   * a later index. Bytes, not bits, so shards can be built concurrently.
+   */
+  std::vector<uint8_t> duplicated;
+
+  /**
+   * Builds the shards from the hashes.
+   *
+   * @param threads The threads to build with, or nullptr.
+   * @param equal Whether the keys of two indices are equal.
+   */
+  void build(ThreadPool *threads,
+             const std::function<bool(index_t, index_t)> &equal);
+
+  /**
+   * Finds a key.
+   *
+   * @param hash The hash of the key.
+   * @param equal Whether the key of an index is the key sought.
+   * @return The index, notFound, or ambiguous.
+   */
+  template <class Equal> index_t lookup(uint64_t hash, Equal equal) const {
+    const auto &slots = shards[shardBits == 0 ? 0 : hash >> (64 - shardBits)];
+    const size_t mask = slots.size() - 1;
+    for (size_t s = hash & mask;; s = (s + 1) & mask) {
+      const index_t i = slots[s];
+      if (i == notFound) {
+        return notFound;
+      }
+      if (hashes[i] == hash && equal(i)) {
+        return duplicated[i] ? ambiguous : i;
+      }
+    }
+  }
+
+public:
+  virtual ~HashIndex() {}
+
+  /**
+   * The number of keys.
+   *
+   * @return The number of keys.
+   */
+  size_t size() const;
+
+  /**
+   * The number of shards.
+   *
+   * @return The number of shards.
+   */
+  size_t nShards() const;
+
+  /**
+   * Whether any key is shared by more than one index.
+   *
+   * @return Whether any is.
+   */
+  bool hasDuplicates() const;
+};
+
+/**
+ * An index from UUIDs to dense indices. UUIDs must be unique.
+ */
+class UuidIndex : public HashIndex {
+private:
+  /**
+   * The UUIDs, by dense index.
+   */
+  std::vector<boost::uuids::uuid> keys;
+
+public:
+  /**
+   * Creates an empty index.
+   */
+  UuidIndex();
+
+  /**
+   * Builds an index.
+   *
+   * @param keys The UUID of each index.
+   * @param threads The threads to build with, or nullptr.
+   * @exception std::invalid_argument If a UUID is repeated.
+   */
+  explicit UuidIndex(std::vector<boost::uuids::uuid> keys,
+                     ThreadPool *threads = nullptr);
+
+  /**
+   * Finds a UUID.
+   *
+   * @param uuid The UUID.
+   * @return The index, or notFound.
+   */
+  index_t find(const boost::uuids::uuid &uuid) const;
+
+  /**
+   * Gets the index of a UUID.
+   *
+   * @param uuid The UUID.
+   * @return The index.
+   * @exception std::out_of_range If there is no such UUID.
+   */
+  index_t at(const boost::uuids::uuid &uuid) const;
+
+  /**
+   * Gets the UUID of an index.
+   *
+   * @param i The index.
+   * @return The UUID.
+   */
+  const boost::uuids::uuid &key(index_t i) const;
+};
+
+/**
+ * An index from names to dense indices. Names may be repeated, in which case
+ * finding them gives ambiguous.
+ */
+class NameIndex : public HashIndex {
+private:
+  /**
+   * The names, by dense index.
+   */
+  std::vector<std::string> keys;
+
+public:
+  /**
+   * Creates an empty index.
+   */
+  NameIndex();
+
+  /**
+   * Builds an index.
+   *
+   * @param keys The name of each index.
+   * @param threads The threads to build with, or nullptr.
+   */
+  explicit NameIndex(std::vector<std::string> keys,
+                     ThreadPool *threads = nullptr);
+
+  /**
+   * Finds a name.
+   *
+   * @param name The name.
+   * @return The index, notFound, or ambiguous.
+   */
+  index_t find(const std::string &name) const;
+
+  /**
+   * Gets the index of a name.
+   *
+   * @param name The name.
+   * @return The index.
+   * @exception std::out_of_range If there is no such name.
+   * @exception std::invalid_argument If the name is not unique.
+   */
+  index_t at(const std::string &name) const;
+
+  /**
+   * Gets the name of an index.
+   *
+   * @param i The index.
+   * @return The name.
+   */
+  const std::string &key(index_t i) const;
+};
+} // namespace BIBS
+
+#endif // BIBS_LOOKUP_H
@@ -0,0 +1,107 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      mapping.hpp
+ * @brief     Header of mapping.cpp
+ * @date      Mon Oct 19 16:12:40 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains the helpers shared by the modules which read and
+ * write files of their own formats: a read-only memory mapping of a file,
+ * and the error thrown when a system call fails.
+ */
+
+#ifndef BIBS_MAPPING_H
+#define BIBS_MAPPING_H
+
+#include <cstddef>
+#include <string>
+
+namespace BIBS {
+
+/**
+ * Throws the std::system_error of an errno value.
+ *
+ * @param error The errno value.
+ * @param what What failed, e.g. "open " + path.
+ * @exception std::system_error Always.
+ */
+[[noreturn]] void throwErrno(int error, const std::string &what);
+
+/**
+ * A whole file, memory-mapped read-only and shared, which is unmapped when
+ * the mapping is destroyed.
+ */
+class ReadOnlyMapping {
+private:
+  /**
+   * The start of the mapping, or nullptr if the file is empty.
+   */
+  void *start = nullptr;
+
+  /**
+   * The size of the mapping.
+   */
+  size_t length = 0;
+
+public:
+  /**
+   * Maps a file. An empty file is not mapped, and has no data.
+   *
+   * @param path The path of the file.
+   * @exception std::system_error If the file cannot be opened or mapped.
+   */
+  explicit ReadOnlyMapping(const std::string &path);
+
+  /**
+   * Unmaps the file.
+   */
+  ~ReadOnlyMapping();
+
+  ReadOnlyMapping(const ReadOnlyMapping &) = delete;
+  ReadOnlyMapping &operator=(const ReadOnlyMapping &) = delete;
+
+  /**
+   * Gets the start of the mapping.
+   *
+   * @return The start, or nullptr if the file is empty.
+   */
+  const char *data() const;
+
+  /**
+   * The size of the file.
+   *
+   * @return The size, in bytes.
+   */
+  size_t size() const;
+
+  /**
+   * Advises the kernel how a range of the mapping will be used, with
+   * madvise. The advice is only a hint, so failures are ignored.
+   *
+   * @param offset The offset of the range, a multiple of the page size.
+   * @param n The size of the range.
+   * @param advice The advice, e.g. MADV_SEQUENTIAL.
+   */
+  void advise(size_t offset, size_t n, int advice) const;
+};
+
+} // namespace BIBS
+
+#endif
@@ -0,0 +1,381 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      meanfield.hpp
+ * @brief     Header of meanfield.cpp
+ * @date      Sun Oct 18 09:12:44 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains a mean-field (cohort) simulation, which tracks the
+ * distribution of activations of homogeneous cohorts of agents rather than
+ * the individual agents.
+ */
+
+#ifndef BIBS_MEANFIELD_H
+#define BIBS_MEANFIELD_H
+
+#include "bibs/behaviour.hpp"
+#include "bibs/belief.hpp"
+#include "bibs/bibs.hpp"
+#include "bibs/simulation.hpp"
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * The error of a mean-field simulation at one tick, measured against an
+ * agent-based simulation of a sample of agents drawn from the cohorts.
+ */
+struct MeanFieldError {
+  /**
+   * The time.
+   */
+  sim_time_t t;
+
+  /**
+   * The largest absolute difference between the mean-field and the sampled
+   * behaviour shares, over all cohorts and behaviours.
+   */
+  double shareError;
+
+  /**
+   * An upper 95% confidence bound on the share error, accounting for the
+   * sampling error of the agent-based run.
+   */
+  double shareErrorBound;
+
+  /**
+   * The largest absolute difference between the mean-field and the sampled
+   * mean activations, over all cohorts and beliefs.
+   */
+  double activationError;
+
+  /**
+   * An upper 95% confidence bound on the activation error, accounting for the
+   * sampling error of the agent-based run.
+   */
+  double activationErrorBound;
+};
+
+/**
+ * A mean-field simulation.
+ *
+ * Each cohort represents a (possibly very large) number of homogeneous
+ * agents. The activations of an agent in a cohort are approximated by
+ * independent normal distributions, whose means and variances are evolved
+ * using the same update as Agent::updateActivation (a Gaussian moment
+ * closure). The behaviour shares of a cohort are found by applying the same
+ * choice rule as Agent::perform to quadrature samples drawn from the cohort's
+ * activation distribution.
+ *
+ * The observed behaviour of a cohort's friends is replaced by its expectation
+ * under the behaviour shares of the cohorts they belong to.
+ */
+class MeanFieldSimulation : public ISimulation {
+protected:
+  /**
+   * The beliefs in the simulation.
+   */
+  std::vector<const IBelief *> beliefs;
+
+  /**
+   * The behaviours in the simulation.
+   */
+  std::vector<const IBehaviour *> behaviours;
+
+  /**
+   * Map from belief to its index in beliefs.
+   */
+  std::map<const IBelief *, size_t> beliefIndex;
+
+  /**
+   * Map from behaviour to its index in behaviours.
+   */
+  std::map<const IBehaviour *, size_t> behaviourIndex;
+
+  /**
+   * The belief relationships, row-major [b][b2].
+   */
+  std::vector<double> beliefRelationships;
+
+  /**
+   * The observed behaviour relationships, row-major [belief][behaviour].
+   */
+  std::vector<double> observedRelationships;
+
+  /**
+   * The performing behaviour relationships, row-major [belief][behaviour].
+   */
+  std::vector<double> performingRelationships;
+
+  /**
+   * The number of agents represented by each cohort.
+   */
+  std::vector<double> cohortSizes;
+
+  /**
+   * The time deltas of each cohort, row-major [cohort][belief].
+   */
+  std::vector<std::vector<double>> timeDeltas;
+
+  /**
+   * The contact weights, [cohort][cohort].
+   */
+  std::vector<std::vector<double>> contacts;
+
+  /**
+   * Whether the behaviour shares of each cohort are set externally.
+   */
+  std::vector<bool> external;
+
+  /**
+   * The mean activations, [t][cohort * nBeliefs + belief].
+   */
+  std::vector<std::vector<double>> means;
+
+  /**
+   * The activation variances, [t][cohort * nBeliefs + belief].
+   */
+  std::vector<std::vector<double>> variances;
+
+  /**
+   * The behaviour shares, [t][cohort * nBehaviours + behaviour].
+   */
+  std::vector<std::vector<double>> shares;
+
+  /**
+   * The number of quadrature samples used for the choice rule.
+   */
+  size_t nQuadrature;
+
+  /**
+   * The seed for the quadrature samples.
+   */
+  unsigned seed;
+
+  /**
+   * Gets the index of a belief.
+   *
+   * @param b The belief.
+   * @return The index.
+   * @exception std::out_of_range If the belief is not in the simulation.
+   */
+  size_t indexOf(const IBelief *b) const;
+
+  /**
+   * Gets the index of a behaviour.
+   *
+   * @param b The behaviour.
+   * @return The index.
+   * @exception std::out_of_range If the behaviour is not in the simulation.
+   */
+  size_t indexOf(const IBehaviour *b) const;
+
+  /**
+   * Calculates the behaviour shares of cohort c at time t, from the mean and
+   * variance of its activations at time t.
+   *
+   * @param t The time.
+   * @param c The cohort.
+   */
+  virtual void updateShares(const sim_time_t t, const size_t c);
+
+  /**
+   * Advance the simulation by a single tick.
+   */
+  virtual void step();
+
+public:
+  /**
+   * Create a new mean-field simulation, with no cohorts.
+   *
+   * The relationships between the beliefs and behaviours are read once, here.
+   *
+   * @param beliefs The beliefs.
+   * @param behaviours The behaviours.
+   * @param nQuadrature The number of quadrature samples per cohort per tick
+   *   used for the choice rule.
+   * @param seed The seed for the quadrature samples.
+   * @exception std::out_of_range If a relationship is not defined.
+   */
+  MeanFieldSimulation(std::vector<const IBelief *> beliefs,
+                      std::vector<const IBehaviour *> behaviours,
+                      size_t nQuadrature = 64, unsigned seed = 0);
+
+  /**
+   * Adds a cohort at time 0.
+   *
+   * @param size The number of agents represented by the cohort.
+   * @param timeDeltas The time delta of each belief, in order of beliefs.
+   * @param mean The mean initial activation of each belief.
+   * @param variance The variance of the initial activation of each belief.
+   * @return The index of the new cohort.
+   * @exception std::invalid_argument If the vectors are not the same size as
+   *   the beliefs, or if the simulation has already been run.
+   */
+  size_t addCohort(double size, const std::vector<double> &timeDeltas,
+                   const std::vector<double> &mean,
+                   const std::vector<double> &variance);
+
+  /**
+   * The number of cohorts.
+   *
+   * @return The number of cohorts.
+   */
+  size_t nCohorts() const;
+
+  /**
+   * Gets the number of agents represented by a cohort.
+   *
+   * @param c The cohort.
+   * @return The size of the cohort.
+   * @exception std::out_of_range If the cohort is not found.
+   */
+  double cohortSize(size_t c) const;
+
+  /**
+   * Gets the total friend weight that an agent in cohort c gives to agents in
+   * cohort d.
+   *
+   * @param c The observing cohort.
+   * @param d The observed cohort.
+   * @return The weight.
+   * @exception std::out_of_range If either cohort is not found.
+   */
+  double contact(size_t c, size_t d) const;
+
+  /**
+   * Sets the total friend weight that an agent in cohort c gives to agents in
+   * cohort d.
+   *
+   * @param c The observing cohort.
+   * @param d The observed cohort.
+   * @param w The weight.
+   * @exception std::out_of_range If either cohort is not found.
+   */
+  void setContact(size_t c, size_t d, double w);
+
+  /**
+   * Sets whether the behaviour shares of cohort c are supplied externally
+   * (using setBehaviourShares) rather than calculated.
+   *
+   * @param c The cohort.
+   * @param isExternal Whether the cohort is external.
+   * @exception std::out_of_range If the cohort is not found.
+   */
+  void setExternal(size_t c, bool isExternal);
+
+  /**
+   * Sets the behaviour shares of cohort c at time t.
+   *
+   * @param t The time.
+   * @param c The cohort.
+   * @param s The share of each behaviour, in order of behaviours.
+   * @exception std::out_of_range If the time or cohort is not found.
+   * @exception std::invalid_argument If s is the wrong size.
+   */
+  void setBehaviourShares(sim_time_t t, size_t c, const std::vector<double> &s);
+
+  /**
+   * The latest time simulated.
+   *
+   * @return The time.
+   */
+  sim_time_t time() const;
+
+  /**
+   * Gets the mean activation of a belief in a cohort at a time.
+   *
+   * @param t The time.
+   * @param c The cohort.
+   * @param b The belief.
+   * @return The mean activation.
+   * @exception std::out_of_range If the time, cohort or belief is not found.
+   */
+  double activationMean(sim_time_t t, size_t c, const IBelief *b) const;
+
+  /**
+   * Gets the variance of the activation of a belief in a cohort at a time.
+   *
+   * @param t The time.
+   * @param c The cohort.
+   * @param b The belief.
+   * @return The variance of the activation.
+   * @exception std::out_of_range If the time, cohort or belief is not found.
+   */
+  double activationVariance(sim_time_t t, size_t c, const IBelief *b) const;
+
+  /**
+   * Gets the share of the agents in a cohort performing a behaviour at a time.
+   *
+   * @param t The time.
+   * @param c The cohort.
+   * @param b The behaviour.
+   * @return The share.
+   * @exception std::out_of_range If the time, cohort or behaviour is not
+   *   found.
+   */
+  double behaviourShare(sim_time_t t, size_t c, const IBehaviour *b) const;
+
+  /**
+   * Gets the expected value, relevant to belief b, of observing the behaviour
+   * of an agent in cohort c at time t.
+   *
+   * @param t The time.
+   * @param c The cohort.
+   * @param b The belief.
+   * @return The expected observed behaviour relationship.
+   * @exception std::out_of_range If the time, cohort or belief is not found.
+   */
+  double observedValue(sim_time_t t, size_t c, const IBelief *b) const;
+
+  /**
+   * Run the simulation for n days, from the latest time simulated.
+   *
+   * @param nDays the number of days.
+   */
+  void run(sim_time_t nDays) override;
+
+  /**
+   * Estimates the error of this simulation, by running an agent-based
+   * simulation (of Agent) with a sample of agents from each cohort, from time
+   * 0 to time().
+   *
+   * Each sampled agent has its initial activations drawn from the initial
+   * distribution of its cohort, and friendsPerCohort friends drawn from each
+   * cohort it has contact with, sharing the contact weight equally.
+   *
+   * @param agentsPerCohort The number of agents to sample from each cohort.
+   * @param friendsPerCohort The number of friends of each agent in each cohort
+   *   it has contact with.
+   * @param seed The seed used to sample the agents.
+   * @return The error at each time from 0 to time().
+   * @exception std::invalid_argument If agentsPerCohort is less than two, or
+   *   if any cohort is external.
+   */
+  std::vector<MeanFieldError> compareWithSample(size_t agentsPerCohort,
+                                                size_t friendsPerCohort,
+                                                unsigned seed) const;
+};
+} // namespace BIBS
+
+#endif // BIBS_MEANFIELD_H
@@ -0,0 +1,374 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      output.hpp
+ * @brief     Header of output.cpp
+ * @date      Sun Oct 18 17:31:22 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains the buffering of the history of a simulation. The
+ * threads of a simulation copy their results into fixed-size chunks and
+ * hand them to a writer thread through a lock-free queue; the writer thread
+ * assembles each tick in agent order and gives it to a sink. The simulation
+ * threads never wait for the writer thread or the sink.
+ */
+
+#ifndef BIBS_OUTPUT_H
+#define BIBS_OUTPUT_H
+
+#include "bibs/bibs.hpp"
+#include "bibs/scenario.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * The results of a contiguous range of agents at a tick.
+ */
+class OutputChunk {
+public:
+  /**
+   * The tick.
+   */
+  sim_time_t t = 0;
+
+  /**
+   * The first agent.
+   */
+  index_t begin = 0;
+
+  /**
+   * The number of agents.
+   */
+  size_t count = 0;
+
+  /**
+   * The activations, row-major [agent][belief].
+   */
+  std::vector<double> activations;
+
+  /**
+   * The behaviour performed by each agent.
+   */
+  std::vector<index_t> performed;
+
+  /**
+   * The next chunk in a ChunkQueue.
+   */
+  std::atomic<OutputChunk *> next{nullptr};
+};
+
+/**
+ * An intrusive, lock-free, multi-producer single-consumer queue of chunks
+ * (Vyukov). Pushing never waits. The queue does not own the chunks.
+ */
+class ChunkQueue {
+private:
+  /**
+   * The node the queue starts from.
+   */
+  OutputChunk stub;
+
+  /**
+   * The last chunk pushed.
+   */
+  std::atomic<OutputChunk *> head;
+
+  /**
+   * The next chunk to pop, owned by the consumer.
+   */
+  OutputChunk *tail;
+
+public:
+  ChunkQueue();
+
+  ChunkQueue(const ChunkQueue &) = delete;
+  ChunkQueue &operator=(const ChunkQueue &) = delete;
+
+  /**
+   * Pushes a chunk. This can be called from any thread.
+   *
+   * @param chunk The chunk.
+   */
+  void push(OutputChunk *chunk);
+
+  /**
+   * Pops a chunk. This must only be called from one thread at a time.
+   *
+   * @return The oldest chunk, or nullptr if the queue is empty or the oldest
+   *   push has not finished.
+   */
+  OutputChunk *pop();
+};
+
+/**
+ * Where the history of a simulation goes, a whole tick at a time.
+ */
+class IHistorySink {
+public:
+  virtual ~IHistorySink() {}
+
+  /**
+   * Writes a tick.
+   *
+   * @param t The tick.
+   * @param activations The activations, row-major [agent][belief].
+   * @param performed The behaviour performed by each agent.
+   */
+  virtual void write(sim_time_t t, const std::vector<double> &activations,
+                     const std::vector<index_t> &performed) = 0;
+};
+
+/**
+ * A sink keeping the history in memory.
+ */
+class MemoryHistorySink : public IHistorySink {
+public:
+  /**
+   * A tick of the history.
+   */
+  class Tick {
+  public:
+    sim_time_t t;
+    std::vector<double> activations;
+    std::vector<index_t> performed;
+  };
+
+  /**
+   * The ticks, in the order they were written.
+   */
+  std::vector<Tick> ticks;
+
+  void write(sim_time_t t, const std::vector<double> &activations,
+             const std::vector<index_t> &performed) override;
+};
+
+/**
+ * Buffers the history of a simulation and writes it to a sink on a thread
+ * of its own.
+ *
+ * write may be called from any number of threads at once, with any
+ * partition of the agents of a tick; it never waits. When every agent of a
+ * tick has been received, the tick is given to the sink. Chunks are reused
+ * once written; if none is free without waiting, a new one is allocated.
+ */
+class HistoryWriter {
+private:
+  /**
+   * The number of agents.
+   */
+  size_t nAgents;
+
+  /**
+   * The number of beliefs.
+   */
+  size_t nBeliefs;
+
+  /**
+   * The number of agents in a chunk.
+   */
+  size_t chunkAgents;
+
+  /**
+   * The sink.
+   */
+  IHistorySink &sink;
+
+  /**
+   * The full chunks waiting for the writer thread.
+   */
+  ChunkQueue queue;
+
+  /**
+   * The chunks which are free to reuse.
+   */
+  std::vector<std::unique_ptr<OutputChunk>> free;
+
+  /**
+   * Protects free. Simulation threads only try to lock it.
+   */
+  std::mutex freeMutex;
+
+  /**
+   * The number of chunks allocated.
+   */
+  std::atomic<size_t> allocated{0};
+
+  /**
+   * The number of agent-ticks submitted.
+   */
+  std::atomic<uint64_t> submitted{0};
+
+  /**
+   * A tick being assembled.
+   */
+  class Pending {
+  public:
+    std::vector<double> activations;
+    std::vector<index_t> performed;
+    size_t received = 0;
+  };
+
+  /**
+   * The ticks being assembled, owned by the writer thread.
+   */
+  std::map<sim_time_t, Pending> pending;
+
+  /**
+   * Protects the state shared with the writer thread below.
+   */
+  std::mutex mutex;
+
+  /**
+   * Wakes the writer thread.
+   */
+  std::condition_variable wake;
+
+  /**
+   * Whether the writer thread is, or is about to start, waiting on wake. It
+   * is set with the mutex held, so a producer which sees it and then takes
+   * the mutex cannot notify before the writer thread waits.
+   */
+  std::atomic<bool> idle{false};
+
+  /**
+   * Signals that the writer thread has caught up.
+   */
+  std::condition_variable caughtUp;
+
+  /**
+   * The number of agent-ticks assembled by the writer thread.
+   */
+  uint64_t done = 0;
+
+  /**
+   * Whether the writer thread should stop once it has caught up.
+   */
+  bool stopping = false;
+
+  /**
+   * The first error thrown by the sink.
+   */
+  std::exception_ptr error;
+
+  /**
+   * The writer thread.
+   */
+  std::thread thread;
+
+  /**
+   * Gets a free chunk, or a new one.
+   *
+   * @return The chunk.
+   */
+  OutputChunk *acquire();
+
+  /**
+   * Adds a chunk to its tick, and writes the tick if it is complete.
+   *
+   * @param chunk The chunk.
+   */
+  void assemble(OutputChunk *chunk);
+
+  /**
+   * The body of the writer thread.
+   */
+  void run();
+
+public:
+  /**
+   * The default number of agents in a chunk.
+   */
+  static constexpr size_t defaultChunkAgents = 4096;
+
+  /**
+   * Creates a writer and starts its thread.
+   *
+   * @param nAgents The number of agents.
+   * @param nBeliefs The number of beliefs.
+   * @param sink The sink, which must outlive the writer.
+   * @param chunkAgents The number of agents in a chunk.
+   * @exception std::invalid_argument If chunkAgents is 0.
+   */
+  HistoryWriter(size_t nAgents, size_t nBeliefs, IHistorySink &sink,
+                size_t chunkAgents = defaultChunkAgents);
+
+  /**
+   * Writes what has been submitted, and stops the thread.
+   */
+  ~HistoryWriter();
+
+  HistoryWriter(const HistoryWriter &) = delete;
+  HistoryWriter &operator=(const HistoryWriter &) = delete;
+
+  /**
+   * Submits the results of agents [begin, end) at a tick. This can be called
+   * from any thread, and never waits.
+   *
+   * @param t The tick.
+   * @param begin The first agent.
+   * @param end One past the last agent.
+   * @param activations The activations of the agents, row-major
+   *   [agent][belief].
+   * @param performed The behaviour performed by each agent.
+   */
+  void write(sim_time_t t, size_t begin, size_t end,
+             const double *activations, const index_t *performed);
+
+  /**
+   * Waits until everything submitted has been given to the sink.
+   *
+   * @exception std::exception Whatever the sink threw, if it threw.
+   */
+  void flush();
+
+  /**
+   * The number of agents.
+   *
+   * @return The number of agents.
+   */
+  size_t getNAgents() const;
+
+  /**
+   * The number of beliefs.
+   *
+   * @return The number of beliefs.
+   */
+  size_t getNBeliefs() const;
+
+  /**
+   * The number of chunks allocated, which grows only when the writer thread
+   * falls behind.
+   *
+   * @return The number of chunks.
+   */
+  size_t nChunks() const;
+};
+} // namespace BIBS
+
+#endif // BIBS_OUTPUT_H
@@ -0,0 +1,178 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      parallel.hpp
+ * @brief     Header of parallel.cpp
+ * @date      Sun Oct 18 11:06:40 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains a simple pool of threads for data-parallel loops.
+ */
+
+#ifndef BIBS_PARALLEL_H
+#define BIBS_PARALLEL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * A fixed pool of threads, which run data-parallel loops.
+ *
+ * The thread calling parallelFor also takes part in the loop, so a pool of
+ * size 1 has no worker threads. Calls to parallelFor from within a loop run
+ * serially on the calling thread.
+ */
+class ThreadPool {
+private:
+  /**
+   * The worker threads.
+   */
+  std::vector<std::thread> workers;
+
+  /**
+   * Serialises calls to parallelFor from different threads.
+   */
+  std::mutex callMutex;
+
+  /**
+   * Protects the job state below.
+   */
+  std::mutex mutex;
+
+  /**
+   * Signalled when a new job starts, or the pool is stopping.
+   */
+  std::condition_variable jobStarted;
+
+  /**
+   * Signalled when a worker finishes the current job.
+   */
+  std::condition_variable jobFinished;
+
+  /**
+   * Incremented for each job.
+   */
+  size_t generation = 0;
+
+  /**
+   * The number of workers still working on the current job.
+   */
+  size_t busy = 0;
+
+  /**
+   * Whether the pool is stopping.
+   */
+  bool stopping = false;
+
+  /**
+   * The body of the current job.
+   */
+  const std::function<void(size_t, size_t)> *body = nullptr;
+
+  /**
+   * The number of iterations of the current job.
+   */
+  size_t n = 0;
+
+  /**
+   * The number of iterations in each chunk of the current job.
+   */
+  size_t grain = 1;
+
+  /**
+   * The next chunk of the current job to run.
+   */
+  std::atomic<size_t> next{0};
+
+  /**
+   * The first exception thrown by the current job.
+   */
+  std::exception_ptr error;
+
+  /**
+   * Runs chunks of the current job until there are none left.
+   */
+  void work();
+
+  /**
+   * The main loop of a worker thread.
+   */
+  void workerLoop();
+
+public:
+  /**
+   * Create a new pool.
+   *
+   * @param nThreads The number of threads, including the calling thread. If
+   *   0, the number of hardware threads is used.
+   */
+  explicit ThreadPool(size_t nThreads = 0);
+
+  /**
+   * Stops and joins the worker threads.
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  /**
+   * The number of threads, including the calling thread.
+   *
+   * @return The number of threads.
+   */
+  size_t size() const;
+
+  /**
+   * Calls fn(begin, end) for consecutive chunks [begin, end) covering [0, n),
+   * in parallel, and waits for them all to finish.
+   *
+   * @param n The number of iterations.
+   * @param grain The number of iterations in each chunk (at least 1).
+   * @param fn The body of the loop.
+   * @exception Any exception thrown by fn is rethrown, after all the chunks
+   *   which were started have finished.
+   */
+  void parallelFor(size_t n, size_t grain,
+                   const std::function<void(size_t, size_t)> &fn);
+};
+
+/**
+ * Calls threads->parallelFor(n, grain, fn), or runs the chunks serially, in
+ * order, if threads is nullptr.
+ *
+ * @param threads The pool, or nullptr.
+ * @param n The number of iterations.
+ * @param grain The number of iterations in each chunk (at least 1).
+ * @param fn The body of the loop.
+ * @exception Any exception thrown by fn is rethrown.
+ */
+void forChunks(ThreadPool *threads, size_t n, size_t grain,
+               const std::function<void(size_t, size_t)> &fn);
+} // namespace BIBS
+
+#endif // BIBS_PARALLEL_H
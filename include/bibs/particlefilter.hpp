@@ -0,0 +1,215 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      particlefilter.hpp
+ * @brief     Header of particlefilter.cpp
+ * @date      Sun Oct 18 12:15:09 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains a particle filter, which assimilates observed
+ * behaviour shares into an ensemble of running simulations.
+ */
+
+#ifndef BIBS_PARTICLEFILTER_H
+#define BIBS_PARTICLEFILTER_H
+
+#include "bibs/bibs.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/state.hpp"
+#include "bibs/vectorised.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * A sequential Monte Carlo (particle filter) engine.
+ *
+ * Each particle is a VectorisedSimulation of the same scenario. Particles are
+ * advanced in parallel, and weighted at each observation by the likelihood of
+ * the observed behaviour shares. When the effective sample size falls below a
+ * threshold, the particles are resampled (systematic resampling): a resampled
+ * particle is a copy-on-write clone of its parent, given a new stream. All
+ * the particles take their frames from one pool, so frames of discarded
+ * particles are recycled.
+ */
+class ParticleFilter {
+protected:
+  /**
+   * The threads which advance the particles.
+   */
+  ThreadPool threads;
+
+  /**
+   * The pool of frames shared by the particles.
+   */
+  std::shared_ptr<FramePool> pool;
+
+  /**
+   * The particles.
+   */
+  std::vector<VectorisedSimulation> particles;
+
+  /**
+   * The normalised log weight of each particle.
+   */
+  std::vector<double> logWeights;
+
+  /**
+   * The effective sample size (as a fraction of the number of particles)
+   * below which the particles are resampled.
+   */
+  double resampleThreshold;
+
+  /**
+   * The stream given to the next resampled particle.
+   */
+  uint64_t nextStream;
+
+  /**
+   * The log of the marginal likelihood of the observations so far.
+   */
+  double logLikelihood = 0.0;
+
+  /**
+   * The number of times the particles have been resampled.
+   */
+  size_t resamples = 0;
+
+  /**
+   * Random number generator used for resampling.
+   */
+  std::mt19937_64 eng;
+
+  /**
+   * Resamples the particles, using systematic resampling.
+   */
+  void resample();
+
+public:
+  /**
+   * Create a new particle filter at time 0, with equally weighted particles.
+   *
+   * @param scenario The scenario.
+   * @param activations The activations at time 0, row-major [agent][belief].
+   * @param performed The behaviours performed at time 0. If empty, they are
+   *   chosen (once, for all the particles) from the activations.
+   * @param nParticles The number of particles.
+   * @param seed The seed.
+   * @param nThreads The number of threads, or 0 for the number of hardware
+   *   threads.
+   * @param resampleThreshold The effective sample size (as a fraction of the
+   *   number of particles) below which the particles are resampled.
+   * @param recordHistory Whether the particles keep the frames of all times.
+   * @exception std::invalid_argument If nParticles is 0, or the scenario,
+   *   activations or performed behaviours are inconsistent.
+   */
+  ParticleFilter(std::shared_ptr<const Scenario> scenario,
+                 const std::vector<double> &activations,
+                 const std::vector<index_t> &performed, size_t nParticles,
+                 uint64_t seed = 0, size_t nThreads = 0,
+                 double resampleThreshold = 0.5, bool recordHistory = false);
+
+  /**
+   * The number of particles.
+   *
+   * @return The number of particles.
+   */
+  size_t nParticles() const;
+
+  /**
+   * Gets a particle.
+   *
+   * @param i The index of the particle.
+   * @return The particle.
+   * @exception std::out_of_range If the particle is not found.
+   */
+  const VectorisedSimulation &particle(size_t i) const;
+
+  /**
+   * The latest time simulated.
+   *
+   * @return The time.
+   */
+  sim_time_t time() const;
+
+  /**
+   * Advance all the particles, in parallel.
+   *
+   * @param nTicks The number of ticks.
+   */
+  void advance(sim_time_t nTicks);
+
+  /**
+   * Weights the particles by the likelihood of an observation at the latest
+   * time, and resamples them if the effective sample size is too small.
+   *
+   * The observation is treated as a multinomial sample of sampleSize agents
+   * with the given behaviour shares.
+   *
+   * @param shares The observed share of each behaviour.
+   * @param sampleSize The number of agents observed (e.g. survey
+   *   respondents).
+   * @exception std::invalid_argument If shares is the wrong size.
+   */
+  void assimilate(const std::vector<double> &shares, double sampleSize);
+
+  /**
+   * Gets the normalised weight of each particle.
+   *
+   * @return The weights.
+   */
+  std::vector<double> weights() const;
+
+  /**
+   * The effective sample size of the weights.
+   *
+   * @return The effective sample size.
+   */
+  double effectiveSampleSize() const;
+
+  /**
+   * The log of the marginal likelihood of all the observations so far.
+   *
+   * @return The log-likelihood.
+   */
+  double logMarginalLikelihood() const;
+
+  /**
+   * The number of times the particles have been resampled.
+   *
+   * @return The number of resamples.
+   */
+  size_t nResamples() const;
+
+  /**
+   * The weighted mean share of each behaviour at the latest time.
+   *
+   * @return The share of each behaviour.
+   */
+  std::vector<double> behaviourShares() const;
+};
+} // namespace BIBS
+
+#endif // BIBS_PARTICLEFILTER_H
@@ -0,0 +1,223 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      partition.hpp
+ * @brief     Header of partition.cpp
+ * @date      Sun Oct 18 22:47:19 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains PartitionedSimulation, which splits the agents into
+ * partitions that advance several ticks between synchronisations.
+ *
+ * An agent's state at a tick depends on the behaviours its friends
+ * performed at the tick before, so a partition which also holds the agents
+ * within k friendships of its own (its halo) can advance k ticks on its
+ * own: a halo agent d friendships away is computed redundantly, and is
+ * exact for k - d ticks. The partitions then exchange the state of
+ * their own agents once, rather than once a tick. This suits partitions
+ * which are loosely coupled, so that the halos are small.
+ */
+
+#ifndef BIBS_PARTITION_H
+#define BIBS_PARTITION_H
+
+#include "bibs/bibs.hpp"
+#include "bibs/choice.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/simulation.hpp"
+#include "bibs/state.hpp"
+#include "bibs/vectorised.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * A VectorisedSimulation split into partitions with deep halos, which
+ * synchronise every haloDepth ticks.
+ *
+ * Each partition is a VectorisedSimulation of its own agents and its halo,
+ * whose random choices are those of the agents in the whole simulation, so
+ * the state after each exchange is that of a VectorisedSimulation of the
+ * whole scenario with the same seed. The partitions run in parallel on the
+ * threads.
+ */
+class PartitionedSimulation : public ISimulation {
+private:
+  class Partition;
+
+  /**
+   * The scenario.
+   */
+  std::shared_ptr<const Scenario> scenario;
+
+  /**
+   * The number of ticks between exchanges.
+   */
+  sim_time_t haloDepth;
+
+  /**
+   * The threads to run the partitions on, or nullptr.
+   */
+  ThreadPool *threads;
+
+  /**
+   * The partitions.
+   */
+  std::vector<std::unique_ptr<Partition>> partitions;
+
+  /**
+   * The state of all the agents after the latest exchange.
+   */
+  Frame state;
+
+  /**
+   * The number of exchanges.
+   */
+  uint64_t exchanges = 0;
+
+  /**
+   * Calls fn(p) for each partition, in parallel.
+   */
+  template <class F> void forPartitions(F fn);
+
+  /**
+   * Gathers the agents of each partition into state, and gives every
+   * partition the new state of its halo.
+   *
+   * @param t The time of the state.
+   */
+  void exchange(sim_time_t t);
+
+public:
+  /**
+   * Create a new PartitionedSimulation at time 0.
+   *
+   * @param scenario The scenario.
+   * @param activations The activations at time 0, row-major
+   *   [agent][belief].
+   * @param performed The behaviours performed at time 0. If empty, the
+   *   behaviours are chosen from the activations.
+   * @param seed The seed.
+   * @param partitionOf The partition of each agent. Partitions without
+   *   agents are skipped.
+   * @param haloDepth The number of ticks between exchanges, which is the
+   *   number of friendships spanned by the halos.
+   * @param threads The threads to run the partitions on, or nullptr.
+   * @exception std::invalid_argument If the scenario is inconsistent, the
+   *   activations, performed behaviours or partitions are the wrong size, or
+   *   haloDepth is 0.
+   */
+  PartitionedSimulation(std::shared_ptr<const Scenario> scenario,
+                        const std::vector<double> &activations,
+                        const std::vector<index_t> &performed, uint64_t seed,
+                        const std::vector<index_t> &partitionOf,
+                        sim_time_t haloDepth, ThreadPool *threads = nullptr);
+
+  /**
+   * Destroy PartitionedSimulation.
+   */
+  ~PartitionedSimulation();
+
+  /**
+   * Splits agents into partitions of consecutive indices, of sizes which
+   * differ by at most one.
+   *
+   * @param nAgents The number of agents.
+   * @param nPartitions The number of partitions.
+   * @return The partition of each agent.
+   * @exception std::invalid_argument If nPartitions is 0.
+   */
+  static std::vector<index_t> blockPartitions(size_t nAgents,
+                                              size_t nPartitions);
+
+  /**
+   * Run the simulation for n days, from the latest time simulated,
+   * exchanging every haloDepth days and after the last.
+   *
+   * @param nDays the number of days.
+   */
+  void run(sim_time_t nDays) override;
+
+  /**
+   * The latest time simulated.
+   *
+   * @return The time.
+   */
+  sim_time_t time() const;
+
+  /**
+   * The state of all the agents at the latest time, with its digest.
+   *
+   * @return The state.
+   */
+  const Frame &current() const;
+
+  /**
+   * Gets the number of ticks between exchanges.
+   *
+   * @return The halo depth.
+   */
+  sim_time_t getHaloDepth() const;
+
+  /**
+   * The number of partitions with agents.
+   *
+   * @return The number of partitions.
+   */
+  size_t nPartitions() const;
+
+  /**
+   * The number of agents of a partition, excluding its halo.
+   *
+   * @param p The partition.
+   * @return The number of agents.
+   */
+  size_t nOwned(size_t p) const;
+
+  /**
+   * The number of agents in the halo of a partition.
+   *
+   * @param p The partition.
+   * @return The number of agents.
+   */
+  size_t nHalo(size_t p) const;
+
+  /**
+   * The number of exchanges so far.
+   *
+   * @return The number of exchanges.
+   */
+  uint64_t nExchanges() const;
+
+  /**
+   * Sets the rule by which agents choose their behaviour, from the next
+   * frame.
+   *
+   * @param p The policy, or nullptr for defaultChoicePolicy.
+   */
+  void setChoicePolicy(std::shared_ptr<const IChoicePolicy> p);
+};
+} // namespace BIBS
+
+#endif // BIBS_PARTITION_H
@@ -0,0 +1,271 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      scenario.hpp
+ * @brief     Header of scenario.cpp
+ * @date      Sun Oct 18 11:21:03 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains Scenario, the static part of a simulation (the belief
+ * network, the agents' time deltas and the friendship graph) stored in dense
+ * arrays indexed by agent, belief and behaviour.
+ */
+
+#ifndef BIBS_SCENARIO_H
+#define BIBS_SCENARIO_H
+
+#include "bibs/agent.hpp"
+#include "bibs/behaviour.hpp"
+#include "bibs/belief.hpp"
+#include "bibs/bibs.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * The index of an agent, belief or behaviour in a Scenario.
+ */
+typedef uint32_t index_t;
+
+/**
+ * The arrays of a scenario, wherever they are stored: in a Scenario, or in
+ * place in a ScenarioImage. The layouts are those of Scenario.
+ */
+struct ScenarioView {
+  /**
+   * The number of agents.
+   */
+  size_t nAgents = 0;
+
+  /**
+   * The number of beliefs.
+   */
+  size_t nBeliefs = 0;
+
+  /**
+   * The number of behaviours.
+   */
+  size_t nBehaviours = 0;
+
+  /**
+   * The belief relationships, nBeliefs * nBeliefs.
+   */
+  const double *beliefRelationships = nullptr;
+
+  /**
+   * The observed behaviour relationships, nBeliefs * nBehaviours.
+   */
+  const double *observedRelationships = nullptr;
+
+  /**
+   * The performing behaviour relationships, nBeliefs * nBehaviours.
+   */
+  const double *performingRelationships = nullptr;
+
+  /**
+   * The time deltas, nAgents * nBeliefs.
+   */
+  const double *timeDeltas = nullptr;
+
+  /**
+   * The offset of the first friend of each agent, nAgents + 1.
+   */
+  const uint64_t *friendOffsets = nullptr;
+
+  /**
+   * The friends, friendOffsets[nAgents].
+   */
+  const index_t *friends = nullptr;
+
+  /**
+   * The friend weights, friendOffsets[nAgents].
+   */
+  const double *friendWeights = nullptr;
+
+  /**
+   * Checks that the friend offsets are sorted, starting from 0, and that
+   * the friends are in range.
+   *
+   * @exception std::invalid_argument If the graph is inconsistent.
+   */
+  void validate() const;
+};
+
+/**
+ * The static part of a simulation, stored in dense arrays.
+ *
+ * Agents, beliefs and behaviours are identified by their index. The
+ * friendship graph is stored in compressed sparse row form: the friends of
+ * agent i are friends[friendOffsets[i]] to friends[friendOffsets[i + 1] - 1].
+ */
+class Scenario {
+public:
+  /**
+   * The number of agents.
+   */
+  size_t nAgents;
+
+  /**
+   * The number of beliefs.
+   */
+  size_t nBeliefs;
+
+  /**
+   * The number of behaviours.
+   */
+  size_t nBehaviours;
+
+  /**
+   * The belief relationships, row-major [b][b2]. See
+   * IBelief::beliefRelationship.
+   */
+  std::vector<double> beliefRelationships;
+
+  /**
+   * The observed behaviour relationships, row-major [belief][behaviour]. See
+   * IBelief::observedBehaviourRelationship.
+   */
+  std::vector<double> observedRelationships;
+
+  /**
+   * The performing behaviour relationships, row-major [belief][behaviour].
+   * See IBelief::performingBehaviourRelationship.
+   */
+  std::vector<double> performingRelationships;
+
+  /**
+   * The time deltas, row-major [agent][belief]. See Agent::timeDelta.
+   */
+  std::vector<double> timeDeltas;
+
+  /**
+   * The offset of the first friend of each agent, with nAgents + 1 entries.
+   */
+  std::vector<uint64_t> friendOffsets;
+
+  /**
+   * The friends of all the agents.
+   */
+  std::vector<index_t> friends;
+
+  /**
+   * The friend weights, in the same order as friends. See
+   * Agent::friendWeight.
+   */
+  std::vector<double> friendWeights;
+
+  /**
+   * Create a new Scenario, with all relationships and time deltas 0, and no
+   * friends.
+   *
+   * @param nAgents The number of agents.
+   * @param nBeliefs The number of beliefs.
+   * @param nBehaviours The number of behaviours.
+   */
+  Scenario(size_t nAgents, size_t nBeliefs, size_t nBehaviours);
+
+  /**
+   * The number of friendships.
+   *
+   * @return The number of friendships.
+   */
+  size_t nEdges() const;
+
+  /**
+   * Replaces the friendship graph.
+   *
+   * Agent from[e] gives weight weights[e] to agent to[e]. The friends of each
+   * agent keep the order in which they are given.
+   *
+   * @param from The observing agents.
+   * @param to The observed agents.
+   * @param weights The weights.
+   * @exception std::invalid_argument If the vectors are different sizes.
+   * @exception std::out_of_range If an agent is out of range.
+   */
+  void setEdges(const std::vector<index_t> &from,
+                const std::vector<index_t> &to,
+                const std::vector<double> &weights);
+
+  /**
+   * Checks that the arrays have sizes consistent with the numbers of agents,
+   * beliefs and behaviours, and that the friends are in range.
+   *
+   * @exception std::invalid_argument If the scenario is inconsistent.
+   */
+  void validate() const;
+
+  /**
+   * Gets a view of the arrays, which is valid until the scenario is
+   * changed or destroyed.
+   *
+   * @return The view.
+   */
+  ScenarioView view() const;
+
+  /**
+   * Creates a Scenario from Agents.
+   *
+   * Friends which are not in agents are ignored. The friends of each agent
+   * are in order of their index.
+   *
+   * @param agents The agents.
+   * @param beliefs The beliefs.
+   * @param behaviours The behaviours.
+   * @return The scenario.
+   * @exception std::out_of_range If an agent does not have a time delta for a
+   *   belief, or a relationship is not defined.
+   */
+  static Scenario fromAgents(const std::vector<const Agent *> &agents,
+                             const std::vector<const IBelief *> &beliefs,
+                             const std::vector<const IBehaviour *> &behaviours);
+};
+
+/**
+ * Gets the activations of agents at a time, row-major [agent][belief].
+ *
+ * @param agents The agents.
+ * @param beliefs The beliefs.
+ * @param t The time.
+ * @return The activations.
+ * @exception std::out_of_range If an activation is not found.
+ */
+std::vector<double>
+activationsOf(const std::vector<const IAgent *> &agents,
+              const std::vector<const IBelief *> &beliefs, sim_time_t t);
+
+/**
+ * Gets the indices of the behaviours performed by agents at a time.
+ *
+ * @param agents The agents.
+ * @param behaviours The behaviours.
+ * @param t The time.
+ * @return The index of each agent's performed behaviour.
+ * @exception std::out_of_range If a performed behaviour is not found, or not
+ *   in behaviours.
+ */
+std::vector<index_t>
+performedOf(const std::vector<const IAgent *> &agents,
+            const std::vector<const IBehaviour *> &behaviours, sim_time_t t);
+} // namespace BIBS
+
+#endif // BIBS_SCENARIO_H
@@ -0,0 +1,130 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      scenarioimage.hpp
+ * @brief     Header of scenarioimage.cpp
+ * @date      Mon Oct 19 13:26:05 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains ScenarioImage, a frozen Scenario (its belief
+ * network and friendship graph) in a file which is memory-mapped read-only
+ * and used in place, so that processes simulating the same scenario share
+ * one copy of it in physical memory.
+ *
+ * The file starts with a header of 128 bytes: the 8 bytes "BIBSSCEN", the
+ * version as uint32, 4 bytes of zeros, then the numbers of agents,
+ * beliefs, behaviours and friendships, and the offsets from the start of
+ * the file of the belief, observed and performing relationships, the time
+ * deltas, the friend offsets, the friends and the friend weights, all as
+ * uint64, then zeros. The arrays follow, laid out as in Scenario, each
+ * starting at a multiple of 64 bytes. Everything is little-endian, and
+ * there are no pointers, so the file can be mapped at any address.
+ */
+
+#ifndef BIBS_SCENARIOIMAGE_H
+#define BIBS_SCENARIOIMAGE_H
+
+#include "bibs/mapping.hpp"
+#include "bibs/scenario.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace BIBS {
+
+/**
+ * A Scenario in a read-only memory-mapped file.
+ *
+ * The arrays are read in place through view(): nothing is copied into the
+ * process, so every process mapping the same file shares its pages. A
+ * VectorisedSimulation can be created from a ScenarioImage in the same way
+ * as from a Scenario.
+ */
+class ScenarioImage {
+private:
+  /**
+   * The file.
+   */
+  ReadOnlyMapping mapping;
+
+  /**
+   * The arrays, in the mapping.
+   */
+  ScenarioView arrays;
+
+public:
+  /**
+   * Maps an image.
+   *
+   * The sizes of the arrays are checked against the file, but not their
+   * contents; see ScenarioView::validate.
+   *
+   * @param path The path of the file.
+   * @exception std::system_error If the file cannot be opened or mapped.
+   * @exception std::runtime_error If the file is not an image, has an
+   *   unknown version or is truncated.
+   */
+  explicit ScenarioImage(const std::string &path);
+
+  ScenarioImage(const ScenarioImage &) = delete;
+  ScenarioImage &operator=(const ScenarioImage &) = delete;
+
+  /**
+   * Writes the image of a scenario.
+   *
+   * @param path The path of the file, which is replaced.
+   * @param scenario The scenario.
+   * @exception std::invalid_argument If the scenario is inconsistent.
+   * @exception std::system_error If the file cannot be written.
+   */
+  static void write(const std::string &path, const Scenario &scenario);
+
+  /**
+   * Gets the arrays, which are valid while the image is.
+   *
+   * @return The view.
+   */
+  const ScenarioView &view() const;
+
+  /**
+   * The number of friendships.
+   *
+   * @return The number of friendships.
+   */
+  size_t nEdges() const;
+
+  /**
+   * The size of the file.
+   *
+   * @return The size, in bytes.
+   */
+  size_t size() const;
+
+  /**
+   * Copies the image into a Scenario.
+   *
+   * @return The scenario.
+   */
+  Scenario toScenario() const;
+};
+
+} // namespace BIBS
+
+#endif
@@ -0,0 +1,338 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      sensitivity.hpp
+ * @brief     Header of sensitivity.cpp
+ * @date      Sun Oct 18 13:32:58 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains a driver for variance-based (Sobol) global
+ * sensitivity analysis of a Scenario, using Saltelli's sampling scheme.
+ */
+
+#ifndef BIBS_SENSITIVITY_H
+#define BIBS_SENSITIVITY_H
+
+#include "bibs/bibs.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/state.hpp"
+#include "bibs/vectorised.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * A parameter of a sensitivity analysis.
+ */
+class SensitivityParameter {
+public:
+  /**
+   * The name of the parameter.
+   */
+  std::string name;
+
+  /**
+   * The lower bound of the parameter.
+   */
+  double lower;
+
+  /**
+   * The upper bound of the parameter.
+   */
+  double upper;
+
+  /**
+   * Applies a value of the parameter to a scenario. The scenario is a copy
+   * of the base scenario, to which other parameters may already have been
+   * applied. It throws std::out_of_range if the parameter refers to a
+   * belief which the scenario does not have.
+   */
+  std::function<void(Scenario &s, const Scenario &base, double value)> apply;
+};
+
+/**
+ * A parameter which sets the time delta of a belief for every agent.
+ *
+ * @param belief The belief.
+ * @param lower The lower bound.
+ * @param upper The upper bound.
+ * @return The parameter.
+ */
+SensitivityParameter timeDeltaParameter(index_t belief, double lower,
+                                        double upper);
+
+/**
+ * A parameter which scales the relationship between two beliefs.
+ *
+ * @param b The belief.
+ * @param b2 The other belief.
+ * @param lower The lower bound of the scaling.
+ * @param upper The upper bound of the scaling.
+ * @return The parameter.
+ */
+SensitivityParameter beliefRelationshipScaling(index_t b, index_t b2,
+                                               double lower, double upper);
+
+/**
+ * A parameter which scales the observed behaviour relationships of a belief.
+ *
+ * @param belief The belief.
+ * @param lower The lower bound of the scaling.
+ * @param upper The upper bound of the scaling.
+ * @return The parameter.
+ */
+SensitivityParameter observedRelationshipScaling(index_t belief, double lower,
+                                                 double upper);
+
+/**
+ * A parameter which scales the performing behaviour relationships of a
+ * belief.
+ *
+ * @param belief The belief.
+ * @param lower The lower bound of the scaling.
+ * @param upper The upper bound of the scaling.
+ * @return The parameter.
+ */
+SensitivityParameter performingRelationshipScaling(index_t belief,
+                                                   double lower, double upper);
+
+/**
+ * A parameter which scales all the friend weights.
+ *
+ * @param lower The lower bound of the scaling.
+ * @param upper The upper bound of the scaling.
+ * @return The parameter.
+ */
+SensitivityParameter friendWeightScaling(double lower, double upper);
+
+/**
+ * A variance-based sensitivity analysis of a scalar output of a simulation.
+ *
+ * For each of N base samples, the parameters are drawn into two rows, A and
+ * B, and the output is found for A, for B, and for each of the P rows AB_i
+ * (A with parameter i taken from B): N(P + 2) runs in total. The runs are
+ * done in parallel waves, each thread reusing its scenario and frames.
+ * Their outputs are accumulated into running estimators of the first-order
+ * (Saltelli 2010) and total (Jansen) indices, so the memory used does not
+ * depend on N. The runs of one base sample share a seed (common random
+ * numbers).
+ */
+class SensitivityAnalysis {
+public:
+  /**
+   * The output of a run.
+   */
+  typedef std::function<double(const VectorisedSimulation &)> output_t;
+
+protected:
+  /**
+   * The base scenario.
+   */
+  std::shared_ptr<const Scenario> base;
+
+  /**
+   * The activations at time 0.
+   */
+  std::vector<double> activations;
+
+  /**
+   * The parameters.
+   */
+  std::vector<SensitivityParameter> parameters;
+
+  /**
+   * The output.
+   */
+  output_t output;
+
+  /**
+   * The number of ticks of each run.
+   */
+  sim_time_t nTicks;
+
+  /**
+   * The seed.
+   */
+  uint64_t seed;
+
+  /**
+   * The threads.
+   */
+  ThreadPool threads;
+
+  /**
+   * A scenario and pool of frames reused by the runs on one thread.
+   */
+  class Workspace {
+  public:
+    std::shared_ptr<Scenario> scenario;
+    std::shared_ptr<FramePool> pool;
+  };
+
+  /**
+   * The workspaces which are not in use.
+   */
+  std::vector<std::unique_ptr<Workspace>> workspaces;
+
+  /**
+   * Protects workspaces.
+   */
+  std::mutex workspaceMutex;
+
+  /**
+   * The number of base samples so far.
+   */
+  size_t n = 0;
+
+  /**
+   * The mean of the outputs of A and B.
+   */
+  double outputMean = 0.0;
+
+  /**
+   * The sum of squared deviations of the outputs of A and B from their mean.
+   */
+  double outputM2 = 0.0;
+
+  /**
+   * The sum of fB (fAB_i - fA) for each parameter.
+   */
+  std::vector<double> firstOrderSums;
+
+  /**
+   * The sum of (fA - fAB_i)^2 for each parameter.
+   */
+  std::vector<double> totalSums;
+
+  /**
+   * Gets the value of a parameter in row A or B of a base sample.
+   *
+   * @param sample The base sample.
+   * @param matrix 0 for A, 1 for B.
+   * @param p The parameter.
+   * @return The value.
+   */
+  double sampleValue(size_t sample, int matrix, size_t p) const;
+
+  /**
+   * Runs one simulation.
+   *
+   * @param sample The base sample.
+   * @param column -2 for A, -1 for B, or the parameter i for AB_i.
+   * @return The output.
+   */
+  double runOne(size_t sample, long column);
+
+  /**
+   * Adds the outputs of one base sample to the estimators.
+   *
+   * @param f The outputs: A, B, then AB_i for each parameter.
+   */
+  void accumulate(const double *f);
+
+public:
+  /**
+   * Create a new sensitivity analysis.
+   *
+   * @param base The base scenario.
+   * @param activations The activations at time 0, row-major [agent][belief].
+   * @param parameters The parameters.
+   * @param output The output of a run.
+   * @param nTicks The number of ticks of each run.
+   * @param seed The seed.
+   * @param nThreads The number of threads, or 0 for the number of hardware
+   *   threads.
+   * @exception std::invalid_argument If there are no parameters.
+   */
+  SensitivityAnalysis(std::shared_ptr<const Scenario> base,
+                      std::vector<double> activations,
+                      std::vector<SensitivityParameter> parameters,
+                      output_t output, sim_time_t nTicks, uint64_t seed = 0,
+                      size_t nThreads = 0);
+
+  /**
+   * Runs more base samples. This can be called repeatedly to extend the
+   * analysis.
+   *
+   * @param nSamples The number of base samples to add.
+   */
+  void run(size_t nSamples);
+
+  /**
+   * The number of base samples so far.
+   *
+   * @return The number of base samples.
+   */
+  size_t nSamples() const;
+
+  /**
+   * The number of runs so far.
+   *
+   * @return The number of runs.
+   */
+  size_t nRuns() const;
+
+  /**
+   * The mean output.
+   *
+   * @return The mean.
+   */
+  double mean() const;
+
+  /**
+   * The variance of the output.
+   *
+   * @return The variance.
+   */
+  double variance() const;
+
+  /**
+   * The first-order index of each parameter.
+   *
+   * @return The first-order indices.
+   */
+  std::vector<double> firstOrder() const;
+
+  /**
+   * The total index of each parameter.
+   *
+   * @return The total indices.
+   */
+  std::vector<double> totalOrder() const;
+};
+
+/**
+ * An output which is the share of agents performing a behaviour at the end
+ * of the run.
+ *
+ * @param behaviour The behaviour.
+ * @return The output.
+ */
+SensitivityAnalysis::output_t finalShareOutput(index_t behaviour);
+} // namespace BIBS
+
+#endif // BIBS_SENSITIVITY_H
@@ -17,13 +17,14 @@
 
 /**
  * @file      simulation.hpp
- * @brief     Header of simulation.hpp
+ * @brief     Header of simulation.cpp
  * @date      Thu Oct 28 14:12:06 2021
  * @author    Robert Greener
  * @copyright GPL-3.0-or-later
  *
- * This module contains an ISimulation interface and a SequentialSimulation
- * implementation.
+ * This module contains the ISimulation interface, the TickObserver and
+ * ITickObserver hooks into each tick of a simulation, and SequentialSimulation,
+ * which ticks each IAgent in turn. VectorisedSimulation is in vectorised.hpp.
  */
 
 #ifndef BIBS_SIMULATION_H
@@ -32,11 +33,17 @@
 #include "bibs/agent.hpp"
 #include "bibs/behaviour.hpp"
 #include "bibs/belief.hpp"
+#include "bibs/bibs.hpp"
+#include "bibs/lookup.hpp"
+#include "bibs/scenario.hpp"
 
+#include <boost/uuid/uuid.hpp>
+#include <string>
 #include <vector>
 
 namespace BIBS {
-
+class Frame;
+class ThreadPool;
 /**
  * The interface for a simulation.
  */
@@ -55,6 +62,90 @@ public:
   virtual void run(sim_time_t nDays) = 0;
 };
 
+/**
+ * Hooks into each tick of a VectorisedSimulation, resolved at compile time.
+ *
+ * VectorisedSimulation::run(nDays, observer) calls the hooks of the
+ * observer's own type, so an observer derives from TickObserver and hides
+ * the hooks it needs; the others are empty and compile to nothing. The
+ * chunk hooks are called by the threads updating the agents, concurrently
+ * for disjoint chunks, so they should only write state of their own chunk.
+ */
+struct TickObserver {
+  /**
+   * Called before a tick.
+   *
+   * @param previous The frame of the previous time.
+   */
+  void tickStart(const Frame &previous) {}
+
+  /**
+   * Called once the activations and contexts of agents [begin, end) of the
+   * new frame are computed.
+   *
+   * @param previous The frame of the previous time.
+   * @param current The new frame.
+   * @param begin The first agent.
+   * @param end One past the last agent.
+   */
+  void afterActivations(const Frame &previous, const Frame &current,
+                        size_t begin, size_t end) {}
+
+  /**
+   * Called once agents [begin, end) of the new frame have chosen their
+   * behaviours.
+   *
+   * @param previous The frame of the previous time.
+   * @param current The new frame.
+   * @param begin The first agent.
+   * @param end One past the last agent.
+   */
+  void afterBehaviours(const Frame &previous, const Frame &current,
+                       size_t begin, size_t end) {}
+
+  /**
+   * Called after a tick, once the new frame is the current one.
+   *
+   * @param current The new frame.
+   */
+  void tickEnd(const Frame &current) {}
+};
+
+/**
+ * Hooks into each tick of a simulation, resolved at run time, and registered
+ * with VectorisedSimulation::addObserver or SequentialSimulation::addObserver.
+ * The hooks are those of TickObserver, and are empty unless overridden.
+ */
+class ITickObserver {
+public:
+  /**
+   * Destroy ITickObserver.
+   */
+  virtual ~ITickObserver() {}
+
+  /**
+   * @see TickObserver::tickStart
+   */
+  virtual void tickStart(const Frame &previous) {}
+
+  /**
+   * @see TickObserver::afterActivations
+   */
+  virtual void afterActivations(const Frame &previous, const Frame &current,
+                                size_t begin, size_t end) {}
+
+  /**
+   * @see TickObserver::afterBehaviours
+   */
+  virtual void afterBehaviours(const Frame &previous, const Frame &current,
+                               size_t begin, size_t end) {}
+
+  /**
+   * @see TickObserver::tickEnd
+   */
+  virtual void tickEnd(const Frame &current) {}
+};
+
 /**
  * A sequential simulation (no multiprocessing).
  */
@@ -90,22 +181,167 @@ protected:
    */
   std::vector<const IBehaviour *> constBehaviours;
 
+  /**
+   * The index of the agents by UUID.
+   */
+  UuidIndex agentUuids;
+
+  /**
+   * The index of the beliefs by UUID.
+   */
+  UuidIndex beliefUuids;
+
+  /**
+   * The index of the beliefs by name.
+   */
+  NameIndex beliefNames;
+
+  /**
+   * The index of the behaviours by UUID.
+   */
+  UuidIndex behaviourUuids;
+
+  /**
+   * The index of the behaviours by name.
+   */
+  NameIndex behaviourNames;
+
+  /**
+   * The observers registered at run time.
+   */
+  std::vector<ITickObserver *> observers;
+
+  /**
+   * Gathers the state of the agents at a time into a frame, with
+   * activationsOf and performedOf. The contexts are left empty.
+   *
+   * @param t The time.
+   * @return The frame.
+   * @exception std::out_of_range If an activation or performed behaviour is
+   *   not found.
+   */
+  Frame frameOf(sim_time_t t) const;
+
 public:
   /**
-   * Create a new sequential simulation
+   * Create a new sequential simulation, indexing the agents, beliefs and
+   * behaviours by UUID and name.
    *
    * @param agents The agents.
    * @param beliefs The beliefs.
    * @param behaviours The behaviours.
+   * @param threads The threads to build the indices with, or nullptr.
+   * @exception std::invalid_argument If two agents, beliefs or behaviours
+   *   have the same UUID.
    */
   SequentialSimulation(std::vector<IAgent *> agents,
                        std::vector<IBelief *> beliefs,
-                       std::vector<IBehaviour *> behaviours);
+                       std::vector<IBehaviour *> behaviours,
+                       ThreadPool *threads = nullptr);
 
   /**
-   * Run the simulation for n days.
+   * Gets the index of an agent.
+   *
+   * @param uuid The UUID of the agent.
+   * @return The index of the agent in the agents given.
+   * @exception std::out_of_range If there is no such agent.
+   */
+  index_t agentIndex(const boost::uuids::uuid &uuid) const;
+
+  /**
+   * Gets the index of a belief.
+   *
+   * @param uuid The UUID of the belief.
+   * @return The index of the belief in the beliefs given.
+   * @exception std::out_of_range If there is no such belief.
+   */
+  index_t beliefIndex(const boost::uuids::uuid &uuid) const;
+
+  /**
+   * Gets the index of a belief.
+   *
+   * @param name The name of the belief.
+   * @return The index of the belief in the beliefs given.
+   * @exception std::out_of_range If there is no such belief.
+   * @exception std::invalid_argument If more than one belief has the name.
+   */
+  index_t beliefIndex(const std::string &name) const;
+
+  /**
+   * Gets the index of a behaviour.
+   *
+   * @param uuid The UUID of the behaviour.
+   * @return The index of the behaviour in the behaviours given.
+   * @exception std::out_of_range If there is no such behaviour.
+   */
+  index_t behaviourIndex(const boost::uuids::uuid &uuid) const;
+
+  /**
+   * Gets the index of a behaviour.
+   *
+   * @param name The name of the behaviour.
+   * @return The index of the behaviour in the behaviours given.
+   * @exception std::out_of_range If there is no such behaviour.
+   * @exception std::invalid_argument If more than one behaviour has the name.
+   */
+  index_t behaviourIndex(const std::string &name) const;
+
+  /**
+   * Gets an agent.
+   *
+   * @param uuid The UUID of the agent.
+   * @return The agent.
+   * @exception std::out_of_range If there is no such agent.
+   */
+  IAgent *agent(const boost::uuids::uuid &uuid) const;
+
+  /**
+   * Gets a belief.
+   *
+   * @param uuid The UUID of the belief.
+   * @return The belief.
+   * @exception std::out_of_range If there is no such belief.
+   */
+  IBelief *belief(const boost::uuids::uuid &uuid) const;
+
+  /**
+   * Gets a behaviour.
+   *
+   * @param uuid The UUID of the behaviour.
+   * @return The behaviour.
+   * @exception std::out_of_range If there is no such behaviour.
+   */
+  IBehaviour *behaviour(const boost::uuids::uuid &uuid) const;
+
+  /**
+   * Registers an observer, whose hooks are called after those already
+   * registered.
+   *
+   * The agents are ticked one at a time, each updating its activations and
+   * then choosing its behaviour, so afterActivations and afterBehaviours are
+   * both called once all the agents have ticked, for all of them. The frames
+   * are gathered from the agents only while an observer is registered.
+   *
+   * @param o The observer, which must outlive the simulation or be removed.
+   * @exception std::invalid_argument If o is nullptr.
+   */
+  void addObserver(ITickObserver *o);
+
+  /**
+   * Unregisters an observer.
+   *
+   * @param o The observer.
+   * @exception std::out_of_range If the observer is not registered.
+   */
+  void removeObserver(ITickObserver *o);
+
+  /**
+   * Run the simulation for n days, ticking the agents at times 0 to
+   * nDays - 1, so the state before the first tick is at time -1.
    *
    * @param nDays the number of days.
+   * @exception std::out_of_range If an observer is registered and the state
+   *   of an agent is not found.
    */
   virtual void run(sim_time_t nDays);
 };
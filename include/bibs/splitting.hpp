@@ -0,0 +1,178 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      splitting.hpp
+ * @brief     Header of splitting.cpp
+ * @date      Mon Oct 19 11:03:48 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains ImportanceSplitting, which estimates the probability
+ * of a rare cascade (the share of agents performing a behaviour reaching a
+ * high level before a deadline) by fixed-effort multilevel splitting.
+ */
+
+#ifndef BIBS_SPLITTING_H
+#define BIBS_SPLITTING_H
+
+#include "bibs/bibs.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/vectorised.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * An estimate from ImportanceSplitting.
+ */
+struct SplittingEstimate {
+  /**
+   * The estimate of the probability of reaching the last level.
+   */
+  double probability = 0.0;
+
+  /**
+   * The fraction of the trajectories started at each level which reached
+   * the next; probability is their product.
+   */
+  std::vector<double> levelProbabilities;
+
+  /**
+   * The relative standard error of the probability, if the levels were
+   * independent: sqrt(sum (1 - p) / (n p)). It is a lower bound in
+   * general, and infinite if a level was not reached.
+   */
+  double relativeError = 0.0;
+
+  /**
+   * The number of ticks simulated, over all trajectories.
+   */
+  uint64_t nTicks = 0;
+};
+
+/**
+ * Fixed-effort multilevel splitting of a VectorisedSimulation.
+ *
+ * The same number of trajectories is run from each level. At the first
+ * level they are copies of a simulation at time 0; each runs until the
+ * share of agents performing the behaviour reaches the level, or the
+ * deadline. The trajectories which reached the level are then cloned (each
+ * an equal number of times, give or take one) to give the trajectories of
+ * the next level, with new streams. The product of the fractions reaching
+ * each level is an unbiased estimate of the probability of reaching the
+ * last.
+ *
+ * The clones share the frame they start from with the trajectory they are
+ * cloned from, and keep only their latest frame, so cloning is cheap.
+ */
+class ImportanceSplitting {
+private:
+  /**
+   * The simulation at time 0.
+   */
+  VectorisedSimulation origin;
+
+  /**
+   * The behaviour.
+   */
+  index_t behaviour;
+
+  /**
+   * The levels of the share of agents performing the behaviour, which
+   * increase.
+   */
+  std::vector<double> levels;
+
+  /**
+   * The deadline.
+   */
+  sim_time_t nDays;
+
+  /**
+   * The number of trajectories run from each level.
+   */
+  size_t nTrajectories;
+
+  /**
+   * The seed.
+   */
+  uint64_t seed;
+
+  /**
+   * The threads to run the trajectories on, or nullptr.
+   */
+  ThreadPool *threads;
+
+  /**
+   * The number of agents performing the behaviour now.
+   *
+   * @param sim The simulation.
+   * @return The number of agents.
+   */
+  size_t performing(const VectorisedSimulation &sim) const;
+
+public:
+  /**
+   * Create a new ImportanceSplitting.
+   *
+   * @param scenario The scenario.
+   * @param activations The activations at time 0, row-major
+   *   [agent][belief].
+   * @param behaviour The behaviour.
+   * @param levels The levels of the share of agents performing the
+   *   behaviour, which increase; the last is the rare event.
+   * @param nDays The deadline.
+   * @param nTrajectories The number of trajectories run from each level.
+   * @param seed The seed.
+   * @param threads The threads to run the trajectories on, or nullptr.
+   * @exception std::invalid_argument If the behaviour is not found, the
+   *   levels are empty, do not increase or are not in (0, 1], or
+   *   nTrajectories is 0.
+   */
+  ImportanceSplitting(std::shared_ptr<const Scenario> scenario,
+                      const std::vector<double> &activations,
+                      index_t behaviour, std::vector<double> levels,
+                      sim_time_t nDays, size_t nTrajectories,
+                      uint64_t seed = 0, ThreadPool *threads = nullptr);
+
+  /**
+   * Estimates the probability of reaching the last level by the deadline.
+   * Estimates with different replicates are independent, and the same
+   * replicate always gives the same estimate, for any number of threads.
+   *
+   * @param replicate The replicate.
+   * @return The estimate.
+   */
+  SplittingEstimate estimate(uint64_t replicate = 0) const;
+
+  /**
+   * Gets the levels.
+   *
+   * @return The levels.
+   */
+  const std::vector<double> &getLevels() const;
+};
+
+} // namespace BIBS
+
+#endif
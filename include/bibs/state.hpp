@@ -0,0 +1,195 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      state.hpp
+ * @brief     Header of state.cpp
+ * @date      Sun Oct 18 11:40:52 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains Frame, the state of all the agents of a
+ * VectorisedSimulation at one time, and FramePool, which recycles frames.
+ */
+
+#ifndef BIBS_STATE_H
+#define BIBS_STATE_H
+
+#include "bibs/bibs.hpp"
+#include "bibs/scenario.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace BIBS {
+
+/**
+ * The state of all the agents at one time.
+ *
+ * Frames are immutable once they have been computed, so simulations which
+ * are copied share their frames (copy-on-write).
+ */
+class Frame {
+public:
+  /**
+   * The time.
+   */
+  sim_time_t t = 0;
+
+  /**
+   * The activations, row-major [agent][belief].
+   */
+  std::vector<double> activations;
+
+  /**
+   * The contextualisation of each activation, row-major [agent][belief]. See
+   * Agent::contextualise.
+   */
+  std::vector<double> contexts;
+
+  /**
+   * The index of the behaviour performed by each agent.
+   */
+  std::vector<index_t> performed;
+
+  /**
+   * The digest of the activations and performed behaviours. See stateDigest.
+   */
+  uint64_t digest = 0;
+
+  /**
+   * Resizes the frame.
+   *
+   * @param nAgents The number of agents.
+   * @param nBeliefs The number of beliefs.
+   */
+  void resize(size_t nAgents, size_t nBeliefs);
+};
+
+/**
+ * The inputs of the utilities of all the agents, kept between ticks so that
+ * they can be updated from the changes in activations rather than computed
+ * again. See VectorisedSimulation::setIncremental.
+ */
+class UtilityCache {
+public:
+  /**
+   * Changes in activations or contextual activations no larger than this
+   * are not applied.
+   */
+  double tolerance = 0.0;
+
+  /**
+   * The number of ticks between full recomputations.
+   */
+  sim_time_t refreshInterval = 1;
+
+  /**
+   * The number of ticks since the last full recomputation.
+   */
+  sim_time_t sinceRefresh = 0;
+
+  /**
+   * Whether the arrays below are of the current frame.
+   */
+  bool valid = false;
+
+  /**
+   * The belief relationships, transposed [b2][b], so that the change in an
+   * activation updates a contiguous column.
+   */
+  std::vector<double> relationshipsT;
+
+  /**
+   * The activations last applied, row-major [agent][belief].
+   */
+  std::vector<double> activations;
+
+  /**
+   * The exponents of the contexts, row-major [agent][belief].
+   */
+  std::vector<double> exponents;
+
+  /**
+   * The contextual activations (context times activation) last applied,
+   * row-major [agent][belief].
+   */
+  std::vector<double> contextual;
+
+  /**
+   * The utilities, row-major [agent][behaviour].
+   */
+  std::vector<double> utilities;
+
+  /**
+   * The number of rank-1 updates applied in the last tick.
+   */
+  uint64_t nUpdates = 0;
+};
+
+/**
+ * A pool of frames, which are returned to the pool when they are no longer
+ * used, to avoid allocating a frame every tick.
+ *
+ * A pool must be created with std::make_shared. Frames may outlive their
+ * pool. A pool may be used from several threads.
+ */
+class FramePool : public std::enable_shared_from_this<FramePool> {
+private:
+  /**
+   * Protects free.
+   */
+  std::mutex mutex;
+
+  /**
+   * The frames which are not in use.
+   */
+  std::vector<std::unique_ptr<Frame>> free;
+
+  /**
+   * Returns a frame to the pool.
+   *
+   * @param frame The frame.
+   */
+  void release(Frame *frame);
+
+public:
+  /**
+   * Gets a frame of the given size, from the pool if there is one.
+   *
+   * The contents of the frame are unspecified.
+   *
+   * @param nAgents The number of agents.
+   * @param nBeliefs The number of beliefs.
+   * @return The frame, which is returned to the pool when the last copy of
+   *   the pointer is destroyed.
+   */
+  std::shared_ptr<Frame> acquire(size_t nAgents, size_t nBeliefs);
+
+  /**
+   * The number of frames which are not in use.
+   *
+   * @return The number of free frames.
+   */
+  size_t nFree();
+};
+} // namespace BIBS
+
+#endif // BIBS_STATE_H
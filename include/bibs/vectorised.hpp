@@ -0,0 +1,707 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      vectorised.hpp
+ * @brief     Header of vectorised.cpp
+ * @date      Mon Oct 19 10:04:12 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains VectorisedSimulation, which simulates a Scenario with
+ * the state of all the agents in dense arrays.
+ */
+
+#ifndef BIBS_VECTORISED_H
+#define BIBS_VECTORISED_H
+
+#include "bibs/bibs.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/simulation.hpp"
+#include "bibs/state.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace BIBS {
+class BlockSparseMatrix;
+class CompressedGraph;
+class ExogenousInput;
+class HistoryWriter;
+class IChoicePolicy;
+class ScenarioImage;
+class ThreadPool;
+/**
+ * A simulation of a Scenario, which stores the state of all the agents in
+ * dense arrays (Frame) and updates them with the same equations as Agent.
+ *
+ * The random number used by each agent to choose its behaviour at each time
+ * is a function of the seed, the stream, the time and the agent only, so the
+ * result does not depend on the order in which agents are updated or on the
+ * number of threads.
+ *
+ * Copying a VectorisedSimulation is cheap: the copy shares the scenario and
+ * the frames already computed, and computes new frames of its own. A copy
+ * should be given a different stream (setStream) to diverge from the
+ * original.
+ *
+ * The arrays of the scenario are read through a ScenarioView, so they may
+ * be those of a Scenario or, used in place, those of a ScenarioImage.
+ */
+class VectorisedSimulation : public ISimulation {
+protected:
+  /**
+   * The scenario. For a simulation of an image, only its numbers of
+   * agents, beliefs and behaviours are set.
+   */
+  std::shared_ptr<const Scenario> scenario;
+
+  /**
+   * The image, or nullptr if the simulation is of a Scenario.
+   */
+  std::shared_ptr<const ScenarioImage> image;
+
+  /**
+   * The arrays of the scenario or of the image.
+   */
+  ScenarioView arrays;
+
+  /**
+   * The pool new frames are taken from.
+   */
+  std::shared_ptr<FramePool> pool;
+
+  /**
+   * The frames, oldest first. If history is not recorded, only the latest.
+   */
+  std::vector<std::shared_ptr<const Frame>> frames;
+
+  /**
+   * Whether all the frames are kept.
+   */
+  bool recordHistory;
+
+  /**
+   * The seed.
+   */
+  uint64_t seed;
+
+  /**
+   * The stream.
+   */
+  uint64_t stream = 0;
+
+  /**
+   * Whether the uniforms are complemented, so that this simulation is the
+   * antithetic partner of one with the same seed and stream.
+   */
+  bool antithetic = false;
+
+  /**
+   * The threads to update the agents with, or nullptr to update them on the
+   * calling thread.
+   */
+  ThreadPool *threads = nullptr;
+
+  /**
+   * Where each new frame is written, or nullptr.
+   */
+  HistoryWriter *historyWriter = nullptr;
+
+  /**
+   * The observers registered at run time.
+   */
+  std::vector<ITickObserver *> observers;
+
+  /**
+   * The rule by which agents choose their behaviour, defaultChoicePolicy
+   * unless set.
+   */
+  std::shared_ptr<const IChoicePolicy> choicePolicy;
+
+  /**
+   * The utilities kept between ticks in incremental mode, or empty.
+   */
+  std::optional<UtilityCache> cache;
+
+  /**
+   * The belief relationships in block sparse row form, or nullptr to use
+   * the dense matrix of the scenario.
+   */
+  std::shared_ptr<const BlockSparseMatrix> blockRelationships;
+
+  /**
+   * The friendship graph in compressed form, or nullptr to use the graph of
+   * the scenario.
+   */
+  std::shared_ptr<const CompressedGraph> graph;
+
+  /**
+   * The external signals added to the utilities, or nullptr.
+   */
+  std::shared_ptr<const ExogenousInput> exogenous;
+
+  /**
+   * The index of each agent in the random streams, or empty if it is the
+   * agent's own index. A partition of a larger simulation uses the indices
+   * of its agents in that simulation.
+   */
+  std::vector<index_t> streamIndices;
+
+  /**
+   * Creates the frame at time 0, once the arrays are set.
+   *
+   * @param activations The activations at time 0.
+   * @param performed The behaviours performed at time 0, or empty.
+   */
+  void start(const std::vector<double> &activations,
+             const std::vector<index_t> &performed);
+
+  /**
+   * Calculates the contextualisation of the activations of agents [begin,
+   * end) in frame f.
+   *
+   * @param f The frame.
+   * @param begin The first agent.
+   * @param end One past the last agent.
+   */
+  void computeContexts(Frame &f, size_t begin, size_t end) const;
+
+  /**
+   * Chooses the behaviour performed by agents [begin, end) in frame f with
+   * the choice policy, in the same way as Agent::perform.
+   *
+   * @param f The frame.
+   * @param begin The first agent.
+   * @param end One past the last agent.
+   */
+  void choose(Frame &f, size_t begin, size_t end) const;
+
+  /**
+   * Updates the cache and the contexts of agents [begin, end) in frame f from
+   * the changes in their activations since the last tick, or computes them
+   * in full.
+   *
+   * @param prev The previous frame.
+   * @param f The frame.
+   * @param begin The first agent.
+   * @param end One past the last agent.
+   * @param refresh Whether to compute them in full.
+   * @return The number of rank-1 updates applied.
+   */
+  uint64_t updateCache(const Frame &prev, Frame &f, size_t begin, size_t end,
+                       bool refresh);
+
+  /**
+   * Updates the activations of agents [begin, end) in frame f from frame
+   * prev, in the same way as Agent::updateActivation.
+   *
+   * @param prev The previous frame.
+   * @param f The frame.
+   * @param begin The first agent.
+   * @param end One past the last agent.
+   */
+  void updateActivations(const Frame &prev, Frame &f, size_t begin,
+                         size_t end) const;
+
+  /**
+   * The state of a tick in progress.
+   */
+  struct Tick {
+    /**
+     * The new frame.
+     */
+    std::shared_ptr<Frame> frame;
+
+    /**
+     * Whether the cache is computed in full.
+     */
+    bool refresh = false;
+
+    /**
+     * The digest of the new frame, summed over the chunks.
+     */
+    std::atomic<uint64_t> digest{0};
+
+    /**
+     * The number of rank-1 updates, summed over the chunks.
+     */
+    std::atomic<uint64_t> nUpdates{0};
+  };
+
+  /**
+   * Calls both a compile-time observer and the observers registered at run
+   * time.
+   */
+  template <class Observer> struct Observers {
+    /**
+     * The compile-time observer.
+     */
+    Observer &first;
+
+    /**
+     * The observers registered at run time.
+     */
+    const std::vector<ITickObserver *> &rest;
+
+    void tickStart(const Frame &previous) {
+      first.tickStart(previous);
+      for (auto *o : rest) {
+        o->tickStart(previous);
+      }
+    }
+
+    void afterActivations(const Frame &previous, const Frame &current,
+                          size_t begin, size_t end) {
+      first.afterActivations(previous, current, begin, end);
+      for (auto *o : rest) {
+        o->afterActivations(previous, current, begin, end);
+      }
+    }
+
+    void afterBehaviours(const Frame &previous, const Frame &current,
+                         size_t begin, size_t end) {
+      first.afterBehaviours(previous, current, begin, end);
+      for (auto *o : rest) {
+        o->afterBehaviours(previous, current, begin, end);
+      }
+    }
+
+    void tickEnd(const Frame &current) {
+      first.tickEnd(current);
+      for (auto *o : rest) {
+        o->tickEnd(current);
+      }
+    }
+  };
+
+  /**
+   * Starts a tick: acquires the new frame and decides whether the cache is
+   * refreshed.
+   *
+   * @param tick The tick.
+   */
+  void startTick(Tick &tick);
+
+  /**
+   * Computes the activations and contexts of agents [begin, end).
+   *
+   * @param tick The tick.
+   * @param begin The first agent.
+   * @param end One past the last agent.
+   */
+  void activate(Tick &tick, size_t begin, size_t end);
+
+  /**
+   * Chooses the behaviours of agents [begin, end), writes them to the
+   * history writer and adds them to the digest.
+   *
+   * @param tick The tick.
+   * @param begin The first agent.
+   * @param end One past the last agent.
+   */
+  void behave(Tick &tick, size_t begin, size_t end);
+
+  /**
+   * Ends a tick: makes the new frame the current one.
+   *
+   * @param tick The tick.
+   */
+  void endTick(Tick &tick);
+
+  /**
+   * Calls body(begin, end) for chunks covering all the agents, on the
+   * threads if there are any.
+   *
+   * @param body The body.
+   */
+  void forAgents(const std::function<void(size_t, size_t)> &body);
+
+  /**
+   * Advance the simulation by a single tick, calling the hooks of an
+   * observer.
+   *
+   * @param observer The observer.
+   */
+  template <class Observer> void tick(Observer &observer);
+
+  /**
+   * Advance the simulation by a single tick, calling the hooks of an
+   * observer and of the observers registered at run time.
+   *
+   * @param observer The observer.
+   */
+  template <class Observer> void step(Observer &observer);
+
+  /**
+   * Advance the simulation by a single tick.
+   */
+  virtual void step();
+
+public:
+  /**
+   * Create a new VectorisedSimulation at time 0.
+   *
+   * @param scenario The scenario.
+   * @param activations The activations at time 0, row-major
+   *   [agent][belief].
+   * @param performed The behaviours performed at time 0. If empty, the
+   *   behaviours are chosen from the activations.
+   * @param seed The seed.
+   * @param recordHistory Whether to keep the frames of all times, rather than
+   *   only the latest.
+   * @param pool The pool to take frames from. If nullptr, a new pool.
+   * @param threads The threads to update the agents with, or nullptr.
+   * @exception std::invalid_argument If the scenario is inconsistent, or the
+   *   activations or performed behaviours are the wrong size.
+   */
+  VectorisedSimulation(std::shared_ptr<const Scenario> scenario,
+                       const std::vector<double> &activations,
+                       const std::vector<index_t> &performed = {},
+                       uint64_t seed = 0, bool recordHistory = true,
+                       std::shared_ptr<FramePool> pool = nullptr,
+                       ThreadPool *threads = nullptr);
+
+  /**
+   * Create a new VectorisedSimulation of a scenario image at time 0, which
+   * reads the arrays of the image in place.
+   *
+   * @param image The image.
+   * @see VectorisedSimulation(std::shared_ptr<const Scenario>,
+   *   const std::vector<double> &, const std::vector<index_t> &, uint64_t,
+   *   bool, std::shared_ptr<FramePool>, ThreadPool *)
+   */
+  VectorisedSimulation(std::shared_ptr<const ScenarioImage> image,
+                       const std::vector<double> &activations,
+                       const std::vector<index_t> &performed = {},
+                       uint64_t seed = 0, bool recordHistory = true,
+                       std::shared_ptr<FramePool> pool = nullptr,
+                       ThreadPool *threads = nullptr);
+
+  /**
+   * Run the simulation for n days, from the latest time simulated.
+   *
+   * @param nDays the number of days.
+   */
+  void run(sim_time_t nDays) override;
+
+  /**
+   * Run the simulation for n days, from the latest time simulated, calling
+   * the hooks of an observer as well as those registered at run time.
+   *
+   * @param nDays The number of days.
+   * @param observer The observer, usually derived from TickObserver.
+   */
+  template <class Observer> void run(sim_time_t nDays, Observer &observer);
+
+  /**
+   * The latest time simulated.
+   *
+   * @return The time.
+   */
+  sim_time_t time() const;
+
+  /**
+   * Gets the scenario. For a simulation of an image, only its numbers of
+   * agents, beliefs and behaviours are set; see getArrays.
+   *
+   * @return The scenario.
+   */
+  const Scenario &getScenario() const;
+
+  /**
+   * Gets the arrays of the scenario, wherever they are stored.
+   *
+   * @return The view.
+   */
+  const ScenarioView &getArrays() const;
+
+  /**
+   * Gets the frame at a time.
+   *
+   * @param t The time.
+   * @return The frame.
+   * @exception std::out_of_range If the frame is not found.
+   */
+  const Frame &frame(sim_time_t t) const;
+
+  /**
+   * Gets the frame at a time, sharing ownership of it. The frame does not
+   * change, and outlives the simulation if need be.
+   *
+   * @param t The time.
+   * @return The frame.
+   * @exception std::out_of_range If the frame is not found.
+   */
+  std::shared_ptr<const Frame> sharedFrame(sim_time_t t) const;
+
+  /**
+   * Gets the latest frame.
+   *
+   * @return The frame.
+   */
+  const Frame &current() const;
+
+  /**
+   * Gets the digest of the state at a time. It is computed as each frame is,
+   * and does not depend on the number of threads.
+   *
+   * @param t The time.
+   * @return The digest.
+   * @exception std::out_of_range If the frame is not found.
+   */
+  uint64_t digest(sim_time_t t) const;
+
+  /**
+   * Gets the activation of a belief of an agent at a time.
+   *
+   * @param t The time.
+   * @param agent The agent.
+   * @param belief The belief.
+   * @return The activation.
+   * @exception std::out_of_range If the time, agent or belief is not found.
+   */
+  double activation(sim_time_t t, index_t agent, index_t belief) const;
+
+  /**
+   * Gets the behaviour performed by an agent at a time.
+   *
+   * @param t The time.
+   * @param agent The agent.
+   * @return The behaviour.
+   * @exception std::out_of_range If the time or agent is not found.
+   */
+  index_t performed(sim_time_t t, index_t agent) const;
+
+  /**
+   * Gets the share of agents performing each behaviour at a time.
+   *
+   * @param t The time.
+   * @return The share of each behaviour.
+   * @exception std::out_of_range If the time is not found.
+   */
+  std::vector<double> behaviourShares(sim_time_t t) const;
+
+  /**
+   * Gets the stream.
+   *
+   * @return The stream.
+   */
+  uint64_t getStream() const;
+
+  /**
+   * Sets the stream, which is used with the seed to choose behaviours from
+   * now on.
+   *
+   * @param s The stream.
+   */
+  void setStream(uint64_t s);
+
+  /**
+   * Gets whether the uniforms are complemented.
+   *
+   * @return Whether the simulation is antithetic.
+   */
+  bool isAntithetic() const;
+
+  /**
+   * Sets whether each uniform u is replaced with 1 - u from now on. Two
+   * copies with the same seed and stream, one of which is antithetic, are
+   * negatively correlated, which reduces the variance of their mean.
+   *
+   * @param a Whether the simulation is antithetic.
+   */
+  void setAntithetic(bool a);
+
+  /**
+   * Sets the threads to update the agents with.
+   *
+   * @param t The threads, or nullptr to update the agents on the calling
+   *   thread.
+   */
+  void setThreadPool(ThreadPool *t);
+
+  /**
+   * Sets where frames are written as they are computed, by the threads
+   * computing them. The current frame is written straight away. Copies of
+   * the simulation share the writer, so a copy should unset it.
+   *
+   * @param w The writer, which must outlive the simulation or be unset, or
+   *   nullptr for none.
+   * @exception std::invalid_argument If the writer is for a different
+   *   number of agents or beliefs.
+   */
+  void setHistoryWriter(HistoryWriter *w);
+
+  /**
+   * Registers an observer, whose hooks are called after those already
+   * registered. Copies of the simulation share the observers.
+   *
+   * @param o The observer, which must outlive the simulation or be removed.
+   * @exception std::invalid_argument If o is nullptr.
+   */
+  void addObserver(ITickObserver *o);
+
+  /**
+   * Unregisters an observer.
+   *
+   * @param o The observer.
+   * @exception std::out_of_range If the observer is not registered.
+   */
+  void removeObserver(ITickObserver *o);
+
+  /**
+   * Sets the rule by which agents choose their behaviour, from the next
+   * frame.
+   *
+   * @param p The policy, or nullptr for defaultChoicePolicy.
+   */
+  void setChoicePolicy(std::shared_ptr<const IChoicePolicy> p);
+
+  /**
+   * Contextualises with the belief relationships in block sparse row form,
+   * which skips the blocks of the matrix which are all 0. This is faster
+   * when the beliefs form clusters with few relationships between them. The
+   * results differ from the dense ones only by rounding.
+   *
+   * @param blockSize The size of the blocks, or 0 to use the dense matrix.
+   */
+  void setBlockSparse(size_t blockSize);
+
+  /**
+   * Observes friends through a compressed friendship graph rather than the
+   * graph of the scenario, which may then be left empty to save memory.
+   * The behaviours of the friends of each agent are summed in order of
+   * index, so the results differ from those of the scenario's graph only by
+   * rounding, unless its friends are in the same order.
+   *
+   * @param g The graph, or nullptr to use the graph of the scenario.
+   * @exception std::invalid_argument If the graph is for a different number
+   *   of agents.
+   */
+  void setCompressedGraph(std::shared_ptr<const CompressedGraph> g);
+
+  /**
+   * Adds external signals to the utilities of the behaviours they affect,
+   * from the next frame. The ticks after the next are prefetched as the
+   * simulation steps; stepping to a time the input has no tick for throws
+   * std::out_of_range, leaving the simulation unchanged.
+   *
+   * @param input The input, or nullptr for none.
+   * @exception std::invalid_argument If the input affects a behaviour not
+   *   in the scenario.
+   */
+  void setExogenousInput(std::shared_ptr<const ExogenousInput> input);
+
+  /**
+   * Keeps the utilities of the agents between ticks and updates them from
+   * the changes in activations, from the next frame.
+   *
+   * When an activation changes by more than the tolerance, the exponents of
+   * the contexts of the agent are updated with a column of the belief
+   * relationships; when a contextual activation changes by more than the
+   * tolerance, the utilities are updated with a row of the performing
+   * relationships. Smaller changes are held back until they exceed the
+   * tolerance, and everything is computed again every refreshInterval
+   * ticks, which bounds the drift from the exact values.
+   *
+   * With a tolerance of 0 the results differ from those of the exact mode
+   * only by rounding.
+   *
+   * @param tolerance The tolerance.
+   * @param refreshInterval The number of ticks between full recomputations.
+   * @exception std::invalid_argument If tolerance is negative or
+   *   refreshInterval is 0.
+   */
+  void setIncremental(double tolerance, sim_time_t refreshInterval);
+
+  /**
+   * Computes the utilities of the agents in full every tick, which is the
+   * default.
+   */
+  void setExact();
+
+  /**
+   * Whether the utilities are updated incrementally.
+   *
+   * @return Whether they are.
+   */
+  bool isIncremental() const;
+
+  /**
+   * The number of rank-1 updates applied in the last tick in incremental
+   * mode.
+   *
+   * @return The number of updates.
+   */
+  uint64_t nRankOneUpdates() const;
+
+  /**
+   * The uniform random number in [0, 1) used by an agent to choose its
+   * behaviour.
+   *
+   * @param seed The seed.
+   * @param stream The stream.
+   * @param t The time.
+   * @param agent The agent.
+   * @return The random number.
+   */
+  static double uniform(uint64_t seed, uint64_t stream, sim_time_t t,
+                        index_t agent);
+};
+
+template <class Observer>
+void VectorisedSimulation::tick(Observer &observer) {
+  Tick t;
+  startTick(t);
+  const Frame &prev = *frames.back();
+  observer.tickStart(prev);
+
+  forAgents([&](size_t begin, size_t end) {
+    activate(t, begin, end);
+    observer.afterActivations(prev, *t.frame, begin, end);
+    behave(t, begin, end);
+    observer.afterBehaviours(prev, *t.frame, begin, end);
+  });
+
+  endTick(t);
+  observer.tickEnd(*frames.back());
+}
+
+template <class Observer>
+void VectorisedSimulation::step(Observer &observer) {
+  if (observers.empty()) {
+    tick(observer);
+  } else {
+    Observers<Observer> all{observer, observers};
+    tick(all);
+  }
+}
+
+template <class Observer>
+void VectorisedSimulation::run(sim_time_t nDays, Observer &observer) {
+  for (sim_time_t i = 0; i < nDays; ++i) {
+    step(observer);
+  }
+}
+} // namespace BIBS
+
+#endif // BIBS_VECTORISED_H
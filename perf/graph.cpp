@@ -0,0 +1,206 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      graph.cpp
+ * @brief     Benchmark of the compressed friendship graph
+ * @date      Sun Oct 18 21:52:06 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains the benchmark of observation through a
+ * CompressedGraph.
+ *
+ * Usage: bibs-graph [--agents N] [--degree D] [--width W] [--blocks S,...]
+ * [--unweighted]
+ *
+ * Each of N agents has D friends, chosen uniformly from the W agents either
+ * side of it (or from all the agents if W is 0), with random weights or,
+ * if unweighted, the same weight. The total weight of the
+ * friends performing each of 4 behaviours is summed for every agent, from
+ * the compressed sparse row (CSR) graph and from CompressedGraphs with each
+ * block size and, if weighted, each weight encoding. The output is a
+ * Markdown table of the best of 5 times per edge, the bytes per edge, and
+ * the slowdown relative to CSR.
+ */
+
+#include "bibs/graph.hpp"
+#include "bibs/scenario.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+/**
+ * The number of behaviours observed.
+ */
+constexpr size_t nBehaviours = 4;
+
+std::vector<size_t> parseList(const char *arg) {
+  std::vector<size_t> values;
+  std::stringstream ss(arg);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    values.push_back(std::stoul(item));
+  }
+  return values;
+}
+
+std::string fmt(const char *format, double value) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), format, value);
+  return buffer;
+}
+
+/**
+ * The best of 5 times of a kernel, in nanoseconds per edge.
+ */
+double time(const std::function<void()> &kernel, size_t nEdges) {
+  double best = std::numeric_limits<double>::max();
+  for (int repeat = 0; repeat < 5; ++repeat) {
+    const auto start = std::chrono::steady_clock::now();
+    kernel();
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count() / nEdges);
+  }
+  return best;
+}
+
+int usage() {
+  std::cerr << "usage: bibs-graph [--agents N] [--degree D] [--width W] "
+               "[--blocks S,...] [--unweighted]\n";
+  return 2;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t nAgents = 1000000;
+  size_t degree = 32;
+  size_t width = 1000;
+  std::vector<size_t> blocks = {16, 64, 256};
+  bool weighted = true;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--agents" && hasValue) {
+      nAgents = std::stoul(argv[++i]);
+    } else if (arg == "--degree" && hasValue) {
+      degree = std::stoul(argv[++i]);
+    } else if (arg == "--width" && hasValue) {
+      width = std::stoul(argv[++i]);
+    } else if (arg == "--blocks" && hasValue) {
+      blocks = parseList(argv[++i]);
+    } else if (arg == "--unweighted") {
+      weighted = false;
+    } else {
+      return usage();
+    }
+  }
+  if (nAgents == 0 || blocks.empty() ||
+      std::find(blocks.begin(), blocks.end(), 0) != blocks.end()) {
+    return usage();
+  }
+
+  std::mt19937_64 eng(1);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::vector<BIBS::index_t> from, to;
+  std::vector<double> weights;
+  for (size_t i = 0; i < nAgents; ++i) {
+    for (size_t d = 0; d < degree; ++d) {
+      const size_t j =
+          width == 0 ? eng() % nAgents
+                     : (i + nAgents - width + eng() % (2 * width + 1)) %
+                           nAgents;
+      from.push_back(static_cast<BIBS::index_t>(i));
+      to.push_back(static_cast<BIBS::index_t>(j));
+      weights.push_back((weighted ? unit(eng) : 1.0) / degree);
+    }
+  }
+  std::vector<BIBS::index_t> performed(nAgents);
+  for (auto &k : performed) {
+    k = static_cast<BIBS::index_t>(eng() % nBehaviours);
+  }
+
+  BIBS::Scenario csr(nAgents, 0, 0);
+  csr.setEdges(from, to, weights);
+  const size_t nE = csr.nEdges();
+
+  std::vector<double> behaviourWeights(nAgents * nBehaviours);
+  const auto observeCsr = [&] {
+    for (size_t i = 0; i < nAgents; ++i) {
+      double *w = &behaviourWeights[i * nBehaviours];
+      std::fill(w, w + nBehaviours, 0.0);
+      for (auto e = csr.friendOffsets[i]; e < csr.friendOffsets[i + 1]; ++e) {
+        w[performed[csr.friends[e]]] += csr.friendWeights[e];
+      }
+    }
+  };
+  const double csrNs = time(observeCsr, nE);
+  const double csrBytes =
+      static_cast<double>((nAgents + 1) * sizeof(uint64_t) +
+                          nE * (sizeof(BIBS::index_t) + sizeof(double))) /
+      nE;
+
+  std::cout << "| graph | ns/edge | bytes/edge | slowdown |\n"
+            << "|---|---|---|---|\n"
+            << "| CSR | " << fmt("%.2f", csrNs) << " | "
+            << fmt("%.2f", csrBytes) << " | 1.00 |\n";
+
+  using Encoding = BIBS::CompressedGraph::WeightEncoding;
+  std::vector<std::pair<std::string, Encoding>> encodings = {
+      {"", Encoding::exact}};
+  if (weighted) {
+    encodings = {{" exact", Encoding::exact},
+                 {" single", Encoding::single},
+                 {" quantised", Encoding::quantised}};
+  }
+
+  for (auto s : blocks) {
+    for (const auto &[name, encoding] : encodings) {
+      const BIBS::CompressedGraph g(nAgents, from, to, weights, s, nullptr,
+                                    encoding);
+      const auto observeCompressed = [&] {
+        for (size_t i = 0; i < nAgents; ++i) {
+          double *w = &behaviourWeights[i * nBehaviours];
+          std::fill(w, w + nBehaviours, 0.0);
+          g.forEachFriend(static_cast<BIBS::index_t>(i),
+                          [&](BIBS::index_t j, double x) {
+                            w[performed[j]] += x;
+                          });
+        }
+      };
+      const double ns = time(observeCompressed, nE);
+      std::cout << "| compressed " << s << name << " | " << fmt("%.2f", ns)
+                << " | "
+                << fmt("%.2f", static_cast<double>(g.memoryBytes()) / nE)
+                << " | " << fmt("%.2f", ns / csrNs) << " |\n";
+    }
+  }
+
+  return 0;
+}
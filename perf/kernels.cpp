@@ -0,0 +1,163 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      kernels.cpp
+ * @date      Sun Oct 18 20:58:17 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains the benchmark of the contextualisation kernels.
+ *
+ * Usage: bibs-kernels [--beliefs B,...] [--cluster C] [--links L]
+ * [--blocks S,...] [--agents N]
+ *
+ * For each number of beliefs, belief relationships made of clusters of C
+ * beliefs with L random links between clusters are multiplied by the
+ * activations of N agents with the dense, CSR and BSR (for each block size)
+ * kernels. The output is a Markdown table of the best of 5 times per agent.
+ */
+
+#include "bibs/blocksparse.hpp"
+
+#include "scenario.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+std::vector<size_t> parseList(const char *arg) {
+  std::vector<size_t> values;
+  std::stringstream ss(arg);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    values.push_back(std::stoul(item));
+  }
+  return values;
+}
+
+std::string fmt(const char *format, double value) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), format, value);
+  return buffer;
+}
+
+/**
+ * The best of 5 times of a kernel, in nanoseconds per agent.
+ */
+double time(const std::function<void()> &kernel, size_t nAgents) {
+  double best = std::numeric_limits<double>::max();
+  for (int repeat = 0; repeat < 5; ++repeat) {
+    const auto start = std::chrono::steady_clock::now();
+    kernel();
+    const std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+    best = std::min(best, elapsed.count() / nAgents);
+  }
+  return best;
+}
+
+int usage() {
+  std::cerr << "usage: bibs-kernels [--beliefs B,...] [--cluster C] "
+               "[--links L] [--blocks S,...] [--agents N]\n";
+  return 2;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<size_t> beliefs = {64, 256, 1024};
+  std::vector<size_t> blocks = {4, 8, 16};
+  size_t cluster = 16;
+  size_t links = 32;
+  size_t nAgents = 2000;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--beliefs" && hasValue) {
+      beliefs = parseList(argv[++i]);
+    } else if (arg == "--blocks" && hasValue) {
+      blocks = parseList(argv[++i]);
+    } else if (arg == "--cluster" && hasValue) {
+      cluster = std::stoul(argv[++i]);
+    } else if (arg == "--links" && hasValue) {
+      links = std::stoul(argv[++i]);
+    } else if (arg == "--agents" && hasValue) {
+      nAgents = std::stoul(argv[++i]);
+    } else {
+      return usage();
+    }
+  }
+  if (beliefs.empty() || blocks.empty() || cluster == 0 || nAgents == 0 ||
+      std::find(blocks.begin(), blocks.end(), 0) != blocks.end()) {
+    return usage();
+  }
+
+  std::cout << "| B | dense ns | CSR ns |";
+  for (auto s : blocks) {
+    std::cout << " BSR " << s << " ns | blocks |";
+  }
+  std::cout << "\n|---|---|---|";
+  for (size_t s = 0; s < blocks.size(); ++s) {
+    std::cout << "---|---|";
+  }
+  std::cout << "\n";
+
+  for (auto nB : beliefs) {
+    const auto r = BIBS::testing::clusteredRelationships(nB, cluster, links);
+    std::mt19937_64 eng(1);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<double> x(nAgents * nB);
+    for (auto &v : x) {
+      v = unit(eng);
+    }
+    std::vector<double> y(nAgents * nB);
+
+    std::cout << "| " << nB << " | "
+              << fmt("%.1f", time(
+                                 [&] {
+                                   BIBS::denseMultiply(r.data(), nB, nB,
+                                                       x.data(), y.data(),
+                                                       nAgents);
+                                 },
+                                 nAgents));
+    const BIBS::CsrMatrix csr(r, nB, nB);
+    std::cout << " | "
+              << fmt("%.1f", time([&] { csr.multiply(x.data(), y.data(),
+                                                     nAgents); },
+                                  nAgents))
+              << " |";
+    for (auto s : blocks) {
+      const BIBS::BlockSparseMatrix bsr(r, nB, nB, s);
+      std::cout << " "
+                << fmt("%.1f", time([&] { bsr.multiply(x.data(), y.data(),
+                                                       nAgents); },
+                                    nAgents))
+                << " | " << bsr.nBlocks() << " |";
+    }
+    std::cout << "\n";
+  }
+
+  return 0;
+}
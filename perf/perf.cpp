@@ -0,0 +1,385 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      perf.cpp
+ * @date      Sun Oct 18 16:20:45 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains the performance regression gate, run by
+ * `meson test --suite perf`.
+ *
+ * Usage: bibs-perf BENCHMARK BASELINE [--tolerance T] [--memory-tolerance M]
+ * [--update]
+ *
+ * Runs a fixed benchmark and compares its relative throughput and memory
+ * against the baseline file. It fails if the relative throughput is more
+ * than T (default 0.5) below the baseline, or the memory more than M
+ * (default 0.25) above it. With --update, the baseline of the benchmark is
+ * replaced by the measurement instead.
+ *
+ * The throughput (agent-ticks per second, best of several repetitions) is
+ * divided by the rate of a calibration loop of exponentials over an array
+ * run in the same process, which is the kind of work a tick does, so that
+ * the baseline holds across machines of different speeds. It should still
+ * be regenerated when the compiler or the kind of machine changes.
+ *
+ * The memory is the growth of the resident memory during the timed run,
+ * from the peak (VmHWM) reset just before it, so it excludes setting up the
+ * scenario and the agents. Where the peak cannot be reset, the peak of the
+ * whole process is used instead.
+ *
+ * The baseline file has a line "BENCHMARK RELATIVE_THROUGHPUT MEMORY_KIB" per
+ * benchmark; lines starting with # are comments.
+ */
+
+#include "bibs/bibs.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/simulation.hpp"
+#include "bibs/vectorised.hpp"
+
+#include "scenario.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+namespace {
+using BIBS::sim_time_t;
+
+/**
+ * The number of times each benchmark is timed.
+ */
+constexpr int repetitions = 3;
+
+/**
+ * The number of times the calibration loop is timed.
+ */
+constexpr int calibrationRepetitions = 5;
+
+/**
+ * The number of doubles in the array of the calibration loop, 8 MiB, which
+ * is more than most caches hold.
+ */
+constexpr size_t calibrationSize = size_t(1) << 20;
+
+/**
+ * The number of passes of the calibration loop over its array.
+ */
+constexpr int calibrationPasses = 8;
+
+/**
+ * Where the calibration loop writes its sum, so that it is not optimised
+ * away.
+ */
+volatile double calibrationSink = 0.0;
+
+/**
+ * A function which sets up a run of a scenario, and returns the timed part.
+ */
+typedef std::function<std::function<void()>(
+    const std::shared_ptr<BIBS::Scenario> &, const std::vector<double> &,
+    sim_time_t)>
+    setup_t;
+
+/**
+ * A benchmark.
+ */
+struct Benchmark {
+  size_t nAgents;
+  sim_time_t nTicks;
+  setup_t setUp;
+};
+
+std::function<void()> sequential(const std::shared_ptr<BIBS::Scenario> &s,
+                                 const std::vector<double> &activations,
+                                 sim_time_t nTicks) {
+  // SequentialSimulation starts at time 0, so the initial state is at time
+  // -1.
+  const sim_time_t start = std::numeric_limits<sim_time_t>::max();
+  auto o = std::make_shared<BIBS::testing::ScenarioObjects>(
+      *s, activations, std::nullopt, start);
+  for (auto &a : o->agents) {
+    a->perform(start, o->constBehaviours);
+  }
+  auto sim = std::make_shared<BIBS::SequentialSimulation>(
+      o->ptrAgents, o->ptrBeliefs, o->ptrBehaviours);
+  return [o, sim, nTicks] { sim->run(nTicks); };
+}
+
+setup_t vectorised(size_t nThreads) {
+  return [nThreads](const std::shared_ptr<BIBS::Scenario> &s,
+                    const std::vector<double> &activations,
+                    sim_time_t nTicks) -> std::function<void()> {
+    auto threads =
+        nThreads > 1 ? std::make_shared<BIBS::ThreadPool>(nThreads) : nullptr;
+    auto sim = std::make_shared<BIBS::VectorisedSimulation>(
+        s, activations, std::vector<BIBS::index_t>{}, 1, false, nullptr,
+        threads.get());
+    return [threads, sim, nTicks] { sim->run(nTicks); };
+  };
+}
+
+std::map<std::string, Benchmark> benchmarks() {
+  return {{"sequential", {2000, 10, sequential}},
+          {"vectorised", {100000, 20, vectorised(1)}},
+          {"vectorised-4-threads", {100000, 20, vectorised(4)}}};
+}
+
+/**
+ * A line of the baseline file.
+ */
+struct Baseline {
+  /**
+   * The agent-ticks per element of the calibration loop.
+   */
+  double throughput;
+
+  /**
+   * The growth of the resident memory during the run, in KiB.
+   */
+  long memory;
+};
+
+double since(std::chrono::steady_clock::time_point start) {
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+/**
+ * The rate of the calibration loop, in elements per second, best of
+ * several repetitions.
+ */
+double calibrate() {
+  std::vector<double> x(calibrationSize);
+  for (size_t i = 0; i < x.size(); ++i) {
+    x[i] = static_cast<double>(i % 1000) / 1000;
+  }
+
+  double best = std::numeric_limits<double>::max();
+  for (int r = 0; r < calibrationRepetitions; ++r) {
+    const auto start = std::chrono::steady_clock::now();
+    double sum = 0.0;
+    for (int pass = 0; pass < calibrationPasses; ++pass) {
+      for (auto v : x) {
+        sum += std::exp(-v);
+      }
+    }
+    calibrationSink = sum;
+    best = std::min(best, since(start));
+  }
+  return static_cast<double>(calibrationPasses) * calibrationSize / best;
+}
+
+/**
+ * Reads a field of /proc/self/status, in KiB.
+ *
+ * @param field The field, such as "VmRSS".
+ * @return The value, or nullopt if it is not found.
+ */
+std::optional<long> statusKib(const std::string &field) {
+  std::ifstream in("/proc/self/status");
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.compare(0, field.size() + 1, field + ":") == 0) {
+      return std::stol(line.substr(field.size() + 1));
+    }
+  }
+  return std::nullopt;
+}
+
+/**
+ * Resets the peak resident memory (VmHWM) of the process to the current.
+ *
+ * @return Whether it was reset.
+ */
+bool resetPeakRss() {
+  std::ofstream out("/proc/self/clear_refs");
+  out << "5" << std::flush;
+  return static_cast<bool>(out);
+}
+
+/**
+ * The peak resident memory since resetPeakRss, or of the whole process if
+ * it was not reset, in KiB.
+ */
+long peakRss(bool reset) {
+  if (reset) {
+    if (const auto hwm = statusKib("VmHWM")) {
+      return *hwm;
+    }
+  }
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+std::map<std::string, Baseline> readBaselines(const std::string &path) {
+  std::map<std::string, Baseline> baselines;
+  std::ifstream in(path);
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream fields(line);
+    std::string name;
+    Baseline b;
+    if (fields >> name >> b.throughput >> b.memory) {
+      baselines[name] = b;
+    }
+  }
+  return baselines;
+}
+
+/**
+ * Replaces the line of a benchmark in the baseline file, keeping the others
+ * and the comments.
+ */
+void writeBaseline(const std::string &path, const std::string &name,
+                   const Baseline &b) {
+  std::vector<std::string> lines;
+  {
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+      std::istringstream fields(line);
+      std::string first;
+      fields >> first;
+      if (first != name) {
+        lines.push_back(line);
+      }
+    }
+  }
+  std::ostringstream line;
+  line << name << " " << b.throughput << " " << b.memory;
+  lines.push_back(line.str());
+
+  std::ofstream out(path);
+  for (const auto &l : lines) {
+    out << l << "\n";
+  }
+}
+
+int usage() {
+  std::cerr << "usage: bibs-perf BENCHMARK BASELINE [--tolerance T] "
+               "[--memory-tolerance M] [--update]\n";
+  return 2;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    return usage();
+  }
+  const std::string name = argv[1];
+  const std::string path = argv[2];
+  double tolerance = 0.5;
+  double memoryTolerance = 0.25;
+  bool update = false;
+  for (int i = 3; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--tolerance" && i + 1 < argc) {
+      tolerance = std::atof(argv[++i]);
+    } else if (arg == "--memory-tolerance" && i + 1 < argc) {
+      memoryTolerance = std::atof(argv[++i]);
+    } else if (arg == "--update") {
+      update = true;
+    } else {
+      return usage();
+    }
+  }
+
+  const auto all = benchmarks();
+  const auto it = all.find(name);
+  if (it == all.end()) {
+    std::cerr << "unknown benchmark " << name << "\n";
+    return usage();
+  }
+  const auto &benchmark = it->second;
+
+  const auto scenario = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(benchmark.nAgents, 3, 3, 8, false));
+  const auto activations = BIBS::testing::randomActivations(*scenario);
+
+  const double rate = calibrate();
+  double best = std::numeric_limits<double>::max();
+  long memory = 0;
+  for (int r = 0; r < repetitions; ++r) {
+    auto run = benchmark.setUp(scenario, activations, benchmark.nTicks);
+    const long before = statusKib("VmRSS").value_or(0);
+    const bool reset = resetPeakRss();
+    const auto start = std::chrono::steady_clock::now();
+    run();
+    best = std::min(best, since(start));
+    memory = std::max(memory, peakRss(reset) - before);
+  }
+
+  const double agentTicks =
+      static_cast<double>(benchmark.nAgents) * benchmark.nTicks / best;
+  const Baseline measured = {agentTicks / rate, memory};
+
+  std::cout << name << ": " << agentTicks << " agent-ticks/s, calibration "
+            << rate << " elements/s, relative throughput "
+            << measured.throughput << ", memory " << measured.memory
+            << " KiB\n";
+
+  if (update) {
+    writeBaseline(path, name, measured);
+    std::cout << "baseline updated\n";
+    return 0;
+  }
+
+  const auto baselines = readBaselines(path);
+  const auto b = baselines.find(name);
+  if (b == baselines.end()) {
+    std::cerr << "no baseline for " << name << " in " << path
+              << "; run with --update to add one\n";
+    return 1;
+  }
+
+  const double minThroughput = b->second.throughput * (1.0 - tolerance);
+  const double maxMemory = b->second.memory * (1.0 + memoryTolerance);
+  std::cout << "baseline: relative throughput " << b->second.throughput
+            << " (min " << minThroughput << "), memory " << b->second.memory
+            << " KiB (max " << maxMemory << ")\n";
+
+  bool ok = true;
+  if (measured.throughput < minThroughput) {
+    std::cerr << "throughput regression\n";
+    ok = false;
+  }
+  if (measured.memory > maxMemory) {
+    std::cerr << "memory regression\n";
+    ok = false;
+  }
+  return ok ? 0 : 1;
+}
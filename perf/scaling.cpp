@@ -0,0 +1,495 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      scaling.cpp
+ * @date      Sun Oct 18 16:58:10 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains the scaling study harness.
+ *
+ * Usage: bibs-scaling [--agents N,...] [--beliefs B,...]
+ * [--behaviours K,...] [--degree D,...] [--threads P,...] [--ticks T]
+ * [--sequential]
+ *
+ * For every combination of the lists, a VectorisedSimulation is run for T
+ * ticks to measure its throughput, then again with each phase of a tick
+ * (observe and update, contextualise, choose, digest) run as a separate
+ * parallel pass, to time the phases. The bytes moved and FLOPs of each phase
+ * are estimated from the sizes of the arrays it reads and writes (each
+ * counted once; the small relationship matrices are assumed to be in
+ * cache, and exp counts as one FLOP). With --sequential, Agents under
+ * SequentialSimulation are also timed, for up to 20000 agents.
+ *
+ * The output is a Markdown table of every run, then for each number of
+ * beliefs, behaviours and friends a strong-scaling (largest population,
+ * every thread count) and a weak-scaling (smallest population per thread)
+ * table, each by phase and against the measured 1-thread run, and the
+ * arithmetic intensity of each phase.
+ */
+
+#include "bibs/bibs.hpp"
+#include "bibs/digest.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/simulation.hpp"
+#include "bibs/state.hpp"
+#include "bibs/vectorised.hpp"
+
+#include "scenario.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+using BIBS::index_t;
+using BIBS::sim_time_t;
+
+/**
+ * The phases of a tick.
+ */
+enum Phase {
+  observePhase,
+  contextualisePhase,
+  choosePhase,
+  digestPhase,
+  nPhases
+};
+
+const char *phaseNames[nPhases] = {"observe", "contextualise", "choose",
+                                   "digest"};
+
+/**
+ * The size of a problem.
+ */
+struct Size {
+  size_t nAgents;
+  size_t nBeliefs;
+  size_t nBehaviours;
+  size_t degree;
+};
+
+/**
+ * The estimated bytes moved and FLOPs of a phase, per agent per tick.
+ */
+struct Cost {
+  double bytes;
+  double flops;
+};
+
+Cost cost(Phase p, const Size &s) {
+  const double b = s.nBeliefs;
+  const double k = s.nBehaviours;
+  const double d = s.degree;
+  switch (p) {
+  case observePhase:
+    // Offset; friend, weight and friend's behaviour per friend; previous
+    // activation, context and time delta, and new activation per belief.
+    return {8 + 16 * d + 32 * b, d + 2 * b * k + 3 * b};
+  case contextualisePhase:
+    return {16 * b, 2 * b * b + b};
+  case choosePhase:
+    return {16 * b + 4, b + 2 * b * k + 2 * k};
+  default:
+    return {8 * b + 4, 0};
+  }
+}
+
+/**
+ * A VectorisedSimulation which runs each phase of a tick as a separate pass,
+ * and times them.
+ */
+class PhasedSimulation : public BIBS::VectorisedSimulation {
+public:
+  using VectorisedSimulation::VectorisedSimulation;
+
+  /**
+   * The seconds spent in each phase.
+   */
+  std::array<double, nPhases> seconds{};
+
+protected:
+  void step() override {
+    const size_t nA = scenario->nAgents;
+    const size_t nB = scenario->nBeliefs;
+
+    const BIBS::Frame &prev = *frames.back();
+    auto f = pool->acquire(nA, nB);
+    f->t = prev.t + 1;
+
+    auto phase = [&](Phase p, const std::function<void(size_t, size_t)> &fn) {
+      const auto start = std::chrono::steady_clock::now();
+      if (threads == nullptr) {
+        fn(0, nA);
+      } else {
+        threads->parallelFor(nA, 256, fn);
+      }
+      const std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      seconds[p] += elapsed.count();
+    };
+
+    std::atomic<uint64_t> sum(0);
+    phase(observePhase, [&](size_t begin, size_t end) {
+      updateActivations(prev, *f, begin, end);
+    });
+    phase(contextualisePhase, [&](size_t begin, size_t end) {
+      computeContexts(*f, begin, end);
+    });
+    phase(choosePhase,
+          [&](size_t begin, size_t end) { choose(*f, begin, end); });
+    phase(digestPhase, [&](size_t begin, size_t end) {
+      sum.fetch_add(
+          BIBS::stateDigest(f->activations, f->performed, nB, begin, end),
+          std::memory_order_relaxed);
+    });
+    f->digest = sum.load(std::memory_order_relaxed);
+
+    if (recordHistory) {
+      frames.push_back(std::move(f));
+    } else {
+      frames.back() = std::move(f);
+    }
+  }
+};
+
+/**
+ * The measurements of a run.
+ */
+struct Run {
+  Size size;
+  size_t nThreads;
+  /**
+   * Seconds per tick of the VectorisedSimulation.
+   */
+  double tick;
+  /**
+   * Seconds per tick of each phase.
+   */
+  std::array<double, nPhases> phases;
+  /**
+   * Seconds per tick of the SequentialSimulation, if run.
+   */
+  std::optional<double> sequential;
+};
+
+double since(std::chrono::steady_clock::time_point start) {
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+Run measure(const Size &size, size_t nThreads, sim_time_t nTicks,
+            bool sequential) {
+  auto s = std::make_shared<BIBS::Scenario>(BIBS::testing::randomScenario(
+      size.nAgents, size.nBeliefs, size.nBehaviours, size.degree, false));
+  const auto activations = BIBS::testing::randomActivations(*s);
+  std::unique_ptr<BIBS::ThreadPool> threads;
+  if (nThreads > 1) {
+    threads = std::make_unique<BIBS::ThreadPool>(nThreads);
+  }
+
+  Run run{size, nThreads, 0, {}, std::nullopt};
+
+  BIBS::VectorisedSimulation fused(s, activations, {}, 1, false, nullptr,
+                                   threads.get());
+  auto start = std::chrono::steady_clock::now();
+  fused.run(nTicks);
+  run.tick = since(start) / nTicks;
+
+  PhasedSimulation phased(s, activations, {}, 1, false, nullptr,
+                          threads.get());
+  phased.run(nTicks);
+  for (size_t p = 0; p < nPhases; ++p) {
+    run.phases[p] = phased.seconds[p] / nTicks;
+  }
+
+  if (sequential && size.nAgents <= 20000) {
+    // SequentialSimulation starts at time 0, so the initial state is at
+    // time -1.
+    const sim_time_t first = std::numeric_limits<sim_time_t>::max();
+    BIBS::testing::ScenarioObjects o(*s, activations, std::nullopt, first);
+    for (auto &a : o.agents) {
+      a->perform(first, o.constBehaviours);
+    }
+    BIBS::SequentialSimulation sim(o.ptrAgents, o.ptrBeliefs,
+                                   o.ptrBehaviours);
+    start = std::chrono::steady_clock::now();
+    sim.run(nTicks);
+    run.sequential = since(start) / nTicks;
+  }
+
+  return run;
+}
+
+std::vector<size_t> parseList(const char *arg) {
+  std::vector<size_t> values;
+  std::stringstream ss(arg);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    values.push_back(std::stoul(item));
+  }
+  return values;
+}
+
+std::string fmt(const char *format, double value) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), format, value);
+  return buffer;
+}
+
+void printRuns(const std::vector<Run> &runs) {
+  std::cout << "## Runs\n\n| N | B | K | D | threads | agent-ticks/s |";
+  for (size_t p = 0; p < nPhases; ++p) {
+    std::cout << " " << phaseNames[p] << " ms | GB/s | GFLOP/s |";
+  }
+  std::cout << " sequential agent-ticks/s |\n|";
+  for (size_t c = 0; c < 7 + 3 * nPhases; ++c) {
+    std::cout << "---|";
+  }
+  std::cout << "\n";
+
+  for (const auto &r : runs) {
+    const double n = r.size.nAgents;
+    std::cout << "| " << r.size.nAgents << " | " << r.size.nBeliefs << " | "
+              << r.size.nBehaviours << " | " << r.size.degree << " | "
+              << r.nThreads << " | " << fmt("%.3g", n / r.tick) << " |";
+    for (size_t p = 0; p < nPhases; ++p) {
+      const auto c = cost(static_cast<Phase>(p), r.size);
+      const double t = r.phases[p];
+      std::cout << " " << fmt("%.3f", 1e3 * t) << " | "
+                << fmt("%.2f", c.bytes * n / t / 1e9) << " | "
+                << fmt("%.2f", c.flops * n / t / 1e9) << " |";
+    }
+    std::cout << " "
+              << (r.sequential ? fmt("%.3g", n / *r.sequential) : "-")
+              << " |\n";
+  }
+  std::cout << "\n";
+}
+
+bool sameProblem(const Size &a, const Size &b) {
+  return a.nBeliefs == b.nBeliefs && a.nBehaviours == b.nBehaviours &&
+         a.degree == b.degree;
+}
+
+/**
+ * The run of a problem with a number of agents and threads, or nullptr.
+ */
+const Run *findRun(const std::vector<Run> &runs, const Size &problem,
+                   size_t nAgents, size_t nThreads) {
+  const auto it = std::find_if(runs.begin(), runs.end(), [&](auto &r) {
+    return r.size.nAgents == nAgents && r.nThreads == nThreads &&
+           sameProblem(r.size, problem);
+  });
+  return it != runs.end() ? &*it : nullptr;
+}
+
+/**
+ * The header of a scaling table, with a ms and ratio column for each phase.
+ */
+void printScalingHeader(const std::string &title, const std::string &columns,
+                        size_t nColumns, const char *ratio) {
+  std::cout << "## " << title << "\n\n| " << columns << " |";
+  for (size_t p = 0; p < nPhases; ++p) {
+    std::cout << " " << phaseNames[p] << " ms | " << ratio << " |";
+  }
+  std::cout << "\n|";
+  for (size_t c = 0; c < nColumns + 2 * nPhases; ++c) {
+    std::cout << "---|";
+  }
+  std::cout << "\n";
+}
+
+/**
+ * The time of a run and of each of its phases, with the ratio of those of
+ * the 1-thread run to them, or "-" if there is no such run.
+ */
+void printScalingTimes(const Run &r, const Run *one) {
+  for (size_t p = 0; p < nPhases; ++p) {
+    std::cout << " " << fmt("%.3f", 1e3 * r.phases[p]) << " | "
+              << (one ? fmt("%.2f", one->phases[p] / r.phases[p]) : "-")
+              << " |";
+  }
+  std::cout << "\n";
+}
+
+void printScaling(const std::vector<Run> &runs, const std::vector<Size> &sizes,
+                  const std::vector<size_t> &agents,
+                  const std::vector<size_t> &threads) {
+  for (const auto &s : sizes) {
+    const std::string problem = ", B = " + std::to_string(s.nBeliefs) +
+                                ", K = " + std::to_string(s.nBehaviours) +
+                                ", D = " + std::to_string(s.degree);
+
+    // Against the same population on 1 thread.
+    const size_t n = agents.back();
+    const Run *one = findRun(runs, s, n, 1);
+    printScalingHeader("Strong scaling (N = " + std::to_string(n) +
+                           problem + ")",
+                       "threads | ms/tick | speedup | efficiency", 4,
+                       "speedup");
+    for (auto p : threads) {
+      const Run *r = findRun(runs, s, n, p);
+      if (r == nullptr) {
+        continue;
+      }
+      std::cout << "| " << p << " | " << fmt("%.3f", 1e3 * r->tick) << " | "
+                << (one ? fmt("%.2f", one->tick / r->tick) : "-") << " | "
+                << (one ? fmt("%.2f", one->tick / r->tick / p) : "-")
+                << " |";
+      printScalingTimes(*r, one);
+    }
+    std::cout << "\n";
+
+    // Against the population per thread on 1 thread.
+    one = findRun(runs, s, agents.front(), 1);
+    printScalingHeader("Weak scaling (N = " +
+                           std::to_string(agents.front()) + " per thread" +
+                           problem + ")",
+                       "threads | N | ms/tick | efficiency", 4, "efficiency");
+    for (auto p : threads) {
+      const Run *r = findRun(runs, s, agents.front() * p, p);
+      if (r == nullptr) {
+        continue;
+      }
+      std::cout << "| " << p << " | " << r->size.nAgents << " | "
+                << fmt("%.3f", 1e3 * r->tick) << " | "
+                << (one ? fmt("%.2f", one->tick / r->tick) : "-") << " |";
+      printScalingTimes(*r, one);
+    }
+    std::cout << "\n";
+  }
+}
+
+void printIntensity(const std::vector<Size> &sizes) {
+  std::cout << "## Arithmetic intensity (FLOP/byte)\n\n| B | K | D |";
+  for (size_t p = 0; p < nPhases; ++p) {
+    std::cout << " " << phaseNames[p] << " |";
+  }
+  std::cout << "\n|---|---|---|";
+  for (size_t p = 0; p < nPhases; ++p) {
+    std::cout << "---|";
+  }
+  std::cout << "\n";
+  for (const auto &s : sizes) {
+    std::cout << "| " << s.nBeliefs << " | " << s.nBehaviours << " | "
+              << s.degree << " |";
+    for (size_t p = 0; p < nPhases; ++p) {
+      const auto c = cost(static_cast<Phase>(p), s);
+      std::cout << " " << fmt("%.3f", c.flops / c.bytes) << " |";
+    }
+    std::cout << "\n";
+  }
+}
+
+int usage() {
+  std::cerr << "usage: bibs-scaling [--agents N,...] [--beliefs B,...] "
+               "[--behaviours K,...] [--degree D,...] [--threads P,...] "
+               "[--ticks T] [--sequential]\n";
+  return 2;
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  std::vector<size_t> agents = {10000, 40000};
+  std::vector<size_t> beliefs = {3, 10};
+  std::vector<size_t> behaviours = {3};
+  std::vector<size_t> degrees = {8};
+  std::vector<size_t> threads = {1, 2, 4};
+  sim_time_t nTicks = 10;
+  bool sequential = false;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--agents" && hasValue) {
+      agents = parseList(argv[++i]);
+    } else if (arg == "--beliefs" && hasValue) {
+      beliefs = parseList(argv[++i]);
+    } else if (arg == "--behaviours" && hasValue) {
+      behaviours = parseList(argv[++i]);
+    } else if (arg == "--degree" && hasValue) {
+      degrees = parseList(argv[++i]);
+    } else if (arg == "--threads" && hasValue) {
+      threads = parseList(argv[++i]);
+    } else if (arg == "--ticks" && hasValue) {
+      nTicks = static_cast<sim_time_t>(std::stoul(argv[++i]));
+    } else if (arg == "--sequential") {
+      sequential = true;
+    } else {
+      return usage();
+    }
+  }
+  if (agents.empty() || beliefs.empty() || behaviours.empty() ||
+      degrees.empty() || threads.empty() || nTicks == 0) {
+    return usage();
+  }
+  std::sort(agents.begin(), agents.end());
+  std::sort(threads.begin(), threads.end());
+
+  std::vector<Size> sizes;
+  for (auto b : beliefs) {
+    for (auto k : behaviours) {
+      for (auto d : degrees) {
+        sizes.push_back({0, b, k, d});
+      }
+    }
+  }
+
+  // The populations of the weak-scaling runs are added to those asked for.
+  std::vector<Run> runs;
+  for (const auto &s : sizes) {
+    std::vector<std::pair<size_t, size_t>> points;
+    for (auto n : agents) {
+      for (auto p : threads) {
+        points.emplace_back(n, p);
+      }
+    }
+    for (auto p : threads) {
+      points.emplace_back(agents.front() * p, p);
+    }
+    std::sort(points.begin(), points.end());
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+
+    for (const auto &[n, p] : points) {
+      Size size = s;
+      size.nAgents = n;
+      runs.push_back(measure(size, p, nTicks, sequential));
+      std::cerr << "measured N=" << n << " B=" << s.nBeliefs
+                << " K=" << s.nBehaviours << " D=" << s.degree
+                << " threads=" << p << "\n";
+    }
+  }
+
+  printRuns(runs);
+  printScaling(runs, sizes, agents, threads);
+  printIntensity(sizes);
+  return 0;
+}
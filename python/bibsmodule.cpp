@@ -0,0 +1,819 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      bibsmodule.cpp
+ * @date      Sun Oct 18 14:48:12 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains the Python extension module bibs. It exposes
+ * Scenario and VectorisedSimulation, and gives their arrays to Python as
+ * read-only buffers (bibs.View) without copying them, so that
+ * numpy.asarray(sim.activations()) is a view of the simulation's frame.
+ * A View keeps what it points into alive. Runs release the GIL.
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "bibs/bibs.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/state.hpp"
+#include "bibs/vectorised.hpp"
+
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+/**
+ * A read-only buffer into memory owned by a shared_ptr.
+ */
+struct ViewObject {
+  PyObject_HEAD
+  std::shared_ptr<const void> owner;
+  const void *data;
+  char format[2];
+  Py_ssize_t itemsize;
+  int ndim;
+  Py_ssize_t shape[2];
+  Py_ssize_t strides[2];
+};
+
+/**
+ * A Scenario. The scenario is shared with the simulations and views made
+ * from it, and is copied before being changed if so.
+ */
+struct ScenarioObject {
+  PyObject_HEAD
+  std::shared_ptr<BIBS::Scenario> scenario;
+};
+
+/**
+ * A VectorisedSimulation.
+ */
+struct SimulationObject {
+  PyObject_HEAD
+  std::unique_ptr<BIBS::ThreadPool> threads;
+  std::unique_ptr<BIBS::VectorisedSimulation> simulation;
+  /**
+   * Whether a run is in progress on another thread, without the GIL.
+   */
+  bool busy;
+};
+
+PyTypeObject ViewType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+PyTypeObject ScenarioType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+PyTypeObject SimulationType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+/**
+ * Sets the Python error for an exception.
+ *
+ * @param error The exception, by default the one being handled.
+ */
+void setError(std::exception_ptr error = std::current_exception()) {
+  try {
+    std::rethrow_exception(error);
+  } catch (const std::invalid_argument &e) {
+    PyErr_SetString(PyExc_ValueError, e.what());
+  } catch (const std::out_of_range &e) {
+    PyErr_SetString(PyExc_IndexError, e.what());
+  } catch (const std::bad_alloc &) {
+    PyErr_NoMemory();
+  } catch (const std::exception &e) {
+    PyErr_SetString(PyExc_RuntimeError, e.what());
+  } catch (...) {
+    PyErr_SetString(PyExc_RuntimeError, "unknown error");
+  }
+}
+
+/**
+ * Makes a View.
+ *
+ * @param owner The owner of the memory.
+ * @param data The memory.
+ * @param format The struct format of an item.
+ * @param itemsize The size of an item.
+ * @param rows The number of rows.
+ * @param cols The number of columns, or 0 for a one-dimensional view.
+ * @return The view, or nullptr with the Python error set.
+ */
+PyObject *makeView(std::shared_ptr<const void> owner, const void *data,
+                   char format, Py_ssize_t itemsize, Py_ssize_t rows,
+                   Py_ssize_t cols = 0) {
+  auto *v = reinterpret_cast<ViewObject *>(ViewType.tp_alloc(&ViewType, 0));
+  if (v == nullptr) {
+    return nullptr;
+  }
+  new (&v->owner) std::shared_ptr<const void>(std::move(owner));
+  // An empty vector may have no data, but a buffer needs a pointer.
+  static const double empty = 0;
+  v->data = data != nullptr ? data : &empty;
+  v->format[0] = format;
+  v->format[1] = '\0';
+  v->itemsize = itemsize;
+  v->ndim = cols == 0 ? 1 : 2;
+  v->shape[0] = rows;
+  v->shape[1] = cols;
+  v->strides[0] = cols == 0 ? itemsize : cols * itemsize;
+  v->strides[1] = itemsize;
+  return reinterpret_cast<PyObject *>(v);
+}
+
+void View_dealloc(ViewObject *self) {
+  self->owner.~shared_ptr();
+  Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+}
+
+int View_getbuffer(ViewObject *self, Py_buffer *view, int flags) {
+  if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE) {
+    PyErr_SetString(PyExc_BufferError, "bibs.View is read-only");
+    view->obj = nullptr;
+    return -1;
+  }
+  view->obj = reinterpret_cast<PyObject *>(self);
+  Py_INCREF(self);
+  view->buf = const_cast<void *>(self->data);
+  view->len = self->itemsize * self->shape[0] *
+              (self->ndim == 2 ? self->shape[1] : 1);
+  view->readonly = 1;
+  view->itemsize = self->itemsize;
+  view->format = (flags & PyBUF_FORMAT) ? self->format : nullptr;
+  view->ndim = self->ndim;
+  view->shape = (flags & PyBUF_ND) == PyBUF_ND ? self->shape : nullptr;
+  view->strides =
+      (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? self->strides : nullptr;
+  view->suboffsets = nullptr;
+  view->internal = nullptr;
+  return 0;
+}
+
+PyBufferProcs ViewBuffer = {reinterpret_cast<getbufferproc>(View_getbuffer),
+                             nullptr};
+
+PyObject *View_getShape(ViewObject *self, void *) {
+  return self->ndim == 1 ? Py_BuildValue("(n)", self->shape[0])
+                         : Py_BuildValue("(nn)", self->shape[0],
+                                         self->shape[1]);
+}
+
+PyGetSetDef ViewGetSet[] = {
+    {"shape", reinterpret_cast<getter>(View_getShape), nullptr,
+     "The shape of the view.", nullptr},
+    {nullptr}};
+
+/**
+ * A contiguous buffer of items of one type, obtained from a Python object
+ * and released on destruction.
+ */
+class Buffer {
+public:
+  Py_buffer view;
+  bool ok = false;
+
+  /**
+   * Gets a buffer.
+   *
+   * @param obj The object.
+   * @param format The struct format of an item.
+   * @param itemsize The size of an item.
+   * @param name The name of the argument, for errors.
+   */
+  Buffer(PyObject *obj, char format, Py_ssize_t itemsize, const char *name) {
+    if (PyObject_GetBuffer(obj, &view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) !=
+        0) {
+      return;
+    }
+    const char *f = view.format != nullptr ? view.format : "B";
+    if (*f == '@' || *f == '=' || *f == '<') {
+      ++f;
+    }
+    if (f[0] != format || f[1] != '\0' || view.itemsize != itemsize) {
+      PyErr_Format(PyExc_TypeError, "%s must be a contiguous buffer of '%c'",
+                   name, format);
+      PyBuffer_Release(&view);
+      return;
+    }
+    ok = true;
+  }
+
+  ~Buffer() {
+    if (ok) {
+      PyBuffer_Release(&view);
+    }
+  }
+
+  Buffer(const Buffer &) = delete;
+  Buffer &operator=(const Buffer &) = delete;
+
+  /**
+   * The number of items.
+   *
+   * @return The number of items.
+   */
+  size_t size() const { return view.len / view.itemsize; }
+
+  /**
+   * The items.
+   *
+   * @return The items.
+   */
+  template <typename T> const T *data() const {
+    return static_cast<const T *>(view.buf);
+  }
+
+  /**
+   * Checks the number of items.
+   *
+   * @param n The number of items needed.
+   * @param name The name of the argument, for errors.
+   * @return Whether there are n items; if not, the Python error is set.
+   */
+  bool expect(size_t n, const char *name) const {
+    if (size() != n) {
+      PyErr_Format(PyExc_ValueError, "%s must have %zu items, not %zu", name,
+                   n, size());
+      return false;
+    }
+    return true;
+  }
+};
+
+/**
+ * Gets the scenario of a ScenarioObject to change, copying it if it is
+ * shared.
+ *
+ * @param self The object.
+ * @return The scenario.
+ */
+BIBS::Scenario &unshare(ScenarioObject *self) {
+  if (self->scenario.use_count() > 1) {
+    self->scenario = std::make_shared<BIBS::Scenario>(*self->scenario);
+  }
+  return *self->scenario;
+}
+
+int Scenario_init(ScenarioObject *self, PyObject *args, PyObject *kwds) {
+  static const char *kwlist[] = {"n_agents", "n_beliefs", "n_behaviours",
+                                 nullptr};
+  Py_ssize_t nAgents, nBeliefs, nBehaviours;
+  if (!PyArg_ParseTupleAndKeywords(args, kwds, "nnn",
+                                   const_cast<char **>(kwlist), &nAgents,
+                                   &nBeliefs, &nBehaviours)) {
+    return -1;
+  }
+  if (nAgents < 0 || nBeliefs < 0 || nBehaviours < 0) {
+    PyErr_SetString(PyExc_ValueError, "sizes must not be negative");
+    return -1;
+  }
+  try {
+    self->scenario =
+        std::make_shared<BIBS::Scenario>(nAgents, nBeliefs, nBehaviours);
+  } catch (...) {
+    setError();
+    return -1;
+  }
+  return 0;
+}
+
+PyObject *Scenario_new(PyTypeObject *type, PyObject *, PyObject *) {
+  auto *self = reinterpret_cast<ScenarioObject *>(type->tp_alloc(type, 0));
+  if (self != nullptr) {
+    new (&self->scenario) std::shared_ptr<BIBS::Scenario>();
+  }
+  return reinterpret_cast<PyObject *>(self);
+}
+
+void Scenario_dealloc(ScenarioObject *self) {
+  self->scenario.~shared_ptr();
+  Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+}
+
+/**
+ * Checks that a ScenarioObject has been initialised.
+ *
+ * @param self The object.
+ * @return Whether it has; if not, the Python error is set.
+ */
+bool initialised(ScenarioObject *self) {
+  if (!self->scenario) {
+    PyErr_SetString(PyExc_RuntimeError, "bibs.Scenario is not initialised");
+    return false;
+  }
+  return true;
+}
+
+/**
+ * A dense matrix of a Scenario.
+ */
+struct Matrix {
+  std::vector<double> BIBS::Scenario::*member;
+  size_t BIBS::Scenario::*rows;
+  size_t BIBS::Scenario::*cols;
+  const char *name;
+};
+
+const Matrix beliefRelationships = {&BIBS::Scenario::beliefRelationships,
+                                    &BIBS::Scenario::nBeliefs,
+                                    &BIBS::Scenario::nBeliefs,
+                                    "belief_relationships"};
+const Matrix observedRelationships = {&BIBS::Scenario::observedRelationships,
+                                      &BIBS::Scenario::nBeliefs,
+                                      &BIBS::Scenario::nBehaviours,
+                                      "observed_relationships"};
+const Matrix performingRelationships = {
+    &BIBS::Scenario::performingRelationships, &BIBS::Scenario::nBeliefs,
+    &BIBS::Scenario::nBehaviours, "performing_relationships"};
+const Matrix timeDeltas = {&BIBS::Scenario::timeDeltas,
+                           &BIBS::Scenario::nAgents,
+                           &BIBS::Scenario::nBeliefs, "time_deltas"};
+
+PyObject *Scenario_getMatrix(ScenarioObject *self, void *closure) {
+  if (!initialised(self)) {
+    return nullptr;
+  }
+  const auto &m = *static_cast<const Matrix *>(closure);
+  const auto &s = *self->scenario;
+  return makeView(self->scenario, (s.*m.member).data(), 'd', sizeof(double),
+                  s.*m.rows, s.*m.cols);
+}
+
+PyObject *Scenario_setMatrix(ScenarioObject *self, PyObject *arg,
+                             const Matrix &m) {
+  if (!initialised(self)) {
+    return nullptr;
+  }
+  Buffer b(arg, 'd', sizeof(double), m.name);
+  if (!b.ok || !b.expect((self->scenario.get()->*m.member).size(), m.name)) {
+    return nullptr;
+  }
+  auto &v = unshare(self).*m.member;
+  std::memcpy(v.data(), b.data<double>(), v.size() * sizeof(double));
+  Py_RETURN_NONE;
+}
+
+PyObject *Scenario_setBeliefRelationships(ScenarioObject *self,
+                                          PyObject *arg) {
+  return Scenario_setMatrix(self, arg, beliefRelationships);
+}
+
+PyObject *Scenario_setObservedRelationships(ScenarioObject *self,
+                                            PyObject *arg) {
+  return Scenario_setMatrix(self, arg, observedRelationships);
+}
+
+PyObject *Scenario_setPerformingRelationships(ScenarioObject *self,
+                                              PyObject *arg) {
+  return Scenario_setMatrix(self, arg, performingRelationships);
+}
+
+PyObject *Scenario_setTimeDeltas(ScenarioObject *self, PyObject *arg) {
+  return Scenario_setMatrix(self, arg, timeDeltas);
+}
+
+PyObject *Scenario_setEdges(ScenarioObject *self, PyObject *args) {
+  PyObject *fromObj, *toObj, *weightsObj;
+  if (!initialised(self) ||
+      !PyArg_ParseTuple(args, "OOO", &fromObj, &toObj, &weightsObj)) {
+    return nullptr;
+  }
+  Buffer from(fromObj, 'I', sizeof(BIBS::index_t), "from");
+  if (!from.ok) {
+    return nullptr;
+  }
+  Buffer to(toObj, 'I', sizeof(BIBS::index_t), "to");
+  if (!to.ok || !to.expect(from.size(), "to")) {
+    return nullptr;
+  }
+  Buffer weights(weightsObj, 'd', sizeof(double), "weights");
+  if (!weights.ok || !weights.expect(from.size(), "weights")) {
+    return nullptr;
+  }
+
+  // The graph is built without the GIL, then swapped in with it.
+  BIBS::Scenario next(self->scenario->nAgents, 0, 0);
+  std::exception_ptr error;
+  Py_BEGIN_ALLOW_THREADS;
+  try {
+    const size_t n = from.size();
+    const auto *f = from.data<BIBS::index_t>();
+    const auto *t = to.data<BIBS::index_t>();
+    const auto *w = weights.data<double>();
+    next.setEdges(std::vector<BIBS::index_t>(f, f + n),
+                  std::vector<BIBS::index_t>(t, t + n),
+                  std::vector<double>(w, w + n));
+  } catch (...) {
+    error = std::current_exception();
+  }
+  Py_END_ALLOW_THREADS;
+  if (error) {
+    setError(error);
+    return nullptr;
+  }
+
+  auto &s = unshare(self);
+  s.friendOffsets.swap(next.friendOffsets);
+  s.friends.swap(next.friends);
+  s.friendWeights.swap(next.friendWeights);
+  Py_RETURN_NONE;
+}
+
+PyObject *Scenario_getSize(ScenarioObject *self, void *closure) {
+  if (!initialised(self)) {
+    return nullptr;
+  }
+  const auto member = *static_cast<size_t BIBS::Scenario::*const *>(closure);
+  return PyLong_FromSize_t(self->scenario.get()->*member);
+}
+
+PyObject *Scenario_getFriendOffsets(ScenarioObject *self, void *) {
+  if (!initialised(self)) {
+    return nullptr;
+  }
+  const auto &v = self->scenario->friendOffsets;
+  return makeView(self->scenario, v.data(), 'Q', sizeof(uint64_t), v.size());
+}
+
+PyObject *Scenario_getFriends(ScenarioObject *self, void *) {
+  if (!initialised(self)) {
+    return nullptr;
+  }
+  const auto &v = self->scenario->friends;
+  return makeView(self->scenario, v.data(), 'I', sizeof(BIBS::index_t),
+                  v.size());
+}
+
+PyObject *Scenario_getFriendWeights(ScenarioObject *self, void *) {
+  if (!initialised(self)) {
+    return nullptr;
+  }
+  const auto &v = self->scenario->friendWeights;
+  return makeView(self->scenario, v.data(), 'd', sizeof(double), v.size());
+}
+
+size_t BIBS::Scenario::*const nAgents = &BIBS::Scenario::nAgents;
+size_t BIBS::Scenario::*const nBeliefs = &BIBS::Scenario::nBeliefs;
+size_t BIBS::Scenario::*const nBehaviours = &BIBS::Scenario::nBehaviours;
+
+PyGetSetDef ScenarioGetSet[] = {
+    {"n_agents", reinterpret_cast<getter>(Scenario_getSize), nullptr,
+     "The number of agents.", const_cast<void *>(static_cast<const void *>(
+                                   &nAgents))},
+    {"n_beliefs", reinterpret_cast<getter>(Scenario_getSize), nullptr,
+     "The number of beliefs.",
+     const_cast<void *>(static_cast<const void *>(&nBeliefs))},
+    {"n_behaviours", reinterpret_cast<getter>(Scenario_getSize), nullptr,
+     "The number of behaviours.",
+     const_cast<void *>(static_cast<const void *>(&nBehaviours))},
+    {"belief_relationships", reinterpret_cast<getter>(Scenario_getMatrix),
+     nullptr, "The belief relationships, [belief][belief].",
+     const_cast<Matrix *>(&beliefRelationships)},
+    {"observed_relationships", reinterpret_cast<getter>(Scenario_getMatrix),
+     nullptr, "The observed relationships, [belief][behaviour].",
+     const_cast<Matrix *>(&observedRelationships)},
+    {"performing_relationships",
+     reinterpret_cast<getter>(Scenario_getMatrix), nullptr,
+     "The performing relationships, [belief][behaviour].",
+     const_cast<Matrix *>(&performingRelationships)},
+    {"time_deltas", reinterpret_cast<getter>(Scenario_getMatrix), nullptr,
+     "The time deltas, [agent][belief].", const_cast<Matrix *>(&timeDeltas)},
+    {"friend_offsets", reinterpret_cast<getter>(Scenario_getFriendOffsets),
+     nullptr, "The offsets of each agent's friends, n_agents + 1.", nullptr},
+    {"friends", reinterpret_cast<getter>(Scenario_getFriends), nullptr,
+     "The friends, grouped by the observing agent.", nullptr},
+    {"friend_weights", reinterpret_cast<getter>(Scenario_getFriendWeights),
+     nullptr, "The weights of the friends.", nullptr},
+    {nullptr}};
+
+PyMethodDef ScenarioMethods[] = {
+    {"set_belief_relationships",
+     reinterpret_cast<PyCFunction>(Scenario_setBeliefRelationships), METH_O,
+     "Sets the belief relationships from a buffer of doubles."},
+    {"set_observed_relationships",
+     reinterpret_cast<PyCFunction>(Scenario_setObservedRelationships),
+     METH_O, "Sets the observed relationships from a buffer of doubles."},
+    {"set_performing_relationships",
+     reinterpret_cast<PyCFunction>(Scenario_setPerformingRelationships),
+     METH_O, "Sets the performing relationships from a buffer of doubles."},
+    {"set_time_deltas", reinterpret_cast<PyCFunction>(Scenario_setTimeDeltas),
+     METH_O, "Sets the time deltas from a buffer of doubles."},
+    {"set_edges", reinterpret_cast<PyCFunction>(Scenario_setEdges),
+     METH_VARARGS,
+     "set_edges(from, to, weights)\n\nReplaces the friendships: agent "
+     "from[e] observes agent to[e] with weight weights[e]. from and to are "
+     "buffers of uint32, weights of doubles."},
+    {nullptr}};
+
+PyObject *Simulation_new(PyTypeObject *type, PyObject *, PyObject *) {
+  auto *self = reinterpret_cast<SimulationObject *>(type->tp_alloc(type, 0));
+  if (self != nullptr) {
+    new (&self->threads) std::unique_ptr<BIBS::ThreadPool>();
+    new (&self->simulation) std::unique_ptr<BIBS::VectorisedSimulation>();
+    self->busy = false;
+  }
+  return reinterpret_cast<PyObject *>(self);
+}
+
+void Simulation_dealloc(SimulationObject *self) {
+  self->simulation.~unique_ptr();
+  self->threads.~unique_ptr();
+  Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+}
+
+int Simulation_init(SimulationObject *self, PyObject *args, PyObject *kwds) {
+  static const char *kwlist[] = {"scenario", "activations", "performed",
+                                 "seed",     "record_history", "threads",
+                                 nullptr};
+  PyObject *scenarioObj, *activationsObj, *performedObj = Py_None;
+  unsigned long long seed = 0;
+  int recordHistory = 1;
+  Py_ssize_t nThreads = 1;
+  if (!PyArg_ParseTupleAndKeywords(
+          args, kwds, "O!O|OKpn", const_cast<char **>(kwlist), &ScenarioType,
+          &scenarioObj, &activationsObj, &performedObj, &seed, &recordHistory,
+          &nThreads)) {
+    return -1;
+  }
+  if (self->busy) {
+    PyErr_SetString(PyExc_RuntimeError, "bibs.Simulation is running");
+    return -1;
+  }
+  auto *scenarioSelf = reinterpret_cast<ScenarioObject *>(scenarioObj);
+  if (!initialised(scenarioSelf)) {
+    return -1;
+  }
+  if (nThreads < 0) {
+    PyErr_SetString(PyExc_ValueError, "threads must not be negative");
+    return -1;
+  }
+  std::shared_ptr<const BIBS::Scenario> scenario = scenarioSelf->scenario;
+
+  Buffer a(activationsObj, 'd', sizeof(double), "activations");
+  if (!a.ok ||
+      !a.expect(scenario->nAgents * scenario->nBeliefs, "activations")) {
+    return -1;
+  }
+  std::vector<BIBS::index_t> performed;
+  if (performedObj != Py_None) {
+    Buffer p(performedObj, 'I', sizeof(BIBS::index_t), "performed");
+    if (!p.ok || !p.expect(scenario->nAgents, "performed")) {
+      return -1;
+    }
+    performed.assign(p.data<BIBS::index_t>(),
+                     p.data<BIBS::index_t>() + p.size());
+  }
+
+  try {
+    scenario->validate();
+    std::vector<double> activations(a.data<double>(),
+                                    a.data<double>() + a.size());
+    std::unique_ptr<BIBS::ThreadPool> threads;
+    if (nThreads != 1) {
+      threads = std::make_unique<BIBS::ThreadPool>(nThreads);
+    }
+    self->simulation = std::make_unique<BIBS::VectorisedSimulation>(
+        scenario, activations, performed, seed, recordHistory != 0, nullptr,
+        threads.get());
+    self->threads = std::move(threads);
+  } catch (...) {
+    setError();
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * Checks that a SimulationObject can be used.
+ *
+ * @param self The object.
+ * @return Whether it can; if not, the Python error is set.
+ */
+bool usable(SimulationObject *self) {
+  if (!self->simulation) {
+    PyErr_SetString(PyExc_RuntimeError, "bibs.Simulation is not initialised");
+    return false;
+  }
+  if (self->busy) {
+    PyErr_SetString(PyExc_RuntimeError, "bibs.Simulation is running");
+    return false;
+  }
+  return true;
+}
+
+PyObject *Simulation_run(SimulationObject *self, PyObject *args) {
+  unsigned int nTicks;
+  if (!PyArg_ParseTuple(args, "I", &nTicks) || !usable(self)) {
+    return nullptr;
+  }
+  std::exception_ptr error;
+  self->busy = true;
+  Py_BEGIN_ALLOW_THREADS;
+  try {
+    self->simulation->run(nTicks);
+  } catch (...) {
+    error = std::current_exception();
+  }
+  Py_END_ALLOW_THREADS;
+  self->busy = false;
+  if (error) {
+    setError(error);
+    return nullptr;
+  }
+  Py_RETURN_NONE;
+}
+
+/**
+ * Gets the frame at a time given as an optional argument.
+ *
+ * @param self The object.
+ * @param args The arguments: the time, or none for the latest.
+ * @return The frame, or nullptr with the Python error set.
+ */
+std::shared_ptr<const BIBS::Frame> frameOf(SimulationObject *self,
+                                           PyObject *args) {
+  PyObject *tObj = Py_None;
+  if (!PyArg_ParseTuple(args, "|O", &tObj) || !usable(self)) {
+    return nullptr;
+  }
+  BIBS::sim_time_t t = self->simulation->time();
+  if (tObj != Py_None) {
+    const unsigned long value = PyLong_AsUnsignedLong(tObj);
+    if (PyErr_Occurred()) {
+      return nullptr;
+    }
+    t = static_cast<BIBS::sim_time_t>(value);
+    if (t != value) {
+      PyErr_SetString(PyExc_IndexError, "frame not found");
+      return nullptr;
+    }
+  }
+  try {
+    return self->simulation->sharedFrame(t);
+  } catch (...) {
+    setError();
+    return nullptr;
+  }
+}
+
+PyObject *Simulation_activations(SimulationObject *self, PyObject *args) {
+  auto f = frameOf(self, args);
+  if (!f) {
+    return nullptr;
+  }
+  const auto &s = self->simulation->getScenario();
+  return makeView(f, f->activations.data(), 'd', sizeof(double), s.nAgents,
+                  s.nBeliefs);
+}
+
+PyObject *Simulation_contexts(SimulationObject *self, PyObject *args) {
+  auto f = frameOf(self, args);
+  if (!f) {
+    return nullptr;
+  }
+  const auto &s = self->simulation->getScenario();
+  return makeView(f, f->contexts.data(), 'd', sizeof(double), s.nAgents,
+                  s.nBeliefs);
+}
+
+PyObject *Simulation_performed(SimulationObject *self, PyObject *args) {
+  auto f = frameOf(self, args);
+  if (!f) {
+    return nullptr;
+  }
+  return makeView(f, f->performed.data(), 'I', sizeof(BIBS::index_t),
+                  f->performed.size());
+}
+
+PyObject *Simulation_behaviourShares(SimulationObject *self,
+                                     PyObject *args) {
+  auto f = frameOf(self, args);
+  if (!f) {
+    return nullptr;
+  }
+  try {
+    auto shares = std::make_shared<std::vector<double>>(
+        self->simulation->behaviourShares(f->t));
+    return makeView(shares, shares->data(), 'd', sizeof(double),
+                    shares->size());
+  } catch (...) {
+    setError();
+    return nullptr;
+  }
+}
+
+PyObject *Simulation_getTime(SimulationObject *self, void *) {
+  if (!usable(self)) {
+    return nullptr;
+  }
+  return PyLong_FromUnsignedLong(self->simulation->time());
+}
+
+PyMethodDef SimulationMethods[] = {
+    {"run", reinterpret_cast<PyCFunction>(Simulation_run), METH_VARARGS,
+     "run(n_ticks)\n\nRuns the simulation, releasing the GIL."},
+    {"activations", reinterpret_cast<PyCFunction>(Simulation_activations),
+     METH_VARARGS,
+     "activations(t=None)\n\nThe activations at a tick (default the latest) "
+     "as a read-only [agent][belief] view of doubles."},
+    {"contexts", reinterpret_cast<PyCFunction>(Simulation_contexts),
+     METH_VARARGS,
+     "contexts(t=None)\n\nThe contextualisations at a tick (default the "
+     "latest) as a read-only [agent][belief] view of doubles."},
+    {"performed", reinterpret_cast<PyCFunction>(Simulation_performed),
+     METH_VARARGS,
+     "performed(t=None)\n\nThe behaviours performed at a tick (default the "
+     "latest) as a read-only view of uint32."},
+    {"behaviour_shares",
+     reinterpret_cast<PyCFunction>(Simulation_behaviourShares), METH_VARARGS,
+     "behaviour_shares(t=None)\n\nThe share of agents performing each "
+     "behaviour at a tick (default the latest)."},
+    {nullptr}};
+
+PyGetSetDef SimulationGetSet[] = {
+    {"time", reinterpret_cast<getter>(Simulation_getTime), nullptr,
+     "The latest tick.", nullptr},
+    {nullptr}};
+
+PyModuleDef bibsModule = {PyModuleDef_HEAD_INIT, "bibs",
+                          "The belief-induced behaviour simulation.", -1};
+} // namespace
+
+PyMODINIT_FUNC PyInit_bibs(void) {
+  ViewType.tp_name = "bibs.View";
+  ViewType.tp_doc = "A read-only buffer into the memory of a simulation.";
+  ViewType.tp_basicsize = sizeof(ViewObject);
+  ViewType.tp_flags = Py_TPFLAGS_DEFAULT;
+  ViewType.tp_dealloc = reinterpret_cast<destructor>(View_dealloc);
+  ViewType.tp_as_buffer = &ViewBuffer;
+  ViewType.tp_getset = ViewGetSet;
+
+  ScenarioType.tp_name = "bibs.Scenario";
+  ScenarioType.tp_doc =
+      "Scenario(n_agents, n_beliefs, n_behaviours)\n\nThe relationships, "
+      "time deltas and friendships of a simulation.";
+  ScenarioType.tp_basicsize = sizeof(ScenarioObject);
+  ScenarioType.tp_flags = Py_TPFLAGS_DEFAULT;
+  ScenarioType.tp_new = Scenario_new;
+  ScenarioType.tp_init = reinterpret_cast<initproc>(Scenario_init);
+  ScenarioType.tp_dealloc = reinterpret_cast<destructor>(Scenario_dealloc);
+  ScenarioType.tp_methods = ScenarioMethods;
+  ScenarioType.tp_getset = ScenarioGetSet;
+
+  SimulationType.tp_name = "bibs.Simulation";
+  SimulationType.tp_doc =
+      "Simulation(scenario, activations, performed=None, seed=0, "
+      "record_history=True, threads=1)\n\nA vectorised simulation of a "
+      "scenario. threads=0 uses every hardware thread.";
+  SimulationType.tp_basicsize = sizeof(SimulationObject);
+  SimulationType.tp_flags = Py_TPFLAGS_DEFAULT;
+  SimulationType.tp_new = Simulation_new;
+  SimulationType.tp_init = reinterpret_cast<initproc>(Simulation_init);
+  SimulationType.tp_dealloc = reinterpret_cast<destructor>(Simulation_dealloc);
+  SimulationType.tp_methods = SimulationMethods;
+  SimulationType.tp_getset = SimulationGetSet;
+
+  if (PyType_Ready(&ViewType) < 0 || PyType_Ready(&ScenarioType) < 0 ||
+      PyType_Ready(&SimulationType) < 0) {
+    return nullptr;
+  }
+
+  PyObject *m = PyModule_Create(&bibsModule);
+  if (m == nullptr) {
+    return nullptr;
+  }
+  const std::pair<const char *, PyTypeObject *> types[] = {
+      {"View", &ViewType},
+      {"Scenario", &ScenarioType},
+      {"Simulation", &SimulationType}};
+  for (const auto &type : types) {
+    Py_INCREF(type.second);
+    if (PyModule_AddObject(m, type.first,
+                           reinterpret_cast<PyObject *>(type.second)) < 0) {
+      Py_DECREF(type.second);
+      Py_DECREF(m);
+      return nullptr;
+    }
+  }
+  return m;
+}
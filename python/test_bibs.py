@@ -0,0 +1,146 @@
+#    BIBS, the belief-induced behaviour simulation
+#    Copyright (C) 2021 Robert Greener
+#
+#    This program is free software: you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation, either version 3 of the License, or
+#    any later version.
+#
+#    This program is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+
+"""Tests of the bibs Python extension module."""
+
+import array
+import random
+import threading
+import unittest
+
+import bibs
+
+
+def scenario(n_agents=50, n_beliefs=2, n_behaviours=3, seed=1):
+    rng = random.Random(seed)
+    s = bibs.Scenario(n_agents, n_beliefs, n_behaviours)
+    s.set_belief_relationships(
+        array.array("d", [rng.uniform(-1, 1) for _ in range(n_beliefs ** 2)]))
+    s.set_observed_relationships(array.array(
+        "d", [rng.uniform(-1, 1) for _ in range(n_beliefs * n_behaviours)]))
+    s.set_performing_relationships(array.array(
+        "d", [rng.uniform(-1, 1) for _ in range(n_beliefs * n_behaviours)]))
+    s.set_time_deltas(array.array(
+        "d", [rng.uniform(0, 1) for _ in range(n_agents * n_beliefs)]))
+    edges = [(i, rng.randrange(n_agents)) for i in range(n_agents)
+             for _ in range(3)]
+    s.set_edges(array.array("I", [e[0] for e in edges]),
+                array.array("I", [e[1] for e in edges]),
+                array.array("d", [rng.uniform(0, 1) for _ in edges]))
+    return s
+
+
+def activations(s, seed=2):
+    rng = random.Random(seed)
+    return array.array(
+        "d", [rng.uniform(0, 1) for _ in range(s.n_agents * s.n_beliefs)])
+
+
+class ScenarioTest(unittest.TestCase):
+    def test_views(self):
+        s = scenario()
+        td = memoryview(s.time_deltas)
+        self.assertTrue(td.readonly)
+        self.assertEqual(td.shape, (50, 2))
+        self.assertEqual(td.format, "d")
+        self.assertEqual(memoryview(s.friend_offsets).shape, (51,))
+        self.assertEqual(memoryview(s.friend_offsets)[50], 150)
+        self.assertEqual(memoryview(s.friends).format, "I")
+        self.assertEqual(s.friend_weights.shape, (150,))
+
+    def test_copy_on_write(self):
+        s = scenario()
+        before = memoryview(s.time_deltas).tolist()
+        view = s.time_deltas
+        s.set_time_deltas(array.array("d", [0.0] * 100))
+        self.assertEqual(memoryview(view).tolist(), before)
+        self.assertEqual(memoryview(s.time_deltas).tolist(),
+                         [[0.0, 0.0]] * 50)
+
+    def test_errors(self):
+        s = bibs.Scenario(3, 1, 1)
+        with self.assertRaises(ValueError):
+            s.set_time_deltas(array.array("d", [0.0] * 2))
+        with self.assertRaises(TypeError):
+            s.set_time_deltas(array.array("f", [0.0] * 3))
+        with self.assertRaises(IndexError):
+            s.set_edges(array.array("I", [3]), array.array("I", [0]),
+                        array.array("d", [1.0]))
+        with self.assertRaises(TypeError):
+            memoryview(s.time_deltas)[0, 0] = 1.0
+
+
+class SimulationTest(unittest.TestCase):
+    def test_run(self):
+        s = scenario()
+        sim = bibs.Simulation(s, activations(s), seed=3)
+        sim.run(5)
+        self.assertEqual(sim.time, 5)
+        a = memoryview(sim.activations(2))
+        self.assertEqual(a.shape, (50, 2))
+        self.assertEqual(memoryview(sim.performed()).shape, (50,))
+        self.assertAlmostEqual(sum(memoryview(sim.behaviour_shares(0))), 1)
+        with self.assertRaises(IndexError):
+            sim.activations(6)
+
+    def test_threads_match(self):
+        s = scenario(500)
+        one = bibs.Simulation(s, activations(s), seed=3)
+        many = bibs.Simulation(s, activations(s), seed=3, threads=4)
+        one.run(5)
+        many.run(5)
+        for t in range(6):
+            self.assertEqual(memoryview(one.activations(t)).tolist(),
+                             memoryview(many.activations(t)).tolist())
+            self.assertEqual(memoryview(one.performed(t)).tolist(),
+                             memoryview(many.performed(t)).tolist())
+
+    def test_views_outlive_frames(self):
+        s = scenario()
+        sim = bibs.Simulation(s, activations(s), record_history=False)
+        view = sim.performed()
+        before = memoryview(view).tolist()
+        sim.run(5)
+        del sim
+        self.assertEqual(memoryview(view).tolist(), before)
+
+    def test_releases_gil(self):
+        s = scenario(2000)
+        sims = [bibs.Simulation(s, activations(s), seed=i) for i in range(4)]
+        threads = [threading.Thread(target=sim.run, args=(10,))
+                   for sim in sims]
+        for t in threads:
+            t.start()
+        for t in threads:
+            t.join()
+        self.assertEqual([sim.time for sim in sims], [10] * 4)
+
+    def test_numpy(self):
+        try:
+            import numpy
+        except ImportError:
+            self.skipTest("numpy is not installed")
+        s = scenario()
+        sim = bibs.Simulation(s, activations(s))
+        a = numpy.asarray(sim.activations())
+        self.assertEqual(a.shape, (50, 2))
+        self.assertFalse(a.flags.writeable)
+        self.assertFalse(a.flags.owndata)
+
+
+if __name__ == "__main__":
+    unittest.main()
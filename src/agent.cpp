@@ -19,10 +19,15 @@
 #include "bibs/behaviour.hpp"
 #include "bibs/belief.hpp"
 #include "bibs/bibs.hpp"
+#include "bibs/choice.hpp"
+#include "bibs/exogenous.hpp"
+#include "bibs/scenario.hpp"
 
+#include <algorithm>
 #include <boost/uuid/uuid_generators.hpp>
 #include <cmath>
 #include <limits>
+#include <map>
 #include <memory>
 #include <random>
 #include <stdexcept>
@@ -84,6 +89,11 @@ void BIBS::Agent::setFriendWeight(const IAgent *a, double w) {
   friends.insert_or_assign(a, w);
 }
 
+const std::map<const BIBS::IAgent *, double> &
+BIBS::Agent::friendWeights() const {
+  return friends;
+}
+
 double BIBS::Agent::contextualise(const IBelief *b, const sim_time_t t) const {
   double value_to_exp = 0.0;
 
@@ -109,6 +119,11 @@ void BIBS::Agent::setTimeDelta(const IBelief *b, const double td) {
   timeDeltaMap.insert_or_assign(b, td);
 }
 
+const std::map<const BIBS::IBelief *, double> &
+BIBS::Agent::timeDeltas() const {
+  return timeDeltaMap;
+}
+
 void BIBS::Agent::updateActivation(const sim_time_t t, const IBelief *b) {
   double newActivation =
       timeDelta(b) * activation(t - 1, b) + contextualObserved(b, t - 1);
@@ -159,7 +174,14 @@ BIBS::Agent::heldBeliefs(const sim_time_t t) const {
 }
 
 double BIBS::Agent::environment(const IBehaviour *b, const sim_time_t t) const {
-  return 0.0;
+  if (exogenous == nullptr) {
+    return 0.0;
+  }
+  const auto it = exogenousIndices->find(b);
+  if (it == exogenousIndices->end()) {
+    return 0.0;
+  }
+  return exogenous->impetus(t, static_cast<index_t>(it->second));
 }
 
 double BIBS::Agent::utility(const IBehaviour *b, const sim_time_t t) const {
@@ -168,32 +190,74 @@ double BIBS::Agent::utility(const IBehaviour *b, const sim_time_t t) const {
 
 void BIBS::Agent::perform(const sim_time_t t,
                           const std::vector<const IBehaviour *> &bs) {
-  double maxUtility = std::numeric_limits<double>::lowest();
-  const IBehaviour *maxBehaviour = nullptr;
-
-  std::vector<const IBehaviour *> positiveBehaviours;
-  std::vector<double> positiveUtilities;
+  if (bs.empty()) {
+    performedMap[t] = nullptr;
+    return;
+  }
 
+  std::vector<double> utilities;
+  utilities.reserve(bs.size());
   for (const auto &b : bs) {
-    auto ut = utility(b, t);
-    if (ut > maxUtility) {
-      maxUtility = ut;
-      maxBehaviour = b;
+    utilities.push_back(utility(b, t));
+  }
+
+  // Most agents have at most one behaviour with positive utility, and need
+  // no random number.
+  const auto &policy = choicePolicy ? *choicePolicy : *defaultChoicePolicy();
+  const double u = policy.needsUniform(utilities.data(), bs.size())
+                       ? choiceUniform(t)
+                       : 0.0;
+  index_t chosen;
+  policy.choose(utilities.data(), &u, 1, bs.size(), &chosen);
+  performedMap[t] = bs[chosen];
+}
+
+void BIBS::Agent::setChoicePolicy(std::shared_ptr<const IChoicePolicy> p) {
+  choicePolicy = std::move(p);
+}
+
+void BIBS::Agent::setExogenousInput(
+    std::shared_ptr<const ExogenousInput> input,
+    const std::vector<const IBehaviour *> &behaviours) {
+  setExogenousInput(std::move(input), indexBehaviours(behaviours));
+}
+
+void BIBS::Agent::setExogenousInput(
+    std::shared_ptr<const ExogenousInput> input,
+    std::shared_ptr<const std::map<const IBehaviour *, size_t>> indices) {
+  if (input != nullptr) {
+    if (indices == nullptr) {
+      throw std::invalid_argument("the behaviour indices are missing");
     }
-    if (ut > 0) {
-      positiveBehaviours.push_back(b);
-      positiveUtilities.push_back(ut);
+    std::vector<bool> known(indices->size());
+    for (const auto &[_b, k] : *indices) {
+      if (k < known.size()) {
+        known[k] = true;
+      }
+    }
+    for (const auto &k : input->getBehaviours()) {
+      if (k >= known.size() || !known[k]) {
+        throw std::invalid_argument("affected behaviour out of range");
+      }
     }
   }
+  exogenous = std::move(input);
+  exogenousIndices = std::move(indices);
+}
 
-  if (positiveUtilities.size() <= 1) {
-    performedMap[t] = maxBehaviour;
-  } else {
-    std::random_device rd;
-    std::default_random_engine eng(rd());
-    std::discrete_distribution<size_t> dist(positiveUtilities.begin(),
-                                            positiveUtilities.end());
-
-    performedMap[t] = positiveBehaviours[dist(eng)];
+std::shared_ptr<const std::map<const BIBS::IBehaviour *, size_t>>
+BIBS::Agent::indexBehaviours(
+    const std::vector<const IBehaviour *> &behaviours) {
+  auto indices = std::make_shared<std::map<const IBehaviour *, size_t>>();
+  for (size_t k = 0; k < behaviours.size(); ++k) {
+    indices->emplace(behaviours[k], k);
   }
+  return indices;
+}
+
+double BIBS::Agent::choiceUniform(const sim_time_t t) const {
+  // One engine per thread, seeded once, rather than a random_device per
+  // draw.
+  thread_local std::mt19937_64 eng(std::random_device{}());
+  return std::uniform_real_distribution<double>(0.0, 1.0)(eng);
 }
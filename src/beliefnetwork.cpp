@@ -0,0 +1,233 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/beliefnetwork.hpp"
+#include "bibs/behaviour.hpp"
+#include "bibs/belief.hpp"
+#include "bibs/lookup.hpp"
+#include "bibs/scenario.hpp"
+
+#include <algorithm>
+#include <boost/uuid/uuid_generators.hpp>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+/**
+ * The value of an unset relationship.
+ */
+constexpr double unset = std::numeric_limits<double>::quiet_NaN();
+} // namespace
+
+BIBS::NetworkBelief::NetworkBelief(const std::string name,
+                                   const boost::uuids::uuid uuid,
+                                   BeliefNetwork *network, index_t row)
+    : IBelief(name, uuid), network(network), row(row) {}
+
+BIBS::index_t BIBS::NetworkBelief::index() const { return row; }
+
+double BIBS::NetworkBelief::beliefRelationship(const IBelief *b2) const {
+  return network->get(BeliefNetwork::Relationship::belief, row,
+                      network->beliefIndex(b2));
+}
+
+void BIBS::NetworkBelief::setBeliefRelationship(const IBelief *b2,
+                                                const double value) {
+  network->set(BeliefNetwork::Relationship::belief, row,
+               network->beliefIndex(b2), value);
+}
+
+double BIBS::NetworkBelief::observedBehaviourRelationship(
+    const IBehaviour *beh) const {
+  return network->get(BeliefNetwork::Relationship::observed, row,
+                      network->behaviourIndex(beh));
+}
+
+void BIBS::NetworkBelief::setObservedBehaviourRelationship(
+    const IBehaviour *beh, const double value) {
+  network->set(BeliefNetwork::Relationship::observed, row,
+               network->behaviourIndex(beh), value);
+}
+
+double BIBS::NetworkBelief::performingBehaviourRelationship(
+    const IBehaviour *beh) const {
+  return network->get(BeliefNetwork::Relationship::performing, row,
+                      network->behaviourIndex(beh));
+}
+
+void BIBS::NetworkBelief::setPerformingBehaviourRelationship(
+    const IBehaviour *beh, const double value) {
+  network->set(BeliefNetwork::Relationship::performing, row,
+               network->behaviourIndex(beh), value);
+}
+
+BIBS::BeliefNetwork::BeliefNetwork(const std::vector<std::string> &names,
+                                   std::vector<const IBehaviour *> behaviours)
+    : behaviours(std::move(behaviours)) {
+  std::vector<boost::uuids::uuid> uuids;
+  for (const auto &beh : this->behaviours) {
+    uuids.push_back(beh->uuid);
+  }
+  behaviourUuids = UuidIndex(std::move(uuids));
+
+  auto uuidGen = boost::uuids::random_generator_mt19937();
+  for (size_t i = 0; i < names.size(); ++i) {
+    beliefs.emplace_back(new NetworkBelief(names[i], uuidGen(), this,
+                                           static_cast<index_t>(i)));
+  }
+
+  for (const auto r :
+       {Relationship::belief, Relationship::observed,
+        Relationship::performing}) {
+    matrix(r).assign(nBeliefs() * nColumns(r), unset);
+  }
+}
+
+std::vector<double> &BIBS::BeliefNetwork::matrix(Relationship r) {
+  return matrices[static_cast<size_t>(r)];
+}
+
+size_t BIBS::BeliefNetwork::nColumns(Relationship r) const {
+  return r == Relationship::belief ? nBeliefs() : nBehaviours();
+}
+
+size_t BIBS::BeliefNetwork::nBeliefs() const { return beliefs.size(); }
+
+size_t BIBS::BeliefNetwork::nBehaviours() const { return behaviours.size(); }
+
+BIBS::NetworkBelief *BIBS::BeliefNetwork::belief(index_t i) const {
+  return beliefs.at(i).get();
+}
+
+std::vector<BIBS::IBelief *> BIBS::BeliefNetwork::getBeliefs() const {
+  std::vector<IBelief *> result;
+  result.reserve(beliefs.size());
+  for (const auto &b : beliefs) {
+    result.push_back(b.get());
+  }
+  return result;
+}
+
+BIBS::index_t BIBS::BeliefNetwork::beliefIndex(const IBelief *b) const {
+  const auto *nb = dynamic_cast<const NetworkBelief *>(b);
+  if (nb == nullptr || nb->network != this) {
+    throw std::out_of_range("belief is not in the network");
+  }
+  return nb->row;
+}
+
+BIBS::index_t BIBS::BeliefNetwork::behaviourIndex(const IBehaviour *beh) const {
+  const index_t i = behaviourUuids.find(beh->uuid);
+  if (i == UuidIndex::notFound || behaviours[i] != beh) {
+    throw std::out_of_range("behaviour is not in the network");
+  }
+  return i;
+}
+
+double BIBS::BeliefNetwork::get(Relationship r, index_t row,
+                                index_t column) const {
+  if (row >= nBeliefs() || column >= nColumns(r)) {
+    throw std::out_of_range("relationship out of range");
+  }
+  const double v = getMatrix(r)[row * nColumns(r) + column];
+  if (std::isnan(v)) {
+    throw std::out_of_range("relationship is not set");
+  }
+  return v;
+}
+
+void BIBS::BeliefNetwork::set(Relationship r, index_t row, index_t column,
+                              double value) {
+  if (row >= nBeliefs() || column >= nColumns(r)) {
+    throw std::out_of_range("relationship out of range");
+  }
+  matrix(r)[row * nColumns(r) + column] = value;
+}
+
+void BIBS::BeliefNetwork::setDense(Relationship r,
+                                   const std::vector<double> &values) {
+  auto &m = matrix(r);
+  if (values.size() != m.size()) {
+    throw std::invalid_argument("matrix has the wrong size");
+  }
+  std::copy(values.begin(), values.end(), m.begin());
+}
+
+void BIBS::BeliefNetwork::setTriplets(Relationship r,
+                                      const std::vector<Triplet> &triplets) {
+  const size_t nC = nColumns(r);
+  for (const auto &e : triplets) {
+    if (e.row >= nBeliefs() || e.column >= nC) {
+      throw std::out_of_range("relationship out of range");
+    }
+  }
+  auto &m = matrix(r);
+  std::fill(m.begin(), m.end(), 0.0);
+  for (const auto &e : triplets) {
+    m[e.row * nC + e.column] = e.value;
+  }
+}
+
+void BIBS::BeliefNetwork::setCsr(Relationship r,
+                                 const std::vector<uint64_t> &offsets,
+                                 const std::vector<index_t> &columns,
+                                 const std::vector<double> &values) {
+  const size_t nC = nColumns(r);
+  if (offsets.size() != nBeliefs() + 1 || offsets.front() != 0 ||
+      offsets.back() != columns.size() || columns.size() != values.size() ||
+      !std::is_sorted(offsets.begin(), offsets.end())) {
+    throw std::invalid_argument("inconsistent compressed sparse rows");
+  }
+  for (const auto &c : columns) {
+    if (c >= nC) {
+      throw std::out_of_range("relationship out of range");
+    }
+  }
+  auto &m = matrix(r);
+  std::fill(m.begin(), m.end(), 0.0);
+  for (size_t i = 0; i < nBeliefs(); ++i) {
+    double *rowValues = m.data() + i * nC;
+    for (uint64_t e = offsets[i]; e < offsets[i + 1]; ++e) {
+      rowValues[columns[e]] = values[e];
+    }
+  }
+}
+
+const std::vector<double> &
+BIBS::BeliefNetwork::getMatrix(Relationship r) const {
+  return matrices[static_cast<size_t>(r)];
+}
+
+void BIBS::BeliefNetwork::copyTo(Scenario &s) const {
+  if (s.nBeliefs != nBeliefs() || s.nBehaviours != nBehaviours()) {
+    throw std::invalid_argument("scenario has different numbers of beliefs "
+                                "or behaviours");
+  }
+  for (const auto &m : matrices) {
+    if (std::any_of(m.begin(), m.end(),
+                    [](double v) { return std::isnan(v); })) {
+      throw std::out_of_range("relationship is not set");
+    }
+  }
+  s.beliefRelationships = getMatrix(Relationship::belief);
+  s.observedRelationships = getMatrix(Relationship::observed);
+  s.performingRelationships = getMatrix(Relationship::performing);
+}
@@ -0,0 +1,282 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/bibs_c.h"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/state.hpp"
+#include "bibs/vectorised.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct bibs_scenario {
+  /**
+   * The scenario. It is shared with the simulations created from it, and
+   * copied before being changed if so.
+   */
+  std::shared_ptr<BIBS::Scenario> scenario;
+};
+
+struct bibs_simulation {
+  /**
+   * The threads, if set.
+   */
+  std::unique_ptr<BIBS::ThreadPool> threads;
+
+  /**
+   * The simulation.
+   */
+  std::unique_ptr<BIBS::VectorisedSimulation> simulation;
+};
+
+namespace {
+/**
+ * The message of the last error on this thread.
+ */
+thread_local std::string lastError;
+
+/**
+ * Calls f, turning exceptions into a status.
+ *
+ * @param f The function.
+ * @return The status.
+ */
+template <typename F> bibs_status guard(F &&f) {
+  try {
+    f();
+    lastError.clear();
+    return BIBS_OK;
+  } catch (const std::invalid_argument &e) {
+    lastError = e.what();
+    return BIBS_INVALID_ARGUMENT;
+  } catch (const std::out_of_range &e) {
+    lastError = e.what();
+    return BIBS_OUT_OF_RANGE;
+  } catch (const std::bad_alloc &e) {
+    lastError = e.what();
+    return BIBS_NO_MEMORY;
+  } catch (const std::exception &e) {
+    lastError = e.what();
+    return BIBS_ERROR;
+  } catch (...) {
+    lastError = "unknown error";
+    return BIBS_ERROR;
+  }
+}
+
+/**
+ * Throws if a pointer is null.
+ *
+ * @param p The pointer.
+ * @param name The name of the argument.
+ * @exception std::invalid_argument If p is null.
+ */
+void notNull(const void *p, const char *name) {
+  if (p == nullptr) {
+    throw std::invalid_argument(std::string(name) + " is null");
+  }
+}
+
+/**
+ * Gets a scenario which is not shared with any simulation, copying it if
+ * need be.
+ *
+ * @param s The scenario.
+ * @return The scenario.
+ */
+BIBS::Scenario &unshare(bibs_scenario *s) {
+  if (s->scenario.use_count() > 1) {
+    s->scenario = std::make_shared<BIBS::Scenario>(*s->scenario);
+  }
+  return *s->scenario;
+}
+
+/**
+ * Throws if a buffer is too short.
+ *
+ * @param length The length of the buffer.
+ * @param needed The length needed.
+ * @exception std::invalid_argument If length < needed.
+ */
+void checkLength(size_t length, size_t needed) {
+  if (length < needed) {
+    throw std::invalid_argument("buffer too short: " + std::to_string(length) +
+                                " < " + std::to_string(needed));
+  }
+}
+} // namespace
+
+const char *bibs_last_error(void) { return lastError.c_str(); }
+
+bibs_status bibs_scenario_create(uint32_t nAgents, uint32_t nBeliefs,
+                                 uint32_t nBehaviours,
+                                 const double *beliefRelationships,
+                                 const double *observedRelationships,
+                                 const double *performingRelationships,
+                                 const double *timeDeltas,
+                                 bibs_scenario **out) {
+  return guard([&] {
+    notNull(out, "out");
+    auto s = std::make_unique<bibs_scenario>();
+    s->scenario =
+        std::make_shared<BIBS::Scenario>(nAgents, nBeliefs, nBehaviours);
+    auto &scenario = *s->scenario;
+    auto copy = [](const double *from, std::vector<double> &to) {
+      if (from != nullptr) {
+        std::copy(from, from + to.size(), to.begin());
+      }
+    };
+    copy(beliefRelationships, scenario.beliefRelationships);
+    copy(observedRelationships, scenario.observedRelationships);
+    copy(performingRelationships, scenario.performingRelationships);
+    copy(timeDeltas, scenario.timeDeltas);
+    *out = s.release();
+  });
+}
+
+bibs_status bibs_scenario_set_edges(bibs_scenario *scenario, size_t nEdges,
+                                    const uint32_t *from, const uint32_t *to,
+                                    const double *weights) {
+  return guard([&] {
+    notNull(scenario, "scenario");
+    if (nEdges > 0) {
+      notNull(from, "from");
+      notNull(to, "to");
+      notNull(weights, "weights");
+    }
+    // Validates before unsharing, so that a failed call leaves the scenario
+    // unchanged.
+    std::vector<BIBS::index_t> f(from, from + nEdges);
+    std::vector<BIBS::index_t> t(to, to + nEdges);
+    std::vector<double> w(weights, weights + nEdges);
+    BIBS::Scenario next(scenario->scenario->nAgents, 0, 0);
+    next.setEdges(f, t, w);
+    auto &s = unshare(scenario);
+    s.friendOffsets.swap(next.friendOffsets);
+    s.friends.swap(next.friends);
+    s.friendWeights.swap(next.friendWeights);
+  });
+}
+
+bibs_status bibs_scenario_set_time_deltas(bibs_scenario *scenario,
+                                          const double *timeDeltas) {
+  return guard([&] {
+    notNull(scenario, "scenario");
+    notNull(timeDeltas, "timeDeltas");
+    auto &s = unshare(scenario);
+    std::copy(timeDeltas, timeDeltas + s.timeDeltas.size(),
+              s.timeDeltas.begin());
+  });
+}
+
+void bibs_scenario_destroy(bibs_scenario *scenario) { delete scenario; }
+
+bibs_status bibs_simulation_create(const bibs_scenario *scenario,
+                                   const double *activations,
+                                   const uint32_t *performed, uint64_t seed,
+                                   int recordHistory, bibs_simulation **out) {
+  return guard([&] {
+    notNull(scenario, "scenario");
+    notNull(activations, "activations");
+    notNull(out, "out");
+    const auto &s = *scenario->scenario;
+    s.validate();
+    std::vector<double> a(activations,
+                          activations + s.nAgents * s.nBeliefs);
+    std::vector<BIBS::index_t> p;
+    if (performed != nullptr) {
+      p.assign(performed, performed + s.nAgents);
+    }
+    auto sim = std::make_unique<bibs_simulation>();
+    sim->simulation = std::make_unique<BIBS::VectorisedSimulation>(
+        scenario->scenario, a, p, seed, recordHistory != 0);
+    *out = sim.release();
+  });
+}
+
+bibs_status bibs_simulation_set_threads(bibs_simulation *simulation,
+                                        size_t nThreads) {
+  return guard([&] {
+    notNull(simulation, "simulation");
+    auto threads = std::make_unique<BIBS::ThreadPool>(nThreads);
+    simulation->simulation->setThreadPool(threads.get());
+    simulation->threads = std::move(threads);
+  });
+}
+
+bibs_status bibs_simulation_run(bibs_simulation *simulation,
+                                uint32_t nTicks) {
+  return guard([&] {
+    notNull(simulation, "simulation");
+    simulation->simulation->run(nTicks);
+  });
+}
+
+bibs_status bibs_simulation_time(const bibs_simulation *simulation,
+                                 uint32_t *out) {
+  return guard([&] {
+    notNull(simulation, "simulation");
+    notNull(out, "out");
+    *out = simulation->simulation->time();
+  });
+}
+
+bibs_status bibs_simulation_activations(const bibs_simulation *simulation,
+                                        uint32_t t, double *out,
+                                        size_t length) {
+  return guard([&] {
+    notNull(simulation, "simulation");
+    notNull(out, "out");
+    const auto &a = simulation->simulation->frame(t).activations;
+    checkLength(length, a.size());
+    std::copy(a.begin(), a.end(), out);
+  });
+}
+
+bibs_status bibs_simulation_performed(const bibs_simulation *simulation,
+                                      uint32_t t, uint32_t *out,
+                                      size_t length) {
+  return guard([&] {
+    notNull(simulation, "simulation");
+    notNull(out, "out");
+    const auto &p = simulation->simulation->frame(t).performed;
+    checkLength(length, p.size());
+    std::copy(p.begin(), p.end(), out);
+  });
+}
+
+bibs_status bibs_simulation_behaviour_shares(const bibs_simulation *simulation,
+                                             uint32_t t, double *out,
+                                             size_t length) {
+  return guard([&] {
+    notNull(simulation, "simulation");
+    notNull(out, "out");
+    const auto shares = simulation->simulation->behaviourShares(t);
+    checkLength(length, shares.size());
+    std::copy(shares.begin(), shares.end(), out);
+  });
+}
+
+void bibs_simulation_destroy(bibs_simulation *simulation) {
+  delete simulation;
+}
@@ -0,0 +1,220 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/blocksparse.hpp"
+#include "bibs/scenario.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+/**
+ * Multiplies a vector by a block row, with the block size known at compile
+ * time so that the loops over a block are unrolled and vectorised. Each
+ * column of a block is added to the block of y, scaled by an entry of x.
+ */
+template <size_t BS>
+void blockRow(const double *values, const BIBS::index_t *blockColumns,
+              uint64_t begin, uint64_t end, const double *x, double *y) {
+  double acc[BS] = {};
+  for (uint64_t e = begin; e < end; ++e) {
+    const double *v = values + e * BS * BS;
+    const double *xs = x + blockColumns[e] * BS;
+    for (size_t c = 0; c < BS; ++c) {
+      const double xc = xs[c];
+      for (size_t r = 0; r < BS; ++r) {
+        acc[r] += v[c * BS + r] * xc;
+      }
+    }
+  }
+  std::copy(acc, acc + BS, y);
+}
+
+/**
+ * Multiplies a vector by a block row, for any block size.
+ */
+void blockRow(size_t bs, const double *values,
+              const BIBS::index_t *blockColumns, uint64_t begin,
+              uint64_t end, const double *x, double *y) {
+  std::fill(y, y + bs, 0.0);
+  for (uint64_t e = begin; e < end; ++e) {
+    const double *v = values + e * bs * bs;
+    const double *xs = x + blockColumns[e] * bs;
+    for (size_t c = 0; c < bs; ++c) {
+      const double xc = xs[c];
+      for (size_t r = 0; r < bs; ++r) {
+        y[r] += v[c * bs + r] * xc;
+      }
+    }
+  }
+}
+} // namespace
+
+BIBS::BlockSparseMatrix::BlockSparseMatrix(const std::vector<double> &dense,
+                                           size_t nRows, size_t nColumns,
+                                           size_t blockSize)
+    : nRows(nRows), nColumns(nColumns), blockSize(blockSize) {
+  if (dense.size() != nRows * nColumns) {
+    throw std::invalid_argument("matrix has the wrong size");
+  }
+  if (blockSize == 0) {
+    throw std::invalid_argument("block size must be positive");
+  }
+
+  const size_t bs = blockSize;
+  const size_t nBlockRows = (nRows + bs - 1) / bs;
+  const size_t nBlockColumns = (nColumns + bs - 1) / bs;
+  blockOffsets.push_back(0);
+  for (size_t br = 0; br < nBlockRows; ++br) {
+    for (size_t bc = 0; bc < nBlockColumns; ++bc) {
+      const size_t rEnd = std::min(nRows, (br + 1) * bs);
+      const size_t cEnd = std::min(nColumns, (bc + 1) * bs);
+
+      bool empty = true;
+      for (size_t r = br * bs; r < rEnd && empty; ++r) {
+        for (size_t c = bc * bs; c < cEnd; ++c) {
+          if (dense[r * nColumns + c] != 0) {
+            empty = false;
+            break;
+          }
+        }
+      }
+      if (empty) {
+        continue;
+      }
+
+      blockColumns.push_back(static_cast<index_t>(bc));
+      const size_t first = values.size();
+      values.resize(first + bs * bs, 0.0);
+      for (size_t r = br * bs; r < rEnd; ++r) {
+        for (size_t c = bc * bs; c < cEnd; ++c) {
+          values[first + (c - bc * bs) * bs + (r - br * bs)] =
+              dense[r * nColumns + c];
+        }
+      }
+    }
+    blockOffsets.push_back(blockColumns.size());
+  }
+}
+
+size_t BIBS::BlockSparseMatrix::getNRows() const { return nRows; }
+
+size_t BIBS::BlockSparseMatrix::getNColumns() const { return nColumns; }
+
+size_t BIBS::BlockSparseMatrix::getBlockSize() const { return blockSize; }
+
+size_t BIBS::BlockSparseMatrix::nBlocks() const { return blockColumns.size(); }
+
+void BIBS::BlockSparseMatrix::multiply(const double *x, double *y,
+                                       size_t nVectors) const {
+  const size_t bs = blockSize;
+  const size_t nBlockRows = blockOffsets.size() - 1;
+  const size_t paddedRows = nBlockRows * bs;
+  const size_t paddedColumns = (nColumns + bs - 1) / bs * bs;
+
+  // The vectors are padded to whole blocks, if they are not already.
+  const bool padded = paddedRows == nRows && paddedColumns == nColumns;
+  std::vector<double> xPad(padded ? 0 : paddedColumns, 0.0);
+  std::vector<double> yPad(padded ? 0 : paddedRows);
+
+  for (size_t v = 0; v < nVectors; ++v) {
+    const double *xv = x + v * nColumns;
+    double *yv = y + v * nRows;
+    if (!padded) {
+      std::copy(xv, xv + nColumns, xPad.begin());
+      xv = xPad.data();
+      yv = yPad.data();
+    }
+
+    for (size_t br = 0; br < nBlockRows; ++br) {
+      const uint64_t begin = blockOffsets[br];
+      const uint64_t end = blockOffsets[br + 1];
+      double *yb = yv + br * bs;
+      switch (bs) {
+      case 4:
+        blockRow<4>(values.data(), blockColumns.data(), begin, end, xv, yb);
+        break;
+      case 8:
+        blockRow<8>(values.data(), blockColumns.data(), begin, end, xv, yb);
+        break;
+      case 16:
+        blockRow<16>(values.data(), blockColumns.data(), begin, end, xv, yb);
+        break;
+      default:
+        blockRow(bs, values.data(), blockColumns.data(), begin, end, xv, yb);
+      }
+    }
+
+    if (!padded) {
+      std::copy(yPad.begin(), yPad.begin() + nRows, y + v * nRows);
+    }
+  }
+}
+
+BIBS::CsrMatrix::CsrMatrix(const std::vector<double> &dense, size_t nRows,
+                           size_t nColumns)
+    : nRows(nRows), nColumns(nColumns) {
+  if (dense.size() != nRows * nColumns) {
+    throw std::invalid_argument("matrix has the wrong size");
+  }
+  offsets.push_back(0);
+  for (size_t r = 0; r < nRows; ++r) {
+    for (size_t c = 0; c < nColumns; ++c) {
+      const double v = dense[r * nColumns + c];
+      if (v != 0) {
+        columns.push_back(static_cast<index_t>(c));
+        values.push_back(v);
+      }
+    }
+    offsets.push_back(columns.size());
+  }
+}
+
+size_t BIBS::CsrMatrix::nNonZeros() const { return values.size(); }
+
+void BIBS::CsrMatrix::multiply(const double *x, double *y,
+                               size_t nVectors) const {
+  for (size_t v = 0; v < nVectors; ++v) {
+    const double *xv = x + v * nColumns;
+    double *yv = y + v * nRows;
+    for (size_t r = 0; r < nRows; ++r) {
+      double s = 0.0;
+      for (uint64_t e = offsets[r]; e < offsets[r + 1]; ++e) {
+        s += values[e] * xv[columns[e]];
+      }
+      yv[r] = s;
+    }
+  }
+}
+
+void BIBS::denseMultiply(const double *a, size_t nRows, size_t nColumns,
+                         const double *x, double *y, size_t nVectors) {
+  for (size_t v = 0; v < nVectors; ++v) {
+    const double *xv = x + v * nColumns;
+    double *yv = y + v * nRows;
+    for (size_t r = 0; r < nRows; ++r) {
+      double s = 0.0;
+      for (size_t c = 0; c < nColumns; ++c) {
+        s += a[r * nColumns + c] * xv[c];
+      }
+      yv[r] = s;
+    }
+  }
+}
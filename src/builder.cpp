@@ -0,0 +1,197 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/builder.hpp"
+#include "bibs/agent.hpp"
+#include "bibs/belief.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+
+#include <algorithm>
+#include <boost/uuid/uuid.hpp>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+/**
+ * The number of agents built by each task.
+ */
+constexpr size_t builderGrain = 1024;
+
+/**
+ * The steps of a build, each with its own random numbers.
+ */
+enum Step : uint64_t {
+  timeDeltaStep = 1,
+  friendStep,
+  activationStep,
+  uuidStep
+};
+
+/**
+ * Fills a row of nBeliefs values of each agent.
+ */
+void fillRows(BIBS::ThreadPool *threads, uint64_t seed, Step step,
+              size_t nAgents, size_t nBeliefs,
+              const BIBS::ScenarioBuilder::RowFunction &fn, double *values) {
+  forChunks(threads, nAgents, builderGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const auto agent = static_cast<BIBS::index_t>(i);
+      BIBS::AgentRandom random(seed, step, agent);
+      fn(agent, random, values + i * nBeliefs);
+    }
+  });
+}
+} // namespace
+
+BIBS::ScenarioBuilder::ScenarioBuilder(size_t nAgents, size_t nBeliefs,
+                                       size_t nBehaviours, uint64_t seed,
+                                       ThreadPool *threads)
+    : scenario(nAgents, nBeliefs, nBehaviours), seed(seed), threads(threads) {
+}
+
+BIBS::Scenario &BIBS::ScenarioBuilder::getScenario() { return scenario; }
+
+void BIBS::ScenarioBuilder::setTimeDeltas(const RowFunction &fn) {
+  fillRows(threads, seed, timeDeltaStep, scenario.nAgents, scenario.nBeliefs,
+           fn, scenario.timeDeltas.data());
+}
+
+void BIBS::ScenarioBuilder::setFriends(const FriendFunction &fn) {
+  const size_t nA = scenario.nAgents;
+  const size_t nChunks = (nA + builderGrain - 1) / builderGrain;
+  std::vector<uint64_t> offsets(nA + 1, 0);
+
+  // Each chunk of agents gathers its friends, and the number of each agent,
+  // then they are copied to their place once the offsets are known.
+  std::vector<std::vector<index_t>> chunkFriends(nChunks);
+  std::vector<std::vector<double>> chunkWeights(nChunks);
+  forChunks(threads, nA, builderGrain, [&](size_t begin, size_t end) {
+    auto &friends = chunkFriends[begin / builderGrain];
+    auto &weights = chunkWeights[begin / builderGrain];
+    std::vector<index_t> f;
+    std::vector<double> w;
+    for (size_t i = begin; i < end; ++i) {
+      const auto agent = static_cast<index_t>(i);
+      AgentRandom random(seed, friendStep, agent);
+      f.clear();
+      w.clear();
+      fn(agent, random, f, w);
+      if (f.size() != w.size()) {
+        throw std::invalid_argument("friends and weights differ in size");
+      }
+      if (std::any_of(f.begin(), f.end(), [&](index_t j) { return j >= nA; })) {
+        throw std::out_of_range("agent not found");
+      }
+      friends.insert(friends.end(), f.begin(), f.end());
+      weights.insert(weights.end(), w.begin(), w.end());
+      offsets[i + 1] = f.size();
+    }
+  });
+  for (size_t i = 0; i < nA; ++i) {
+    offsets[i + 1] += offsets[i];
+  }
+
+  scenario.friendOffsets = std::move(offsets);
+  scenario.friends.resize(scenario.friendOffsets[nA]);
+  scenario.friendWeights.resize(scenario.friendOffsets[nA]);
+  forChunks(threads, nA, builderGrain, [&](size_t begin, size_t end) {
+    auto &friends = chunkFriends[begin / builderGrain];
+    auto &weights = chunkWeights[begin / builderGrain];
+    const auto offset = scenario.friendOffsets[begin];
+    std::copy(friends.begin(), friends.end(),
+              scenario.friends.begin() + offset);
+    std::copy(weights.begin(), weights.end(),
+              scenario.friendWeights.begin() + offset);
+    std::vector<index_t>().swap(friends);
+    std::vector<double>().swap(weights);
+  });
+}
+
+std::vector<double>
+BIBS::ScenarioBuilder::activations(const RowFunction &fn) const {
+  std::vector<double> a(scenario.nAgents * scenario.nBeliefs);
+  fillRows(threads, seed, activationStep, scenario.nAgents, scenario.nBeliefs,
+           fn, a.data());
+  return a;
+}
+
+BIBS::Scenario BIBS::ScenarioBuilder::build() {
+  scenario.validate();
+  Scenario s(0, scenario.nBeliefs, scenario.nBehaviours);
+  std::swap(s, scenario);
+  return s;
+}
+
+std::vector<std::unique_ptr<BIBS::Agent>> BIBS::ScenarioBuilder::agents(
+    const Scenario &scenario, const std::vector<double> &activations,
+    const std::vector<const IBelief *> &beliefs, uint64_t seed,
+    ThreadPool *threads) {
+  const size_t nA = scenario.nAgents;
+  const size_t nB = scenario.nBeliefs;
+
+  if (beliefs.size() != nB) {
+    throw std::invalid_argument("beliefs have the wrong size");
+  }
+  if (activations.size() != nA * nB) {
+    throw std::invalid_argument("activations have the wrong size");
+  }
+
+  std::vector<std::unique_ptr<Agent>> agents(nA);
+  forChunks(threads, nA, builderGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      // A version 4 (random) UUID.
+      AgentRandom random(seed, uuidStep, static_cast<index_t>(i));
+      boost::uuids::uuid uuid;
+      const uint64_t words[2] = {random(), random()};
+      std::memcpy(uuid.data, words, sizeof(words));
+      uuid.data[6] = (uuid.data[6] & 0x0f) | 0x40;
+      uuid.data[8] = (uuid.data[8] & 0x3f) | 0x80;
+
+      std::map<const IBelief *, double> initial;
+      for (size_t b = 0; b < nB; ++b) {
+        initial.emplace(beliefs[b], activations[i * nB + b]);
+      }
+      agents[i] = std::make_unique<Agent>(
+          uuid, std::map<sim_time_t, std::map<const IBelief *, double>>{
+                    {0, std::move(initial)}});
+      for (size_t b = 0; b < nB; ++b) {
+        agents[i]->setTimeDelta(beliefs[b], scenario.timeDeltas[i * nB + b]);
+      }
+    }
+  });
+
+  // Each agent's friends are set by the task of that agent only.
+  forChunks(threads, nA, builderGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      std::map<const IAgent *, double> weights;
+      for (auto e = scenario.friendOffsets[i];
+           e < scenario.friendOffsets[i + 1]; ++e) {
+        weights[agents[scenario.friends[e]].get()] += scenario.friendWeights[e];
+      }
+      for (const auto &[f, w] : weights) {
+        agents[i]->setFriendWeight(f, w);
+      }
+    }
+  });
+
+  return agents;
+}
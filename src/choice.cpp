@@ -0,0 +1,169 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/choice.hpp"
+#include "bibs/scenario.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+/**
+ * The index of the greatest utility of a row; the first if there is a tie.
+ */
+BIBS::index_t argmax(const double *u, size_t nK) {
+  size_t best = 0;
+  for (size_t k = 1; k < nK; ++k) {
+    if (u[k] > u[best]) {
+      best = k;
+    }
+  }
+  return static_cast<BIBS::index_t>(best);
+}
+
+/**
+ * The index k at which the running sum of w passes target, or the last
+ * index with positive weight if rounding keeps it from passing.
+ */
+BIBS::index_t walk(const double *w, size_t nK, double target) {
+  double cumulative = 0.0;
+  size_t last = 0;
+  for (size_t k = 0; k < nK; ++k) {
+    if (w[k] > 0) {
+      cumulative += w[k];
+      last = k;
+      if (target < cumulative) {
+        break;
+      }
+    }
+  }
+  return static_cast<BIBS::index_t>(last);
+}
+} // namespace
+
+bool BIBS::IChoicePolicy::needsUniform(const double *, size_t) const {
+  return true;
+}
+
+void BIBS::ArgmaxPolicy::choose(const double *utilities, const double *,
+                                size_t n, size_t nBehaviours,
+                                index_t *chosen) const {
+  for (size_t i = 0; i < n; ++i) {
+    chosen[i] = argmax(utilities + i * nBehaviours, nBehaviours);
+  }
+}
+
+void BIBS::ProportionalPolicy::choose(const double *utilities,
+                                      const double *uniforms, size_t n,
+                                      size_t nBehaviours,
+                                      index_t *chosen) const {
+  const size_t nK = nBehaviours;
+  for (size_t i = 0; i < n; ++i) {
+    const double *u = utilities + i * nK;
+
+    // Branch-free, so that it vectorises.
+    double positiveSum = 0.0;
+    size_t nPositive = 0;
+    for (size_t k = 0; k < nK; ++k) {
+      const bool positive = u[k] > 0;
+      positiveSum += positive ? u[k] : 0.0;
+      nPositive += positive;
+    }
+
+    chosen[i] = nPositive <= 1 ? argmax(u, nK)
+                               : walk(u, nK, uniforms[i] * positiveSum);
+  }
+}
+
+bool BIBS::ArgmaxPolicy::needsUniform(const double *, size_t) const {
+  return false;
+}
+
+bool BIBS::ProportionalPolicy::needsUniform(const double *utilities,
+                                            size_t nBehaviours) const {
+  size_t nPositive = 0;
+  for (size_t k = 0; k < nBehaviours && nPositive <= 1; ++k) {
+    nPositive += utilities[k] > 0;
+  }
+  return nPositive > 1;
+}
+
+BIBS::SoftmaxPolicy::SoftmaxPolicy(double temperature)
+    : temperature(temperature) {
+  if (!(temperature > 0)) {
+    throw std::invalid_argument("temperature must be positive");
+  }
+}
+
+void BIBS::SoftmaxPolicy::choose(const double *utilities,
+                                 const double *uniforms, size_t n,
+                                 size_t nBehaviours, index_t *chosen) const {
+  const size_t nK = nBehaviours;
+  const double beta = 1.0 / temperature;
+  std::vector<double> w(nK);
+  for (size_t i = 0; i < n; ++i) {
+    const double *u = utilities + i * nK;
+
+    // Subtracting the maximum keeps exp from overflowing; the greatest
+    // weight is 1, so the sum is at least 1.
+    double maxUtility = u[0];
+    for (size_t k = 1; k < nK; ++k) {
+      maxUtility = std::max(maxUtility, u[k]);
+    }
+    double sum = 0.0;
+    for (size_t k = 0; k < nK; ++k) {
+      w[k] = std::exp((u[k] - maxUtility) * beta);
+      sum += w[k];
+    }
+
+    chosen[i] = walk(w.data(), nK, uniforms[i] * sum);
+  }
+}
+
+BIBS::EpsilonGreedyPolicy::EpsilonGreedyPolicy(double epsilon)
+    : epsilon(epsilon) {
+  if (!(epsilon >= 0 && epsilon <= 1)) {
+    throw std::invalid_argument("epsilon must be in [0, 1]");
+  }
+}
+
+void BIBS::EpsilonGreedyPolicy::choose(const double *utilities,
+                                       const double *uniforms, size_t n,
+                                       size_t nBehaviours,
+                                       index_t *chosen) const {
+  const size_t nK = nBehaviours;
+  for (size_t i = 0; i < n; ++i) {
+    // One random number decides both whether to explore and what: given
+    // that it is below epsilon, it is uniform on [0, epsilon).
+    const double r = uniforms[i];
+    if (r < epsilon) {
+      chosen[i] = static_cast<index_t>(
+          std::min(static_cast<size_t>(r / epsilon * nK), nK - 1));
+    } else {
+      chosen[i] = argmax(utilities + i * nK, nK);
+    }
+  }
+}
+
+std::shared_ptr<const BIBS::IChoicePolicy> BIBS::defaultChoicePolicy() {
+  static const auto policy = std::make_shared<const ProportionalPolicy>();
+  return policy;
+}
@@ -0,0 +1,335 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/coarsegrain.hpp"
+#include "bibs/agent.hpp"
+#include "bibs/behaviour.hpp"
+#include "bibs/belief.hpp"
+#include "bibs/bibs.hpp"
+#include "bibs/meanfield.hpp"
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+std::vector<size_t>
+BIBS::detectCommunities(const std::vector<const Agent *> &agents,
+                        size_t maxIterations) {
+  const size_t n = agents.size();
+
+  std::map<const IAgent *, size_t> index;
+  for (size_t i = 0; i < n; ++i) {
+    index.emplace(agents[i], i);
+  }
+
+  std::vector<std::map<size_t, double>> neighbours(n);
+  for (size_t i = 0; i < n; ++i) {
+    for (const auto &[a, w] : agents[i]->friendWeights()) {
+      auto it = index.find(a);
+      if (it == index.end() || it->second == i) {
+        continue;
+      }
+      neighbours[i][it->second] += std::abs(w);
+      neighbours[it->second][i] += std::abs(w);
+    }
+  }
+
+  std::vector<size_t> labels(n);
+  for (size_t i = 0; i < n; ++i) {
+    labels[i] = i;
+  }
+
+  for (size_t iteration = 0; iteration < maxIterations; ++iteration) {
+    bool changed = false;
+
+    for (size_t i = 0; i < n; ++i) {
+      std::map<size_t, double> labelWeights;
+      for (const auto &[j, w] : neighbours[i]) {
+        labelWeights[labels[j]] += w;
+      }
+
+      size_t best = labels[i];
+      double bestWeight = labelWeights[labels[i]];
+      for (const auto &[label, w] : labelWeights) {
+        if (w > bestWeight) {
+          best = label;
+          bestWeight = w;
+        }
+      }
+
+      if (best != labels[i]) {
+        labels[i] = best;
+        changed = true;
+      }
+    }
+
+    if (!changed) {
+      break;
+    }
+  }
+
+  std::map<size_t, size_t> renumbered;
+  for (auto &label : labels) {
+    label = renumbered.emplace(label, renumbered.size()).first->second;
+  }
+
+  return labels;
+}
+
+BIBS::RefinedAgent::RefinedAgent(
+    const boost::uuids::uuid uuid,
+    const std::map<sim_time_t, std::map<const IBelief *, double>> activationMap,
+    const MeanFieldSimulation *meanField, sim_time_t t0)
+    : BIBS::Agent(uuid, activationMap), meanField(meanField), t0(t0),
+      communityWeights(meanField->nCohorts(), 0.0) {}
+
+double BIBS::RefinedAgent::communityWeight(size_t c) const {
+  return communityWeights.at(c);
+}
+
+void BIBS::RefinedAgent::setCommunityWeight(size_t c, double w) {
+  communityWeights.at(c) = w;
+}
+
+double BIBS::RefinedAgent::observed(const IBelief *b,
+                                    const sim_time_t t) const {
+  double ret_value = Agent::observed(b, t);
+
+  for (size_t c = 0; c < communityWeights.size(); ++c) {
+    if (communityWeights[c] != 0.0) {
+      ret_value += communityWeights[c] * meanField->observedValue(t - t0, c, b);
+    }
+  }
+
+  return ret_value;
+}
+
+BIBS::CoarseGrainedSimulation::CoarseGrainedSimulation(
+    std::vector<const Agent *> agents, std::vector<const IBelief *> beliefs,
+    std::vector<const IBehaviour *> behaviours, std::vector<size_t> communities,
+    sim_time_t t0, size_t nQuadrature, unsigned seed)
+    : agents(agents), beliefs(beliefs), behaviours(behaviours),
+      communities(communities), t0(t0),
+      meanField(beliefs, behaviours, nQuadrature, seed),
+      refined(agents.size()), eng(seed) {
+  const size_t n = agents.size();
+  const size_t nB = beliefs.size();
+
+  if (communities.size() != n) {
+    throw std::invalid_argument("there must be one community per agent");
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    agentIndex.emplace(agents[i], i);
+    if (communities[i] >= members.size()) {
+      members.resize(communities[i] + 1);
+    }
+    members[communities[i]].push_back(i);
+  }
+
+  const size_t nC = members.size();
+  refinedCommunities.resize(nC, false);
+
+  for (size_t c = 0; c < nC; ++c) {
+    std::vector<double> td(nB, 0.0);
+    std::vector<double> mean(nB, 0.0);
+    std::vector<double> variance(nB, 0.0);
+    const double size = static_cast<double>(members[c].size());
+
+    for (const auto &i : members[c]) {
+      for (size_t b = 0; b < nB; ++b) {
+        const double a = agents[i]->activation(t0, beliefs[b]);
+        td[b] += agents[i]->timeDelta(beliefs[b]);
+        mean[b] += a;
+        variance[b] += a * a;
+      }
+    }
+
+    for (size_t b = 0; b < nB; ++b) {
+      if (size > 0) {
+        td[b] /= size;
+        mean[b] /= size;
+        variance[b] = variance[b] / size - mean[b] * mean[b];
+      }
+    }
+
+    meanField.addCohort(size, td, mean, variance);
+  }
+
+  std::vector<std::vector<double>> contacts(nC, std::vector<double>(nC, 0.0));
+  for (size_t i = 0; i < n; ++i) {
+    for (const auto &[a, w] : agents[i]->friendWeights()) {
+      auto it = agentIndex.find(a);
+      if (it != agentIndex.end()) {
+        contacts[communities[i]][communities[it->second]] += w;
+      }
+    }
+  }
+
+  for (size_t c = 0; c < nC; ++c) {
+    for (size_t d = 0; d < nC; ++d) {
+      if (!members[c].empty()) {
+        meanField.setContact(c, d, contacts[c][d] / members[c].size());
+      }
+    }
+  }
+}
+
+size_t BIBS::CoarseGrainedSimulation::nCommunities() const {
+  return members.size();
+}
+
+BIBS::sim_time_t BIBS::CoarseGrainedSimulation::time() const {
+  return t0 + meanField.time();
+}
+
+const BIBS::MeanFieldSimulation &
+BIBS::CoarseGrainedSimulation::getMeanField() const {
+  return meanField;
+}
+
+double
+BIBS::CoarseGrainedSimulation::behaviourShare(sim_time_t t, size_t c,
+                                              const IBehaviour *b) const {
+  if (t < t0) {
+    throw std::out_of_range("time not found");
+  }
+  return meanField.behaviourShare(t - t0, c, b);
+}
+
+bool BIBS::CoarseGrainedSimulation::isRefined(size_t c) const {
+  return refinedCommunities.at(c);
+}
+
+const BIBS::RefinedAgent *
+BIBS::CoarseGrainedSimulation::refinedAgent(const Agent *a) const {
+  const auto *agent = refined.at(agentIndex.at(a)).get();
+  if (agent == nullptr) {
+    throw std::out_of_range("agent not refined");
+  }
+  return agent;
+}
+
+void BIBS::CoarseGrainedSimulation::updateRefinedShares(sim_time_t t,
+                                                        size_t c) {
+  std::vector<double> shares(behaviours.size(), 0.0);
+  const double w = 1.0 / members[c].size();
+
+  for (const auto &i : members[c]) {
+    const auto *performed = refined[i]->performed(t);
+    for (size_t k = 0; k < behaviours.size(); ++k) {
+      if (behaviours[k] == performed) {
+        shares[k] += w;
+      }
+    }
+  }
+
+  meanField.setBehaviourShares(t - t0, c, shares);
+}
+
+void BIBS::CoarseGrainedSimulation::refine(size_t c) {
+  if (refinedCommunities.at(c)) {
+    return;
+  }
+
+  const size_t nB = beliefs.size();
+  const sim_time_t t = time();
+
+  std::normal_distribution<double> normal;
+
+  for (const auto &i : members[c]) {
+    std::map<const IBelief *, double> initial;
+    for (size_t b = 0; b < nB; ++b) {
+      if (t == t0) {
+        initial.emplace(beliefs[b], agents[i]->activation(t0, beliefs[b]));
+      } else {
+        initial.emplace(
+            beliefs[b],
+            meanField.activationMean(t - t0, c, beliefs[b]) +
+                std::sqrt(meanField.activationVariance(t - t0, c, beliefs[b])) *
+                    normal(eng));
+      }
+    }
+
+    refined[i] = std::make_unique<RefinedAgent>(
+        agents[i]->uuid,
+        std::map<sim_time_t, std::map<const IBelief *, double>>{{t, initial}},
+        &meanField, t0);
+
+    for (const auto &b : beliefs) {
+      refined[i]->setTimeDelta(b, agents[i]->timeDelta(b));
+    }
+  }
+
+  refinedCommunities[c] = true;
+
+  // Rewire the friends of all the refined agents: friends which are refined
+  // are observed individually, and the others through their super-agent.
+  for (size_t i = 0; i < agents.size(); ++i) {
+    if (refined[i] == nullptr) {
+      continue;
+    }
+    const bool isNew = communities[i] == c;
+
+    for (const auto &[a, w] : agents[i]->friendWeights()) {
+      auto it = agentIndex.find(a);
+      if (it == agentIndex.end()) {
+        continue;
+      }
+      const size_t j = it->second;
+      const size_t d = communities[j];
+
+      if (refined[j] != nullptr && (isNew || d == c)) {
+        refined[i]->setFriendWeight(refined[j].get(), w);
+      } else if (isNew && refined[j] == nullptr) {
+        refined[i]->setCommunityWeight(d, refined[i]->communityWeight(d) + w);
+      }
+    }
+
+    // All of community c is now observed individually.
+    refined[i]->setCommunityWeight(c, 0.0);
+  }
+
+  for (const auto &i : members[c]) {
+    refined[i]->perform(t, behaviours);
+  }
+
+  meanField.setExternal(c, true);
+  updateRefinedShares(t, c);
+}
+
+void BIBS::CoarseGrainedSimulation::run(sim_time_t nDays) {
+  for (sim_time_t day = 0; day < nDays; ++day) {
+    meanField.run(1);
+    const sim_time_t t = time();
+
+    for (auto &agent : refined) {
+      if (agent != nullptr) {
+        agent->tick(t, behaviours, beliefs);
+      }
+    }
+
+    for (size_t c = 0; c < members.size(); ++c) {
+      if (refinedCommunities[c]) {
+        updateRefinedShares(t, c);
+      }
+    }
+  }
+}
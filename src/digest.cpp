@@ -0,0 +1,67 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/digest.hpp"
+#include "bibs/scenario.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+uint64_t BIBS::agentDigest(index_t agent, index_t performed,
+                           const double *activations, size_t nBeliefs,
+                           double quantum) {
+  uint64_t x = mix64(agent);
+  x = mix64(x ^ performed);
+  for (size_t b = 0; b < nBeliefs; ++b) {
+    // The rounded value is hashed by its bits, which also covers values too
+    // large for an integer. Adding 0.0 turns -0.0 into 0.0.
+    const double q = std::nearbyint(activations[b] / quantum) + 0.0;
+    uint64_t bits;
+    std::memcpy(&bits, &q, sizeof(bits));
+    x = mix64(x ^ bits);
+  }
+  return x;
+}
+
+uint64_t BIBS::stateDigest(const std::vector<double> &activations,
+                           const std::vector<index_t> &performed,
+                           size_t nBeliefs, size_t begin, size_t end,
+                           double quantum) {
+  uint64_t sum = 0;
+  for (size_t i = begin; i < end; ++i) {
+    sum += agentDigest(static_cast<index_t>(i), performed[i],
+                       &activations[i * nBeliefs], nBeliefs, quantum);
+  }
+  return sum;
+}
+
+std::vector<uint64_t>
+BIBS::agentDigests(const std::vector<double> &activations,
+                   const std::vector<index_t> &performed, size_t nBeliefs,
+                   double quantum) {
+  if (activations.size() != performed.size() * nBeliefs) {
+    throw std::invalid_argument("activations and performed do not match");
+  }
+  std::vector<uint64_t> digests(performed.size());
+  for (size_t i = 0; i < digests.size(); ++i) {
+    digests[i] = agentDigest(static_cast<index_t>(i), performed[i],
+                             &activations[i * nBeliefs], nBeliefs, quantum);
+  }
+  return digests;
+}
@@ -0,0 +1,323 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/ensemble.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+double BIBS::EnsembleSummary::halfWidth(double z) const {
+  return z * standardError;
+}
+
+size_t BIBS::EnsembleSummary::replicatesFor(double target, double z) const {
+  if (!(target > 0)) {
+    throw std::invalid_argument("the half-width must be positive");
+  }
+  const double ratio = halfWidth(z) / target;
+  const double n = std::ceil(nReplicates * ratio * ratio / unitSize);
+  if (!(n < static_cast<double>(std::numeric_limits<size_t>::max() /
+                                unitSize))) {
+    return std::numeric_limits<size_t>::max() / unitSize * unitSize;
+  }
+  return static_cast<size_t>(n) * unitSize;
+}
+
+BIBS::Ensemble::Ensemble(
+    const std::vector<std::shared_ptr<const Scenario>> &scenarios,
+    const std::vector<double> &activations, std::vector<Metric> metrics,
+    sim_time_t nDays, uint64_t seed, Sampling sampling,
+    bool commonRandomNumbers, ThreadPool *threads)
+    : metrics(std::move(metrics)), nDays(nDays), sampling(sampling),
+      commonRandomNumbers(commonRandomNumbers), threads(threads),
+      values(scenarios.size(),
+             std::vector<std::vector<double>>(this->metrics.size())) {
+  if (scenarios.empty()) {
+    throw std::invalid_argument("there must be at least one arm");
+  }
+  if (this->metrics.empty() ||
+      std::any_of(this->metrics.begin(), this->metrics.end(),
+                  [](const Metric &m) { return !m; })) {
+    throw std::invalid_argument("there must be at least one metric");
+  }
+  for (const auto &s : scenarios) {
+    if (!s || s->nAgents != scenarios[0]->nAgents ||
+        s->nBehaviours != scenarios[0]->nBehaviours ||
+        s->nBeliefs != scenarios[0]->nBeliefs) {
+      throw std::invalid_argument("the arms must have the same numbers of "
+                                  "agents, behaviours and beliefs");
+    }
+  }
+
+  origins.reserve(scenarios.size());
+  for (const auto &s : scenarios) {
+    origins.emplace_back(s, activations, std::vector<index_t>{}, seed,
+                         false);
+  }
+}
+
+BIBS::Ensemble::Ensemble(
+    const std::vector<std::shared_ptr<const Scenario>> &scenarios,
+    const std::vector<double> &activations, Metric metric, sim_time_t nDays,
+    uint64_t seed, Sampling sampling, bool commonRandomNumbers,
+    ThreadPool *threads)
+    : Ensemble(scenarios, activations, std::vector<Metric>{std::move(metric)},
+               nDays, seed, sampling, commonRandomNumbers, threads) {}
+
+BIBS::Ensemble::Metric BIBS::Ensemble::atEnd(
+    std::function<double(const VectorisedSimulation &)> f) {
+  class AtEnd : public Accumulator {
+  public:
+    std::function<double(const VectorisedSimulation &)> f;
+
+    explicit AtEnd(std::function<double(const VectorisedSimulation &)> f)
+        : f(std::move(f)) {}
+
+    double finish(const VectorisedSimulation &sim) override { return f(sim); }
+  };
+
+  if (!f) {
+    return nullptr;
+  }
+  return [f = std::move(f)]() -> std::unique_ptr<Accumulator> {
+    return std::make_unique<AtEnd>(f);
+  };
+}
+
+BIBS::Ensemble::Metric BIBS::Ensemble::finalShare(index_t k) {
+  return atEnd([k](const VectorisedSimulation &sim) {
+    return sim.behaviourShares(sim.time()).at(k);
+  });
+}
+
+BIBS::Ensemble::Metric BIBS::Ensemble::peakTime(index_t k) {
+  // The running argmax of the share, so the replicate needs no history.
+  class PeakTime : public Accumulator {
+  public:
+    index_t k;
+    sim_time_t peak = 0;
+    double highest = -1.0;
+
+    explicit PeakTime(index_t k) : k(k) {}
+
+    void observe(const VectorisedSimulation &sim) override {
+      const double share = sim.behaviourShares(sim.time()).at(k);
+      if (share > highest) {
+        highest = share;
+        peak = sim.time();
+      }
+    }
+
+    double finish(const VectorisedSimulation &) override {
+      return static_cast<double>(peak);
+    }
+  };
+
+  return [k]() -> std::unique_ptr<Accumulator> {
+    return std::make_unique<PeakTime>(k);
+  };
+}
+
+size_t BIBS::Ensemble::unitSize() const {
+  return sampling == Sampling::antithetic ? 2 : 1;
+}
+
+void BIBS::Ensemble::run(size_t nReplicates) {
+  if (nReplicates % unitSize() != 0) {
+    throw std::invalid_argument("antithetic replicates must be run in pairs");
+  }
+
+  const size_t first = this->nReplicates();
+  const size_t arms = origins.size();
+  std::vector<std::vector<double>> added(
+      arms, std::vector<double>(nReplicates * metrics.size()));
+
+  const auto body = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const size_t arm = i % arms;
+      const size_t r = first + i / arms;
+      const size_t unit = r / unitSize();
+
+      VectorisedSimulation replicate = origins[arm];
+      replicate.setStream(commonRandomNumbers ? unit : unit * arms + arm);
+      replicate.setAntithetic(r % unitSize() == 1);
+
+      std::vector<std::unique_ptr<Accumulator>> accumulators;
+      accumulators.reserve(metrics.size());
+      for (const auto &metric : metrics) {
+        accumulators.push_back(metric());
+        accumulators.back()->observe(replicate);
+      }
+      for (sim_time_t t = 0; t < nDays; ++t) {
+        replicate.run(1);
+        for (auto &a : accumulators) {
+          a->observe(replicate);
+        }
+      }
+      for (size_t m = 0; m < metrics.size(); ++m) {
+        added[arm][m * nReplicates + i / arms] =
+            accumulators[m]->finish(replicate);
+      }
+    }
+  };
+  forChunks(threads, arms * nReplicates, 1, body);
+
+  for (size_t arm = 0; arm < arms; ++arm) {
+    for (size_t m = 0; m < metrics.size(); ++m) {
+      const auto begin = added[arm].begin() + m * nReplicates;
+      values[arm][m].insert(values[arm][m].end(), begin, begin + nReplicates);
+    }
+  }
+}
+
+bool BIBS::Ensemble::runUntil(const std::vector<EnsembleTarget> &targets,
+                              size_t waveSize, size_t maxReplicates,
+                              double z) {
+  if (targets.empty()) {
+    throw std::invalid_argument("there must be at least one target");
+  }
+  if (waveSize == 0) {
+    throw std::invalid_argument("the wave size must be positive");
+  }
+  for (const auto &target : targets) {
+    if (!(target.halfWidth > 0)) {
+      throw std::invalid_argument("the half-widths must be positive");
+    }
+    summary(target.arm, target.metric);
+  }
+  waveSize = (waveSize + unitSize() - 1) / unitSize() * unitSize();
+  maxReplicates = maxReplicates / unitSize() * unitSize();
+
+  while (!met(targets, z) && nReplicates() < maxReplicates) {
+    // A standard error needs two units, so the first wave has at least two.
+    size_t needed = std::max(2 * unitSize(), waveSize);
+    for (const auto &target : targets) {
+      needed = std::max(needed, summary(target.arm, target.metric)
+                                    .replicatesFor(target.halfWidth, z));
+    }
+    size_t wave = needed > nReplicates() ? needed - nReplicates() : 0;
+    wave = std::min(wave, std::max(nReplicates(), waveSize));
+    wave = std::max<size_t>((wave + waveSize - 1) / waveSize, 1) * waveSize;
+    run(std::min(wave, maxReplicates - nReplicates()));
+  }
+
+  return met(targets, z);
+}
+
+bool BIBS::Ensemble::met(const std::vector<EnsembleTarget> &targets,
+                         double z) const {
+  return std::all_of(targets.begin(), targets.end(), [&](const auto &target) {
+    return summary(target.arm, target.metric).halfWidth(z) <= target.halfWidth;
+  });
+}
+
+size_t BIBS::Ensemble::nArms() const { return origins.size(); }
+
+size_t BIBS::Ensemble::nMetrics() const { return metrics.size(); }
+
+size_t BIBS::Ensemble::nReplicates() const { return values[0][0].size(); }
+
+const std::vector<double> &BIBS::Ensemble::getValues(size_t arm,
+                                                     size_t metric) const {
+  return values.at(arm).at(metric);
+}
+
+BIBS::EnsembleSummary
+BIBS::Ensemble::combine(const std::vector<double> &coefficients,
+                        size_t metric) const {
+  if (metric >= metrics.size()) {
+    throw std::out_of_range("metric not found");
+  }
+
+  EnsembleSummary s;
+  s.nReplicates = nReplicates();
+  s.unitSize = unitSize();
+  const size_t nUnits = s.nReplicates / unitSize();
+  if (nUnits == 0) {
+    s.standardError = std::numeric_limits<double>::infinity();
+    return s;
+  }
+
+  // The value of each unit, and the variance of single replicates as if
+  // they (and the arms) were independent.
+  std::vector<double> units(nUnits, 0.0);
+  double independentVariance = 0.0;
+  for (size_t arm = 0; arm < coefficients.size(); ++arm) {
+    const double c = coefficients[arm];
+    if (c == 0) {
+      continue;
+    }
+    const auto &x = values[arm][metric];
+    double mean = 0.0;
+    for (size_t r = 0; r < x.size(); ++r) {
+      units[r / unitSize()] += c * x[r] / unitSize();
+      mean += x[r];
+    }
+    mean /= x.size();
+    double ss = 0.0;
+    for (double v : x) {
+      ss += (v - mean) * (v - mean);
+    }
+    if (x.size() > 1) {
+      independentVariance += c * c * ss / (x.size() - 1);
+    }
+  }
+
+  for (double u : units) {
+    s.mean += u;
+  }
+  s.mean /= nUnits;
+
+  if (nUnits < 2) {
+    s.standardError = std::numeric_limits<double>::infinity();
+    return s;
+  }
+  double ss = 0.0;
+  for (double u : units) {
+    ss += (u - s.mean) * (u - s.mean);
+  }
+  s.standardError = std::sqrt(ss / (nUnits - 1) / nUnits);
+
+  if (s.standardError > 0) {
+    s.effectiveSampleSize =
+        independentVariance / (s.standardError * s.standardError);
+  } else {
+    s.effectiveSampleSize = independentVariance > 0
+                                ? std::numeric_limits<double>::infinity()
+                                : static_cast<double>(s.nReplicates);
+  }
+  return s;
+}
+
+BIBS::EnsembleSummary BIBS::Ensemble::summary(size_t arm,
+                                              size_t metric) const {
+  std::vector<double> c(origins.size(), 0.0);
+  c.at(arm) = 1.0;
+  return combine(c, metric);
+}
+
+BIBS::EnsembleSummary BIBS::Ensemble::difference(size_t a, size_t b,
+                                                 size_t metric) const {
+  std::vector<double> c(origins.size(), 0.0);
+  c.at(a) += 1.0;
+  c.at(b) -= 1.0;
+  return combine(c, metric);
+}
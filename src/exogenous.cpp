@@ -0,0 +1,210 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/exogenous.hpp"
+#include "bibs/bibs.hpp"
+#include "bibs/mapping.hpp"
+#include "bibs/scenario.hpp"
+
+#include <algorithm>
+#include <boost/endian/conversion.hpp>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+/**
+ * The magic number at the start of an exogenous input file.
+ */
+const char magic[8] = {'B', 'I', 'B', 'S', 'E', 'X', 'O', 'G'};
+
+/**
+ * The version of the exogenous input file format.
+ */
+constexpr uint32_t version = 1;
+
+// The format is little-endian, and is read and written with memcpy (or
+// used in place), so only in the native byte order.
+static_assert(boost::endian::order::native == boost::endian::order::little,
+              "exogenous input files are little-endian");
+
+/**
+ * The size of the header of an exogenous input file.
+ */
+constexpr size_t headerSize = 24;
+
+/**
+ * The offset of the values in a file with nColumns columns.
+ */
+size_t valuesOffset(size_t nColumns) {
+  return headerSize + (nColumns * sizeof(uint32_t) + 7) / 8 * 8;
+}
+
+/**
+ * The column of each behaviour up to the largest affected, or the number of
+ * columns if it is not affected.
+ *
+ * @exception std::invalid_argument If a behaviour is affected twice.
+ */
+std::vector<size_t> columnsOf(const std::vector<BIBS::index_t> &behaviours) {
+  const size_t nC = behaviours.size();
+  std::vector<size_t> columns;
+  for (size_t c = 0; c < nC; ++c) {
+    const auto k = behaviours[c];
+    if (k >= columns.size()) {
+      columns.resize(static_cast<size_t>(k) + 1, nC);
+    }
+    if (columns[k] != nC) {
+      throw std::invalid_argument("behaviour affected twice");
+    }
+    columns[k] = c;
+  }
+  return columns;
+}
+} // namespace
+
+BIBS::ExogenousInput::ExogenousInput(const std::string &path,
+                                     size_t lookahead)
+    : mapping(path), lookahead(lookahead),
+      pageSize(static_cast<size_t>(sysconf(_SC_PAGESIZE))) {
+  const char *bytes = mapping.data();
+  if (mapping.size() < headerSize ||
+      std::memcmp(bytes, magic, sizeof(magic)) != 0) {
+    throw std::runtime_error(path + " is not an exogenous input file");
+  }
+  uint32_t v, nC;
+  uint64_t nT;
+  std::memcpy(&v, bytes + 8, sizeof(v));
+  std::memcpy(&nC, bytes + 12, sizeof(nC));
+  std::memcpy(&nT, bytes + 16, sizeof(nT));
+  if (v != version) {
+    throw std::runtime_error(path + " has an unknown version");
+  }
+  const size_t offset = valuesOffset(nC);
+  if (mapping.size() < offset ||
+      (mapping.size() - offset) / sizeof(double) / std::max<size_t>(nC, 1) <
+          nT) {
+    throw std::runtime_error(path + " is truncated");
+  }
+
+  behaviours.resize(nC);
+  std::memcpy(behaviours.data(), bytes + headerSize, nC * sizeof(uint32_t));
+  try {
+    columns = columnsOf(behaviours);
+  } catch (const std::invalid_argument &) {
+    throw std::runtime_error(path + " affects a behaviour twice");
+  }
+  nTicks = nT;
+  values = reinterpret_cast<const double *>(bytes + offset);
+
+  // The ticks are read in order, so the kernel can read ahead and drop the
+  // pages behind.
+  mapping.advise(0, mapping.size(), MADV_SEQUENTIAL);
+}
+
+void BIBS::ExogenousInput::write(const std::string &path,
+                                 const std::vector<index_t> &behaviours,
+                                 const std::vector<double> &values) {
+  const size_t nC = behaviours.size();
+  if (nC == 0 ? !values.empty() : values.size() % nC != 0) {
+    throw std::invalid_argument("values are not a whole number of ticks");
+  }
+  columnsOf(behaviours);
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    throwErrno(errno, "open " + path);
+  }
+
+  char header[headerSize];
+  const uint32_t c = static_cast<uint32_t>(nC);
+  const uint64_t t = nC == 0 ? 0 : values.size() / nC;
+  std::memcpy(header, magic, sizeof(magic));
+  std::memcpy(header + 8, &version, sizeof(version));
+  std::memcpy(header + 12, &c, sizeof(c));
+  std::memcpy(header + 16, &t, sizeof(t));
+  out.write(header, sizeof(header));
+  out.write(reinterpret_cast<const char *>(behaviours.data()),
+            nC * sizeof(uint32_t));
+  const std::vector<char> padding(valuesOffset(nC) - headerSize -
+                                  nC * sizeof(uint32_t));
+  out.write(padding.data(), padding.size());
+  out.write(reinterpret_cast<const char *>(values.data()),
+            values.size() * sizeof(double));
+  if (!out.flush()) {
+    throwErrno(errno, "write " + path);
+  }
+}
+
+size_t BIBS::ExogenousInput::getNTicks() const { return nTicks; }
+
+size_t BIBS::ExogenousInput::nColumns() const { return behaviours.size(); }
+
+const std::vector<BIBS::index_t> &
+BIBS::ExogenousInput::getBehaviours() const {
+  return behaviours;
+}
+
+const double *BIBS::ExogenousInput::row(sim_time_t t) const {
+  if (t >= nTicks) {
+    throw std::out_of_range("no exogenous input at time " +
+                            std::to_string(t));
+  }
+  return values + static_cast<size_t>(t) * behaviours.size();
+}
+
+double BIBS::ExogenousInput::impetus(sim_time_t t, index_t behaviour) const {
+  const double *r = row(t);
+  if (behaviour >= columns.size() || columns[behaviour] == behaviours.size()) {
+    return 0.0;
+  }
+  return r[columns[behaviour]];
+}
+
+void BIBS::ExogenousInput::prefetch(sim_time_t t) const {
+  if (t >= nTicks || behaviours.empty()) {
+    return;
+  }
+  const size_t rowBytes = behaviours.size() * sizeof(double);
+  const size_t last = std::min<size_t>(t + lookahead + 1, nTicks);
+  const size_t offset = reinterpret_cast<const char *>(values) - mapping.data();
+  const size_t begin = (offset + t * rowBytes) / pageSize * pageSize;
+  const size_t end = offset + last * rowBytes;
+  mapping.advise(begin, end - begin, MADV_WILLNEED);
+}
+
+void BIBS::ExogenousInput::apply(sim_time_t t, double *utilities, size_t n,
+                                 size_t nBehaviours) const {
+  const double *r = row(t);
+  if (columns.size() > nBehaviours) {
+    throw std::out_of_range("affected behaviour not found");
+  }
+
+  const size_t nC = behaviours.size();
+  const index_t *k = behaviours.data();
+  for (size_t j = 0; j < n; ++j) {
+    double *ut = utilities + j * nBehaviours;
+    for (size_t c = 0; c < nC; ++c) {
+      ut[k[c]] += r[c];
+    }
+  }
+}
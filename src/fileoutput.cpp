@@ -0,0 +1,651 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/fileoutput.hpp"
+#include "bibs/bibs.hpp"
+#include "bibs/mapping.hpp"
+#include "bibs/output.hpp"
+#include "bibs/scenario.hpp"
+
+#include <algorithm>
+#include <boost/endian/conversion.hpp>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define BIBS_HAVE_IO_URING 1
+#else
+#define BIBS_HAVE_IO_URING 0
+#endif
+
+namespace {
+/**
+ * The magic number at the start of a history file.
+ */
+const char magic[8] = {'B', 'I', 'B', 'S', 'H', 'I', 'S', 'T'};
+
+/**
+ * The version of the history file format.
+ */
+constexpr uint32_t version = 1;
+
+// The format is little-endian, and is read and written with memcpy (or
+// used in place), so only in the native byte order.
+static_assert(boost::endian::order::native == boost::endian::order::little,
+              "history files are little-endian");
+
+/**
+ * The size of the header of a history file.
+ */
+constexpr size_t headerSize = 24;
+
+size_t roundUp(size_t n, size_t to) { return (n + to - 1) / to * to; }
+} // namespace
+
+BIBS::AlignedBuffers::AlignedBuffers(size_t count, size_t size)
+    : memory(nullptr, std::free),
+      size(roundUp(size, IWriteBackend::alignment)), count(count) {
+  if (count == 0 || size == 0) {
+    throw std::invalid_argument("there must be at least one buffer of data");
+  }
+  memory.reset(static_cast<char *>(
+      std::aligned_alloc(IWriteBackend::alignment, this->size * count)));
+  if (!memory) {
+    throw std::bad_alloc();
+  }
+}
+
+char *BIBS::AlignedBuffers::get(size_t i) const {
+  return memory.get() + i * size;
+}
+
+size_t BIBS::AlignedBuffers::indexOf(const char *buffer) const {
+  return static_cast<size_t>(buffer - memory.get()) / size;
+}
+
+#if BIBS_HAVE_IO_URING
+/**
+ * The rings shared with the kernel, set up with the raw system calls.
+ */
+class BIBS::IoUringBackend::Ring {
+public:
+  int fd = -1;
+  io_uring_params params{};
+
+  void *sqRing = MAP_FAILED;
+  size_t sqRingSize = 0;
+  void *cqRing = MAP_FAILED;
+  size_t cqRingSize = 0;
+  io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+  size_t sqesSize = 0;
+
+  unsigned *sqTail;
+  unsigned sqMask;
+  unsigned *sqArray;
+  unsigned *cqHead;
+  unsigned *cqTail;
+  unsigned cqMask;
+  io_uring_cqe *cqes;
+
+  bool registered = false;
+
+  explicit Ring(unsigned entries) {
+    fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd < 0) {
+      throwErrno(errno, "io_uring_setup");
+    }
+
+    sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) {
+      sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+    }
+
+    sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sqRing == MAP_FAILED) {
+      const int e = errno;
+      ::close(fd);
+      throwErrno(e, "mmap of io_uring submission ring");
+    }
+    if (single) {
+      cqRing = sqRing;
+    } else {
+      cqRing = mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    }
+    sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe *>(
+        mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+    if (cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+      const int e = errno;
+      unmap();
+      throwErrno(e, "mmap of io_uring rings");
+    }
+
+    auto *sq = static_cast<char *>(sqRing);
+    auto *cq = static_cast<char *>(cqRing);
+    sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+  }
+
+  void unmap() {
+    if (sqes != MAP_FAILED) {
+      munmap(sqes, sqesSize);
+    }
+    if (cqRing != MAP_FAILED && cqRing != sqRing) {
+      munmap(cqRing, cqRingSize);
+    }
+    if (sqRing != MAP_FAILED) {
+      munmap(sqRing, sqRingSize);
+    }
+    ::close(fd);
+  }
+
+  ~Ring() { unmap(); }
+
+  /**
+   * Registers buffers. This may fail, e.g. if the memory lock limit is too
+   * low, in which case the buffers are used unregistered.
+   */
+  void registerBuffers(const AlignedBuffers &buffers) {
+    std::vector<iovec> iov(buffers.count);
+    for (size_t i = 0; i < buffers.count; ++i) {
+      iov[i].iov_base = buffers.get(i);
+      iov[i].iov_len = buffers.size;
+    }
+    registered = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS,
+                         iov.data(), static_cast<unsigned>(iov.size())) == 0;
+  }
+
+  /**
+   * Queues and submits a write.
+   */
+  void write(int file, char *data, size_t length, uint64_t offset,
+             size_t bufferIndex) {
+    const unsigned tail = *sqTail;
+    const unsigned index = tail & sqMask;
+    io_uring_sqe &sqe = sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = registered ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe.fd = file;
+    sqe.addr = reinterpret_cast<uint64_t>(data);
+    sqe.len = static_cast<uint32_t>(length);
+    sqe.off = offset;
+    sqe.buf_index = static_cast<uint16_t>(bufferIndex);
+    sqe.user_data = bufferIndex;
+    sqArray[index] = index;
+    __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    while (syscall(__NR_io_uring_enter, fd, 1, 0, 0, nullptr, 0) < 0) {
+      if (errno != EINTR) {
+        throwErrno(errno, "io_uring_enter");
+      }
+    }
+  }
+
+  /**
+   * Waits for at least one completion.
+   */
+  void waitForCompletion() {
+    while (syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS,
+                   nullptr, 0) < 0) {
+      if (errno != EINTR) {
+        throwErrno(errno, "io_uring_enter");
+      }
+    }
+  }
+};
+
+BIBS::IoUringBackend::IoUringBackend(int fd, size_t nBuffers,
+                                     size_t bufferSize)
+    : buffers(nBuffers, bufferSize), fd(fd), writes(nBuffers) {
+  if (bufferSize > 0x7ffff000) {
+    throw std::invalid_argument("io_uring buffers must be under 2 GiB");
+  }
+  ring = std::make_unique<Ring>(static_cast<unsigned>(nBuffers));
+  ring->registerBuffers(buffers);
+  for (size_t i = nBuffers; i > 0; --i) {
+    free.push_back(i - 1);
+  }
+}
+
+BIBS::IoUringBackend::~IoUringBackend() {
+  try {
+    while (inFlight > 0) {
+      reap(true);
+    }
+  } catch (...) {
+  }
+}
+
+bool BIBS::IoUringBackend::available() {
+  io_uring_params params{};
+  const int fd = static_cast<int>(syscall(__NR_io_uring_setup, 1, &params));
+  if (fd < 0) {
+    return false;
+  }
+
+  // Kernels 5.1 to 5.5 set up rings but fail IORING_OP_WRITE with EINVAL;
+  // they do not support IORING_REGISTER_PROBE either.
+  constexpr unsigned nOps = 256;
+  std::vector<uint64_t> memory(
+      (sizeof(io_uring_probe) + nOps * sizeof(io_uring_probe_op) + 7) / 8);
+  auto *probe = reinterpret_cast<io_uring_probe *>(memory.data());
+  const bool probed = syscall(__NR_io_uring_register, fd,
+                              IORING_REGISTER_PROBE, probe, nOps) == 0;
+  ::close(fd);
+  return probed && IORING_OP_WRITE <= probe->last_op &&
+         (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+}
+
+bool BIBS::IoUringBackend::registered() const { return ring->registered; }
+
+void BIBS::IoUringBackend::queue(size_t i) {
+  const Write &w = writes[i];
+  ring->write(fd, buffers.get(i) + w.done, w.length - w.done,
+              w.offset + w.done, i);
+}
+
+void BIBS::IoUringBackend::reap(bool wait) {
+  if (wait) {
+    ring->waitForCompletion();
+  }
+  unsigned head = *ring->cqHead;
+  const unsigned tail = __atomic_load_n(ring->cqTail, __ATOMIC_ACQUIRE);
+  std::vector<size_t> resubmit;
+  for (; head != tail; ++head) {
+    const io_uring_cqe &cqe = ring->cqes[head & ring->cqMask];
+    const size_t i = static_cast<size_t>(cqe.user_data);
+    Write &w = writes[i];
+    if (cqe.res < 0) {
+      if (error == 0) {
+        error = -cqe.res;
+      }
+    } else if (cqe.res == 0 && w.done < w.length) {
+      if (error == 0) {
+        error = EIO;
+      }
+    } else {
+      w.done += static_cast<size_t>(cqe.res);
+      if (w.done < w.length) {
+        // A short write: the rest is written from where it stopped.
+        resubmit.push_back(i);
+        continue;
+      }
+    }
+    --inFlight;
+    free.push_back(i);
+  }
+  __atomic_store_n(ring->cqHead, head, __ATOMIC_RELEASE);
+  for (const auto i : resubmit) {
+    queue(i);
+  }
+}
+
+void BIBS::IoUringBackend::check() const {
+  if (error != 0) {
+    throwErrno(error, "io_uring write");
+  }
+}
+
+const char *BIBS::IoUringBackend::name() const { return "io_uring"; }
+
+size_t BIBS::IoUringBackend::bufferSize() const { return buffers.size; }
+
+char *BIBS::IoUringBackend::acquire() {
+  reap(false);
+  while (free.empty()) {
+    reap(true);
+  }
+  check();
+  const size_t i = free.back();
+  free.pop_back();
+  return buffers.get(i);
+}
+
+void BIBS::IoUringBackend::submit(char *buffer, size_t length,
+                                  uint64_t offset) {
+  const size_t i = buffers.indexOf(buffer);
+  writes[i] = {0, length, offset};
+  ++inFlight;
+  queue(i);
+}
+
+void BIBS::IoUringBackend::wait() {
+  while (inFlight > 0) {
+    reap(true);
+  }
+  check();
+}
+#else
+class BIBS::IoUringBackend::Ring {};
+
+BIBS::IoUringBackend::IoUringBackend(int fd, size_t nBuffers,
+                                     size_t bufferSize)
+    : buffers(nBuffers, bufferSize), fd(fd) {
+  throwErrno(ENOSYS, "io_uring");
+}
+
+BIBS::IoUringBackend::~IoUringBackend() {}
+
+bool BIBS::IoUringBackend::available() { return false; }
+
+bool BIBS::IoUringBackend::registered() const { return false; }
+
+void BIBS::IoUringBackend::queue(size_t i) {}
+
+void BIBS::IoUringBackend::reap(bool wait) {}
+
+void BIBS::IoUringBackend::check() const {}
+
+const char *BIBS::IoUringBackend::name() const { return "io_uring"; }
+
+size_t BIBS::IoUringBackend::bufferSize() const { return buffers.size; }
+
+char *BIBS::IoUringBackend::acquire() { return nullptr; }
+
+void BIBS::IoUringBackend::submit(char *buffer, size_t length,
+                                  uint64_t offset) {}
+
+void BIBS::IoUringBackend::wait() {}
+#endif
+
+BIBS::PwriteBackend::PwriteBackend(int fd, size_t nBuffers,
+                                   size_t bufferSize)
+    : buffers(nBuffers, bufferSize), fd(fd) {
+  for (size_t i = nBuffers; i > 0; --i) {
+    free.push_back(i - 1);
+  }
+  thread = std::thread([this] { run(); });
+}
+
+BIBS::PwriteBackend::~PwriteBackend() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  changed.notify_all();
+  thread.join();
+}
+
+void BIBS::PwriteBackend::run() {
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;) {
+    changed.wait(lock, [this] { return stopping || !pending.empty(); });
+    if (pending.empty()) {
+      return;
+    }
+    const Write w = pending.front();
+    pending.pop_front();
+
+    lock.unlock();
+    const char *data = buffers.get(w.buffer);
+    size_t done = 0;
+    int e = 0;
+    while (done < w.length) {
+      const ssize_t n = pwrite(fd, data + done, w.length - done,
+                               static_cast<off_t>(w.offset + done));
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        e = n < 0 ? errno : EIO;
+        break;
+      }
+      done += static_cast<size_t>(n);
+    }
+    lock.lock();
+
+    if (e != 0 && error == 0) {
+      error = e;
+    }
+    free.push_back(w.buffer);
+    --inFlight;
+    changed.notify_all();
+  }
+}
+
+const char *BIBS::PwriteBackend::name() const { return "pwrite"; }
+
+size_t BIBS::PwriteBackend::bufferSize() const { return buffers.size; }
+
+char *BIBS::PwriteBackend::acquire() {
+  std::unique_lock<std::mutex> lock(mutex);
+  changed.wait(lock, [this] { return !free.empty(); });
+  if (error != 0) {
+    throwErrno(error, "pwrite");
+  }
+  const size_t i = free.back();
+  free.pop_back();
+  return buffers.get(i);
+}
+
+void BIBS::PwriteBackend::submit(char *buffer, size_t length,
+                                 uint64_t offset) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back({buffers.indexOf(buffer), length, offset});
+    ++inFlight;
+  }
+  changed.notify_all();
+}
+
+void BIBS::PwriteBackend::wait() {
+  std::unique_lock<std::mutex> lock(mutex);
+  changed.wait(lock, [this] { return inFlight == 0; });
+  if (error != 0) {
+    throwErrno(error, "pwrite");
+  }
+}
+
+BIBS::FileHistorySink::FileHistorySink(const std::string &path,
+                                       size_t nAgents, size_t nBeliefs)
+    : FileHistorySink(path, nAgents, nBeliefs, Options()) {}
+
+BIBS::FileHistorySink::FileHistorySink(const std::string &path,
+                                       size_t nAgents, size_t nBeliefs,
+                                       const Options &options)
+    : nAgents(nAgents), nBeliefs(nBeliefs) {
+  const int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  if (options.direct) {
+    fd = ::open(path.c_str(), flags | O_DIRECT, 0644);
+    direct = fd >= 0;
+  }
+  if (fd < 0) {
+    fd = ::open(path.c_str(), flags, 0644);
+  }
+  if (fd < 0) {
+    throwErrno(errno, "open " + path);
+  }
+
+  try {
+    if (options.backend == Backend::ioUring) {
+      backend = std::make_unique<IoUringBackend>(fd, options.nBuffers,
+                                                 options.bufferSize);
+    } else if (options.backend == Backend::automatic &&
+               IoUringBackend::available()) {
+      // Setting up the rings can still fail, e.g. if they exceed the
+      // memory lock limit, in which case pwrite is used.
+      try {
+        backend = std::make_unique<IoUringBackend>(fd, options.nBuffers,
+                                                   options.bufferSize);
+      } catch (const std::system_error &) {
+      } catch (const std::invalid_argument &) {
+      }
+    }
+    if (!backend) {
+      backend = std::make_unique<PwriteBackend>(fd, options.nBuffers,
+                                                options.bufferSize);
+    }
+
+    char header[headerSize] = {};
+    const uint32_t b = static_cast<uint32_t>(nBeliefs);
+    const uint64_t a = nAgents;
+    std::memcpy(header, magic, sizeof(magic));
+    std::memcpy(header + 8, &version, sizeof(version));
+    std::memcpy(header + 12, &b, sizeof(b));
+    std::memcpy(header + 16, &a, sizeof(a));
+    append(header, sizeof(header));
+  } catch (...) {
+    backend.reset();
+    ::close(fd);
+    throw;
+  }
+}
+
+BIBS::FileHistorySink::~FileHistorySink() {
+  try {
+    close();
+  } catch (...) {
+  }
+}
+
+void BIBS::FileHistorySink::append(const void *data, size_t n) {
+  const char *bytes = static_cast<const char *>(data);
+  const size_t size = backend->bufferSize();
+  while (n > 0) {
+    if (buffer == nullptr) {
+      buffer = backend->acquire();
+      used = 0;
+    }
+    const size_t k = std::min(n, size - used);
+    std::memcpy(buffer + used, bytes, k);
+    used += k;
+    bytes += k;
+    n -= k;
+    if (used == size) {
+      backend->submit(buffer, size, offset);
+      offset += size;
+      buffer = nullptr;
+    }
+  }
+}
+
+void BIBS::FileHistorySink::write(sim_time_t t,
+                                  const std::vector<double> &activations,
+                                  const std::vector<index_t> &performed) {
+  if (fd < 0) {
+    throw std::logic_error("history file is closed");
+  }
+  if (activations.size() != nAgents * nBeliefs ||
+      performed.size() != nAgents) {
+    throw std::invalid_argument("tick has the wrong size");
+  }
+  const uint32_t record[2] = {t, 0};
+  append(record, sizeof(record));
+  append(activations.data(), activations.size() * sizeof(double));
+  append(performed.data(), performed.size() * sizeof(index_t));
+}
+
+void BIBS::FileHistorySink::close() {
+  if (fd < 0) {
+    return;
+  }
+  const uint64_t size = offset + used;
+  try {
+    if (buffer != nullptr) {
+      // O_DIRECT writes whole blocks; the file is cut back afterwards.
+      const size_t length =
+          direct ? roundUp(used, IWriteBackend::alignment) : used;
+      std::memset(buffer + used, 0, length - used);
+      backend->submit(buffer, length, offset);
+      buffer = nullptr;
+    }
+    backend->wait();
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+      throwErrno(errno, "ftruncate");
+    }
+  } catch (...) {
+    backend.reset();
+    ::close(fd);
+    fd = -1;
+    throw;
+  }
+  backend.reset();
+  if (::close(fd) != 0) {
+    fd = -1;
+    throwErrno(errno, "close");
+  }
+  fd = -1;
+}
+
+const char *BIBS::FileHistorySink::backendName() const {
+  return backend ? backend->name() : "closed";
+}
+
+bool BIBS::FileHistorySink::isDirect() const { return direct; }
+
+std::vector<BIBS::MemoryHistorySink::Tick>
+BIBS::FileHistorySink::read(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    throwErrno(errno, "open " + path);
+  }
+
+  char header[headerSize];
+  uint32_t v, nB;
+  uint64_t nA;
+  if (!in.read(header, sizeof(header)) ||
+      std::memcmp(header, magic, sizeof(magic)) != 0) {
+    throw std::runtime_error(path + " is not a history file");
+  }
+  std::memcpy(&v, header + 8, sizeof(v));
+  std::memcpy(&nB, header + 12, sizeof(nB));
+  std::memcpy(&nA, header + 16, sizeof(nA));
+  if (v != version) {
+    throw std::runtime_error(path + " has an unknown version");
+  }
+
+  std::vector<MemoryHistorySink::Tick> ticks;
+  uint32_t record[2];
+  while (in.read(reinterpret_cast<char *>(record), sizeof(record))) {
+    MemoryHistorySink::Tick tick{record[0], std::vector<double>(nA * nB),
+                                 std::vector<index_t>(nA)};
+    if (!in.read(reinterpret_cast<char *>(tick.activations.data()),
+                 tick.activations.size() * sizeof(double)) ||
+        !in.read(reinterpret_cast<char *>(tick.performed.data()),
+                 tick.performed.size() * sizeof(index_t))) {
+      throw std::runtime_error(path + " is truncated");
+    }
+    ticks.push_back(std::move(tick));
+  }
+  return ticks;
+}
@@ -0,0 +1,326 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/graph.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+/**
+ * The number of agents sorted or encoded by each task.
+ */
+constexpr size_t graphGrain = 4096;
+
+/**
+ * The number of bits needed to write v.
+ */
+unsigned bitWidth(uint32_t v) {
+  unsigned n = 0;
+  while (v > 0) {
+    v >>= 1;
+    ++n;
+  }
+  return n;
+}
+
+/**
+ * Writes v, which has at most width bits, from bit of p, which must be
+ * zero. Only the bytes holding a set bit are written, so a task never
+ * writes to the block of another.
+ */
+void writeBits(uint8_t *p, uint64_t bit, unsigned width, uint32_t v) {
+  for (unsigned b = 0; b < width; b += 8) {
+    const uint64_t at = bit + b;
+    const unsigned chunk = (v >> b) & 0xff;
+    const auto low = static_cast<uint8_t>(chunk << (at & 7));
+    const auto high = static_cast<uint8_t>(chunk >> (8 - (at & 7)));
+    if (low != 0) {
+      p[at >> 3] |= low;
+    }
+    if (high != 0) {
+      p[(at >> 3) + 1] |= high;
+    }
+  }
+}
+} // namespace
+
+BIBS::CompressedGraph::CompressedGraph(size_t nAgents,
+                                       const std::vector<index_t> &from,
+                                       const std::vector<index_t> &to,
+                                       const std::vector<double> &weights,
+                                       size_t blockSize, ThreadPool *threads,
+                                       WeightEncoding encoding)
+    : nAgents(nAgents), blockSize(blockSize), edgeOffsets(nAgents + 1, 0),
+      blockOffsets(nAgents + 1, 0), encoding(encoding) {
+  const size_t nE = from.size();
+
+  if (to.size() != nE || weights.size() != nE) {
+    throw std::invalid_argument("edge vectors must be the same size");
+  }
+  if (blockSize == 0) {
+    throw std::invalid_argument("block size must be positive");
+  }
+  if (encoding == WeightEncoding::quantised &&
+      !std::all_of(weights.begin(), weights.end(),
+                   [](double w) { return std::isfinite(w); })) {
+    throw std::invalid_argument("quantised weights must be finite");
+  }
+
+  for (size_t e = 0; e < nE; ++e) {
+    if (from[e] >= nAgents || to[e] >= nAgents) {
+      throw std::out_of_range("agent not found");
+    }
+    ++edgeOffsets[from[e] + 1];
+  }
+  for (size_t i = 0; i < nAgents; ++i) {
+    edgeOffsets[i + 1] += edgeOffsets[i];
+    blockOffsets[i + 1] =
+        blockOffsets[i] +
+        (edgeOffsets[i + 1] - edgeOffsets[i] + blockSize - 1) / blockSize;
+  }
+
+  // A stable counting sort by the observing agent, of the edge numbers.
+  std::vector<uint64_t> position(edgeOffsets.begin(), edgeOffsets.end() - 1);
+  std::vector<uint64_t> order(nE);
+  for (size_t e = 0; e < nE; ++e) {
+    order[position[from[e]]++] = e;
+  }
+  std::vector<uint64_t>().swap(position);
+
+  const bool weighted =
+      std::adjacent_find(weights.begin(), weights.end(),
+                         std::not_equal_to<double>()) != weights.end();
+  if (!weighted && nE > 0) {
+    weight = weights[0];
+  }
+
+  // The least and greatest weight of each agent, and whether they differ.
+  std::vector<double> greatest;
+  std::vector<uint8_t> differs;
+  if (weighted) {
+    agentWeights.assign(nAgents, 0.0);
+    greatest.assign(nAgents, 0.0);
+    differs.assign(nAgents, 0);
+    forChunks(threads, nAgents, graphGrain, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        if (edgeOffsets[i] == edgeOffsets[i + 1]) {
+          continue;
+        }
+        const double first = weights[order[edgeOffsets[i]]];
+        double least = first;
+        double most = first;
+        for (auto e = edgeOffsets[i] + 1; e < edgeOffsets[i + 1]; ++e) {
+          const double w = weights[order[e]];
+          differs[i] |= w != first;
+          least = std::min(least, w);
+          most = std::max(most, w);
+        }
+        agentWeights[i] = least;
+        greatest[i] = most;
+      }
+    });
+  }
+
+  // Unless each agent has one weight, store the weight of each edge.
+  const bool perEdge =
+      std::find(differs.begin(), differs.end(), 1) != differs.end();
+  if (perEdge) {
+    switch (encoding) {
+    case WeightEncoding::exact:
+      this->weights.resize(nE);
+      std::vector<double>().swap(agentWeights);
+      break;
+    case WeightEncoding::single:
+      singleWeights.resize(nE);
+      std::vector<double>().swap(agentWeights);
+      break;
+    case WeightEncoding::quantised:
+      quantisedWeights.resize(nE);
+      weightSteps.resize(nAgents);
+      for (size_t i = 0; i < nAgents; ++i) {
+        weightSteps[i] = (greatest[i] - agentWeights[i]) /
+                         std::numeric_limits<uint16_t>::max();
+      }
+      break;
+    }
+  }
+  std::vector<double>().swap(greatest);
+  std::vector<uint8_t>().swap(differs);
+
+  // Sort the friends of each agent and count the bytes of its blocks.
+  const size_t nBlocks = blockOffsets[nAgents];
+  blockBytes.assign(nBlocks + 1, 0);
+  blockFirst.resize(nBlocks);
+  blockWidths.resize(nBlocks);
+  forChunks(threads, nAgents, graphGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const auto first = order.begin() + edgeOffsets[i];
+      const auto last = order.begin() + edgeOffsets[i + 1];
+      std::stable_sort(first, last, [&](uint64_t a, uint64_t b) {
+        return to[a] < to[b];
+      });
+
+      uint64_t e = edgeOffsets[i];
+      for (uint64_t k = blockOffsets[i]; k < blockOffsets[i + 1]; ++k) {
+        const uint64_t blockEnd =
+            std::min<uint64_t>(e + blockSize, edgeOffsets[i + 1]);
+        blockFirst[k] = to[order[e]];
+        const uint64_t nGaps = blockEnd - e - 1;
+        unsigned width = 0;
+        for (++e; e < blockEnd; ++e) {
+          width = std::max(width, bitWidth(to[order[e]] - to[order[e - 1]]));
+        }
+        blockWidths[k] = static_cast<uint8_t>(width);
+        blockBytes[k + 1] = (nGaps * width + 7) / 8;
+      }
+    }
+  });
+  for (size_t k = 0; k < nBlocks; ++k) {
+    blockBytes[k + 1] += blockBytes[k];
+  }
+
+  // Encode the gaps, now that the offset of each block is known. Each block
+  // is a whole number of bytes, so no two tasks write the same byte.
+  bytes.assign(blockBytes[nBlocks] + sizeof(uint64_t), 0);
+  forChunks(threads, nAgents, graphGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      uint64_t e = edgeOffsets[i];
+      for (uint64_t k = blockOffsets[i]; k < blockOffsets[i + 1]; ++k) {
+        const uint64_t blockEnd =
+            std::min<uint64_t>(e + blockSize, edgeOffsets[i + 1]);
+        uint8_t *p = bytes.data() + blockBytes[k];
+        const unsigned width = blockWidths[k];
+        uint64_t bit = 0;
+        for (++e; e < blockEnd; ++e, bit += width) {
+          writeBits(p, bit, width, to[order[e]] - to[order[e - 1]]);
+        }
+      }
+
+      // The weights, in the order of the friends.
+      for (e = edgeOffsets[i]; perEdge && e < edgeOffsets[i + 1]; ++e) {
+        const double w = weights[order[e]];
+        if (!this->weights.empty()) {
+          this->weights[e] = w;
+        } else if (!singleWeights.empty()) {
+          singleWeights[e] = static_cast<float>(w);
+        } else if (weightSteps[i] > 0.0) {
+          quantisedWeights[e] = static_cast<uint16_t>(
+              std::lround((w - agentWeights[i]) / weightSteps[i]));
+        }
+      }
+    }
+  });
+}
+
+BIBS::CompressedGraph
+BIBS::CompressedGraph::fromScenario(const Scenario &scenario,
+                                    size_t blockSize, ThreadPool *threads,
+                                    WeightEncoding encoding) {
+  const size_t nA = scenario.nAgents;
+  std::vector<index_t> from(scenario.nEdges());
+  for (size_t i = 0; i < nA; ++i) {
+    std::fill(from.begin() + scenario.friendOffsets[i],
+              from.begin() + scenario.friendOffsets[i + 1],
+              static_cast<index_t>(i));
+  }
+  return CompressedGraph(nA, from, scenario.friends, scenario.friendWeights,
+                         blockSize, threads, encoding);
+}
+
+size_t BIBS::CompressedGraph::getNAgents() const { return nAgents; }
+
+size_t BIBS::CompressedGraph::getBlockSize() const { return blockSize; }
+
+size_t BIBS::CompressedGraph::nEdges() const { return edgeOffsets[nAgents]; }
+
+size_t BIBS::CompressedGraph::nBlocks() const { return blockFirst.size(); }
+
+size_t BIBS::CompressedGraph::degree(index_t i) const {
+  return edgeOffsets[i + 1] - edgeOffsets[i];
+}
+
+bool BIBS::CompressedGraph::isWeighted() const {
+  return !weights.empty() || !singleWeights.empty() || !agentWeights.empty();
+}
+
+BIBS::CompressedGraph::WeightEncoding
+BIBS::CompressedGraph::getWeightEncoding() const {
+  return encoding;
+}
+
+size_t BIBS::CompressedGraph::memoryBytes() const {
+  return (edgeOffsets.size() + blockOffsets.size() + blockBytes.size()) *
+             sizeof(uint64_t) +
+         blockFirst.size() * sizeof(index_t) + blockWidths.size() +
+         bytes.size() +
+         (weights.size() + agentWeights.size() + weightSteps.size()) *
+             sizeof(double) +
+         singleWeights.size() * sizeof(float) +
+         quantisedWeights.size() * sizeof(uint16_t);
+}
+
+bool BIBS::CompressedGraph::hasFriend(index_t i, index_t j) const {
+  // The last block of i starting at or before j.
+  const auto first = blockFirst.begin() + blockOffsets[i];
+  const auto last = blockFirst.begin() + blockOffsets[i + 1];
+  const auto it = std::upper_bound(first, last, j);
+  if (it == first) {
+    return false;
+  }
+  const uint64_t k = (it - blockFirst.begin()) - 1;
+
+  const uint64_t begin = edgeOffsets[i] + (k - blockOffsets[i]) * blockSize;
+  const uint64_t end =
+      std::min<uint64_t>(begin + blockSize, edgeOffsets[i + 1]);
+  const uint8_t *p = bytes.data() + blockBytes[k];
+  const unsigned width = blockWidths[k];
+  const uint64_t mask = (uint64_t(1) << width) - 1;
+  index_t f = blockFirst[k];
+  uint64_t bit = 0;
+  for (uint64_t e = begin + 1; e < end && f < j; ++e, bit += width) {
+    f += static_cast<index_t>(readBits(p, bit) & mask);
+  }
+  return f == j;
+}
+
+void BIBS::CompressedGraph::toEdges(std::vector<index_t> &from,
+                                    std::vector<index_t> &to,
+                                    std::vector<double> &weights) const {
+  from.clear();
+  to.clear();
+  weights.clear();
+  from.reserve(nEdges());
+  to.reserve(nEdges());
+  weights.reserve(nEdges());
+  for (size_t i = 0; i < nAgents; ++i) {
+    forEachFriend(static_cast<index_t>(i), [&](index_t j, double w) {
+      from.push_back(static_cast<index_t>(i));
+      to.push_back(j);
+      weights.push_back(w);
+    });
+  }
+}
@@ -0,0 +1,213 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/lookup.hpp"
+#include "bibs/digest.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+
+#include <algorithm>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+/**
+ * The number of keys hashed or partitioned by each task.
+ */
+constexpr size_t keyGrain = 16384;
+
+/**
+ * The number of keys from which the index is split into shards.
+ */
+constexpr size_t shardThreshold = 65536;
+
+/**
+ * The number of bits selecting the shard of a large index.
+ */
+constexpr unsigned largeShardBits = 6;
+
+uint64_t hashUuid(const boost::uuids::uuid &uuid) {
+  uint64_t hi, lo;
+  std::memcpy(&hi, uuid.data, sizeof(hi));
+  std::memcpy(&lo, uuid.data + sizeof(hi), sizeof(lo));
+  return BIBS::mix64(lo ^ BIBS::mix64(hi));
+}
+
+uint64_t hashName(const std::string &name) {
+  return BIBS::mix64(std::hash<std::string>()(name));
+}
+} // namespace
+
+void BIBS::HashIndex::build(
+    ThreadPool *threads, const std::function<bool(index_t, index_t)> &equal) {
+  const size_t n = hashes.size();
+  if (n >= ambiguous) {
+    throw std::length_error("too many keys to index");
+  }
+  shardBits = n < shardThreshold ? 0 : largeShardBits;
+  const size_t nShards = size_t(1) << shardBits;
+  const auto shardOf = [&](uint64_t h) {
+    return shardBits == 0 ? 0 : static_cast<size_t>(h >> (64 - shardBits));
+  };
+
+  // Partition the indices by shard, keeping them in order within each shard
+  // so that the first of a repeated key is the one kept.
+  const size_t nChunks = (n + keyGrain - 1) / keyGrain;
+  std::vector<size_t> counts(nChunks * nShards, 0);
+  forChunks(threads, n, keyGrain, [&](size_t begin, size_t end) {
+    size_t *c = &counts[begin / keyGrain * nShards];
+    for (size_t i = begin; i < end; ++i) {
+      ++c[shardOf(hashes[i])];
+    }
+  });
+
+  std::vector<size_t> shardBegin(nShards + 1, 0);
+  for (size_t s = 0, offset = 0; s < nShards; ++s) {
+    shardBegin[s] = offset;
+    for (size_t c = 0; c < nChunks; ++c) {
+      const size_t k = counts[c * nShards + s];
+      counts[c * nShards + s] = offset;
+      offset += k;
+    }
+  }
+  shardBegin[nShards] = n;
+
+  std::vector<index_t> order(n);
+  forChunks(threads, n, keyGrain, [&](size_t begin, size_t end) {
+    size_t *next = &counts[begin / keyGrain * nShards];
+    for (size_t i = begin; i < end; ++i) {
+      order[next[shardOf(hashes[i])]++] = static_cast<index_t>(i);
+    }
+  });
+
+  shards.assign(nShards, {});
+  duplicated.assign(n, 0);
+  forChunks(threads, nShards, 1, [&](size_t begin, size_t end) {
+    for (size_t s = begin; s < end; ++s) {
+      const size_t count = shardBegin[s + 1] - shardBegin[s];
+      size_t capacity = 2;
+      while (capacity < 2 * count) {
+        capacity *= 2;
+      }
+      auto &slots = shards[s];
+      slots.assign(capacity, notFound);
+      const size_t mask = capacity - 1;
+
+      for (size_t k = shardBegin[s]; k < shardBegin[s + 1]; ++k) {
+        const index_t i = order[k];
+        const uint64_t h = hashes[i];
+        for (size_t j = h & mask;; j = (j + 1) & mask) {
+          const index_t other = slots[j];
+          if (other == notFound) {
+            slots[j] = i;
+            break;
+          }
+          if (hashes[other] == h && equal(other, i)) {
+            duplicated[other] = 1;
+            break;
+          }
+        }
+      }
+    }
+  });
+}
+
+size_t BIBS::HashIndex::size() const { return hashes.size(); }
+
+size_t BIBS::HashIndex::nShards() const { return shards.size(); }
+
+bool BIBS::HashIndex::hasDuplicates() const {
+  return std::find(duplicated.begin(), duplicated.end(), 1) !=
+         duplicated.end();
+}
+
+BIBS::UuidIndex::UuidIndex() : UuidIndex(std::vector<boost::uuids::uuid>()) {}
+
+BIBS::UuidIndex::UuidIndex(std::vector<boost::uuids::uuid> keys,
+                           ThreadPool *threads)
+    : keys(std::move(keys)) {
+  const auto &k = this->keys;
+  hashes.resize(k.size());
+  forChunks(threads, k.size(), keyGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      hashes[i] = hashUuid(k[i]);
+    }
+  });
+  build(threads, [&](index_t i, index_t j) { return k[i] == k[j]; });
+
+  if (hasDuplicates()) {
+    const auto first = std::find(duplicated.begin(), duplicated.end(), 1);
+    throw std::invalid_argument(
+        "repeated UUID " +
+        boost::uuids::to_string(k[first - duplicated.begin()]));
+  }
+}
+
+BIBS::index_t BIBS::UuidIndex::find(const boost::uuids::uuid &uuid) const {
+  return lookup(hashUuid(uuid), [&](index_t i) { return keys[i] == uuid; });
+}
+
+BIBS::index_t BIBS::UuidIndex::at(const boost::uuids::uuid &uuid) const {
+  const index_t i = find(uuid);
+  if (i == notFound) {
+    throw std::out_of_range("no such UUID " + boost::uuids::to_string(uuid));
+  }
+  return i;
+}
+
+const boost::uuids::uuid &BIBS::UuidIndex::key(index_t i) const {
+  return keys.at(i);
+}
+
+BIBS::NameIndex::NameIndex() : NameIndex(std::vector<std::string>()) {}
+
+BIBS::NameIndex::NameIndex(std::vector<std::string> keys,
+                           ThreadPool *threads)
+    : keys(std::move(keys)) {
+  const auto &k = this->keys;
+  hashes.resize(k.size());
+  forChunks(threads, k.size(), keyGrain, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      hashes[i] = hashName(k[i]);
+    }
+  });
+  build(threads, [&](index_t i, index_t j) { return k[i] == k[j]; });
+}
+
+BIBS::index_t BIBS::NameIndex::find(const std::string &name) const {
+  return lookup(hashName(name), [&](index_t i) { return keys[i] == name; });
+}
+
+BIBS::index_t BIBS::NameIndex::at(const std::string &name) const {
+  const index_t i = find(name);
+  if (i == notFound) {
+    throw std::out_of_range("no such name " + name);
+  }
+  if (i == ambiguous) {
+    throw std::invalid_argument("more than one object is named " + name);
+  }
+  return i;
+}
+
+const std::string &BIBS::NameIndex::key(index_t i) const {
+  return keys.at(i);
+}
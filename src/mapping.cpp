@@ -0,0 +1,74 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/mapping.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+
+void BIBS::throwErrno(int error, const std::string &what) {
+  throw std::system_error(error, std::generic_category(), what);
+}
+
+BIBS::ReadOnlyMapping::ReadOnlyMapping(const std::string &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throwErrno(errno, "open " + path);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    const int e = errno;
+    ::close(fd);
+    throwErrno(e, "stat " + path);
+  }
+  length = static_cast<size_t>(st.st_size);
+  if (length == 0) {
+    ::close(fd);
+    return;
+  }
+  start = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+  const int e = errno;
+  ::close(fd);
+  if (start == MAP_FAILED) {
+    start = nullptr;
+    throwErrno(e, "mmap " + path);
+  }
+}
+
+BIBS::ReadOnlyMapping::~ReadOnlyMapping() {
+  if (start != nullptr) {
+    munmap(start, length);
+  }
+}
+
+const char *BIBS::ReadOnlyMapping::data() const {
+  return static_cast<const char *>(start);
+}
+
+size_t BIBS::ReadOnlyMapping::size() const { return length; }
+
+void BIBS::ReadOnlyMapping::advise(size_t offset, size_t n,
+                                   int advice) const {
+  if (start != nullptr && n > 0) {
+    madvise(static_cast<char *>(start) + offset, n, advice);
+  }
+}
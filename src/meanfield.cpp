@@ -0,0 +1,480 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/meanfield.hpp"
+#include "bibs/agent.hpp"
+#include "bibs/behaviour.hpp"
+#include "bibs/belief.hpp"
+#include "bibs/bibs.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+/**
+ * The z-value of a two-sided 95% confidence interval.
+ */
+constexpr double z95 = 1.959963984540054;
+
+/**
+ * Adds the choice probabilities of Agent::perform, for the utilities ut, to
+ * probs.
+ *
+ * If there is at most one positive utility, the behaviour with the maximum
+ * utility is chosen. Otherwise, a behaviour is chosen proportionally to the
+ * positive utilities.
+ *
+ * @param ut The utilities.
+ * @param probs The probabilities to add to.
+ * @param weight The weight of this sample.
+ */
+void addChoiceProbabilities(const std::vector<double> &ut,
+                            std::vector<double> &probs, const double weight) {
+  double maxUtility = std::numeric_limits<double>::lowest();
+  size_t maxBehaviour = 0;
+  size_t nPositive = 0;
+  double positiveSum = 0.0;
+
+  for (size_t k = 0; k < ut.size(); ++k) {
+    if (ut[k] > maxUtility) {
+      maxUtility = ut[k];
+      maxBehaviour = k;
+    }
+    if (ut[k] > 0) {
+      ++nPositive;
+      positiveSum += ut[k];
+    }
+  }
+
+  if (nPositive <= 1) {
+    probs[maxBehaviour] += weight;
+  } else {
+    for (size_t k = 0; k < ut.size(); ++k) {
+      if (ut[k] > 0) {
+        probs[k] += weight * ut[k] / positiveSum;
+      }
+    }
+  }
+}
+} // namespace
+
+BIBS::MeanFieldSimulation::MeanFieldSimulation(
+    std::vector<const IBelief *> beliefs,
+    std::vector<const IBehaviour *> behaviours, size_t nQuadrature,
+    unsigned seed)
+    : beliefs(beliefs), behaviours(behaviours), means(1), variances(1),
+      shares(1), nQuadrature(std::max<size_t>(nQuadrature, 1)), seed(seed) {
+  const size_t nB = beliefs.size();
+  const size_t nK = behaviours.size();
+
+  for (size_t b = 0; b < nB; ++b) {
+    beliefIndex.emplace(beliefs[b], b);
+  }
+  for (size_t k = 0; k < nK; ++k) {
+    behaviourIndex.emplace(behaviours[k], k);
+  }
+
+  beliefRelationships.resize(nB * nB);
+  observedRelationships.resize(nB * nK);
+  performingRelationships.resize(nB * nK);
+
+  for (size_t b = 0; b < nB; ++b) {
+    for (size_t b2 = 0; b2 < nB; ++b2) {
+      beliefRelationships[b * nB + b2] =
+          beliefs[b]->beliefRelationship(beliefs[b2]);
+    }
+    for (size_t k = 0; k < nK; ++k) {
+      observedRelationships[b * nK + k] =
+          beliefs[b]->observedBehaviourRelationship(behaviours[k]);
+      performingRelationships[b * nK + k] =
+          beliefs[b]->performingBehaviourRelationship(behaviours[k]);
+    }
+  }
+}
+
+size_t BIBS::MeanFieldSimulation::indexOf(const IBelief *b) const {
+  return beliefIndex.at(b);
+}
+
+size_t BIBS::MeanFieldSimulation::indexOf(const IBehaviour *b) const {
+  return behaviourIndex.at(b);
+}
+
+size_t
+BIBS::MeanFieldSimulation::addCohort(double size, const std::vector<double> &td,
+                                     const std::vector<double> &mean,
+                                     const std::vector<double> &variance) {
+  const size_t nB = beliefs.size();
+
+  if (td.size() != nB || mean.size() != nB || variance.size() != nB) {
+    throw std::invalid_argument(
+        "cohort vectors must have one entry per belief");
+  }
+  if (means.size() != 1) {
+    throw std::invalid_argument("cannot add a cohort after running");
+  }
+
+  const size_t c = cohortSizes.size();
+
+  cohortSizes.push_back(size);
+  timeDeltas.push_back(td);
+  for (auto &row : contacts) {
+    row.push_back(0.0);
+  }
+  contacts.emplace_back(c + 1, 0.0);
+  external.push_back(false);
+
+  means[0].insert(means[0].end(), mean.begin(), mean.end());
+  for (const auto &v : variance) {
+    variances[0].push_back(std::max(v, 0.0));
+  }
+  shares[0].resize(shares[0].size() + behaviours.size(), 0.0);
+  updateShares(0, c);
+
+  return c;
+}
+
+size_t BIBS::MeanFieldSimulation::nCohorts() const {
+  return cohortSizes.size();
+}
+
+double BIBS::MeanFieldSimulation::cohortSize(size_t c) const {
+  return cohortSizes.at(c);
+}
+
+double BIBS::MeanFieldSimulation::contact(size_t c, size_t d) const {
+  return contacts.at(c).at(d);
+}
+
+void BIBS::MeanFieldSimulation::setContact(size_t c, size_t d, double w) {
+  contacts.at(c).at(d) = w;
+}
+
+void BIBS::MeanFieldSimulation::setExternal(size_t c, bool isExternal) {
+  external.at(c) = isExternal;
+}
+
+void BIBS::MeanFieldSimulation::setBehaviourShares(
+    sim_time_t t, size_t c, const std::vector<double> &s) {
+  const size_t nK = behaviours.size();
+
+  if (s.size() != nK) {
+    throw std::invalid_argument("shares must have one entry per behaviour");
+  }
+  if (c >= cohortSizes.size()) {
+    throw std::out_of_range("cohort not found");
+  }
+
+  std::copy(s.begin(), s.end(), shares.at(t).begin() + c * nK);
+}
+
+BIBS::sim_time_t BIBS::MeanFieldSimulation::time() const {
+  return static_cast<sim_time_t>(means.size() - 1);
+}
+
+double BIBS::MeanFieldSimulation::activationMean(sim_time_t t, size_t c,
+                                                 const IBelief *b) const {
+  if (c >= cohortSizes.size()) {
+    throw std::out_of_range("cohort not found");
+  }
+  return means.at(t)[c * beliefs.size() + indexOf(b)];
+}
+
+double BIBS::MeanFieldSimulation::activationVariance(sim_time_t t, size_t c,
+                                                     const IBelief *b) const {
+  if (c >= cohortSizes.size()) {
+    throw std::out_of_range("cohort not found");
+  }
+  return variances.at(t)[c * beliefs.size() + indexOf(b)];
+}
+
+double BIBS::MeanFieldSimulation::behaviourShare(sim_time_t t, size_t c,
+                                                 const IBehaviour *b) const {
+  if (c >= cohortSizes.size()) {
+    throw std::out_of_range("cohort not found");
+  }
+  return shares.at(t)[c * behaviours.size() + indexOf(b)];
+}
+
+double BIBS::MeanFieldSimulation::observedValue(sim_time_t t, size_t c,
+                                               const IBelief *b) const {
+  const size_t nK = behaviours.size();
+
+  if (c >= cohortSizes.size()) {
+    throw std::out_of_range("cohort not found");
+  }
+
+  const auto &s = shares.at(t);
+  const size_t bIdx = indexOf(b);
+
+  double value = 0.0;
+  for (size_t k = 0; k < nK; ++k) {
+    value += s[c * nK + k] * observedRelationships[bIdx * nK + k];
+  }
+
+  return value;
+}
+
+void BIBS::MeanFieldSimulation::updateShares(const sim_time_t t,
+                                             const size_t c) {
+  const size_t nB = beliefs.size();
+  const size_t nK = behaviours.size();
+
+  if (nK == 0) {
+    return;
+  }
+
+  const double *m = &means[t][c * nB];
+  const double *v = &variances[t][c * nB];
+
+  std::seed_seq seq{seed, static_cast<unsigned>(t), static_cast<unsigned>(c)};
+  std::mt19937_64 eng(seq);
+  std::normal_distribution<double> normal;
+
+  std::vector<double> a(nB);
+  std::vector<double> ut(nK);
+  std::vector<double> probs(nK, 0.0);
+
+  for (size_t s = 0; s < nQuadrature; ++s) {
+    for (size_t b = 0; b < nB; ++b) {
+      a[b] = m[b] + std::sqrt(v[b]) * normal(eng);
+    }
+
+    std::fill(ut.begin(), ut.end(), 0.0);
+    for (size_t b = 0; b < nB; ++b) {
+      double valueToExp = 0.0;
+      for (size_t b2 = 0; b2 < nB; ++b2) {
+        valueToExp += a[b2] * beliefRelationships[b * nB + b2];
+      }
+      const double contextual = std::exp(valueToExp) * a[b];
+      for (size_t k = 0; k < nK; ++k) {
+        ut[k] += contextual * performingRelationships[b * nK + k];
+      }
+    }
+
+    addChoiceProbabilities(ut, probs, 1.0 / nQuadrature);
+  }
+
+  std::copy(probs.begin(), probs.end(), shares[t].begin() + c * nK);
+}
+
+void BIBS::MeanFieldSimulation::step() {
+  const size_t nB = beliefs.size();
+  const size_t nK = behaviours.size();
+  const size_t nC = cohortSizes.size();
+  const sim_time_t t = time() + 1;
+
+  means.push_back(means.back());
+  variances.push_back(variances.back());
+  shares.push_back(shares.back());
+
+  const auto &prevMeans = means[t - 1];
+  const auto &prevVariances = variances[t - 1];
+  const auto &prevShares = shares[t - 1];
+
+  // The expected observed value of each belief for each behaviour performed.
+  std::vector<double> observedBehaviour(nC * nB, 0.0);
+  for (size_t d = 0; d < nC; ++d) {
+    for (size_t b = 0; b < nB; ++b) {
+      double value = 0.0;
+      for (size_t k = 0; k < nK; ++k) {
+        value += prevShares[d * nK + k] * observedRelationships[b * nK + k];
+      }
+      observedBehaviour[d * nB + b] = value;
+    }
+  }
+
+  std::vector<double> observed(nB);
+
+  for (size_t c = 0; c < nC; ++c) {
+    if (external[c]) {
+      continue;
+    }
+
+    std::fill(observed.begin(), observed.end(), 0.0);
+    for (size_t d = 0; d < nC; ++d) {
+      const double w = contacts[c][d];
+      if (w == 0.0) {
+        continue;
+      }
+      for (size_t b = 0; b < nB; ++b) {
+        observed[b] += w * observedBehaviour[d * nB + b];
+      }
+    }
+
+    const double *m = &prevMeans[c * nB];
+    const double *v = &prevVariances[c * nB];
+
+    for (size_t b = 0; b < nB; ++b) {
+      // The argument of the exponential in Agent::contextualise is normal,
+      // so the contextualisation is log-normal.
+      double mu = 0.0;
+      double sigma2 = 0.0;
+      for (size_t b2 = 0; b2 < nB; ++b2) {
+        const double r = beliefRelationships[b * nB + b2];
+        mu += m[b2] * r;
+        sigma2 += v[b2] * r * r;
+      }
+      const double ctxMean = std::exp(mu + sigma2 / 2);
+      const double ctxVariance = std::expm1(sigma2) * ctxMean * ctxMean;
+      // Stein's lemma: Cov(a, exp(X)) = Cov(a, X) E[exp(X)].
+      const double covariance =
+          beliefRelationships[b * nB + b] * v[b] * ctxMean;
+
+      const double td = timeDeltas[c][b];
+      const double o = observed[b];
+
+      means[t][c * nB + b] = td * m[b] + ctxMean * o;
+      variances[t][c * nB + b] = std::max(
+          td * td * v[b] + o * o * ctxVariance + 2 * td * o * covariance, 0.0);
+    }
+
+    updateShares(t, c);
+  }
+}
+
+void BIBS::MeanFieldSimulation::run(sim_time_t nDays) {
+  for (sim_time_t i = 0; i < nDays; ++i) {
+    step();
+  }
+}
+
+std::vector<BIBS::MeanFieldError>
+BIBS::MeanFieldSimulation::compareWithSample(size_t agentsPerCohort,
+                                             size_t friendsPerCohort,
+                                             unsigned seed) const {
+  const size_t nB = beliefs.size();
+  const size_t nK = behaviours.size();
+  const size_t nC = cohortSizes.size();
+  const size_t n = agentsPerCohort;
+  const sim_time_t nDays = time();
+
+  if (n < 2) {
+    throw std::invalid_argument("at least two agents per cohort are needed");
+  }
+  if (std::find(external.begin(), external.end(), true) != external.end()) {
+    throw std::invalid_argument("cannot sample an external cohort");
+  }
+
+  std::mt19937_64 eng(seed);
+  std::normal_distribution<double> normal;
+
+  std::vector<std::unique_ptr<Agent>> agents;
+  agents.reserve(nC * n);
+  for (size_t c = 0; c < nC; ++c) {
+    for (size_t i = 0; i < n; ++i) {
+      std::map<const IBelief *, double> initial;
+      for (size_t b = 0; b < nB; ++b) {
+        initial.emplace(beliefs[b], means[0][c * nB + b] +
+                                        std::sqrt(variances[0][c * nB + b]) *
+                                            normal(eng));
+      }
+      agents.push_back(std::make_unique<Agent>(
+          std::map<sim_time_t, std::map<const IBelief *, double>>{
+              {0, initial}}));
+      for (size_t b = 0; b < nB; ++b) {
+        agents.back()->setTimeDelta(beliefs[b], timeDeltas[c][b]);
+      }
+    }
+  }
+
+  std::vector<size_t> candidates(n);
+  for (size_t c = 0; c < nC; ++c) {
+    for (size_t d = 0; d < nC; ++d) {
+      if (contacts[c][d] == 0.0) {
+        continue;
+      }
+      for (size_t i = 0; i < n; ++i) {
+        // Draw distinct friends by a partial Fisher-Yates shuffle.
+        std::iota(candidates.begin(), candidates.end(), 0);
+        size_t nCandidates = n;
+        if (c == d) {
+          std::swap(candidates[i], candidates[n - 1]);
+          --nCandidates;
+        }
+        const size_t nFriends = std::min(friendsPerCohort, nCandidates);
+        for (size_t f = 0; f < nFriends; ++f) {
+          std::uniform_int_distribution<size_t> pick(f, nCandidates - 1);
+          std::swap(candidates[f], candidates[pick(eng)]);
+          agents[c * n + i]->setFriendWeight(
+              agents[d * n + candidates[f]].get(),
+              contacts[c][d] / static_cast<double>(nFriends));
+        }
+      }
+    }
+  }
+
+  for (auto &agent : agents) {
+    agent->perform(0, behaviours);
+  }
+
+  std::vector<MeanFieldError> errors;
+  errors.reserve(nDays + 1);
+
+  for (sim_time_t t = 0; t <= nDays; ++t) {
+    if (t > 0) {
+      for (auto &agent : agents) {
+        agent->tick(t, behaviours, beliefs);
+      }
+    }
+
+    MeanFieldError error{t, 0.0, 0.0, 0.0, 0.0};
+
+    for (size_t c = 0; c < nC; ++c) {
+      std::vector<double> counts(nK, 0.0);
+      for (size_t i = 0; i < n; ++i) {
+        const auto *performed = agents[c * n + i]->performed(t);
+        counts[indexOf(performed)] += 1.0;
+      }
+      for (size_t k = 0; k < nK; ++k) {
+        const double p = counts[k] / n;
+        const double diff = std::abs(p - shares[t][c * nK + k]);
+        const double se = std::sqrt(p * (1 - p) / n);
+        error.shareError = std::max(error.shareError, diff);
+        error.shareErrorBound =
+            std::max(error.shareErrorBound, diff + z95 * se);
+      }
+
+      for (size_t b = 0; b < nB; ++b) {
+        double sum = 0.0;
+        double sumSquares = 0.0;
+        for (size_t i = 0; i < n; ++i) {
+          const double a = agents[c * n + i]->activation(t, beliefs[b]);
+          sum += a;
+          sumSquares += a * a;
+        }
+        const double mean = sum / n;
+        const double var =
+            std::max(sumSquares - n * mean * mean, 0.0) / (n - 1);
+        const double diff = std::abs(mean - means[t][c * nB + b]);
+        error.activationError = std::max(error.activationError, diff);
+        error.activationErrorBound = std::max(error.activationErrorBound,
+                                              diff + z95 * std::sqrt(var / n));
+      }
+    }
+
+    errors.push_back(error);
+  }
+
+  return errors;
+}
@@ -0,0 +1,210 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/output.hpp"
+#include "bibs/bibs.hpp"
+#include "bibs/scenario.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+BIBS::ChunkQueue::ChunkQueue() : head(&stub), tail(&stub) {}
+
+void BIBS::ChunkQueue::push(OutputChunk *chunk) {
+  chunk->next.store(nullptr, std::memory_order_relaxed);
+  OutputChunk *prev = head.exchange(chunk, std::memory_order_acq_rel);
+  // Between the exchange and this store, the queue is briefly broken, and
+  // pop sees it as empty.
+  prev->next.store(chunk, std::memory_order_release);
+}
+
+BIBS::OutputChunk *BIBS::ChunkQueue::pop() {
+  OutputChunk *t = tail;
+  OutputChunk *next = t->next.load(std::memory_order_acquire);
+
+  if (t == &stub) {
+    if (next == nullptr) {
+      return nullptr;
+    }
+    tail = next;
+    t = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+  if (next != nullptr) {
+    tail = next;
+    return t;
+  }
+  if (t != head.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  // t is the only chunk; the stub goes behind it so that it can be taken.
+  push(&stub);
+  next = t->next.load(std::memory_order_acquire);
+  if (next != nullptr) {
+    tail = next;
+    return t;
+  }
+  return nullptr;
+}
+
+void BIBS::MemoryHistorySink::write(sim_time_t t,
+                                    const std::vector<double> &activations,
+                                    const std::vector<index_t> &performed) {
+  ticks.push_back({t, activations, performed});
+}
+
+BIBS::HistoryWriter::HistoryWriter(size_t nAgents, size_t nBeliefs,
+                                   IHistorySink &sink, size_t chunkAgents)
+    : nAgents(nAgents), nBeliefs(nBeliefs), chunkAgents(chunkAgents),
+      sink(sink) {
+  if (chunkAgents == 0) {
+    throw std::invalid_argument("chunks must hold at least one agent");
+  }
+  thread = std::thread([this] { run(); });
+}
+
+BIBS::HistoryWriter::~HistoryWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  thread.join();
+}
+
+BIBS::OutputChunk *BIBS::HistoryWriter::acquire() {
+  {
+    std::unique_lock<std::mutex> lock(freeMutex, std::try_to_lock);
+    if (lock.owns_lock() && !free.empty()) {
+      auto chunk = std::move(free.back());
+      free.pop_back();
+      return chunk.release();
+    }
+  }
+  allocated.fetch_add(1, std::memory_order_relaxed);
+  auto chunk = std::make_unique<OutputChunk>();
+  chunk->activations.resize(chunkAgents * nBeliefs);
+  chunk->performed.resize(chunkAgents);
+  return chunk.release();
+}
+
+void BIBS::HistoryWriter::write(sim_time_t t, size_t begin, size_t end,
+                                const double *activations,
+                                const index_t *performed) {
+  for (size_t first = begin; first < end; first += chunkAgents) {
+    const size_t last = std::min(end, first + chunkAgents);
+    OutputChunk *chunk = acquire();
+    chunk->t = t;
+    chunk->begin = static_cast<index_t>(first);
+    chunk->count = last - first;
+    std::copy(activations + (first - begin) * nBeliefs,
+              activations + (last - begin) * nBeliefs,
+              chunk->activations.begin());
+    std::copy(performed + (first - begin), performed + (last - begin),
+              chunk->performed.begin());
+    submitted.fetch_add(chunk->count);
+    queue.push(chunk);
+  }
+  // Only an idle writer thread needs waking; otherwise it sees the chunks
+  // before it next waits, since it checks submitted after setting idle.
+  // Taking the mutex makes sure that it is already waiting.
+  if (idle.load()) {
+    mutex.lock();
+    mutex.unlock();
+    wake.notify_one();
+  }
+}
+
+void BIBS::HistoryWriter::assemble(OutputChunk *chunk) {
+  auto &p = pending[chunk->t];
+  if (p.performed.empty()) {
+    p.activations.resize(nAgents * nBeliefs);
+    p.performed.resize(nAgents);
+  }
+  std::copy(chunk->activations.begin(),
+            chunk->activations.begin() + chunk->count * nBeliefs,
+            p.activations.begin() + chunk->begin * nBeliefs);
+  std::copy(chunk->performed.begin(),
+            chunk->performed.begin() + chunk->count,
+            p.performed.begin() + chunk->begin);
+  p.received += chunk->count;
+
+  const sim_time_t t = chunk->t;
+  const size_t count = chunk->count;
+  {
+    std::lock_guard<std::mutex> lock(freeMutex);
+    free.emplace_back(chunk);
+  }
+
+  std::exception_ptr e;
+  if (p.received >= nAgents) {
+    try {
+      sink.write(t, p.activations, p.performed);
+    } catch (...) {
+      e = std::current_exception();
+    }
+    pending.erase(t);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (e && !error) {
+    error = e;
+  }
+  done += count;
+}
+
+void BIBS::HistoryWriter::run() {
+  for (;;) {
+    while (OutputChunk *chunk = queue.pop()) {
+      assemble(chunk);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (done == submitted.load()) {
+      caughtUp.notify_all();
+      if (stopping) {
+        return;
+      }
+    }
+    idle.store(true);
+    // A chunk submitted but not yet pushed is only briefly out of the
+    // queue, so the writer thread spins rather than sleeping through it.
+    wake.wait(lock, [this] { return stopping || done != submitted.load(); });
+    idle.store(false, std::memory_order_relaxed);
+  }
+}
+
+void BIBS::HistoryWriter::flush() {
+  std::unique_lock<std::mutex> lock(mutex);
+  caughtUp.wait(lock, [this] {
+    return done == submitted.load(std::memory_order_acquire);
+  });
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+size_t BIBS::HistoryWriter::getNAgents() const { return nAgents; }
+
+size_t BIBS::HistoryWriter::getNBeliefs() const { return nBeliefs; }
+
+size_t BIBS::HistoryWriter::nChunks() const {
+  return allocated.load(std::memory_order_relaxed);
+}
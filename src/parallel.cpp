@@ -0,0 +1,159 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace {
+/**
+ * Whether the current thread is running a chunk of a parallel loop.
+ */
+thread_local bool inParallelFor = false;
+} // namespace
+
+BIBS::ThreadPool::ThreadPool(size_t nThreads) {
+  if (nThreads == 0) {
+    nThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  }
+
+  for (size_t i = 1; i < nThreads; ++i) {
+    workers.emplace_back(&ThreadPool::workerLoop, this);
+  }
+}
+
+BIBS::ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  jobStarted.notify_all();
+
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+size_t BIBS::ThreadPool::size() const { return workers.size() + 1; }
+
+void BIBS::ThreadPool::work() {
+  const bool wasInParallelFor = inParallelFor;
+  inParallelFor = true;
+
+  for (;;) {
+    const size_t begin = next.fetch_add(grain);
+    if (begin >= n) {
+      break;
+    }
+    try {
+      (*body)(begin, std::min(begin + grain, n));
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+      // Skip the remaining chunks.
+      next.store(n);
+    }
+  }
+
+  inParallelFor = wasInParallelFor;
+}
+
+void BIBS::ThreadPool::workerLoop() {
+  size_t seen = 0;
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobStarted.wait(lock, [&] { return stopping || generation != seen; });
+      if (stopping) {
+        return;
+      }
+      seen = generation;
+    }
+
+    work();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      --busy;
+    }
+    jobFinished.notify_one();
+  }
+}
+
+void BIBS::ThreadPool::parallelFor(
+    size_t n, size_t grain, const std::function<void(size_t, size_t)> &fn) {
+  grain = std::max<size_t>(grain, 1);
+
+  if (n == 0) {
+    return;
+  }
+
+  if (workers.empty() || inParallelFor || n <= grain) {
+    for (size_t begin = 0; begin < n; begin += grain) {
+      fn(begin, std::min(begin + grain, n));
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> callLock(callMutex);
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    body = &fn;
+    this->n = n;
+    this->grain = grain;
+    next.store(0);
+    error = nullptr;
+    busy = workers.size();
+    ++generation;
+  }
+  jobStarted.notify_all();
+
+  work();
+
+  std::exception_ptr e;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    jobFinished.wait(lock, [&] { return busy == 0; });
+    body = nullptr;
+    e = error;
+  }
+
+  if (e) {
+    std::rethrow_exception(e);
+  }
+}
+
+void BIBS::forChunks(ThreadPool *threads, size_t n, size_t grain,
+                     const std::function<void(size_t, size_t)> &fn) {
+  if (threads != nullptr) {
+    threads->parallelFor(n, grain, fn);
+    return;
+  }
+  grain = std::max<size_t>(grain, 1);
+  for (size_t begin = 0; begin < n; begin += grain) {
+    fn(begin, std::min(begin + grain, n));
+  }
+}
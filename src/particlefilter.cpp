@@ -0,0 +1,195 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/particlefilter.hpp"
+#include "bibs/bibs.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/state.hpp"
+#include "bibs/vectorised.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+BIBS::ParticleFilter::ParticleFilter(std::shared_ptr<const Scenario> scenario,
+                                     const std::vector<double> &activations,
+                                     const std::vector<index_t> &performed,
+                                     size_t nParticles, uint64_t seed,
+                                     size_t nThreads, double resampleThreshold,
+                                     bool recordHistory)
+    : threads(nThreads), pool(std::make_shared<FramePool>()),
+      resampleThreshold(resampleThreshold), nextStream(nParticles),
+      eng(seed) {
+  if (nParticles == 0) {
+    throw std::invalid_argument("there must be at least one particle");
+  }
+
+  particles.reserve(nParticles);
+  particles.emplace_back(scenario, activations, performed, seed,
+                         recordHistory, pool);
+  // The particles share the frame at time 0.
+  for (size_t i = 1; i < nParticles; ++i) {
+    particles.push_back(particles[0]);
+    particles.back().setStream(i);
+  }
+
+  logWeights.assign(nParticles, -std::log(static_cast<double>(nParticles)));
+}
+
+size_t BIBS::ParticleFilter::nParticles() const { return particles.size(); }
+
+const BIBS::VectorisedSimulation &
+BIBS::ParticleFilter::particle(size_t i) const {
+  return particles.at(i);
+}
+
+BIBS::sim_time_t BIBS::ParticleFilter::time() const {
+  return particles[0].time();
+}
+
+void BIBS::ParticleFilter::advance(sim_time_t nTicks) {
+  threads.parallelFor(particles.size(), 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      particles[i].run(nTicks);
+    }
+  });
+}
+
+void BIBS::ParticleFilter::assimilate(const std::vector<double> &shares,
+                                      double sampleSize) {
+  const size_t n = particles.size();
+  const auto &scenario = particles[0].getScenario();
+
+  if (shares.size() != scenario.nBehaviours) {
+    throw std::invalid_argument("shares must have one entry per behaviour");
+  }
+
+  // A share of 0 is replaced by half an agent, so that no particle has a
+  // likelihood of 0.
+  const double floor = 0.5 / std::max<size_t>(scenario.nAgents, 1);
+  const sim_time_t t = time();
+
+  std::vector<double> logLikelihoods(n);
+  threads.parallelFor(n, 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const auto p = particles[i].behaviourShares(t);
+      double value = 0.0;
+      for (size_t k = 0; k < p.size(); ++k) {
+        if (shares[k] > 0) {
+          value += shares[k] * std::log(std::max(p[k], floor));
+        }
+      }
+      logLikelihoods[i] = sampleSize * value;
+    }
+  });
+
+  double maxLogWeight = std::numeric_limits<double>::lowest();
+  for (size_t i = 0; i < n; ++i) {
+    logWeights[i] += logLikelihoods[i];
+    maxLogWeight = std::max(maxLogWeight, logWeights[i]);
+  }
+
+  double sum = 0.0;
+  for (const auto &lw : logWeights) {
+    sum += std::exp(lw - maxLogWeight);
+  }
+  const double logSum = maxLogWeight + std::log(sum);
+
+  // The previous weights were normalised, so logSum is the log of the
+  // likelihood of this observation given the previous ones.
+  logLikelihood += logSum;
+  for (auto &lw : logWeights) {
+    lw -= logSum;
+  }
+
+  if (effectiveSampleSize() < resampleThreshold * n) {
+    resample();
+  }
+}
+
+void BIBS::ParticleFilter::resample() {
+  const size_t n = particles.size();
+  const auto w = weights();
+
+  std::uniform_real_distribution<double> distr(0.0, 1.0);
+  const double u0 = distr(eng);
+
+  std::vector<bool> used(n, false);
+  std::vector<VectorisedSimulation> next;
+  next.reserve(n);
+
+  double cumulative = w[0];
+  size_t parent = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const double position = (u0 + i) / n;
+    while (position >= cumulative && parent + 1 < n) {
+      ++parent;
+      cumulative += w[parent];
+    }
+
+    next.push_back(particles[parent]);
+    // The first child continues its parent; the others diverge from it.
+    if (used[parent]) {
+      next.back().setStream(nextStream++);
+    }
+    used[parent] = true;
+  }
+
+  particles.swap(next);
+  logWeights.assign(n, -std::log(static_cast<double>(n)));
+  ++resamples;
+}
+
+std::vector<double> BIBS::ParticleFilter::weights() const {
+  std::vector<double> w(logWeights.size());
+  std::transform(logWeights.begin(), logWeights.end(), w.begin(),
+                 [](double lw) { return std::exp(lw); });
+  return w;
+}
+
+double BIBS::ParticleFilter::effectiveSampleSize() const {
+  double sumSquares = 0.0;
+  for (const auto &w : weights()) {
+    sumSquares += w * w;
+  }
+  return 1.0 / sumSquares;
+}
+
+double BIBS::ParticleFilter::logMarginalLikelihood() const {
+  return logLikelihood;
+}
+
+size_t BIBS::ParticleFilter::nResamples() const { return resamples; }
+
+std::vector<double> BIBS::ParticleFilter::behaviourShares() const {
+  const auto w = weights();
+  const sim_time_t t = time();
+  std::vector<double> shares(particles[0].getScenario().nBehaviours, 0.0);
+
+  for (size_t i = 0; i < particles.size(); ++i) {
+    const auto p = particles[i].behaviourShares(t);
+    for (size_t k = 0; k < shares.size(); ++k) {
+      shares[k] += w[i] * p[k];
+    }
+  }
+
+  return shares;
+}
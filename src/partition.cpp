@@ -0,0 +1,273 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/partition.hpp"
+#include "bibs/bibs.hpp"
+#include "bibs/choice.hpp"
+#include "bibs/digest.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/state.hpp"
+#include "bibs/vectorised.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * A VectorisedSimulation of the agents of a partition and its halo, whose
+ * random streams are those of the agents in the whole simulation.
+ */
+class BIBS::PartitionedSimulation::Partition : public VectorisedSimulation {
+public:
+  /**
+   * The number of agents of the partition, excluding the halo.
+   */
+  const size_t nOwned;
+
+  /**
+   * @param agents The index of each agent in the whole simulation: first
+   *   the agents of the partition, then the halo.
+   */
+  Partition(std::shared_ptr<const Scenario> scenario,
+            const std::vector<double> &activations,
+            const std::vector<index_t> &performed, uint64_t seed,
+            std::vector<index_t> agents, size_t nOwned)
+      : VectorisedSimulation(scenario, activations, performed, seed, false),
+        nOwned(nOwned) {
+    streamIndices = std::move(agents);
+  }
+
+  /**
+   * The index of each agent in the whole simulation.
+   */
+  const std::vector<index_t> &agents() const { return streamIndices; }
+
+  /**
+   * Copies the latest state of the agents of the partition into the state
+   * of the whole simulation.
+   *
+   * @return The sum of the digests of the agents.
+   */
+  uint64_t store(Frame &whole) const {
+    const size_t nB = scenario->nBeliefs;
+    const Frame &f = *frames.back();
+    uint64_t digest = 0;
+    for (size_t j = 0; j < nOwned; ++j) {
+      const index_t i = streamIndices[j];
+      std::copy_n(&f.activations[j * nB], nB, &whole.activations[i * nB]);
+      std::copy_n(&f.contexts[j * nB], nB, &whole.contexts[i * nB]);
+      whole.performed[i] = f.performed[j];
+      digest += agentDigest(i, f.performed[j], &f.activations[j * nB], nB);
+    }
+    return digest;
+  }
+
+  /**
+   * Replaces the latest frame with the state of the agents in the whole
+   * simulation, which corrects the halo.
+   */
+  void load(const Frame &whole) {
+    const size_t nB = scenario->nBeliefs;
+    const size_t n = streamIndices.size();
+    auto f = pool->acquire(n, nB);
+    f->t = whole.t;
+    for (size_t j = 0; j < n; ++j) {
+      const index_t i = streamIndices[j];
+      std::copy_n(&whole.activations[i * nB], nB, &f->activations[j * nB]);
+      std::copy_n(&whole.contexts[i * nB], nB, &f->contexts[j * nB]);
+      f->performed[j] = whole.performed[i];
+    }
+    f->digest = stateDigest(f->activations, f->performed, nB, 0, n);
+    frames.back() = std::move(f);
+  }
+};
+
+template <class F> void BIBS::PartitionedSimulation::forPartitions(F fn) {
+  auto body = [&](size_t begin, size_t end) {
+    for (size_t p = begin; p < end; ++p) {
+      fn(p);
+    }
+  };
+  forChunks(threads, partitions.size(), 1, body);
+}
+
+BIBS::PartitionedSimulation::PartitionedSimulation(
+    std::shared_ptr<const Scenario> scenario,
+    const std::vector<double> &activations,
+    const std::vector<index_t> &performed, uint64_t seed,
+    const std::vector<index_t> &partitionOf, sim_time_t haloDepth,
+    ThreadPool *threads)
+    : scenario(scenario), haloDepth(haloDepth), threads(threads) {
+  const size_t nA = scenario->nAgents;
+  const size_t nB = scenario->nBeliefs;
+  const size_t nK = scenario->nBehaviours;
+
+  if (haloDepth == 0) {
+    throw std::invalid_argument("halo depth must be positive");
+  }
+  if (partitionOf.size() != nA) {
+    throw std::invalid_argument("partitions have the wrong size");
+  }
+
+  // The whole simulation gives the state at time 0, choosing the behaviours
+  // if they are not given.
+  const VectorisedSimulation whole(scenario, activations, performed, seed,
+                                   false, nullptr, threads);
+  state = whole.current();
+
+  std::vector<std::vector<index_t>> owned;
+  for (size_t i = 0; i < nA; ++i) {
+    if (partitionOf[i] >= owned.size()) {
+      owned.resize(static_cast<size_t>(partitionOf[i]) + 1);
+    }
+    owned[partitionOf[i]].push_back(static_cast<index_t>(i));
+  }
+  owned.erase(std::remove_if(owned.begin(), owned.end(),
+                             [](const auto &o) { return o.empty(); }),
+              owned.end());
+  partitions.resize(owned.size());
+
+  forPartitions([&](size_t p) {
+    // The halo, in order of distance, found by a breadth-first search of
+    // the friendships.
+    constexpr index_t none = std::numeric_limits<index_t>::max();
+    std::vector<index_t> localOf(nA, none);
+    std::vector<index_t> agents = owned[p];
+    for (size_t j = 0; j < agents.size(); ++j) {
+      localOf[agents[j]] = static_cast<index_t>(j);
+    }
+    size_t begin = 0;
+    for (sim_time_t d = 0; d < haloDepth; ++d) {
+      const size_t end = agents.size();
+      for (size_t j = begin; j < end; ++j) {
+        const index_t i = agents[j];
+        for (auto e = scenario->friendOffsets[i];
+             e < scenario->friendOffsets[i + 1]; ++e) {
+          const index_t f = scenario->friends[e];
+          if (localOf[f] == none) {
+            localOf[f] = static_cast<index_t>(agents.size());
+            agents.push_back(f);
+          }
+        }
+      }
+      begin = end;
+    }
+
+    // The scenario of the partition. Friendships leaving it are those of
+    // the furthest halo agents, which are not exact after an exchange.
+    const size_t n = agents.size();
+    auto local = std::make_shared<Scenario>(n, nB, nK);
+    local->beliefRelationships = scenario->beliefRelationships;
+    local->observedRelationships = scenario->observedRelationships;
+    local->performingRelationships = scenario->performingRelationships;
+    std::vector<double> a(n * nB);
+    std::vector<index_t> k(n);
+    std::vector<index_t> from, to;
+    std::vector<double> weights;
+    for (size_t j = 0; j < n; ++j) {
+      const index_t i = agents[j];
+      std::copy_n(&scenario->timeDeltas[i * nB], nB,
+                  &local->timeDeltas[j * nB]);
+      std::copy_n(&state.activations[i * nB], nB, &a[j * nB]);
+      k[j] = state.performed[i];
+      for (auto e = scenario->friendOffsets[i];
+           e < scenario->friendOffsets[i + 1]; ++e) {
+        const index_t f = localOf[scenario->friends[e]];
+        if (f != none) {
+          from.push_back(static_cast<index_t>(j));
+          to.push_back(f);
+          weights.push_back(scenario->friendWeights[e]);
+        }
+      }
+    }
+    local->setEdges(from, to, weights);
+
+    const size_t nOwned = owned[p].size();
+    partitions[p] = std::make_unique<Partition>(local, a, k, seed,
+                                                std::move(agents), nOwned);
+  });
+}
+
+BIBS::PartitionedSimulation::~PartitionedSimulation() = default;
+
+void BIBS::PartitionedSimulation::exchange(sim_time_t t) {
+  std::atomic<uint64_t> digest(0);
+  forPartitions([&](size_t p) {
+    digest.fetch_add(partitions[p]->store(state), std::memory_order_relaxed);
+  });
+  state.t = t;
+  state.digest = digest.load();
+  forPartitions([&](size_t p) { partitions[p]->load(state); });
+  ++exchanges;
+}
+
+std::vector<BIBS::index_t>
+BIBS::PartitionedSimulation::blockPartitions(size_t nAgents,
+                                             size_t nPartitions) {
+  if (nPartitions == 0) {
+    throw std::invalid_argument("number of partitions must be positive");
+  }
+  std::vector<index_t> partitionOf(nAgents);
+  for (size_t i = 0; i < nAgents; ++i) {
+    partitionOf[i] = static_cast<index_t>(i * nPartitions / nAgents);
+  }
+  return partitionOf;
+}
+
+void BIBS::PartitionedSimulation::run(sim_time_t nDays) {
+  while (nDays > 0) {
+    const sim_time_t k = std::min(haloDepth, nDays);
+    forPartitions([&](size_t p) { partitions[p]->run(k); });
+    exchange(state.t + k);
+    nDays -= k;
+  }
+}
+
+BIBS::sim_time_t BIBS::PartitionedSimulation::time() const { return state.t; }
+
+const BIBS::Frame &BIBS::PartitionedSimulation::current() const {
+  return state;
+}
+
+BIBS::sim_time_t BIBS::PartitionedSimulation::getHaloDepth() const {
+  return haloDepth;
+}
+
+size_t BIBS::PartitionedSimulation::nPartitions() const {
+  return partitions.size();
+}
+
+size_t BIBS::PartitionedSimulation::nOwned(size_t p) const {
+  return partitions.at(p)->nOwned;
+}
+
+size_t BIBS::PartitionedSimulation::nHalo(size_t p) const {
+  return partitions.at(p)->agents().size() - partitions.at(p)->nOwned;
+}
+
+uint64_t BIBS::PartitionedSimulation::nExchanges() const { return exchanges; }
+
+void BIBS::PartitionedSimulation::setChoicePolicy(
+    std::shared_ptr<const IChoicePolicy> p) {
+  for (auto &partition : partitions) {
+    partition->setChoicePolicy(p);
+  }
+}
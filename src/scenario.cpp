@@ -0,0 +1,209 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/scenario.hpp"
+#include "bibs/agent.hpp"
+#include "bibs/behaviour.hpp"
+#include "bibs/belief.hpp"
+#include "bibs/bibs.hpp"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+BIBS::Scenario::Scenario(size_t nAgents, size_t nBeliefs, size_t nBehaviours)
+    : nAgents(nAgents), nBeliefs(nBeliefs), nBehaviours(nBehaviours),
+      beliefRelationships(nBeliefs * nBeliefs, 0.0),
+      observedRelationships(nBeliefs * nBehaviours, 0.0),
+      performingRelationships(nBeliefs * nBehaviours, 0.0),
+      timeDeltas(nAgents * nBeliefs, 0.0), friendOffsets(nAgents + 1, 0) {}
+
+size_t BIBS::Scenario::nEdges() const { return friends.size(); }
+
+void BIBS::Scenario::setEdges(const std::vector<index_t> &from,
+                              const std::vector<index_t> &to,
+                              const std::vector<double> &weights) {
+  const size_t nE = from.size();
+
+  if (to.size() != nE || weights.size() != nE) {
+    throw std::invalid_argument("edge vectors must be the same size");
+  }
+
+  std::fill(friendOffsets.begin(), friendOffsets.end(), 0);
+  for (size_t e = 0; e < nE; ++e) {
+    if (from[e] >= nAgents || to[e] >= nAgents) {
+      throw std::out_of_range("agent not found");
+    }
+    ++friendOffsets[from[e] + 1];
+  }
+  for (size_t i = 0; i < nAgents; ++i) {
+    friendOffsets[i + 1] += friendOffsets[i];
+  }
+
+  // A stable counting sort by the observing agent.
+  std::vector<uint64_t> position(friendOffsets.begin(),
+                                 friendOffsets.end() - 1);
+  friends.resize(nE);
+  friendWeights.resize(nE);
+  for (size_t e = 0; e < nE; ++e) {
+    const auto p = position[from[e]]++;
+    friends[p] = to[e];
+    friendWeights[p] = weights[e];
+  }
+}
+
+void BIBS::Scenario::validate() const {
+  if (beliefRelationships.size() != nBeliefs * nBeliefs ||
+      observedRelationships.size() != nBeliefs * nBehaviours ||
+      performingRelationships.size() != nBeliefs * nBehaviours) {
+    throw std::invalid_argument("relationship matrix has the wrong size");
+  }
+  if (timeDeltas.size() != nAgents * nBeliefs) {
+    throw std::invalid_argument("time deltas have the wrong size");
+  }
+  if (friendOffsets.size() != nAgents + 1 ||
+      friendOffsets[nAgents] != friends.size() ||
+      friendWeights.size() != friends.size()) {
+    throw std::invalid_argument("friendship graph has the wrong size");
+  }
+  view().validate();
+}
+
+BIBS::ScenarioView BIBS::Scenario::view() const {
+  ScenarioView v;
+  v.nAgents = nAgents;
+  v.nBeliefs = nBeliefs;
+  v.nBehaviours = nBehaviours;
+  v.beliefRelationships = beliefRelationships.data();
+  v.observedRelationships = observedRelationships.data();
+  v.performingRelationships = performingRelationships.data();
+  v.timeDeltas = timeDeltas.data();
+  v.friendOffsets = friendOffsets.data();
+  v.friends = friends.data();
+  v.friendWeights = friendWeights.data();
+  return v;
+}
+
+void BIBS::ScenarioView::validate() const {
+  if (friendOffsets[0] != 0) {
+    throw std::invalid_argument("friendship graph has the wrong size");
+  }
+  for (size_t i = 0; i < nAgents; ++i) {
+    if (friendOffsets[i] > friendOffsets[i + 1]) {
+      throw std::invalid_argument("friend offsets are not sorted");
+    }
+  }
+  for (uint64_t e = 0; e < friendOffsets[nAgents]; ++e) {
+    if (friends[e] >= nAgents) {
+      throw std::invalid_argument("friend out of range");
+    }
+  }
+}
+
+BIBS::Scenario
+BIBS::Scenario::fromAgents(const std::vector<const Agent *> &agents,
+                           const std::vector<const IBelief *> &beliefs,
+                           const std::vector<const IBehaviour *> &behaviours) {
+  const size_t nA = agents.size();
+  const size_t nB = beliefs.size();
+  const size_t nK = behaviours.size();
+
+  Scenario s(nA, nB, nK);
+
+  for (size_t b = 0; b < nB; ++b) {
+    for (size_t b2 = 0; b2 < nB; ++b2) {
+      s.beliefRelationships[b * nB + b2] =
+          beliefs[b]->beliefRelationship(beliefs[b2]);
+    }
+    for (size_t k = 0; k < nK; ++k) {
+      s.observedRelationships[b * nK + k] =
+          beliefs[b]->observedBehaviourRelationship(behaviours[k]);
+      s.performingRelationships[b * nK + k] =
+          beliefs[b]->performingBehaviourRelationship(behaviours[k]);
+    }
+  }
+
+  std::map<const IAgent *, index_t> index;
+  for (size_t i = 0; i < nA; ++i) {
+    index.emplace(agents[i], static_cast<index_t>(i));
+  }
+
+  std::vector<index_t> from;
+  std::vector<index_t> to;
+  std::vector<double> weights;
+  std::vector<std::pair<index_t, double>> agentFriends;
+
+  for (size_t i = 0; i < nA; ++i) {
+    for (size_t b = 0; b < nB; ++b) {
+      s.timeDeltas[i * nB + b] = agents[i]->timeDelta(beliefs[b]);
+    }
+
+    agentFriends.clear();
+    for (const auto &[a, w] : agents[i]->friendWeights()) {
+      auto it = index.find(a);
+      if (it != index.end()) {
+        agentFriends.emplace_back(it->second, w);
+      }
+    }
+    std::sort(agentFriends.begin(), agentFriends.end());
+
+    for (const auto &[j, w] : agentFriends) {
+      from.push_back(static_cast<index_t>(i));
+      to.push_back(j);
+      weights.push_back(w);
+    }
+  }
+
+  s.setEdges(from, to, weights);
+
+  return s;
+}
+
+std::vector<double>
+BIBS::activationsOf(const std::vector<const IAgent *> &agents,
+                    const std::vector<const IBelief *> &beliefs,
+                    sim_time_t t) {
+  const size_t nB = beliefs.size();
+  std::vector<double> activations(agents.size() * nB);
+
+  for (size_t i = 0; i < agents.size(); ++i) {
+    for (size_t b = 0; b < nB; ++b) {
+      activations[i * nB + b] = agents[i]->activation(t, beliefs[b]);
+    }
+  }
+
+  return activations;
+}
+
+std::vector<BIBS::index_t>
+BIBS::performedOf(const std::vector<const IAgent *> &agents,
+                  const std::vector<const IBehaviour *> &behaviours,
+                  sim_time_t t) {
+  std::map<const IBehaviour *, index_t> index;
+  for (size_t k = 0; k < behaviours.size(); ++k) {
+    index.emplace(behaviours[k], static_cast<index_t>(k));
+  }
+
+  std::vector<index_t> performed(agents.size());
+  for (size_t i = 0; i < agents.size(); ++i) {
+    performed[i] = index.at(agents[i]->performed(t));
+  }
+
+  return performed;
+}
@@ -0,0 +1,228 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/scenarioimage.hpp"
+#include "bibs/mapping.hpp"
+#include "bibs/scenario.hpp"
+
+#include <algorithm>
+#include <array>
+#include <boost/endian/conversion.hpp>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+/**
+ * The magic number at the start of a scenario image.
+ */
+const char magic[8] = {'B', 'I', 'B', 'S', 'S', 'C', 'E', 'N'};
+
+/**
+ * The version of the scenario image format.
+ */
+constexpr uint32_t version = 1;
+
+// The format is little-endian, and is read and written with memcpy (or
+// used in place), so only in the native byte order.
+static_assert(boost::endian::order::native == boost::endian::order::little,
+              "scenario images are little-endian");
+
+/**
+ * The size of the header of a scenario image.
+ */
+constexpr size_t headerSize = 128;
+
+/**
+ * The alignment of the arrays of a scenario image.
+ */
+constexpr size_t alignment = 64;
+
+/**
+ * The number of arrays in a scenario image.
+ */
+constexpr size_t nArrays = 7;
+
+/**
+ * The offset of the counts in the header.
+ */
+constexpr size_t countsOffset = 16;
+
+/**
+ * The offset of the array offsets in the header.
+ */
+constexpr size_t offsetsOffset = countsOffset + 4 * sizeof(uint64_t);
+
+/**
+ * Multiplies a by b, unless the product overflows.
+ *
+ * @return Whether the product fits.
+ */
+bool multiply(uint64_t a, uint64_t b, uint64_t &product) {
+  if (b != 0 && a > std::numeric_limits<uint64_t>::max() / b) {
+    return false;
+  }
+  product = a * b;
+  return true;
+}
+
+/**
+ * The size in bytes of each array of a scenario, in the order of the
+ * file, or false if a size overflows.
+ */
+bool arraySizes(uint64_t nA, uint64_t nB, uint64_t nK, uint64_t nE,
+                std::array<uint64_t, nArrays> &sizes) {
+  uint64_t bb, bk, ab;
+  return multiply(nB, nB, bb) && multiply(bb, sizeof(double), sizes[0]) &&
+         multiply(nB, nK, bk) && multiply(bk, sizeof(double), sizes[1]) &&
+         multiply(bk, sizeof(double), sizes[2]) && multiply(nA, nB, ab) &&
+         multiply(ab, sizeof(double), sizes[3]) &&
+         nA < std::numeric_limits<uint64_t>::max() &&
+         multiply(nA + 1, sizeof(uint64_t), sizes[4]) &&
+         multiply(nE, sizeof(BIBS::index_t), sizes[5]) &&
+         multiply(nE, sizeof(double), sizes[6]);
+}
+} // namespace
+
+BIBS::ScenarioImage::ScenarioImage(const std::string &path)
+    : mapping(path) {
+  const char *bytes = mapping.data();
+  if (mapping.size() < headerSize ||
+      std::memcmp(bytes, magic, sizeof(magic)) != 0) {
+    throw std::runtime_error(path + " is not a scenario image");
+  }
+  uint32_t v;
+  uint64_t counts[4];
+  uint64_t offsets[nArrays];
+  std::memcpy(&v, bytes + 8, sizeof(v));
+  std::memcpy(counts, bytes + countsOffset, sizeof(counts));
+  std::memcpy(offsets, bytes + offsetsOffset, sizeof(offsets));
+  if (v != version) {
+    throw std::runtime_error(path + " has an unknown version");
+  }
+
+  std::array<uint64_t, nArrays> sizes;
+  if (!arraySizes(counts[0], counts[1], counts[2], counts[3], sizes)) {
+    throw std::runtime_error(path + " is truncated");
+  }
+  for (size_t a = 0; a < nArrays; ++a) {
+    if (offsets[a] % alignment != 0 || offsets[a] < headerSize ||
+        offsets[a] > mapping.size() ||
+        sizes[a] > mapping.size() - offsets[a]) {
+      throw std::runtime_error(path + " is truncated");
+    }
+  }
+
+  arrays.nAgents = counts[0];
+  arrays.nBeliefs = counts[1];
+  arrays.nBehaviours = counts[2];
+  arrays.beliefRelationships =
+      reinterpret_cast<const double *>(bytes + offsets[0]);
+  arrays.observedRelationships =
+      reinterpret_cast<const double *>(bytes + offsets[1]);
+  arrays.performingRelationships =
+      reinterpret_cast<const double *>(bytes + offsets[2]);
+  arrays.timeDeltas = reinterpret_cast<const double *>(bytes + offsets[3]);
+  arrays.friendOffsets =
+      reinterpret_cast<const uint64_t *>(bytes + offsets[4]);
+  arrays.friends = reinterpret_cast<const index_t *>(bytes + offsets[5]);
+  arrays.friendWeights = reinterpret_cast<const double *>(bytes + offsets[6]);
+  if (arrays.friendOffsets[arrays.nAgents] != counts[3]) {
+    throw std::runtime_error(path + " is truncated");
+  }
+}
+
+void BIBS::ScenarioImage::write(const std::string &path,
+                                const Scenario &scenario) {
+  scenario.validate();
+
+  const auto v = scenario.view();
+  const uint64_t counts[4] = {scenario.nAgents, scenario.nBeliefs,
+                              scenario.nBehaviours, scenario.nEdges()};
+  std::array<uint64_t, nArrays> sizes;
+  arraySizes(counts[0], counts[1], counts[2], counts[3], sizes);
+  const char *data[nArrays] = {
+      reinterpret_cast<const char *>(v.beliefRelationships),
+      reinterpret_cast<const char *>(v.observedRelationships),
+      reinterpret_cast<const char *>(v.performingRelationships),
+      reinterpret_cast<const char *>(v.timeDeltas),
+      reinterpret_cast<const char *>(v.friendOffsets),
+      reinterpret_cast<const char *>(v.friends),
+      reinterpret_cast<const char *>(v.friendWeights)};
+
+  uint64_t offsets[nArrays];
+  uint64_t end = headerSize;
+  for (size_t a = 0; a < nArrays; ++a) {
+    offsets[a] = (end + alignment - 1) / alignment * alignment;
+    end = offsets[a] + sizes[a];
+  }
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    throwErrno(errno, "open " + path);
+  }
+
+  char header[headerSize] = {};
+  std::memcpy(header, magic, sizeof(magic));
+  std::memcpy(header + 8, &version, sizeof(version));
+  std::memcpy(header + countsOffset, counts, sizeof(counts));
+  std::memcpy(header + offsetsOffset, offsets, sizeof(offsets));
+  out.write(header, sizeof(header));
+
+  const char padding[alignment] = {};
+  uint64_t written = headerSize;
+  for (size_t a = 0; a < nArrays; ++a) {
+    out.write(padding, offsets[a] - written);
+    out.write(data[a], sizes[a]);
+    written = offsets[a] + sizes[a];
+  }
+  if (!out.flush()) {
+    throwErrno(errno, "write " + path);
+  }
+}
+
+const BIBS::ScenarioView &BIBS::ScenarioImage::view() const { return arrays; }
+
+size_t BIBS::ScenarioImage::nEdges() const {
+  return arrays.friendOffsets[arrays.nAgents];
+}
+
+size_t BIBS::ScenarioImage::size() const { return mapping.size(); }
+
+BIBS::Scenario BIBS::ScenarioImage::toScenario() const {
+  const size_t nA = arrays.nAgents;
+  const size_t nB = arrays.nBeliefs;
+  const size_t nK = arrays.nBehaviours;
+  const size_t nE = nEdges();
+
+  Scenario s(nA, nB, nK);
+  std::copy_n(arrays.beliefRelationships, nB * nB,
+              s.beliefRelationships.begin());
+  std::copy_n(arrays.observedRelationships, nB * nK,
+              s.observedRelationships.begin());
+  std::copy_n(arrays.performingRelationships, nB * nK,
+              s.performingRelationships.begin());
+  std::copy_n(arrays.timeDeltas, nA * nB, s.timeDeltas.begin());
+  std::copy_n(arrays.friendOffsets, nA + 1, s.friendOffsets.begin());
+  s.friends.assign(arrays.friends, arrays.friends + nE);
+  s.friendWeights.assign(arrays.friendWeights, arrays.friendWeights + nE);
+  return s;
+}
@@ -0,0 +1,246 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/sensitivity.hpp"
+#include "bibs/bibs.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/state.hpp"
+#include "bibs/vectorised.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+BIBS::SensitivityParameter BIBS::timeDeltaParameter(index_t belief,
+                                                    double lower,
+                                                    double upper) {
+  return {"timeDelta[" + std::to_string(belief) + "]", lower, upper,
+          [belief](Scenario &s, const Scenario &, double value) {
+            if (belief >= s.nBeliefs) {
+              throw std::out_of_range("belief not found");
+            }
+            for (size_t i = 0; i < s.nAgents; ++i) {
+              s.timeDeltas[i * s.nBeliefs + belief] = value;
+            }
+          }};
+}
+
+BIBS::SensitivityParameter BIBS::beliefRelationshipScaling(index_t b,
+                                                           index_t b2,
+                                                           double lower,
+                                                           double upper) {
+  return {"beliefRelationship[" + std::to_string(b) + "][" +
+              std::to_string(b2) + "]",
+          lower, upper,
+          [b, b2](Scenario &s, const Scenario &base, double value) {
+            if (b >= s.nBeliefs || b2 >= s.nBeliefs) {
+              throw std::out_of_range("belief not found");
+            }
+            const size_t k = b * s.nBeliefs + b2;
+            s.beliefRelationships[k] = value * base.beliefRelationships[k];
+          }};
+}
+
+BIBS::SensitivityParameter BIBS::observedRelationshipScaling(index_t belief,
+                                                             double lower,
+                                                             double upper) {
+  return {"observedRelationship[" + std::to_string(belief) + "]", lower,
+          upper, [belief](Scenario &s, const Scenario &base, double value) {
+            if (belief >= s.nBeliefs) {
+              throw std::out_of_range("belief not found");
+            }
+            for (size_t k = 0; k < s.nBehaviours; ++k) {
+              const size_t j = belief * s.nBehaviours + k;
+              s.observedRelationships[j] =
+                  value * base.observedRelationships[j];
+            }
+          }};
+}
+
+BIBS::SensitivityParameter
+BIBS::performingRelationshipScaling(index_t belief, double lower,
+                                    double upper) {
+  return {"performingRelationship[" + std::to_string(belief) + "]", lower,
+          upper, [belief](Scenario &s, const Scenario &base, double value) {
+            if (belief >= s.nBeliefs) {
+              throw std::out_of_range("belief not found");
+            }
+            for (size_t k = 0; k < s.nBehaviours; ++k) {
+              const size_t j = belief * s.nBehaviours + k;
+              s.performingRelationships[j] =
+                  value * base.performingRelationships[j];
+            }
+          }};
+}
+
+BIBS::SensitivityParameter BIBS::friendWeightScaling(double lower,
+                                                     double upper) {
+  return {"friendWeights", lower, upper,
+          [](Scenario &s, const Scenario &base, double value) {
+            for (size_t e = 0; e < s.friendWeights.size(); ++e) {
+              s.friendWeights[e] = value * base.friendWeights[e];
+            }
+          }};
+}
+
+BIBS::SensitivityAnalysis::SensitivityAnalysis(
+    std::shared_ptr<const Scenario> base, std::vector<double> activations,
+    std::vector<SensitivityParameter> parameters, output_t output,
+    sim_time_t nTicks, uint64_t seed, size_t nThreads)
+    : base(std::move(base)), activations(std::move(activations)),
+      parameters(std::move(parameters)), output(std::move(output)),
+      nTicks(nTicks), seed(seed), threads(nThreads) {
+  if (this->parameters.empty()) {
+    throw std::invalid_argument("there must be at least one parameter");
+  }
+  firstOrderSums.assign(this->parameters.size(), 0.0);
+  totalSums.assign(this->parameters.size(), 0.0);
+}
+
+double BIBS::SensitivityAnalysis::sampleValue(size_t sample, int matrix,
+                                              size_t p) const {
+  // Counter-based, so that the samples do not depend on the waves or
+  // threads, and later calls to run extend the same sequence.
+  const double u = VectorisedSimulation::uniform(
+      seed, 2 * static_cast<uint64_t>(sample) + matrix,
+      static_cast<sim_time_t>(p), 0xffffffffu);
+  const auto &param = parameters[p];
+  return param.lower + u * (param.upper - param.lower);
+}
+
+double BIBS::SensitivityAnalysis::runOne(size_t sample, long column) {
+  std::unique_ptr<Workspace> ws;
+  {
+    std::lock_guard<std::mutex> lock(workspaceMutex);
+    if (!workspaces.empty()) {
+      ws = std::move(workspaces.back());
+      workspaces.pop_back();
+    }
+  }
+  if (!ws) {
+    ws = std::make_unique<Workspace>();
+    ws->scenario = std::make_shared<Scenario>(*base);
+    ws->pool = std::make_shared<FramePool>();
+  } else {
+    // Reuses the storage of the last run.
+    *ws->scenario = *base;
+  }
+
+  const int matrix = column == -1 ? 1 : 0;
+  for (size_t p = 0; p < parameters.size(); ++p) {
+    const int m = static_cast<long>(p) == column ? 1 : matrix;
+    parameters[p].apply(*ws->scenario, *base, sampleValue(sample, m, p));
+  }
+
+  double result;
+  {
+    VectorisedSimulation sim(ws->scenario, activations, {},
+                             seed + 0x9e3779b97f4a7c15ULL * (sample + 1),
+                             false, ws->pool);
+    sim.run(nTicks);
+    result = output(sim);
+  }
+
+  std::lock_guard<std::mutex> lock(workspaceMutex);
+  workspaces.push_back(std::move(ws));
+  return result;
+}
+
+void BIBS::SensitivityAnalysis::accumulate(const double *f) {
+  const double fA = f[0];
+  const double fB = f[1];
+
+  double count = 2.0 * n;
+  for (double y : {fA, fB}) {
+    count += 1.0;
+    const double delta = y - outputMean;
+    outputMean += delta / count;
+    outputM2 += delta * (y - outputMean);
+  }
+
+  for (size_t p = 0; p < parameters.size(); ++p) {
+    const double fAB = f[2 + p];
+    firstOrderSums[p] += fB * (fAB - fA);
+    totalSums[p] += (fA - fAB) * (fA - fAB);
+  }
+  ++n;
+}
+
+void BIBS::SensitivityAnalysis::run(size_t nSamples) {
+  const size_t width = parameters.size() + 2;
+  const size_t wave = std::max<size_t>(1, 4 * threads.size());
+  std::vector<double> outputs(wave * width);
+
+  for (size_t first = n, last = n + nSamples; first < last;) {
+    const size_t rows = std::min(wave, last - first);
+    threads.parallelFor(rows * width, 1, [&](size_t begin, size_t end) {
+      for (size_t r = begin; r < end; ++r) {
+        outputs[r] = runOne(first + r / width,
+                            static_cast<long>(r % width) - 2);
+      }
+    });
+    // Accumulating in order keeps the estimates independent of the threads.
+    for (size_t row = 0; row < rows; ++row) {
+      accumulate(&outputs[row * width]);
+    }
+    first += rows;
+  }
+}
+
+size_t BIBS::SensitivityAnalysis::nSamples() const { return n; }
+
+size_t BIBS::SensitivityAnalysis::nRuns() const {
+  return n * (parameters.size() + 2);
+}
+
+double BIBS::SensitivityAnalysis::mean() const { return outputMean; }
+
+double BIBS::SensitivityAnalysis::variance() const {
+  return n == 0 ? 0.0 : outputM2 / (2.0 * n - 1.0);
+}
+
+std::vector<double> BIBS::SensitivityAnalysis::firstOrder() const {
+  const double v = variance();
+  std::vector<double> s(parameters.size(), 0.0);
+  if (v > 0.0) {
+    for (size_t p = 0; p < s.size(); ++p) {
+      s[p] = firstOrderSums[p] / n / v;
+    }
+  }
+  return s;
+}
+
+std::vector<double> BIBS::SensitivityAnalysis::totalOrder() const {
+  const double v = variance();
+  std::vector<double> s(parameters.size(), 0.0);
+  if (v > 0.0) {
+    for (size_t p = 0; p < s.size(); ++p) {
+      s[p] = totalSums[p] / (2.0 * n) / v;
+    }
+  }
+  return s;
+}
+
+BIBS::SensitivityAnalysis::output_t
+BIBS::finalShareOutput(index_t behaviour) {
+  return [behaviour](const VectorisedSimulation &sim) {
+    return sim.behaviourShares(sim.time()).at(behaviour);
+  };
+}
@@ -19,24 +19,158 @@
 #include "bibs/agent.hpp"
 #include "bibs/behaviour.hpp"
 #include "bibs/bibs.hpp"
+#include "bibs/digest.hpp"
+#include "bibs/lookup.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/state.hpp"
+#include <algorithm>
 #include <iterator>
+#include <limits>
 #include <stdexcept>
+#include <string>
 #include <vector>
 
+namespace {
+/**
+ * The number of agents whose UUIDs are gathered by each task.
+ */
+constexpr size_t agentGrain = 256;
+} // namespace
+
+
 BIBS::SequentialSimulation::SequentialSimulation(
     std::vector<IAgent *> agents, std::vector<IBelief *> beliefs,
-    std::vector<IBehaviour *> behaviours)
+    std::vector<IBehaviour *> behaviours, ThreadPool *threads)
     : agents(agents), beliefs(beliefs), behaviours(behaviours) {
   std::copy(agents.begin(), agents.end(), std::back_inserter(constAgents));
   std::copy(beliefs.begin(), beliefs.end(), std::back_inserter(constBeliefs));
   std::copy(behaviours.begin(), behaviours.end(),
             std::back_inserter(constBehaviours));
+
+  std::vector<boost::uuids::uuid> uuids(agents.size());
+  const auto getUuid = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      uuids[i] = agents[i]->uuid;
+    }
+  };
+  forChunks(threads, agents.size(), agentGrain, getUuid);
+  agentUuids = UuidIndex(std::move(uuids), threads);
+
+  std::vector<std::string> names;
+  uuids.clear();
+  for (const auto &b : beliefs) {
+    uuids.push_back(b->uuid);
+    names.push_back(b->name);
+  }
+  beliefUuids = UuidIndex(std::move(uuids), threads);
+  beliefNames = NameIndex(std::move(names), threads);
+
+  names.clear();
+  uuids.clear();
+  for (const auto &b : behaviours) {
+    uuids.push_back(b->uuid);
+    names.push_back(b->name);
+  }
+  behaviourUuids = UuidIndex(std::move(uuids), threads);
+  behaviourNames = NameIndex(std::move(names), threads);
+}
+
+BIBS::index_t
+BIBS::SequentialSimulation::agentIndex(const boost::uuids::uuid &uuid) const {
+  return agentUuids.at(uuid);
+}
+
+BIBS::index_t
+BIBS::SequentialSimulation::beliefIndex(const boost::uuids::uuid &uuid) const {
+  return beliefUuids.at(uuid);
+}
+
+BIBS::index_t
+BIBS::SequentialSimulation::beliefIndex(const std::string &name) const {
+  return beliefNames.at(name);
+}
+
+BIBS::index_t BIBS::SequentialSimulation::behaviourIndex(
+    const boost::uuids::uuid &uuid) const {
+  return behaviourUuids.at(uuid);
+}
+
+BIBS::index_t
+BIBS::SequentialSimulation::behaviourIndex(const std::string &name) const {
+  return behaviourNames.at(name);
+}
+
+BIBS::IAgent *
+BIBS::SequentialSimulation::agent(const boost::uuids::uuid &uuid) const {
+  return agents[agentIndex(uuid)];
+}
+
+BIBS::IBelief *
+BIBS::SequentialSimulation::belief(const boost::uuids::uuid &uuid) const {
+  return beliefs[beliefIndex(uuid)];
+}
+
+BIBS::IBehaviour *
+BIBS::SequentialSimulation::behaviour(const boost::uuids::uuid &uuid) const {
+  return behaviours[behaviourIndex(uuid)];
+}
+
+void BIBS::SequentialSimulation::addObserver(ITickObserver *o) {
+  if (o == nullptr) {
+    throw std::invalid_argument("observer must not be null");
+  }
+  observers.push_back(o);
+}
+
+void BIBS::SequentialSimulation::removeObserver(ITickObserver *o) {
+  const auto it = std::find(observers.begin(), observers.end(), o);
+  if (it == observers.end()) {
+    throw std::out_of_range("observer not found");
+  }
+  observers.erase(it);
+}
+
+BIBS::Frame BIBS::SequentialSimulation::frameOf(sim_time_t t) const {
+  Frame f;
+  f.t = t;
+  f.activations = activationsOf(constAgents, constBeliefs, t);
+  f.performed = performedOf(constAgents, constBehaviours, t);
+  f.digest = stateDigest(f.activations, f.performed, constBeliefs.size(), 0,
+                         constAgents.size());
+  return f;
 }
 
 void BIBS::SequentialSimulation::run(sim_time_t nDays) {
+  if (observers.empty()) {
+    for (sim_time_t t = 0; t < nDays; ++t) {
+      for (auto &agent : agents) {
+        agent->tick(t, constBehaviours, constBeliefs);
+      }
+    }
+    return;
+  }
+
+  const size_t n = agents.size();
+  Frame previous = frameOf(std::numeric_limits<sim_time_t>::max());
   for (sim_time_t t = 0; t < nDays; ++t) {
+    for (auto *o : observers) {
+      o->tickStart(previous);
+    }
     for (auto &agent : agents) {
       agent->tick(t, constBehaviours, constBeliefs);
     }
+
+    Frame current = frameOf(t);
+    for (auto *o : observers) {
+      o->afterActivations(previous, current, 0, n);
+    }
+    for (auto *o : observers) {
+      o->afterBehaviours(previous, current, 0, n);
+    }
+    for (auto *o : observers) {
+      o->tickEnd(current);
+    }
+    previous = std::move(current);
   }
 }
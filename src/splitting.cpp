@@ -0,0 +1,146 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/splitting.hpp"
+#include "bibs/digest.hpp"
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+BIBS::ImportanceSplitting::ImportanceSplitting(
+    std::shared_ptr<const Scenario> scenario,
+    const std::vector<double> &activations, index_t behaviour,
+    std::vector<double> levels, sim_time_t nDays, size_t nTrajectories,
+    uint64_t seed, ThreadPool *threads)
+    : origin(scenario, activations, {}, seed, false), behaviour(behaviour),
+      levels(std::move(levels)), nDays(nDays), nTrajectories(nTrajectories),
+      seed(seed), threads(threads) {
+  if (behaviour >= scenario->nBehaviours) {
+    throw std::invalid_argument("behaviour not found");
+  }
+  if (this->levels.empty()) {
+    throw std::invalid_argument("there must be at least one level");
+  }
+  for (size_t l = 0; l < this->levels.size(); ++l) {
+    if (!(this->levels[l] > (l == 0 ? 0.0 : this->levels[l - 1])) ||
+        this->levels[l] > 1) {
+      throw std::invalid_argument("the levels must increase, in (0, 1]");
+    }
+  }
+  if (nTrajectories == 0) {
+    throw std::invalid_argument("there must be at least one trajectory");
+  }
+}
+
+size_t
+BIBS::ImportanceSplitting::performing(const VectorisedSimulation &sim) const {
+  size_t n = 0;
+  for (const auto k : sim.current().performed) {
+    n += k == behaviour;
+  }
+  return n;
+}
+
+BIBS::SplittingEstimate
+BIBS::ImportanceSplitting::estimate(uint64_t replicate) const {
+  const size_t nAgents = origin.getScenario().nAgents;
+  std::mt19937_64 eng(mix64(seed ^ mix64(replicate)));
+
+  SplittingEstimate e;
+  e.probability = 1.0;
+  std::vector<VectorisedSimulation> trajectories(nTrajectories, origin);
+  std::vector<char> reached(nTrajectories);
+  std::vector<uint64_t> ticks(nTrajectories);
+
+  for (size_t l = 0; l < levels.size(); ++l) {
+    // Every trajectory of every level of every replicate has its own
+    // stream.
+    const uint64_t first = (replicate * levels.size() + l) * nTrajectories;
+    for (size_t i = 0; i < nTrajectories; ++i) {
+      trajectories[i].setStream(first + i + 1);
+    }
+
+    const double target = levels[l] * nAgents;
+    const auto body = [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        auto &sim = trajectories[i];
+        const sim_time_t start = sim.time();
+        while (performing(sim) < target && sim.time() < nDays) {
+          sim.run(1);
+        }
+        reached[i] = performing(sim) >= target;
+        ticks[i] = sim.time() - start;
+      }
+    };
+    forChunks(threads, nTrajectories, 1, body);
+
+    std::vector<size_t> successes;
+    for (size_t i = 0; i < nTrajectories; ++i) {
+      e.nTicks += ticks[i];
+      if (reached[i]) {
+        successes.push_back(i);
+      }
+    }
+
+    const double p = static_cast<double>(successes.size()) / nTrajectories;
+    e.levelProbabilities.push_back(p);
+    e.probability *= p;
+    if (successes.empty()) {
+      break;
+    }
+    if (l + 1 == levels.size()) {
+      break;
+    }
+
+    // Each success is cloned nTrajectories / R times, and the remainder
+    // are cloned once more, chosen without replacement.
+    const size_t r = successes.size();
+    std::vector<size_t> clones(nTrajectories);
+    for (size_t i = 0; i < nTrajectories / r * r; ++i) {
+      clones[i] = successes[i % r];
+    }
+    for (size_t j = 0; j < nTrajectories % r; ++j) {
+      std::uniform_int_distribution<size_t> pick(j, r - 1);
+      std::swap(successes[j], successes[pick(eng)]);
+      clones[nTrajectories / r * r + j] = successes[j];
+    }
+
+    std::vector<VectorisedSimulation> next;
+    next.reserve(nTrajectories);
+    for (const auto i : clones) {
+      next.push_back(trajectories[i]);
+    }
+    trajectories = std::move(next);
+  }
+
+  if (e.probability == 0) {
+    e.relativeError = std::numeric_limits<double>::infinity();
+  } else {
+    for (const double p : e.levelProbabilities) {
+      e.relativeError += (1 - p) / (nTrajectories * p);
+    }
+    e.relativeError = std::sqrt(e.relativeError);
+  }
+  return e;
+}
+
+const std::vector<double> &BIBS::ImportanceSplitting::getLevels() const {
+  return levels;
+}
@@ -0,0 +1,63 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/state.hpp"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+void BIBS::Frame::resize(size_t nAgents, size_t nBeliefs) {
+  activations.resize(nAgents * nBeliefs);
+  contexts.resize(nAgents * nBeliefs);
+  performed.resize(nAgents);
+}
+
+void BIBS::FramePool::release(Frame *frame) {
+  std::lock_guard<std::mutex> lock(mutex);
+  free.emplace_back(frame);
+}
+
+std::shared_ptr<BIBS::Frame> BIBS::FramePool::acquire(size_t nAgents,
+                                                      size_t nBeliefs) {
+  std::unique_ptr<Frame> frame;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!free.empty()) {
+      frame = std::move(free.back());
+      free.pop_back();
+    }
+  }
+  if (frame == nullptr) {
+    frame = std::make_unique<Frame>();
+  }
+  frame->resize(nAgents, nBeliefs);
+
+  std::weak_ptr<FramePool> weakPool = weak_from_this();
+  return std::shared_ptr<Frame>(frame.release(), [weakPool](Frame *f) {
+    if (auto pool = weakPool.lock()) {
+      pool->release(f);
+    } else {
+      delete f;
+    }
+  });
+}
+
+size_t BIBS::FramePool::nFree() {
+  std::lock_guard<std::mutex> lock(mutex);
+  return free.size();
+}
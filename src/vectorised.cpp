@@ -0,0 +1,603 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/vectorised.hpp"
+#include "bibs/bibs.hpp"
+#include "bibs/blocksparse.hpp"
+#include "bibs/choice.hpp"
+#include "bibs/digest.hpp"
+#include "bibs/exogenous.hpp"
+#include "bibs/graph.hpp"
+#include "bibs/output.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/scenarioimage.hpp"
+#include "bibs/simulation.hpp"
+#include "bibs/state.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+/**
+ * The number of agents updated by each task of a parallel tick.
+ */
+constexpr size_t agentGrain = 256;
+
+/**
+ * The number of agents given to the choice policy at once.
+ */
+constexpr size_t choiceGrain = 64;
+
+/**
+ * A Scenario with the numbers of agents, beliefs and behaviours of an image,
+ * and none of its arrays.
+ */
+std::shared_ptr<const BIBS::Scenario> sizesOf(const BIBS::ScenarioImage &i) {
+  auto s = std::make_shared<BIBS::Scenario>(0, 0, 0);
+  s->nAgents = i.view().nAgents;
+  s->nBeliefs = i.view().nBeliefs;
+  s->nBehaviours = i.view().nBehaviours;
+  return s;
+}
+} // namespace
+
+BIBS::VectorisedSimulation::VectorisedSimulation(
+    std::shared_ptr<const Scenario> scenario,
+    const std::vector<double> &activations,
+    const std::vector<index_t> &performed, uint64_t seed, bool recordHistory,
+    std::shared_ptr<FramePool> pool, ThreadPool *threads)
+    : scenario(scenario), arrays(scenario->view()), pool(pool),
+      recordHistory(recordHistory), seed(seed), threads(threads),
+      choicePolicy(defaultChoicePolicy()) {
+  scenario->validate();
+  start(activations, performed);
+}
+
+BIBS::VectorisedSimulation::VectorisedSimulation(
+    std::shared_ptr<const ScenarioImage> image,
+    const std::vector<double> &activations,
+    const std::vector<index_t> &performed, uint64_t seed, bool recordHistory,
+    std::shared_ptr<FramePool> pool, ThreadPool *threads)
+    : scenario(sizesOf(*image)), image(image), arrays(image->view()),
+      pool(pool), recordHistory(recordHistory), seed(seed), threads(threads),
+      choicePolicy(defaultChoicePolicy()) {
+  arrays.validate();
+  start(activations, performed);
+}
+
+void BIBS::VectorisedSimulation::start(const std::vector<double> &activations,
+                                       const std::vector<index_t> &performed) {
+  const size_t nA = scenario->nAgents;
+  const size_t nB = scenario->nBeliefs;
+
+  if (activations.size() != nA * nB) {
+    throw std::invalid_argument("activations have the wrong size");
+  }
+  if (!performed.empty() && performed.size() != nA) {
+    throw std::invalid_argument("performed behaviours have the wrong size");
+  }
+  for (const auto &k : performed) {
+    if (k >= scenario->nBehaviours) {
+      throw std::invalid_argument("performed behaviour out of range");
+    }
+  }
+
+  if (this->pool == nullptr) {
+    this->pool = std::make_shared<FramePool>();
+  }
+
+  auto f = this->pool->acquire(nA, nB);
+  f->t = 0;
+  std::copy(activations.begin(), activations.end(), f->activations.begin());
+  computeContexts(*f, 0, nA);
+  if (performed.empty()) {
+    choose(*f, 0, nA);
+  } else {
+    std::copy(performed.begin(), performed.end(), f->performed.begin());
+  }
+  f->digest = stateDigest(f->activations, f->performed, nB, 0, nA);
+
+  frames.push_back(std::move(f));
+}
+
+double BIBS::VectorisedSimulation::uniform(uint64_t seed, uint64_t stream,
+                                           sim_time_t t, index_t agent) {
+  uint64_t x = mix64(seed);
+  x = mix64(x ^ stream);
+  x = mix64(x ^ t);
+  x = mix64(x ^ agent);
+  return static_cast<double>(x >> 11) * 0x1.0p-53;
+}
+
+void BIBS::VectorisedSimulation::computeContexts(Frame &f, size_t begin,
+                                                 size_t end) const {
+  const size_t nB = scenario->nBeliefs;
+  const double *r = arrays.beliefRelationships;
+
+  if (blockRelationships) {
+    double *ctx = f.contexts.data() + begin * nB;
+    blockRelationships->multiply(f.activations.data() + begin * nB, ctx,
+                                 end - begin);
+    for (size_t j = 0; j < (end - begin) * nB; ++j) {
+      ctx[j] = std::exp(ctx[j]);
+    }
+    return;
+  }
+
+  for (size_t i = begin; i < end; ++i) {
+    const double *a = &f.activations[i * nB];
+    double *ctx = &f.contexts[i * nB];
+    for (size_t b = 0; b < nB; ++b) {
+      double valueToExp = 0.0;
+      for (size_t b2 = 0; b2 < nB; ++b2) {
+        valueToExp += a[b2] * r[b * nB + b2];
+      }
+      ctx[b] = std::exp(valueToExp);
+    }
+  }
+}
+
+void BIBS::VectorisedSimulation::choose(Frame &f, size_t begin,
+                                        size_t end) const {
+  const size_t nB = scenario->nBeliefs;
+  const size_t nK = scenario->nBehaviours;
+  const double *p = arrays.performingRelationships;
+
+  if (nK == 0) {
+    std::fill(f.performed.begin() + begin, f.performed.begin() + end, 0);
+    return;
+  }
+
+  std::vector<double> utilities(choiceGrain * nK);
+  std::vector<double> uniforms(choiceGrain);
+  const auto draw = [&](size_t i) {
+    const double u =
+        uniform(seed, stream, f.t,
+                streamIndices.empty() ? static_cast<index_t>(i)
+                                      : streamIndices[i]);
+    // Exact, and in [0, 1) as u is a multiple of 2^-53.
+    return antithetic ? 0x1.fffffffffffffp-1 - u : u;
+  };
+
+  for (size_t chunk = begin; chunk < end; chunk += choiceGrain) {
+    const size_t n = std::min(choiceGrain, end - chunk);
+
+    if (cache && cache->valid) {
+      for (size_t j = 0; j < n; ++j) {
+        uniforms[j] = draw(chunk + j);
+      }
+      const double *cached = &cache->utilities[chunk * nK];
+      if (exogenous) {
+        // The cache holds the utilities without the exogenous input.
+        std::copy(cached, cached + n * nK, utilities.begin());
+        exogenous->apply(f.t, utilities.data(), n, nK);
+        cached = utilities.data();
+      }
+      choicePolicy->choose(cached, uniforms.data(), n, nK,
+                           &f.performed[chunk]);
+      continue;
+    }
+
+    std::fill(utilities.begin(), utilities.end(), 0.0);
+
+    for (size_t j = 0; j < n; ++j) {
+      const size_t i = chunk + j;
+      const double *a = &f.activations[i * nB];
+      const double *ctx = &f.contexts[i * nB];
+      double *ut = &utilities[j * nK];
+
+      for (size_t b = 0; b < nB; ++b) {
+        const double contextual = ctx[b] * a[b];
+        for (size_t k = 0; k < nK; ++k) {
+          ut[k] += contextual * p[b * nK + k];
+        }
+      }
+      uniforms[j] = draw(i);
+    }
+    if (exogenous) {
+      exogenous->apply(f.t, utilities.data(), n, nK);
+    }
+
+    choicePolicy->choose(utilities.data(), uniforms.data(), n, nK,
+                         &f.performed[chunk]);
+  }
+}
+
+uint64_t BIBS::VectorisedSimulation::updateCache(const Frame &prev, Frame &f,
+                                                size_t begin, size_t end,
+                                                bool refresh) {
+  const size_t nB = scenario->nBeliefs;
+  const size_t nK = scenario->nBehaviours;
+  const double *r = arrays.beliefRelationships;
+  const double *p = arrays.performingRelationships;
+  const double *rT = cache->relationshipsT.data();
+  const double tol = cache->tolerance;
+  uint64_t nUpdates = 0;
+
+  for (size_t i = begin; i < end; ++i) {
+    const double *a = &f.activations[i * nB];
+    double *ctx = &f.contexts[i * nB];
+    double *applied = &cache->activations[i * nB];
+    double *x = &cache->exponents[i * nB];
+    double *contextual = &cache->contextual[i * nB];
+    double *ut = &cache->utilities[i * nK];
+
+    if (refresh) {
+      std::fill(ut, ut + nK, 0.0);
+      for (size_t b = 0; b < nB; ++b) {
+        double valueToExp = 0.0;
+        for (size_t b2 = 0; b2 < nB; ++b2) {
+          valueToExp += a[b2] * r[b * nB + b2];
+        }
+        applied[b] = a[b];
+        x[b] = valueToExp;
+        ctx[b] = std::exp(valueToExp);
+      }
+      for (size_t b = 0; b < nB; ++b) {
+        contextual[b] = ctx[b] * a[b];
+        for (size_t k = 0; k < nK; ++k) {
+          ut[k] += contextual[b] * p[b * nK + k];
+        }
+      }
+      continue;
+    }
+
+    // The exponents are linear in the activations: a rank-1 update per
+    // changed activation.
+    bool changed = false;
+    for (size_t b2 = 0; b2 < nB; ++b2) {
+      const double d = a[b2] - applied[b2];
+      if (std::abs(d) > tol) {
+        const double *column = &rT[b2 * nB];
+        for (size_t b = 0; b < nB; ++b) {
+          x[b] += d * column[b];
+        }
+        applied[b2] = a[b2];
+        changed = true;
+        ++nUpdates;
+      }
+    }
+    if (changed) {
+      for (size_t b = 0; b < nB; ++b) {
+        ctx[b] = std::exp(x[b]);
+      }
+    } else {
+      std::copy(&prev.contexts[i * nB], &prev.contexts[(i + 1) * nB], ctx);
+    }
+
+    // The utilities are linear in the contextual activations.
+    for (size_t b = 0; b < nB; ++b) {
+      const double c = ctx[b] * a[b];
+      const double d = c - contextual[b];
+      if (std::abs(d) > tol) {
+        for (size_t k = 0; k < nK; ++k) {
+          ut[k] += d * p[b * nK + k];
+        }
+        contextual[b] = c;
+        ++nUpdates;
+      }
+    }
+  }
+  return nUpdates;
+}
+
+void BIBS::VectorisedSimulation::updateActivations(const Frame &prev, Frame &f,
+                                                   size_t begin,
+                                                   size_t end) const {
+  const size_t nB = scenario->nBeliefs;
+  const size_t nK = scenario->nBehaviours;
+  const double *o = arrays.observedRelationships;
+  const double *td = arrays.timeDeltas;
+  const uint64_t *offsets = arrays.friendOffsets;
+  const index_t *friends = arrays.friends;
+  const double *weights = arrays.friendWeights;
+
+  // The total weight of the friends performing each behaviour.
+  std::vector<double> behaviourWeights(nK);
+
+  for (size_t i = begin; i < end; ++i) {
+    std::fill(behaviourWeights.begin(), behaviourWeights.end(), 0.0);
+    if (graph && nK > 0) {
+      graph->forEachFriend(static_cast<index_t>(i), [&](index_t j, double w) {
+        behaviourWeights[prev.performed[j]] += w;
+      });
+    } else {
+      for (auto e = offsets[i]; e < offsets[i + 1] && nK > 0; ++e) {
+        behaviourWeights[prev.performed[friends[e]]] += weights[e];
+      }
+    }
+
+    const double *a = &prev.activations[i * nB];
+    const double *ctx = &prev.contexts[i * nB];
+    double *newA = &f.activations[i * nB];
+
+    for (size_t b = 0; b < nB; ++b) {
+      double observed = 0.0;
+      for (size_t k = 0; k < nK; ++k) {
+        observed += behaviourWeights[k] * o[b * nK + k];
+      }
+      newA[b] = td[i * nB + b] * a[b] + ctx[b] * observed;
+    }
+  }
+}
+
+void BIBS::VectorisedSimulation::startTick(Tick &tick) {
+  const Frame &prev = *frames.back();
+  if (exogenous) {
+    // Fail before the frame is changed, and read the next ticks ahead.
+    exogenous->row(prev.t + 1);
+    exogenous->prefetch(prev.t + 1);
+  }
+  tick.frame = pool->acquire(scenario->nAgents, scenario->nBeliefs);
+  tick.frame->t = prev.t + 1;
+
+  if (cache) {
+    tick.refresh =
+        !cache->valid || ++cache->sinceRefresh >= cache->refreshInterval;
+    if (tick.refresh) {
+      cache->sinceRefresh = 0;
+    }
+    cache->valid = true;
+  }
+}
+
+void BIBS::VectorisedSimulation::activate(Tick &tick, size_t begin,
+                                          size_t end) {
+  const Frame &prev = *frames.back();
+  updateActivations(prev, *tick.frame, begin, end);
+  if (cache) {
+    tick.nUpdates.fetch_add(
+        updateCache(prev, *tick.frame, begin, end, tick.refresh),
+        std::memory_order_relaxed);
+  } else {
+    computeContexts(*tick.frame, begin, end);
+  }
+}
+
+void BIBS::VectorisedSimulation::behave(Tick &tick, size_t begin,
+                                        size_t end) {
+  const size_t nB = scenario->nBeliefs;
+  Frame &f = *tick.frame;
+  choose(f, begin, end);
+  if (historyWriter != nullptr) {
+    historyWriter->write(f.t, begin, end, f.activations.data() + begin * nB,
+                         f.performed.data() + begin);
+  }
+  // The digest is a sum, so the chunks can add to it in any order.
+  tick.digest.fetch_add(
+      stateDigest(f.activations, f.performed, nB, begin, end),
+      std::memory_order_relaxed);
+}
+
+void BIBS::VectorisedSimulation::endTick(Tick &tick) {
+  tick.frame->digest = tick.digest.load(std::memory_order_relaxed);
+  if (cache) {
+    cache->nUpdates = tick.nUpdates.load(std::memory_order_relaxed);
+  }
+
+  if (recordHistory) {
+    frames.push_back(std::move(tick.frame));
+  } else {
+    frames.back() = std::move(tick.frame);
+  }
+}
+
+void BIBS::VectorisedSimulation::forAgents(
+    const std::function<void(size_t, size_t)> &body) {
+  forChunks(threads, scenario->nAgents, agentGrain, body);
+}
+
+void BIBS::VectorisedSimulation::step() {
+  TickObserver none;
+  step(none);
+}
+
+void BIBS::VectorisedSimulation::run(sim_time_t nDays) {
+  for (sim_time_t i = 0; i < nDays; ++i) {
+    step();
+  }
+}
+
+BIBS::sim_time_t BIBS::VectorisedSimulation::time() const {
+  return frames.back()->t;
+}
+
+const BIBS::ScenarioView &BIBS::VectorisedSimulation::getArrays() const {
+  return arrays;
+}
+
+const BIBS::Scenario &BIBS::VectorisedSimulation::getScenario() const {
+  return *scenario;
+}
+
+const BIBS::Frame &BIBS::VectorisedSimulation::frame(sim_time_t t) const {
+  const sim_time_t first = frames.front()->t;
+  if (t < first || t > time()) {
+    throw std::out_of_range("frame not found");
+  }
+  return *frames[t - first];
+}
+
+std::shared_ptr<const BIBS::Frame>
+BIBS::VectorisedSimulation::sharedFrame(sim_time_t t) const {
+  const sim_time_t first = frames.front()->t;
+  if (t < first || t > time()) {
+    throw std::out_of_range("frame not found");
+  }
+  return frames[t - first];
+}
+
+const BIBS::Frame &BIBS::VectorisedSimulation::current() const {
+  return *frames.back();
+}
+
+uint64_t BIBS::VectorisedSimulation::digest(sim_time_t t) const {
+  return frame(t).digest;
+}
+
+double BIBS::VectorisedSimulation::activation(sim_time_t t, index_t agent,
+                                              index_t belief) const {
+  if (agent >= scenario->nAgents || belief >= scenario->nBeliefs) {
+    throw std::out_of_range("agent or belief not found");
+  }
+  return frame(t).activations[agent * scenario->nBeliefs + belief];
+}
+
+BIBS::index_t BIBS::VectorisedSimulation::performed(sim_time_t t,
+                                                    index_t agent) const {
+  return frame(t).performed.at(agent);
+}
+
+std::vector<double>
+BIBS::VectorisedSimulation::behaviourShares(sim_time_t t) const {
+  const auto &f = frame(t);
+  std::vector<double> shares(scenario->nBehaviours, 0.0);
+
+  for (const auto &k : f.performed) {
+    shares[k] += 1.0;
+  }
+  for (auto &s : shares) {
+    s /= static_cast<double>(scenario->nAgents);
+  }
+
+  return shares;
+}
+
+uint64_t BIBS::VectorisedSimulation::getStream() const { return stream; }
+
+void BIBS::VectorisedSimulation::setStream(uint64_t s) { stream = s; }
+
+void BIBS::VectorisedSimulation::setThreadPool(ThreadPool *t) { threads = t; }
+
+bool BIBS::VectorisedSimulation::isAntithetic() const { return antithetic; }
+
+void BIBS::VectorisedSimulation::setAntithetic(bool a) { antithetic = a; }
+
+void BIBS::VectorisedSimulation::setBlockSparse(size_t blockSize) {
+  const size_t nB = scenario->nBeliefs;
+  if (blockSize == 0) {
+    blockRelationships = nullptr;
+  } else if (image) {
+    // The matrix is copied out of the image to be compressed.
+    blockRelationships = std::make_shared<const BlockSparseMatrix>(
+        std::vector<double>(arrays.beliefRelationships,
+                            arrays.beliefRelationships + nB * nB),
+        nB, nB, blockSize);
+  } else {
+    blockRelationships = std::make_shared<const BlockSparseMatrix>(
+        scenario->beliefRelationships, nB, nB, blockSize);
+  }
+}
+
+void BIBS::VectorisedSimulation::setCompressedGraph(
+    std::shared_ptr<const CompressedGraph> g) {
+  if (g != nullptr && g->getNAgents() != scenario->nAgents) {
+    throw std::invalid_argument("graph has the wrong number of agents");
+  }
+  graph = std::move(g);
+}
+
+void BIBS::VectorisedSimulation::setExogenousInput(
+    std::shared_ptr<const ExogenousInput> input) {
+  if (input != nullptr) {
+    const auto &k = input->getBehaviours();
+    if (std::any_of(k.begin(), k.end(), [&](index_t b) {
+          return b >= scenario->nBehaviours;
+        })) {
+      throw std::invalid_argument("affected behaviour out of range");
+    }
+  }
+  exogenous = std::move(input);
+}
+
+void BIBS::VectorisedSimulation::setIncremental(double tolerance,
+                                                sim_time_t refreshInterval) {
+  if (!(tolerance >= 0)) {
+    throw std::invalid_argument("tolerance must not be negative");
+  }
+  if (refreshInterval == 0) {
+    throw std::invalid_argument("refresh interval must be positive");
+  }
+
+  const size_t nA = scenario->nAgents;
+  const size_t nB = scenario->nBeliefs;
+  cache.emplace();
+  cache->tolerance = tolerance;
+  cache->refreshInterval = refreshInterval;
+  cache->relationshipsT.resize(nB * nB);
+  for (size_t b = 0; b < nB; ++b) {
+    for (size_t b2 = 0; b2 < nB; ++b2) {
+      cache->relationshipsT[b2 * nB + b] =
+          arrays.beliefRelationships[b * nB + b2];
+    }
+  }
+  cache->activations.resize(nA * nB);
+  cache->exponents.resize(nA * nB);
+  cache->contextual.resize(nA * nB);
+  cache->utilities.resize(nA * scenario->nBehaviours);
+}
+
+void BIBS::VectorisedSimulation::setExact() { cache.reset(); }
+
+bool BIBS::VectorisedSimulation::isIncremental() const {
+  return cache.has_value();
+}
+
+uint64_t BIBS::VectorisedSimulation::nRankOneUpdates() const {
+  return cache ? cache->nUpdates : 0;
+}
+
+void BIBS::VectorisedSimulation::setChoicePolicy(
+    std::shared_ptr<const IChoicePolicy> p) {
+  choicePolicy = p ? std::move(p) : defaultChoicePolicy();
+}
+
+void BIBS::VectorisedSimulation::setHistoryWriter(HistoryWriter *w) {
+  if (w != nullptr && (w->getNAgents() != scenario->nAgents ||
+                       w->getNBeliefs() != scenario->nBeliefs)) {
+    throw std::invalid_argument("history writer has the wrong size");
+  }
+  historyWriter = w;
+  if (w != nullptr) {
+    const Frame &f = current();
+    w->write(f.t, 0, scenario->nAgents, f.activations.data(),
+             f.performed.data());
+  }
+}
+
+void BIBS::VectorisedSimulation::addObserver(ITickObserver *o) {
+  if (o == nullptr) {
+    throw std::invalid_argument("observer must not be null");
+  }
+  observers.push_back(o);
+}
+
+void BIBS::VectorisedSimulation::removeObserver(ITickObserver *o) {
+  const auto it = std::find(observers.begin(), observers.end(), o);
+  if (it == observers.end()) {
+    throw std::out_of_range("observer not found");
+  }
+  observers.erase(it);
+}
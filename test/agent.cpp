@@ -18,6 +18,7 @@
 #include "bibs/agent.hpp"
 #include "bibs/behaviour.hpp"
 #include "bibs/belief.hpp"
+#include "bibs/choice.hpp"
 
 #include "agent.hpp"
 #include "behaviour.hpp"
@@ -29,6 +30,7 @@
 #include <cstdio>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <map>
 #include <memory>
 #include <random>
 #include <stdexcept>
@@ -126,6 +128,48 @@ TEST(Agent, performWhenFound) {
   EXPECT_EQ(a.performed(10), b.get());
 }
 
+/**
+ * An Agent with fixed utilities, counting the random numbers it draws.
+ */
+class AgentCountingDraws : public BIBS::Agent {
+public:
+  std::map<const BIBS::IBehaviour *, double> utilities;
+  mutable size_t nDraws = 0;
+
+protected:
+  double utility(const BIBS::IBehaviour *b,
+                 const BIBS::sim_time_t t) const override {
+    return utilities.at(b);
+  }
+
+  double choiceUniform(const BIBS::sim_time_t t) const override {
+    ++nDraws;
+    return 0.5;
+  }
+};
+
+TEST(Agent, performDrawsOnlyWhenNeeded) {
+  auto b1 = std::make_unique<BIBS::testing::MockBehaviour>("b1");
+  auto b2 = std::make_unique<BIBS::testing::MockBehaviour>("b2");
+  const std::vector<const BIBS::IBehaviour *> bs{b1.get(), b2.get()};
+  AgentCountingDraws a;
+
+  // At most one positive utility: the greatest, with no draw.
+  a.utilities = {{b1.get(), -1.0}, {b2.get(), 2.0}};
+  a.perform(0, bs);
+  EXPECT_EQ(a.performed(0), b2.get());
+  EXPECT_EQ(a.nDraws, 0);
+
+  a.utilities = {{b1.get(), 1.0}, {b2.get(), 3.0}};
+  a.perform(1, bs);
+  EXPECT_EQ(a.nDraws, 1);
+
+  a.setChoicePolicy(std::make_shared<const BIBS::ArgmaxPolicy>());
+  a.perform(2, bs);
+  EXPECT_EQ(a.performed(2), b2.get());
+  EXPECT_EQ(a.nDraws, 1);
+}
+
 TEST(Agent, friendWeightWhenNotFound) {
   auto a1 = BIBS::Agent();
   auto a2 = std::make_unique<BIBS::testing::MockAgent>(
@@ -158,6 +202,23 @@ TEST(Agent, setFriendWeightUpdating) {
   EXPECT_EQ(a1.friendWeight(a2.get()), 1.0);
 }
 
+TEST(Agent, friendWeights) {
+  auto a1 = BIBS::Agent();
+  auto a2 = std::make_unique<BIBS::testing::MockAgent>(
+      boost::uuids::random_generator_mt19937()());
+  auto a3 = std::make_unique<BIBS::testing::MockAgent>(
+      boost::uuids::random_generator_mt19937()());
+
+  EXPECT_TRUE(a1.friendWeights().empty());
+
+  a1.setFriendWeight(a2.get(), 5.0);
+  a1.setFriendWeight(a3.get(), 1.0);
+
+  std::map<const BIBS::IAgent *, double> expected{{a2.get(), 5.0},
+                                                  {a3.get(), 1.0}};
+  EXPECT_EQ(a1.friendWeights(), expected);
+}
+
 class AgentWithObservedWrapper : public BIBS::Agent {
 public:
   using Agent::Agent;
@@ -355,6 +416,21 @@ TEST(Agent, setTimeDeltaUpdating) {
   EXPECT_DOUBLE_EQ(a.timeDelta(b.get()), 5.0);
 }
 
+TEST(Agent, timeDeltas) {
+  BIBS::Agent a;
+  auto b1 = std::make_unique<BIBS::testing::MockBelief>("b1");
+  auto b2 = std::make_unique<BIBS::testing::MockBelief>("b2");
+
+  EXPECT_TRUE(a.timeDeltas().empty());
+
+  a.setTimeDelta(b1.get(), 2.0);
+  a.setTimeDelta(b2.get(), 5.0);
+
+  std::map<const BIBS::IBelief *, double> expected{{b1.get(), 2.0},
+                                                   {b2.get(), 5.0}};
+  EXPECT_EQ(a.timeDeltas(), expected);
+}
+
 class AgentUpdateActivationTest : public BIBS::Agent {
 public:
   using Agent::Agent;
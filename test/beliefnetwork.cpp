@@ -0,0 +1,153 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/beliefnetwork.hpp"
+#include "bibs/behaviour.hpp"
+#include "bibs/belief.hpp"
+#include "bibs/scenario.hpp"
+
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Relationship = BIBS::BeliefNetwork::Relationship;
+
+namespace {
+class BeliefNetworkTest : public ::testing::Test {
+protected:
+  BIBS::Behaviour beh0{"beh0"};
+  BIBS::Behaviour beh1{"beh1"};
+  BIBS::Behaviour other{"other"};
+  BIBS::BeliefNetwork network{{"b0", "b1", "b2"}, {&beh0, &beh1}};
+};
+} // namespace
+
+TEST_F(BeliefNetworkTest, constructor) {
+  EXPECT_EQ(network.nBeliefs(), 3);
+  EXPECT_EQ(network.nBehaviours(), 2);
+  EXPECT_EQ(network.belief(1)->name, "b1");
+  EXPECT_EQ(network.belief(2)->index(), 2);
+  EXPECT_THROW(network.belief(3), std::out_of_range);
+  EXPECT_EQ(network.getBeliefs().size(), 3);
+  EXPECT_EQ(network.behaviourIndex(&beh1), 1);
+  EXPECT_THROW(network.behaviourIndex(&other), std::out_of_range);
+
+  EXPECT_THROW(BIBS::BeliefNetwork({"b"}, {&beh0, &beh0}),
+               std::invalid_argument);
+}
+
+TEST_F(BeliefNetworkTest, unset) {
+  auto *b0 = network.belief(0);
+  EXPECT_THROW(b0->beliefRelationship(network.belief(1)), std::out_of_range);
+  EXPECT_THROW(b0->observedBehaviourRelationship(&beh0), std::out_of_range);
+  EXPECT_THROW(b0->performingBehaviourRelationship(&beh0), std::out_of_range);
+}
+
+TEST_F(BeliefNetworkTest, individualSetters) {
+  auto *b0 = network.belief(0);
+  auto *b2 = network.belief(2);
+  b0->setBeliefRelationship(b2, 0.5);
+  b2->setObservedBehaviourRelationship(&beh1, 0.25);
+  b2->setPerformingBehaviourRelationship(&beh0, -1);
+
+  EXPECT_EQ(b0->beliefRelationship(b2), 0.5);
+  EXPECT_EQ(network.get(Relationship::belief, 0, 2), 0.5);
+  EXPECT_EQ(b2->observedBehaviourRelationship(&beh1), 0.25);
+  EXPECT_EQ(b2->performingBehaviourRelationship(&beh0), -1);
+  EXPECT_THROW(b2->beliefRelationship(b0), std::out_of_range);
+
+  // Beliefs and behaviours from elsewhere are not in the network.
+  BIBS::Belief outside("outside");
+  BIBS::BeliefNetwork another({"b0"}, {&beh0});
+  EXPECT_THROW(b0->setBeliefRelationship(&outside, 1), std::out_of_range);
+  EXPECT_THROW(b0->beliefRelationship(another.belief(0)), std::out_of_range);
+  EXPECT_THROW(b0->setObservedBehaviourRelationship(&other, 1),
+               std::out_of_range);
+  EXPECT_THROW(network.set(Relationship::observed, 0, 2, 1.0),
+               std::out_of_range);
+}
+
+TEST_F(BeliefNetworkTest, setDense) {
+  const std::vector<double> beliefs = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+  network.setDense(Relationship::belief, beliefs);
+  EXPECT_EQ(network.getMatrix(Relationship::belief), beliefs);
+  EXPECT_EQ(network.belief(1)->beliefRelationship(network.belief(2)), 6);
+
+  network.setDense(Relationship::performing, {1, 2, 3, 4, 5, 6});
+  EXPECT_EQ(network.belief(2)->performingBehaviourRelationship(&beh0), 5);
+
+  EXPECT_THROW(network.setDense(Relationship::observed, beliefs),
+               std::invalid_argument);
+}
+
+TEST_F(BeliefNetworkTest, setTriplets) {
+  network.setTriplets(Relationship::observed,
+                      {{2, 1, 0.5}, {0, 0, 1.5}, {2, 1, 2.5}});
+  EXPECT_EQ(network.getMatrix(Relationship::observed),
+            std::vector<double>({1.5, 0, 0, 0, 0, 2.5}));
+
+  EXPECT_THROW(network.setTriplets(Relationship::observed, {{0, 2, 1}}),
+               std::out_of_range);
+  EXPECT_THROW(network.setTriplets(Relationship::belief, {{3, 0, 1}}),
+               std::out_of_range);
+}
+
+TEST_F(BeliefNetworkTest, setCsr) {
+  network.setCsr(Relationship::belief, {0, 2, 2, 3}, {0, 2, 1},
+                 {1.0, 2.0, 3.0});
+  EXPECT_EQ(network.getMatrix(Relationship::belief),
+            std::vector<double>({1, 0, 2, 0, 0, 0, 0, 3, 0}));
+
+  EXPECT_THROW(network.setCsr(Relationship::belief, {0, 2, 3}, {0, 2, 1},
+                              {1.0, 2.0, 3.0}),
+               std::invalid_argument);
+  EXPECT_THROW(network.setCsr(Relationship::belief, {0, 2, 1, 3}, {0, 2, 1},
+                              {1.0, 2.0, 3.0}),
+               std::invalid_argument);
+  EXPECT_THROW(network.setCsr(Relationship::belief, {0, 2, 2, 3}, {0, 2, 1},
+                              {1.0, 2.0}),
+               std::invalid_argument);
+  EXPECT_THROW(network.setCsr(Relationship::observed, {0, 1, 1, 1}, {2},
+                              {1.0}),
+               std::out_of_range);
+}
+
+TEST_F(BeliefNetworkTest, copyTo) {
+  BIBS::Scenario s(4, 3, 2);
+  EXPECT_THROW(network.copyTo(s), std::out_of_range);
+
+  network.setTriplets(Relationship::belief, {{0, 1, 0.5}});
+  network.setTriplets(Relationship::observed, {{1, 1, 0.25}});
+  network.setTriplets(Relationship::performing, {{2, 0, 2}});
+  network.copyTo(s);
+  EXPECT_EQ(s.beliefRelationships, network.getMatrix(Relationship::belief));
+  EXPECT_EQ(s.observedRelationships[3], 0.25);
+  EXPECT_EQ(s.performingRelationships[4], 2);
+
+  // The same as reading the relationships one by one.
+  const auto beliefs = network.getBeliefs();
+  const auto fromAgents = BIBS::Scenario::fromAgents(
+      {}, {beliefs.begin(), beliefs.end()}, {&beh0, &beh1});
+  EXPECT_EQ(fromAgents.beliefRelationships, s.beliefRelationships);
+  EXPECT_EQ(fromAgents.observedRelationships, s.observedRelationships);
+  EXPECT_EQ(fromAgents.performingRelationships, s.performingRelationships);
+
+  BIBS::Scenario wrong(4, 2, 2);
+  EXPECT_THROW(network.copyTo(wrong), std::invalid_argument);
+}
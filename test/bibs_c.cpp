@@ -0,0 +1,154 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/bibs_c.h"
+#include "bibs/scenario.hpp"
+#include "bibs/vectorised.hpp"
+
+#include "scenario.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class BibsCTest : public ::testing::Test {
+protected:
+  std::shared_ptr<BIBS::Scenario> scenario;
+  std::vector<double> activations;
+  std::vector<uint32_t> from;
+  std::vector<uint32_t> to;
+  bibs_scenario *cScenario = nullptr;
+
+  void SetUp() override {
+    scenario = std::make_shared<BIBS::Scenario>(
+        BIBS::testing::randomScenario(300, 3, 4, 5, false));
+    activations = BIBS::testing::randomActivations(*scenario);
+    for (uint32_t i = 0; i < scenario->nAgents; ++i) {
+      for (auto e = scenario->friendOffsets[i];
+           e < scenario->friendOffsets[i + 1]; ++e) {
+        from.push_back(i);
+        to.push_back(scenario->friends[e]);
+      }
+    }
+
+    ASSERT_EQ(bibs_scenario_create(
+                  300, 3, 4, scenario->beliefRelationships.data(),
+                  scenario->observedRelationships.data(),
+                  scenario->performingRelationships.data(),
+                  scenario->timeDeltas.data(), &cScenario),
+              BIBS_OK);
+    ASSERT_EQ(bibs_scenario_set_edges(cScenario, from.size(), from.data(),
+                                      to.data(),
+                                      scenario->friendWeights.data()),
+              BIBS_OK);
+  }
+
+  void TearDown() override { bibs_scenario_destroy(cScenario); }
+};
+
+TEST_F(BibsCTest, matchesVectorisedSimulation) {
+  bibs_simulation *sim = nullptr;
+  ASSERT_EQ(bibs_simulation_create(cScenario, activations.data(), nullptr, 5,
+                                   1, &sim),
+            BIBS_OK);
+  ASSERT_EQ(bibs_simulation_set_threads(sim, 3), BIBS_OK);
+  ASSERT_EQ(bibs_simulation_run(sim, 4), BIBS_OK);
+
+  BIBS::VectorisedSimulation expected(scenario, activations, {}, 5);
+  expected.run(4);
+
+  uint32_t t = 0;
+  ASSERT_EQ(bibs_simulation_time(sim, &t), BIBS_OK);
+  EXPECT_EQ(t, 4);
+
+  std::vector<double> a(300 * 3);
+  std::vector<uint32_t> p(300);
+  std::vector<double> shares(4);
+  for (uint32_t tick = 0; tick <= 4; ++tick) {
+    ASSERT_EQ(bibs_simulation_activations(sim, tick, a.data(), a.size()),
+              BIBS_OK);
+    ASSERT_EQ(bibs_simulation_performed(sim, tick, p.data(), p.size()),
+              BIBS_OK);
+    ASSERT_EQ(bibs_simulation_behaviour_shares(sim, tick, shares.data(),
+                                               shares.size()),
+              BIBS_OK);
+    EXPECT_EQ(a, expected.frame(tick).activations);
+    EXPECT_EQ(p, std::vector<uint32_t>(expected.frame(tick).performed.begin(),
+                                       expected.frame(tick).performed.end()));
+    EXPECT_EQ(shares, expected.behaviourShares(tick));
+  }
+
+  bibs_simulation_destroy(sim);
+}
+
+TEST_F(BibsCTest, scenarioChangesDoNotAffectSimulations) {
+  bibs_simulation *sim = nullptr;
+  ASSERT_EQ(bibs_simulation_create(cScenario, activations.data(), nullptr, 5,
+                                   1, &sim),
+            BIBS_OK);
+
+  std::vector<double> zeros(300 * 3, 0.0);
+  ASSERT_EQ(bibs_scenario_set_time_deltas(cScenario, zeros.data()), BIBS_OK);
+  ASSERT_EQ(bibs_scenario_set_edges(cScenario, 0, nullptr, nullptr, nullptr),
+            BIBS_OK);
+  ASSERT_EQ(bibs_simulation_run(sim, 2), BIBS_OK);
+
+  BIBS::VectorisedSimulation expected(scenario, activations, {}, 5);
+  expected.run(2);
+  std::vector<double> a(300 * 3);
+  ASSERT_EQ(bibs_simulation_activations(sim, 2, a.data(), a.size()),
+            BIBS_OK);
+  EXPECT_EQ(a, expected.frame(2).activations);
+
+  bibs_simulation_destroy(sim);
+}
+
+TEST_F(BibsCTest, errors) {
+  EXPECT_EQ(bibs_scenario_create(1, 1, 1, nullptr, nullptr, nullptr, nullptr,
+                                 nullptr),
+            BIBS_INVALID_ARGUMENT);
+  EXPECT_NE(std::string(bibs_last_error()), "");
+
+  uint32_t bad = 300;
+  double w = 1;
+  EXPECT_EQ(bibs_scenario_set_edges(cScenario, 1, &bad, &bad, &w),
+            BIBS_OUT_OF_RANGE);
+
+  bibs_simulation *sim = nullptr;
+  EXPECT_EQ(bibs_simulation_create(cScenario, nullptr, nullptr, 0, 1, &sim),
+            BIBS_INVALID_ARGUMENT);
+  ASSERT_EQ(bibs_simulation_create(cScenario, activations.data(), nullptr, 0,
+                                   0, &sim),
+            BIBS_OK);
+  EXPECT_EQ(std::string(bibs_last_error()), "");
+
+  std::vector<double> a(300 * 3);
+  EXPECT_EQ(bibs_simulation_activations(sim, 0, a.data(), a.size() - 1),
+            BIBS_INVALID_ARGUMENT);
+  EXPECT_EQ(bibs_simulation_activations(sim, 1, a.data(), a.size()),
+            BIBS_OUT_OF_RANGE);
+  ASSERT_EQ(bibs_simulation_run(sim, 3), BIBS_OK);
+  // Without history, only the latest tick is kept.
+  EXPECT_EQ(bibs_simulation_activations(sim, 2, a.data(), a.size()),
+            BIBS_OUT_OF_RANGE);
+  EXPECT_EQ(bibs_simulation_activations(sim, 3, a.data(), a.size()),
+            BIBS_OK);
+
+  bibs_simulation_destroy(sim);
+  bibs_simulation_destroy(nullptr);
+  bibs_scenario_destroy(nullptr);
+}
@@ -0,0 +1,126 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/blocksparse.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/vectorised.hpp"
+
+#include "scenario.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+std::vector<double> randomVectors(size_t n, unsigned seed) {
+  std::mt19937_64 eng(seed);
+  std::uniform_real_distribution<double> unit(-1.0, 1.0);
+  std::vector<double> x(n);
+  for (auto &v : x) {
+    v = unit(eng);
+  }
+  return x;
+}
+
+void expectNear(const std::vector<double> &a, const std::vector<double> &b) {
+  ASSERT_EQ(a.size(), b.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    EXPECT_NEAR(a[i], b[i], 1e-12) << "at " << i;
+  }
+}
+} // namespace
+
+TEST(BlockSparseMatrix, constructor) {
+  EXPECT_THROW(BIBS::BlockSparseMatrix(std::vector<double>(5), 2, 3, 2),
+               std::invalid_argument);
+  EXPECT_THROW(BIBS::BlockSparseMatrix(std::vector<double>(6), 2, 3, 0),
+               std::invalid_argument);
+
+  // Two of the four 2x2 blocks have a non-zero entry.
+  const std::vector<double> dense = {1, 0, 0, 0, //
+                                     0, 2, 0, 0, //
+                                     0, 0, 0, 0, //
+                                     0, 3, 0, 0};
+  BIBS::BlockSparseMatrix m(dense, 4, 4, 2);
+  EXPECT_EQ(m.getNRows(), 4);
+  EXPECT_EQ(m.getNColumns(), 4);
+  EXPECT_EQ(m.getBlockSize(), 2);
+  EXPECT_EQ(m.nBlocks(), 2);
+
+  BIBS::CsrMatrix csr(dense, 4, 4);
+  EXPECT_EQ(csr.nNonZeros(), 3);
+}
+
+TEST(BlockSparseMatrix, multiplyMatchesDense) {
+  // Block sizes with and without specialised kernels, and sizes which are
+  // not whole blocks.
+  for (const size_t n : {1, 7, 16, 37}) {
+    for (const size_t bs : {1, 3, 4, 8, 16}) {
+      const auto dense = BIBS::testing::clusteredRelationships(n, 5, n);
+      const size_t nVectors = 9;
+      const auto x = randomVectors(n * nVectors, 4);
+
+      std::vector<double> expected(n * nVectors);
+      BIBS::denseMultiply(dense.data(), n, n, x.data(), expected.data(),
+                          nVectors);
+
+      std::vector<double> y(n * nVectors, -1);
+      BIBS::BlockSparseMatrix(dense, n, n, bs).multiply(x.data(), y.data(),
+                                                        nVectors);
+      expectNear(y, expected);
+
+      std::fill(y.begin(), y.end(), -1);
+      BIBS::CsrMatrix(dense, n, n).multiply(x.data(), y.data(), nVectors);
+      expectNear(y, expected);
+    }
+  }
+}
+
+TEST(BlockSparseMatrix, rectangular) {
+  const std::vector<double> dense = {1, 2, 3, 4, 5, //
+                                     6, 7, 8, 9, 10};
+  const std::vector<double> x = {1, 0, 1, 0, 1, 0, 1, 0, 1, 0};
+  std::vector<double> y(4);
+  BIBS::BlockSparseMatrix(dense, 2, 5, 4).multiply(x.data(), y.data(), 2);
+  EXPECT_EQ(y, std::vector<double>({9, 24, 6, 16}));
+}
+
+TEST(BlockSparseMatrix, vectorisedSimulation) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(1000, 24, 3, 4, false));
+  s->beliefRelationships = BIBS::testing::clusteredRelationships(24, 6, 10);
+  const auto activations = BIBS::testing::randomActivations(*s);
+
+  BIBS::VectorisedSimulation dense(s, activations, {}, 3);
+  BIBS::VectorisedSimulation sparse(s, activations, {}, 3);
+  sparse.setBlockSparse(8);
+  dense.run(5);
+  sparse.run(5);
+
+  for (BIBS::sim_time_t t = 1; t <= 5; ++t) {
+    const auto &a = dense.frame(t).activations;
+    const auto &b = sparse.frame(t).activations;
+    for (size_t i = 0; i < a.size(); ++i) {
+      ASSERT_NEAR(a[i], b[i], 1e-9);
+    }
+  }
+
+  sparse.setBlockSparse(0);
+  sparse.run(1);
+  EXPECT_EQ(sparse.time(), 6);
+}
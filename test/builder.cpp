@@ -0,0 +1,170 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/builder.hpp"
+#include "bibs/agent.hpp"
+#include "bibs/belief.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+/**
+ * Builds a scenario whose friends are distinct, sorted, and near the agent.
+ */
+BIBS::Scenario buildScenario(size_t nAgents, BIBS::ThreadPool *threads) {
+  BIBS::ScenarioBuilder builder(nAgents, 3, 2, 17, threads);
+  builder.getScenario().beliefRelationships = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+  builder.setTimeDeltas(
+      [](BIBS::index_t, BIBS::AgentRandom &random, double *td) {
+        for (size_t b = 0; b < 3; ++b) {
+          td[b] = 0.5 + 0.5 * random.uniform();
+        }
+      });
+  builder.setFriends([nAgents](BIBS::index_t i, BIBS::AgentRandom &random,
+                               std::vector<BIBS::index_t> &friends,
+                               std::vector<double> &weights) {
+    std::uniform_int_distribution<size_t> degree(0, 8);
+    for (size_t d = 1, n = degree(random); d <= n; ++d) {
+      friends.push_back(static_cast<BIBS::index_t>((i + d) % nAgents));
+      weights.push_back(random.uniform());
+    }
+    std::sort(friends.begin(), friends.end());
+  });
+  return builder.build();
+}
+} // namespace
+
+TEST(AgentRandom, deterministic) {
+  BIBS::AgentRandom a(1, 2, 3);
+  BIBS::AgentRandom b(1, 2, 3);
+  BIBS::AgentRandom c(1, 2, 4);
+  for (int n = 0; n < 100; ++n) {
+    const auto x = a();
+    EXPECT_EQ(x, b());
+    EXPECT_NE(x, c());
+  }
+  for (int n = 0; n < 1000; ++n) {
+    const double u = a.uniform();
+    EXPECT_GE(u, 0.0);
+    EXPECT_LT(u, 1.0);
+  }
+}
+
+TEST(ScenarioBuilder, independentOfThreads) {
+  const auto serial = buildScenario(10000, nullptr);
+  EXPECT_NO_THROW(serial.validate());
+  EXPECT_EQ(serial.beliefRelationships[4], 5);
+  EXPECT_GT(serial.nEdges(), 30000);
+  EXPECT_LT(serial.nEdges(), 50000);
+
+  for (size_t n : {1, 3, 8}) {
+    BIBS::ThreadPool threads(n);
+    const auto parallel = buildScenario(10000, &threads);
+    EXPECT_EQ(parallel.timeDeltas, serial.timeDeltas);
+    EXPECT_EQ(parallel.friendOffsets, serial.friendOffsets);
+    EXPECT_EQ(parallel.friends, serial.friends);
+    EXPECT_EQ(parallel.friendWeights, serial.friendWeights);
+
+    BIBS::ScenarioBuilder builder(10000, 3, 2, 17, &threads);
+    const auto fill = [](BIBS::index_t i, BIBS::AgentRandom &random,
+                         double *a) {
+      for (size_t b = 0; b < 3; ++b) {
+        a[b] = i + random.uniform();
+      }
+    };
+    BIBS::ScenarioBuilder serialBuilder(10000, 3, 2, 17);
+    EXPECT_EQ(builder.activations(fill), serialBuilder.activations(fill));
+  }
+}
+
+TEST(ScenarioBuilder, errors) {
+  BIBS::ThreadPool threads(4);
+  BIBS::ScenarioBuilder builder(5000, 1, 1, 0, &threads);
+  EXPECT_THROW(builder.setFriends([](BIBS::index_t i, BIBS::AgentRandom &,
+                                     std::vector<BIBS::index_t> &friends,
+                                     std::vector<double> &) {
+    friends.push_back(i);
+  }),
+               std::invalid_argument);
+  EXPECT_THROW(builder.setFriends([](BIBS::index_t i, BIBS::AgentRandom &,
+                                     std::vector<BIBS::index_t> &friends,
+                                     std::vector<double> &weights) {
+    friends.push_back(i == 4321 ? 5000 : i);
+    weights.push_back(1.0);
+  }),
+               std::out_of_range);
+
+  const auto s = builder.build();
+  EXPECT_EQ(s.nAgents, 5000);
+  EXPECT_EQ(s.nEdges(), 0);
+  EXPECT_EQ(builder.getScenario().nAgents, 0);
+}
+
+TEST(ScenarioBuilder, agents) {
+  const auto s = buildScenario(3000, nullptr);
+  BIBS::ScenarioBuilder builder(3000, 3, 2, 17);
+  const auto activations = builder.activations(
+      [](BIBS::index_t, BIBS::AgentRandom &random, double *a) {
+        for (size_t b = 0; b < 3; ++b) {
+          a[b] = random.uniform();
+        }
+      });
+  std::vector<std::unique_ptr<BIBS::Belief>> beliefs;
+  std::vector<const BIBS::IBelief *> constBeliefs;
+  for (size_t b = 0; b < 3; ++b) {
+    beliefs.push_back(std::make_unique<BIBS::Belief>("b" + std::to_string(b)));
+    constBeliefs.push_back(beliefs.back().get());
+  }
+  EXPECT_THROW(BIBS::ScenarioBuilder::agents(s, {}, constBeliefs),
+               std::invalid_argument);
+
+  BIBS::ThreadPool threads(4);
+  const auto serial =
+      BIBS::ScenarioBuilder::agents(s, activations, constBeliefs, 5);
+  const auto parallel =
+      BIBS::ScenarioBuilder::agents(s, activations, constBeliefs, 5, &threads);
+  ASSERT_EQ(parallel.size(), 3000);
+  std::vector<const BIBS::Agent *> agents;
+  for (size_t i = 0; i < 3000; ++i) {
+    EXPECT_EQ(parallel[i]->uuid, serial[i]->uuid);
+    EXPECT_EQ(parallel[i]->activation(0, constBeliefs[1]),
+              activations[i * 3 + 1]);
+    agents.push_back(parallel[i].get());
+  }
+  EXPECT_NE(parallel[0]->uuid, parallel[1]->uuid);
+
+  // The agents give back the scenario.
+  for (size_t b = 0; b < 3; ++b) {
+    for (size_t b2 = 0; b2 < 3; ++b2) {
+      beliefs[b]->setBeliefRelationship(beliefs[b2].get(),
+                                        s.beliefRelationships[b * 3 + b2]);
+    }
+  }
+  const auto back = BIBS::Scenario::fromAgents(agents, constBeliefs, {});
+  EXPECT_EQ(back.timeDeltas, s.timeDeltas);
+  EXPECT_EQ(back.friendOffsets, s.friendOffsets);
+  EXPECT_EQ(back.friends, s.friends);
+  EXPECT_EQ(back.friendWeights, s.friendWeights);
+}
@@ -0,0 +1,112 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/choice.hpp"
+#include "bibs/scenario.hpp"
+
+#include <cmath>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+/**
+ * The number of n uniforms, evenly spread over [0, 1), with which a policy
+ * chooses each behaviour for the same utilities.
+ */
+std::vector<size_t> counts(const BIBS::IChoicePolicy &policy,
+                           const std::vector<double> &row, size_t n) {
+  const size_t nK = row.size();
+  std::vector<double> utilities;
+  std::vector<double> uniforms(n);
+  for (size_t i = 0; i < n; ++i) {
+    utilities.insert(utilities.end(), row.begin(), row.end());
+    uniforms[i] = (i + 0.5) / n;
+  }
+  std::vector<BIBS::index_t> chosen(n);
+  policy.choose(utilities.data(), uniforms.data(), n, nK, chosen.data());
+
+  std::vector<size_t> result(nK, 0);
+  for (const auto k : chosen) {
+    ++result[k];
+  }
+  return result;
+}
+} // namespace
+
+TEST(ArgmaxPolicy, choose) {
+  const BIBS::ArgmaxPolicy policy;
+  const double utilities[] = {1, 3, 2, -1, -2, -1, 5, 5, 0};
+  const double uniforms[] = {0.1, 0.5, 0.9};
+  BIBS::index_t chosen[3];
+  policy.choose(utilities, uniforms, 3, 3, chosen);
+  EXPECT_EQ(chosen[0], 1);
+  EXPECT_EQ(chosen[1], 0);
+  EXPECT_EQ(chosen[2], 0);
+}
+
+TEST(ProportionalPolicy, choose) {
+  const BIBS::ProportionalPolicy policy;
+
+  // At most one positive utility: the greatest.
+  EXPECT_EQ(counts(policy, {-1, 2, -3}, 10),
+            std::vector<size_t>({0, 10, 0}));
+  EXPECT_EQ(counts(policy, {-3, -1, -2}, 10),
+            std::vector<size_t>({0, 10, 0}));
+
+  // Otherwise in proportion to the positive utilities.
+  EXPECT_EQ(counts(policy, {1, -5, 3}, 1000),
+            std::vector<size_t>({250, 0, 750}));
+}
+
+TEST(ProportionalPolicy, needsUniform) {
+  const double one[] = {-1, 2, -3};
+  const double none[] = {-3, -1, -2};
+  const double two[] = {1, -5, 3};
+  const BIBS::ProportionalPolicy proportional;
+  EXPECT_FALSE(proportional.needsUniform(one, 3));
+  EXPECT_FALSE(proportional.needsUniform(none, 3));
+  EXPECT_TRUE(proportional.needsUniform(two, 3));
+  EXPECT_FALSE(BIBS::ArgmaxPolicy().needsUniform(two, 3));
+  EXPECT_TRUE(BIBS::SoftmaxPolicy(1).needsUniform(one, 3));
+}
+
+TEST(SoftmaxPolicy, choose) {
+  EXPECT_THROW(BIBS::SoftmaxPolicy(0), std::invalid_argument);
+  EXPECT_THROW(BIBS::SoftmaxPolicy(-1), std::invalid_argument);
+
+  EXPECT_EQ(counts(BIBS::SoftmaxPolicy(1), {0, std::log(3.0)}, 1000),
+            std::vector<size_t>({250, 750}));
+
+  // Large utilities do not overflow, and a low temperature is greedy.
+  EXPECT_EQ(counts(BIBS::SoftmaxPolicy(1e-3), {1000, 1001, 999}, 100),
+            std::vector<size_t>({0, 100, 0}));
+}
+
+TEST(EpsilonGreedyPolicy, choose) {
+  EXPECT_THROW(BIBS::EpsilonGreedyPolicy(-0.1), std::invalid_argument);
+  EXPECT_THROW(BIBS::EpsilonGreedyPolicy(1.1), std::invalid_argument);
+
+  EXPECT_EQ(counts(BIBS::EpsilonGreedyPolicy(0), {1, 3, 2, 0}, 100),
+            std::vector<size_t>({0, 100, 0, 0}));
+
+  // 20% explore uniformly; the rest take the greatest.
+  EXPECT_EQ(counts(BIBS::EpsilonGreedyPolicy(0.2), {1, 3, 2, 0}, 1000),
+            std::vector<size_t>({50, 850, 50, 50}));
+  EXPECT_EQ(counts(BIBS::EpsilonGreedyPolicy(1), {1, 3, 2, 0}, 1000),
+            std::vector<size_t>(4, 250));
+}
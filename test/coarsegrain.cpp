@@ -0,0 +1,177 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/coarsegrain.hpp"
+#include "bibs/agent.hpp"
+#include "bibs/behaviour.hpp"
+#include "bibs/belief.hpp"
+#include "bibs/bibs.hpp"
+
+#include <gtest/gtest.h>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+class CoarseGrainTest : public ::testing::Test {
+protected:
+  BIBS::Belief b1{"b1"};
+  BIBS::Behaviour beh1{"beh1"};
+  BIBS::Behaviour beh2{"beh2"};
+  std::vector<std::unique_ptr<BIBS::Agent>> agents;
+  std::vector<const BIBS::Agent *> constAgents;
+
+  void SetUp() override {
+    b1.setBeliefRelationship(&b1, 0.1);
+    b1.setObservedBehaviourRelationship(&beh1, 0.5);
+    b1.setObservedBehaviourRelationship(&beh2, 0.0);
+    b1.setPerformingBehaviourRelationship(&beh1, 1.0);
+    b1.setPerformingBehaviourRelationship(&beh2, -1.0);
+  }
+
+  /**
+   * Two triangles, {0, 1, 2} and {3, 4, 5}, joined by weak edges. Within a
+   * triangle the agents are identical.
+   */
+  void makeTriangles() {
+    for (size_t i = 0; i < 6; ++i) {
+      agents.push_back(std::make_unique<BIBS::Agent>(
+          std::map<BIBS::sim_time_t, std::map<const BIBS::IBelief *, double>>{
+              {0, {{&b1, i < 3 ? 1.0 : 0.2}}}}));
+      agents.back()->setTimeDelta(&b1, i < 3 ? 0.5 : 0.9);
+      constAgents.push_back(agents.back().get());
+    }
+    for (size_t i = 0; i < 6; ++i) {
+      for (size_t j = 0; j < 6; ++j) {
+        if (i == j) {
+          continue;
+        }
+        const bool same = (i < 3) == (j < 3);
+        agents[i]->setFriendWeight(agents[j].get(), same ? 1.0 : 0.1);
+      }
+    }
+  }
+
+  /**
+   * Run the original agents as an agent-based simulation.
+   */
+  void runAgents(BIBS::sim_time_t nDays) {
+    for (auto &a : agents) {
+      a->perform(0, {&beh1, &beh2});
+    }
+    for (BIBS::sim_time_t t = 1; t <= nDays; ++t) {
+      for (auto &a : agents) {
+        a->tick(t, {&beh1, &beh2}, {&b1});
+      }
+    }
+  }
+};
+
+TEST_F(CoarseGrainTest, detectCommunities) {
+  makeTriangles();
+
+  auto communities = BIBS::detectCommunities(constAgents);
+
+  std::vector<size_t> expected{0, 0, 0, 1, 1, 1};
+  EXPECT_EQ(communities, expected);
+}
+
+TEST_F(CoarseGrainTest, detectCommunitiesIsolated) {
+  makeTriangles();
+  BIBS::Agent lonely;
+  constAgents.push_back(&lonely);
+
+  auto communities = BIBS::detectCommunities(constAgents);
+
+  EXPECT_EQ(communities.back(), 2);
+}
+
+TEST_F(CoarseGrainTest, constructor) {
+  makeTriangles();
+
+  EXPECT_THROW(BIBS::CoarseGrainedSimulation(constAgents, {&b1},
+                                             {&beh1, &beh2}, {0, 1}),
+               std::invalid_argument);
+
+  BIBS::CoarseGrainedSimulation sim(constAgents, {&b1}, {&beh1, &beh2},
+                                    {0, 0, 0, 1, 1, 1});
+  const auto &mf = sim.getMeanField();
+
+  EXPECT_EQ(sim.nCommunities(), 2);
+  EXPECT_EQ(sim.time(), 0);
+  EXPECT_EQ(mf.cohortSize(0), 3);
+  EXPECT_DOUBLE_EQ(mf.activationMean(0, 0, &b1), 1.0);
+  EXPECT_DOUBLE_EQ(mf.activationMean(0, 1, &b1), 0.2);
+  EXPECT_NEAR(mf.activationVariance(0, 1, &b1), 0.0, 1e-15);
+  EXPECT_DOUBLE_EQ(mf.contact(0, 0), 2.0);
+  EXPECT_DOUBLE_EQ(mf.contact(0, 1), 0.3);
+  EXPECT_FALSE(sim.isRefined(0));
+  EXPECT_THROW(sim.refinedAgent(constAgents[0]), std::out_of_range);
+}
+
+TEST_F(CoarseGrainTest, coarseMatchesAgents) {
+  makeTriangles();
+  BIBS::CoarseGrainedSimulation sim(constAgents, {&b1}, {&beh1, &beh2},
+                                    {0, 0, 0, 1, 1, 1});
+
+  sim.run(5);
+  runAgents(5);
+
+  EXPECT_EQ(sim.time(), 5);
+  for (BIBS::sim_time_t t = 0; t <= 5; ++t) {
+    EXPECT_NEAR(sim.getMeanField().activationMean(t, 0, &b1),
+                agents[0]->activation(t, &b1), 1e-12);
+    EXPECT_NEAR(sim.getMeanField().activationMean(t, 1, &b1),
+                agents[3]->activation(t, &b1), 1e-12);
+    EXPECT_DOUBLE_EQ(sim.behaviourShare(t, 0, &beh1), 1.0);
+  }
+}
+
+TEST_F(CoarseGrainTest, refinedMatchesAgents) {
+  makeTriangles();
+  BIBS::CoarseGrainedSimulation sim(constAgents, {&b1}, {&beh1, &beh2},
+                                    {0, 0, 0, 1, 1, 1});
+
+  sim.refine(0);
+  EXPECT_TRUE(sim.isRefined(0));
+  EXPECT_FALSE(sim.isRefined(1));
+
+  const auto *r = sim.refinedAgent(constAgents[1]);
+  EXPECT_EQ(r->uuid, constAgents[1]->uuid);
+  EXPECT_DOUBLE_EQ(r->communityWeight(1), 0.3);
+  EXPECT_DOUBLE_EQ(r->communityWeight(0), 0.0);
+  EXPECT_DOUBLE_EQ(r->friendWeight(sim.refinedAgent(constAgents[0])), 1.0);
+
+  sim.run(3);
+  sim.refine(1);
+
+  EXPECT_DOUBLE_EQ(r->communityWeight(1), 0.0);
+  EXPECT_DOUBLE_EQ(r->friendWeight(sim.refinedAgent(constAgents[3])), 0.1);
+
+  sim.run(2);
+  runAgents(5);
+
+  for (size_t i = 0; i < 3; ++i) {
+    const auto *refined = sim.refinedAgent(constAgents[i]);
+    for (BIBS::sim_time_t t = 0; t <= 5; ++t) {
+      EXPECT_NEAR(refined->activation(t, &b1), agents[i]->activation(t, &b1),
+                  1e-12);
+    }
+  }
+  EXPECT_NEAR(sim.refinedAgent(constAgents[4])->activation(5, &b1),
+              agents[4]->activation(5, &b1), 1e-12);
+}
@@ -0,0 +1,316 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/digest.hpp"
+#include "bibs/choice.hpp"
+#include "bibs/exogenous.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/vectorised.hpp"
+
+#include "scenario.hpp"
+#include <cstdio>
+#include <functional>
+#include <gtest/gtest.h>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+/**
+ * An engine under differential test.
+ */
+struct Engine {
+  std::string name;
+  /**
+   * Advances the engine by one tick.
+   */
+  std::function<void()> step;
+  /**
+   * The digest of the current state.
+   */
+  std::function<uint64_t()> digest;
+  /**
+   * The digest of each agent of the current state.
+   */
+  std::function<std::vector<uint64_t>()> agentDigests;
+};
+
+/**
+ * Where two engines first diverge.
+ */
+struct Divergence {
+  BIBS::sim_time_t t;
+  /**
+   * The first agent which differs, or the number of agents if the agents
+   * match but the digests do not.
+   */
+  size_t agent;
+};
+
+std::ostream &operator<<(std::ostream &os, const Divergence &d) {
+  return os << "tick " << d.t << ", agent " << d.agent;
+}
+
+/**
+ * Runs two engines side by side, comparing their digests after each tick,
+ * and the digests of their agents if they differ.
+ */
+std::optional<Divergence> firstDivergence(Engine &a, Engine &b,
+                                          BIBS::sim_time_t nTicks) {
+  for (BIBS::sim_time_t t = 0;; ++t) {
+    if (a.digest() != b.digest()) {
+      const auto da = a.agentDigests();
+      const auto db = b.agentDigests();
+      size_t i = 0;
+      while (i < da.size() && i < db.size() && da[i] == db[i]) {
+        ++i;
+      }
+      return Divergence{t, i};
+    }
+    if (t == nTicks) {
+      return std::nullopt;
+    }
+    a.step();
+    b.step();
+  }
+}
+
+/**
+ * Checks that engines agree, reporting where they first diverge.
+ */
+::testing::AssertionResult agree(Engine &a, Engine &b,
+                                 BIBS::sim_time_t nTicks) {
+  const auto d = firstDivergence(a, b, nTicks);
+  if (!d) {
+    return ::testing::AssertionSuccess();
+  }
+  return ::testing::AssertionFailure()
+         << a.name << " and " << b.name << " diverge at " << *d;
+}
+
+Engine vectorised(const std::string &name, BIBS::VectorisedSimulation &sim) {
+  return {name, [&sim] { sim.run(1); },
+          [&sim] { return sim.current().digest; },
+          [&sim] {
+            const auto &f = sim.current();
+            return BIBS::agentDigests(f.activations, f.performed,
+                                      sim.getScenario().nBeliefs);
+          }};
+}
+
+Engine agents(const std::string &name, BIBS::testing::ScenarioObjects &o) {
+  auto t = std::make_shared<BIBS::sim_time_t>(0);
+  for (auto &a : o.agents) {
+    a->perform(0, o.constBehaviours);
+  }
+  auto state = [&o, t] {
+    return std::make_pair(
+        BIBS::activationsOf(o.constIAgents, o.constBeliefs, *t),
+        BIBS::performedOf(o.constIAgents, o.constBehaviours, *t));
+  };
+  return {name,
+          [&o, t] {
+            ++*t;
+            for (auto &a : o.agents) {
+              a->tick(*t, o.constBehaviours, o.constBeliefs);
+            }
+          },
+          [&o, state] {
+            const auto s = state();
+            return BIBS::stateDigest(s.first, s.second, o.beliefs.size(), 0,
+                                     s.second.size());
+          },
+          [&o, state] {
+            const auto s = state();
+            return BIBS::agentDigests(s.first, s.second, o.beliefs.size());
+          }};
+}
+} // namespace
+
+TEST(Digest, agentDigest) {
+  const double a[] = {0.25, -1.5};
+  const double close[] = {0.25 + 1e-15, -1.5 - 1e-15};
+  const double far[] = {0.25 + 1e-6, -1.5};
+  const double zero[] = {0.0};
+  const double negativeZero[] = {-0.0};
+
+  EXPECT_EQ(BIBS::agentDigest(3, 1, a, 2), BIBS::agentDigest(3, 1, close, 2));
+  EXPECT_NE(BIBS::agentDigest(3, 1, a, 2), BIBS::agentDigest(3, 1, far, 2));
+  EXPECT_NE(BIBS::agentDigest(3, 1, a, 2), BIBS::agentDigest(3, 0, a, 2));
+  EXPECT_NE(BIBS::agentDigest(3, 1, a, 2), BIBS::agentDigest(2, 1, a, 2));
+  EXPECT_EQ(BIBS::agentDigest(0, 0, zero, 1),
+            BIBS::agentDigest(0, 0, negativeZero, 1));
+  // A coarser quantum hides larger differences.
+  EXPECT_EQ(BIBS::agentDigest(3, 1, a, 2, 1e-3),
+            BIBS::agentDigest(3, 1, far, 2, 1e-3));
+}
+
+TEST(Digest, stateDigest) {
+  const auto s = BIBS::testing::randomScenario(1000, 3, 3, 4, false);
+  const auto activations = BIBS::testing::randomActivations(s);
+  std::vector<BIBS::index_t> performed(1000);
+  for (size_t i = 0; i < performed.size(); ++i) {
+    performed[i] = i % 3;
+  }
+
+  const auto digests = BIBS::agentDigests(activations, performed, 3);
+  uint64_t sum = 0;
+  for (auto d : digests) {
+    sum += d;
+  }
+  const auto whole = BIBS::stateDigest(activations, performed, 3, 0, 1000);
+
+  EXPECT_EQ(whole, sum);
+  EXPECT_EQ(whole, BIBS::stateDigest(activations, performed, 3, 0, 317) +
+                       BIBS::stateDigest(activations, performed, 3, 317,
+                                         1000));
+  EXPECT_THROW(BIBS::agentDigests(activations, performed, 2),
+               std::invalid_argument);
+}
+
+TEST(Digest, vectorisedSimulation) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(1000, 3, 3, 4, false));
+  BIBS::ThreadPool threads(4);
+  BIBS::VectorisedSimulation sim(s, BIBS::testing::randomActivations(*s), {},
+                                 1, true, nullptr, &threads);
+
+  sim.run(3);
+
+  for (BIBS::sim_time_t t = 0; t <= 3; ++t) {
+    const auto &f = sim.frame(t);
+    EXPECT_EQ(sim.digest(t),
+              BIBS::stateDigest(f.activations, f.performed, 3, 0, 1000));
+  }
+  EXPECT_NE(sim.digest(2), sim.digest(3));
+  EXPECT_THROW(sim.digest(4), std::out_of_range);
+}
+
+TEST(Differential, agentsMatchVectorised) {
+  const uint64_t seed = 7;
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(2000, 3, 4, 5, false));
+  const auto activations = BIBS::testing::randomActivations(*s);
+  BIBS::testing::ScenarioObjects o(*s, activations, seed);
+  BIBS::VectorisedSimulation sim(s, activations, {}, seed, false);
+
+  auto a = agents("Agent", o);
+  auto v = vectorised("VectorisedSimulation", sim);
+
+  EXPECT_TRUE(agree(a, v, 10));
+}
+
+TEST(Differential, agentsMatchVectorisedWithPolicies) {
+  const uint64_t seed = 11;
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(1000, 3, 4, 5, false));
+  const auto activations = BIBS::testing::randomActivations(*s);
+
+  const std::vector<std::shared_ptr<const BIBS::IChoicePolicy>> policies = {
+      std::make_shared<BIBS::ArgmaxPolicy>(),
+      std::make_shared<BIBS::SoftmaxPolicy>(0.5),
+      std::make_shared<BIBS::EpsilonGreedyPolicy>(0.2)};
+  for (const auto &policy : policies) {
+    BIBS::testing::ScenarioObjects o(*s, activations, seed);
+    for (auto &agent : o.agents) {
+      agent->setChoicePolicy(policy);
+    }
+    auto a = agents("Agent", o);
+
+    // The policy applies from the next frame, so the first is given.
+    BIBS::VectorisedSimulation sim(
+        s, activations, BIBS::performedOf(o.constIAgents, o.constBehaviours, 0),
+        seed, false);
+    sim.setChoicePolicy(policy);
+    auto v = vectorised("VectorisedSimulation", sim);
+
+    EXPECT_TRUE(agree(a, v, 10));
+  }
+}
+
+TEST(Differential, agentsMatchVectorisedWithExogenousInput) {
+  const uint64_t seed = 11;
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(1000, 3, 4, 5, false));
+  const auto activations = BIBS::testing::randomActivations(*s);
+
+  const std::string path = ::testing::TempDir() + "bibs-differential-exog";
+  std::vector<double> values;
+  for (int t = 0; t <= 10; ++t) {
+    values.push_back(0.3 * (t % 3));
+    values.push_back(-0.2 * (t % 2));
+  }
+  BIBS::ExogenousInput::write(path, {3, 1}, values);
+  auto input = std::make_shared<const BIBS::ExogenousInput>(path);
+
+  BIBS::testing::ScenarioObjects o(*s, activations, seed);
+  const auto indices = BIBS::Agent::indexBehaviours(o.constBehaviours);
+  for (auto &agent : o.agents) {
+    agent->setExogenousInput(input, indices);
+  }
+  auto a = agents("Agent", o);
+
+  // The input applies from the next frame, so the first is given.
+  BIBS::VectorisedSimulation sim(
+      s, activations, BIBS::performedOf(o.constIAgents, o.constBehaviours, 0),
+      seed, false);
+  sim.setExogenousInput(input);
+  auto v = vectorised("VectorisedSimulation", sim);
+
+  EXPECT_TRUE(agree(a, v, 10));
+  std::remove(path.c_str());
+}
+
+TEST(Differential, threadsMatchAtScale) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(100000, 3, 4, 8, false));
+  const auto activations = BIBS::testing::randomActivations(*s);
+  BIBS::ThreadPool threads(8);
+  BIBS::VectorisedSimulation one(s, activations, {}, 3, false);
+  BIBS::VectorisedSimulation many(s, activations, {}, 3, false, nullptr,
+                                  &threads);
+
+  auto a = vectorised("1 thread", one);
+  auto b = vectorised("8 threads", many);
+
+  EXPECT_TRUE(agree(a, b, 20));
+}
+
+TEST(Differential, reportsDivergence) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(1000, 3, 4, 5, false));
+  auto activations = BIBS::testing::randomActivations(*s);
+  BIBS::VectorisedSimulation original(s, activations, {}, 3, false);
+  activations[123 * 3 + 1] += 1e-3;
+  BIBS::VectorisedSimulation perturbed(s, activations, {}, 3, false);
+
+  auto a = vectorised("original", original);
+  auto b = vectorised("perturbed", perturbed);
+  const auto d = firstDivergence(a, b, 5);
+
+  ASSERT_TRUE(d);
+  EXPECT_EQ(d->t, 0);
+  EXPECT_EQ(d->agent, 123);
+
+  BIBS::VectorisedSimulation reseeded(s, activations, {}, 4, false);
+  auto c = vectorised("reseeded", reseeded);
+  EXPECT_FALSE(agree(b, c, 5));
+}
@@ -0,0 +1,220 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/ensemble.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/vectorised.hpp"
+
+#include "scenario.hpp"
+#include <cmath>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+/**
+ * The share of agents performing behaviour 0 now.
+ */
+double shareNow(const BIBS::VectorisedSimulation &sim) {
+  return sim.behaviourShares(sim.time())[0];
+}
+
+/**
+ * The share of agents performing behaviour 0 at the end of the run.
+ */
+const BIBS::Ensemble::Metric share = BIBS::Ensemble::atEnd(shareNow);
+
+/**
+ * A random scenario of two behaviours, in which behaviour 0 is made more
+ * attractive by shift.
+ */
+std::shared_ptr<const BIBS::Scenario> scenario(double shift = 0.0) {
+  auto s = BIBS::testing::randomScenario(200, 3, 2, 4, false);
+  for (size_t b = 0; b < s.nBeliefs; ++b) {
+    s.performingRelationships[b * s.nBehaviours] += shift;
+  }
+  return std::make_shared<const BIBS::Scenario>(std::move(s));
+}
+} // namespace
+
+TEST(Ensemble, constructor) {
+  const auto s = scenario();
+  const auto activations = BIBS::testing::randomActivations(*s);
+  EXPECT_THROW(BIBS::Ensemble({}, activations, share, 2),
+               std::invalid_argument);
+  EXPECT_THROW(BIBS::Ensemble({s}, activations, nullptr, 2),
+               std::invalid_argument);
+  const auto other = std::make_shared<const BIBS::Scenario>(
+      BIBS::testing::randomScenario(200, 3, 3, 4, false));
+  EXPECT_THROW(BIBS::Ensemble({s, other}, activations, share, 2),
+               std::invalid_argument);
+
+  BIBS::Ensemble e({s}, activations, share, 2, 7,
+                   BIBS::Ensemble::Sampling::antithetic);
+  EXPECT_EQ(e.nArms(), 1);
+  EXPECT_EQ(e.nReplicates(), 0);
+  EXPECT_THROW(e.run(3), std::invalid_argument);
+  EXPECT_TRUE(std::isinf(e.summary(0).standardError));
+  e.run(2);
+  EXPECT_TRUE(std::isinf(e.summary(0).standardError));
+  EXPECT_THROW(e.summary(1), std::out_of_range);
+}
+
+TEST(Ensemble, deterministic) {
+  const auto s = scenario();
+  const auto activations = BIBS::testing::randomActivations(*s);
+  BIBS::ThreadPool threads(3);
+
+  BIBS::Ensemble serial({s, scenario(0.2)}, activations, share, 3, 7,
+                        BIBS::Ensemble::Sampling::antithetic);
+  serial.run(8);
+  BIBS::Ensemble parallel({s, scenario(0.2)}, activations, share, 3, 7,
+                          BIBS::Ensemble::Sampling::antithetic, true,
+                          &threads);
+  parallel.run(2);
+  parallel.run(6);
+  EXPECT_EQ(serial.getValues(0), parallel.getValues(0));
+  EXPECT_EQ(serial.getValues(1), parallel.getValues(1));
+
+  // An antithetic replicate is the original with complemented uniforms.
+  BIBS::VectorisedSimulation sim(s, activations, {}, 7, false);
+  sim.setStream(1);
+  sim.setAntithetic(true);
+  EXPECT_TRUE(sim.isAntithetic());
+  sim.run(3);
+  EXPECT_EQ(shareNow(sim), serial.getValues(0)[3]);
+}
+
+TEST(Ensemble, metrics) {
+  const auto s = scenario(0.1);
+  const auto activations = BIBS::testing::randomActivations(*s);
+  BIBS::Ensemble e({s}, activations,
+                   {BIBS::Ensemble::finalShare(0), BIBS::Ensemble::peakTime(0),
+                    BIBS::Ensemble::peakTime(1)},
+                   6, 11);
+  e.run(3);
+
+  // The metrics, accumulated as each replicate runs, match its history.
+  for (size_t r = 0; r < 3; ++r) {
+    BIBS::VectorisedSimulation sim(s, activations, {}, 11);
+    sim.setStream(r);
+    sim.run(6);
+    EXPECT_EQ(e.getValues(0, 0)[r], shareNow(sim));
+    for (BIBS::index_t k = 0; k < 2; ++k) {
+      BIBS::sim_time_t peak = 0;
+      for (BIBS::sim_time_t t = 1; t <= 6; ++t) {
+        if (sim.behaviourShares(t)[k] > sim.behaviourShares(peak)[k]) {
+          peak = t;
+        }
+      }
+      EXPECT_EQ(e.getValues(0, 1 + k)[r], peak);
+    }
+  }
+}
+
+TEST(Ensemble, antithetic) {
+  const auto s = scenario();
+  const auto activations = BIBS::testing::randomActivations(*s);
+
+  BIBS::Ensemble independent({s}, activations, share, 1, 3);
+  independent.run(64);
+  const auto i = independent.summary(0);
+  EXPECT_EQ(i.nReplicates, 64);
+  EXPECT_DOUBLE_EQ(i.effectiveSampleSize, 64);
+
+  BIBS::Ensemble antithetic({s}, activations, share, 1, 3,
+                            BIBS::Ensemble::Sampling::antithetic);
+  antithetic.run(64);
+  const auto a = antithetic.summary(0);
+  EXPECT_NEAR(a.mean, i.mean, 4 * i.standardError);
+  EXPECT_GT(a.effectiveSampleSize, 2 * 64);
+  EXPECT_LT(a.standardError, i.standardError);
+  EXPECT_LT(a.replicatesFor(a.halfWidth()), 66);
+  EXPECT_EQ(a.unitSize, 2);
+  EXPECT_EQ(a.replicatesFor(a.halfWidth() / 3) % 2, 0);
+  EXPECT_THROW(a.replicatesFor(0), std::invalid_argument);
+}
+
+TEST(Ensemble, commonRandomNumbers) {
+  const auto a = scenario();
+  const auto b = scenario(0.05);
+  const auto activations = BIBS::testing::randomActivations(*a);
+
+  BIBS::Ensemble common({a, b, a}, activations, share, 3, 5);
+  common.run(32);
+  const auto d = common.difference(1, 0);
+  EXPECT_GT(d.mean, 0);
+  EXPECT_GT(d.effectiveSampleSize, 4 * 32);
+
+  // Identical arms with common random numbers do not differ at all.
+  EXPECT_EQ(common.getValues(0), common.getValues(2));
+  EXPECT_EQ(common.difference(0, 2).standardError, 0);
+
+  BIBS::Ensemble independent({a, b, a}, activations, share, 3, 5,
+                             BIBS::Ensemble::Sampling::independent, false);
+  independent.run(32);
+  EXPECT_NE(independent.getValues(0), independent.getValues(2));
+  EXPECT_LT(independent.difference(1, 0).effectiveSampleSize, 2 * 32);
+  EXPECT_GT(independent.difference(1, 0).standardError, d.standardError);
+}
+
+TEST(Ensemble, runUntil) {
+  const auto s = scenario();
+  const auto activations = BIBS::testing::randomActivations(*s);
+  BIBS::ThreadPool threads(2);
+  const std::vector<BIBS::Ensemble::Metric> metrics{
+      BIBS::Ensemble::finalShare(0), BIBS::Ensemble::peakTime(0)};
+
+  BIBS::Ensemble e({s}, activations, metrics, 4, 9,
+                   BIBS::Ensemble::Sampling::independent, true, &threads);
+  EXPECT_EQ(e.nMetrics(), 2);
+  EXPECT_THROW(e.runUntil({}, 4), std::invalid_argument);
+  EXPECT_THROW(e.runUntil({{0, 0, 0.01}}, 0), std::invalid_argument);
+  EXPECT_THROW(e.runUntil({{0, 0, 0.0}}, 4), std::invalid_argument);
+  EXPECT_THROW(e.runUntil({{0, 2, 0.01}}, 4), std::out_of_range);
+  EXPECT_THROW(e.runUntil({{1, 0, 0.01}}, 4), std::out_of_range);
+  EXPECT_EQ(e.nReplicates(), 0);
+
+  // Too few replicates are allowed.
+  EXPECT_FALSE(e.runUntil({{0, 0, 0.001}}, 4, 10));
+  EXPECT_EQ(e.nReplicates(), 10);
+
+  const std::vector<BIBS::EnsembleTarget> targets{{0, 0, 0.01},
+                                                  {0, 1, 0.5}};
+  EXPECT_TRUE(e.runUntil(targets, 4));
+  EXPECT_TRUE(e.met(targets));
+  EXPECT_LE(e.summary(0, 0).halfWidth(), 0.01);
+  EXPECT_LE(e.summary(0, 1).halfWidth(), 0.5);
+  for (double t : e.getValues(0, 1)) {
+    EXPECT_GE(t, 0);
+    EXPECT_LE(t, 4);
+  }
+
+  // A met target runs nothing more.
+  const size_t n = e.nReplicates();
+  EXPECT_TRUE(e.runUntil(targets, 4));
+  EXPECT_EQ(e.nReplicates(), n);
+
+  // Antithetic pairs need fewer replicates for the same target.
+  BIBS::Ensemble a({s}, activations, metrics, 4, 9,
+                   BIBS::Ensemble::Sampling::antithetic, true, &threads);
+  EXPECT_TRUE(a.runUntil({{0, 0, 0.01}}, 3));
+  EXPECT_EQ(a.nReplicates() % 4, 0);
+  EXPECT_LT(a.nReplicates(), e.summary(0, 0).replicatesFor(0.01));
+}
@@ -0,0 +1,114 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/exogenous.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/vectorised.hpp"
+
+#include "scenario.hpp"
+#include "temp.hpp"
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+TEST(ExogenousInput, roundTrip) {
+  const std::string path = BIBS::testing::tempPath("exogenous");
+  // Behaviours 2 and 0, for 3 ticks.
+  BIBS::ExogenousInput::write(path, {2, 0}, {1, 2, 3, 4, 5, 6});
+  BIBS::ExogenousInput input(path);
+  EXPECT_EQ(input.getNTicks(), 3);
+  EXPECT_EQ(input.nColumns(), 2);
+  EXPECT_EQ(input.getBehaviours(), std::vector<BIBS::index_t>({2, 0}));
+  EXPECT_EQ(input.row(1)[0], 3);
+  EXPECT_EQ(input.row(1)[1], 4);
+  EXPECT_EQ(input.impetus(2, 2), 5);
+  EXPECT_EQ(input.impetus(2, 0), 6);
+  EXPECT_EQ(input.impetus(2, 1), 0);
+  EXPECT_EQ(input.impetus(2, 7), 0);
+  EXPECT_THROW(input.row(3), std::out_of_range);
+  EXPECT_THROW(input.impetus(3, 0), std::out_of_range);
+  input.prefetch(0);
+  input.prefetch(5);
+
+  // Every agent's utilities get the tick's values.
+  std::vector<double> utilities(2 * 3, 1.0);
+  input.apply(0, utilities.data(), 2, 3);
+  EXPECT_EQ(utilities, std::vector<double>({3, 1, 2, 3, 1, 2}));
+  EXPECT_THROW(input.apply(0, utilities.data(), 2, 2), std::out_of_range);
+  std::remove(path.c_str());
+}
+
+TEST(ExogenousInput, errors) {
+  EXPECT_THROW(BIBS::ExogenousInput("/nonexistent/bibs-exogenous"),
+               std::system_error);
+
+  const std::string path = BIBS::testing::tempPath("not-exogenous");
+  EXPECT_THROW(BIBS::ExogenousInput::write(path, {0, 1}, {1, 2, 3}),
+               std::invalid_argument);
+  EXPECT_THROW(BIBS::ExogenousInput::write(path, {1, 1}, {1, 2}),
+               std::invalid_argument);
+
+  std::FILE *f = std::fopen(path.c_str(), "w");
+  std::fputs("not an exogenous input file", f);
+  std::fclose(f);
+  EXPECT_THROW(BIBS::ExogenousInput{path}, std::runtime_error);
+
+  // A file cut short of its last tick.
+  BIBS::ExogenousInput::write(path, {0}, {1, 2, 3});
+  ASSERT_EQ(truncate(path.c_str(), 24 + 8 + 2 * 8 + 4), 0);
+  EXPECT_THROW(BIBS::ExogenousInput{path}, std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(ExogenousInput, vectorisedSimulation) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(500, 3, 3, 4, true));
+  const auto activations = BIBS::testing::randomActivations(*s);
+
+  // Behaviour 2 is pushed far ahead of the others at time 2 only.
+  const std::string path = BIBS::testing::tempPath("exogenous-simulation");
+  BIBS::ExogenousInput::write(path, {2}, {0, 0, 1e9, 0});
+  auto input = std::make_shared<const BIBS::ExogenousInput>(path);
+  BIBS::ExogenousInput::write(path + "-wide", {3}, {0});
+  auto wide = std::make_shared<const BIBS::ExogenousInput>(path + "-wide");
+
+  for (bool incremental : {false, true}) {
+    BIBS::VectorisedSimulation sim(s, activations, {}, 3);
+    if (incremental) {
+      sim.setIncremental(0.0, 2);
+    }
+    EXPECT_THROW(sim.setExogenousInput(wide), std::invalid_argument);
+    sim.setExogenousInput(input);
+    sim.run(3);
+    for (BIBS::sim_time_t t = 1; t <= 3; ++t) {
+      EXPECT_EQ(sim.behaviourShares(t)[t == 2 ? 2 : 0], 1.0) << t;
+    }
+    EXPECT_THROW(sim.run(1), std::out_of_range);
+    EXPECT_EQ(sim.time(), 3);
+
+    sim.setExogenousInput(nullptr);
+    sim.run(1);
+    EXPECT_EQ(sim.behaviourShares(4)[0], 1.0);
+  }
+  std::remove(path.c_str());
+  std::remove((path + "-wide").c_str());
+}
@@ -0,0 +1,165 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/fileoutput.hpp"
+#include "bibs/output.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/vectorised.hpp"
+
+#include "scenario.hpp"
+#include "temp.hpp"
+#include <cstdio>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace {
+/**
+ * Writes ticks large enough to span several buffers, and reads them back.
+ */
+void roundTrip(const BIBS::FileHistorySink::Options &options,
+               const std::string &name) {
+  const std::string path = BIBS::testing::tempPath(name);
+  const size_t nAgents = 1000;
+  const size_t nBeliefs = 3;
+  std::vector<BIBS::MemoryHistorySink::Tick> expected;
+  {
+    BIBS::FileHistorySink sink(path, nAgents, nBeliefs, options);
+    for (BIBS::sim_time_t t = 0; t < 20; ++t) {
+      BIBS::MemoryHistorySink::Tick tick{t,
+                                         std::vector<double>(nAgents * 3),
+                                         std::vector<BIBS::index_t>(nAgents)};
+      for (size_t i = 0; i < tick.activations.size(); ++i) {
+        tick.activations[i] = t * 0.5 + i;
+      }
+      for (size_t i = 0; i < nAgents; ++i) {
+        tick.performed[i] = static_cast<BIBS::index_t>((t + i) % 4);
+      }
+      sink.write(tick.t, tick.activations, tick.performed);
+      expected.push_back(std::move(tick));
+    }
+    EXPECT_THROW(sink.write(20, {}, {}), std::invalid_argument);
+    sink.close();
+    EXPECT_THROW(sink.write(20, expected[0].activations,
+                            expected[0].performed),
+                 std::logic_error);
+  }
+
+  const auto ticks = BIBS::FileHistorySink::read(path);
+  ASSERT_EQ(ticks.size(), expected.size());
+  for (size_t t = 0; t < ticks.size(); ++t) {
+    EXPECT_EQ(ticks[t].t, expected[t].t);
+    EXPECT_EQ(ticks[t].activations, expected[t].activations);
+    EXPECT_EQ(ticks[t].performed, expected[t].performed);
+  }
+  std::remove(path.c_str());
+}
+} // namespace
+
+TEST(AlignedBuffers, constructor) {
+  EXPECT_THROW(BIBS::AlignedBuffers(0, 10), std::invalid_argument);
+  EXPECT_THROW(BIBS::AlignedBuffers(10, 0), std::invalid_argument);
+
+  BIBS::AlignedBuffers buffers(3, 5000);
+  EXPECT_EQ(buffers.size, 8192);
+  for (size_t i = 0; i < 3; ++i) {
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(buffers.get(i)) %
+                  BIBS::IWriteBackend::alignment,
+              0);
+    EXPECT_EQ(buffers.indexOf(buffers.get(i)), i);
+  }
+}
+
+TEST(FileHistorySink, pwrite) {
+  BIBS::FileHistorySink::Options options;
+  options.backend = BIBS::FileHistorySink::Backend::pwrite;
+  options.nBuffers = 2;
+  options.bufferSize = 8192;
+  roundTrip(options, "pwrite");
+
+  options.direct = true;
+  roundTrip(options, "pwrite-direct");
+}
+
+TEST(FileHistorySink, ioUring) {
+  if (!BIBS::IoUringBackend::available()) {
+    GTEST_SKIP() << "io_uring is not available";
+  }
+  BIBS::FileHistorySink::Options options;
+  options.backend = BIBS::FileHistorySink::Backend::ioUring;
+  options.nBuffers = 2;
+  options.bufferSize = 8192;
+  roundTrip(options, "io_uring");
+
+  options.direct = true;
+  roundTrip(options, "io_uring-direct");
+}
+
+TEST(FileHistorySink, automatic) {
+  const std::string path = BIBS::testing::tempPath("automatic");
+  BIBS::FileHistorySink sink(path, 1, 1);
+  EXPECT_STREQ(sink.backendName(),
+               BIBS::IoUringBackend::available() ? "io_uring" : "pwrite");
+  EXPECT_FALSE(sink.isDirect());
+  sink.close();
+  EXPECT_STREQ(sink.backendName(), "closed");
+  EXPECT_TRUE(BIBS::FileHistorySink::read(path).empty());
+  std::remove(path.c_str());
+}
+
+TEST(FileHistorySink, errors) {
+  EXPECT_THROW(BIBS::FileHistorySink("/nonexistent/bibs-history", 1, 1),
+               std::system_error);
+
+  const std::string path = BIBS::testing::tempPath("not-history");
+  std::FILE *f = std::fopen(path.c_str(), "w");
+  std::fputs("not a history file at all", f);
+  std::fclose(f);
+  EXPECT_THROW(BIBS::FileHistorySink::read(path), std::runtime_error);
+  std::remove(path.c_str());
+}
+
+TEST(FileHistorySink, historyWriter) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(5000, 3, 3, 4, false));
+  BIBS::ThreadPool threads(4);
+  const std::string path = BIBS::testing::tempPath("simulation");
+  BIBS::FileHistorySink::Options options;
+  options.bufferSize = 64 << 10;
+  BIBS::FileHistorySink sink(path, 5000, 3, options);
+  BIBS::HistoryWriter writer(5000, 3, sink, 100);
+  BIBS::VectorisedSimulation sim(s, BIBS::testing::randomActivations(*s), {},
+                                 1, true, nullptr, &threads);
+
+  sim.setHistoryWriter(&writer);
+  sim.run(5);
+  writer.flush();
+  sink.close();
+
+  const auto ticks = BIBS::FileHistorySink::read(path);
+  ASSERT_EQ(ticks.size(), 6);
+  for (BIBS::sim_time_t t = 0; t <= 5; ++t) {
+    EXPECT_EQ(ticks[t].t, t);
+    EXPECT_EQ(ticks[t].activations, sim.frame(t).activations);
+    EXPECT_EQ(ticks[t].performed, sim.frame(t).performed);
+  }
+  std::remove(path.c_str());
+}
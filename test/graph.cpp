@@ -0,0 +1,251 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/graph.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/vectorised.hpp"
+
+#include "scenario.hpp"
+#include <algorithm>
+#include <cmath>
+#include <gtest/gtest.h>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+/**
+ * The scenario with the friends of each agent sorted by index, as they are
+ * in a CompressedGraph.
+ */
+BIBS::Scenario sortedFriends(BIBS::Scenario s) {
+  for (size_t i = 0; i < s.nAgents; ++i) {
+    const auto begin = s.friendOffsets[i];
+    const auto end = s.friendOffsets[i + 1];
+    std::vector<uint64_t> order(end - begin);
+    std::iota(order.begin(), order.end(), begin);
+    std::stable_sort(order.begin(), order.end(), [&](uint64_t a, uint64_t b) {
+      return s.friends[a] < s.friends[b];
+    });
+    std::vector<BIBS::index_t> friends;
+    std::vector<double> weights;
+    for (auto e : order) {
+      friends.push_back(s.friends[e]);
+      weights.push_back(s.friendWeights[e]);
+    }
+    std::copy(friends.begin(), friends.end(), s.friends.begin() + begin);
+    std::copy(weights.begin(), weights.end(), s.friendWeights.begin() + begin);
+  }
+  return s;
+}
+} // namespace
+
+TEST(CompressedGraph, constructor) {
+  EXPECT_THROW(BIBS::CompressedGraph(3, {0}, {1, 2}, {1.0}),
+               std::invalid_argument);
+  EXPECT_THROW(BIBS::CompressedGraph(3, {0}, {1}, {1.0}, 0),
+               std::invalid_argument);
+  EXPECT_THROW(BIBS::CompressedGraph(3, {0}, {3}, {1.0}), std::out_of_range);
+
+  // Gaps of one, two and three bytes, a repeated friend, and an agent
+  // without friends.
+  const size_t nA = 300000;
+  BIBS::CompressedGraph g(nA, {2, 0, 0, 0, 0, 0}, {1, 200000, 5, 100, 5, 0},
+                          {0.5, 1.0, 2.0, 3.0, 4.0, 5.0});
+  EXPECT_EQ(g.getNAgents(), nA);
+  EXPECT_EQ(g.getBlockSize(), BIBS::CompressedGraph::defaultBlockSize);
+  EXPECT_EQ(g.nEdges(), 6);
+  EXPECT_EQ(g.nBlocks(), 2);
+  EXPECT_EQ(g.degree(0), 5);
+  EXPECT_EQ(g.degree(1), 0);
+  EXPECT_EQ(g.degree(2), 1);
+  EXPECT_TRUE(g.isWeighted());
+
+  std::vector<BIBS::index_t> from, to;
+  std::vector<double> weights;
+  g.toEdges(from, to, weights);
+  EXPECT_EQ(from, std::vector<BIBS::index_t>({0, 0, 0, 0, 0, 2}));
+  EXPECT_EQ(to, std::vector<BIBS::index_t>({0, 5, 5, 100, 200000, 1}));
+  EXPECT_EQ(weights, std::vector<double>({5.0, 2.0, 4.0, 3.0, 1.0, 0.5}));
+
+  EXPECT_TRUE(g.hasFriend(0, 200000));
+  EXPECT_TRUE(g.hasFriend(0, 0));
+  EXPECT_FALSE(g.hasFriend(0, 6));
+  EXPECT_FALSE(g.hasFriend(0, 200001));
+  EXPECT_FALSE(g.hasFriend(1, 0));
+}
+
+TEST(CompressedGraph, blocks) {
+  std::vector<BIBS::index_t> from(10, 4);
+  std::vector<BIBS::index_t> to = {9, 8, 7, 6, 5, 4, 3, 2, 1, 0};
+  BIBS::CompressedGraph g(10, from, to, std::vector<double>(10, 0.25), 3);
+  EXPECT_EQ(g.nBlocks(), 4);
+  EXPECT_FALSE(g.isWeighted());
+
+  std::vector<BIBS::index_t> friends;
+  g.forEachFriend(4, [&](BIBS::index_t j, double w) {
+    friends.push_back(j);
+    EXPECT_EQ(w, 0.25);
+  });
+  EXPECT_EQ(friends,
+            std::vector<BIBS::index_t>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+  for (BIBS::index_t j = 0; j < 10; ++j) {
+    EXPECT_TRUE(g.hasFriend(4, j));
+    EXPECT_EQ(g.hasFriend(j, 4), j == 4);
+  }
+}
+
+TEST(CompressedGraph, fromScenario) {
+  const auto s = BIBS::testing::randomScenario(2000, 2, 2, 12, false);
+  const auto sorted = sortedFriends(s);
+  const auto g = BIBS::CompressedGraph::fromScenario(s, 5);
+
+  std::vector<BIBS::index_t> from, to;
+  std::vector<double> weights;
+  g.toEdges(from, to, weights);
+  EXPECT_EQ(to, sorted.friends);
+  EXPECT_EQ(weights, sorted.friendWeights);
+  for (size_t i = 0; i < s.nAgents; ++i) {
+    EXPECT_EQ(g.degree(static_cast<BIBS::index_t>(i)), 12);
+  }
+
+  // Encoding on threads gives the same graph.
+  BIBS::ThreadPool threads(4);
+  const auto p = BIBS::CompressedGraph::fromScenario(s, 5, &threads);
+  std::vector<BIBS::index_t> pFrom, pTo;
+  std::vector<double> pWeights;
+  p.toEdges(pFrom, pTo, pWeights);
+  EXPECT_EQ(pFrom, from);
+  EXPECT_EQ(pTo, to);
+  EXPECT_EQ(pWeights, weights);
+  EXPECT_EQ(p.memoryBytes(), g.memoryBytes());
+}
+
+TEST(CompressedGraph, smallerThanCsr) {
+  // Friends near the agent, with equal weights.
+  const size_t nA = 10000;
+  std::vector<BIBS::index_t> from, to;
+  for (size_t i = 0; i < nA; ++i) {
+    for (size_t d = 1; d <= 16; ++d) {
+      from.push_back(static_cast<BIBS::index_t>(i));
+      to.push_back(static_cast<BIBS::index_t>((i + d * d) % nA));
+    }
+  }
+  BIBS::CompressedGraph g(nA, from, to, std::vector<double>(from.size(), 1.0));
+  const size_t csrBytes = (nA + 1) * sizeof(uint64_t) +
+                          from.size() * (sizeof(BIBS::index_t) +
+                                         sizeof(double));
+  EXPECT_LT(g.memoryBytes() * 4, csrBytes);
+
+  // With the same weight for the friends of each agent.
+  std::vector<double> weights;
+  for (auto i : from) {
+    weights.push_back(1.0 / (i + 1));
+  }
+  BIBS::CompressedGraph perAgent(nA, from, to, weights);
+  EXPECT_TRUE(perAgent.isWeighted());
+  EXPECT_LT(perAgent.memoryBytes() * 4, csrBytes);
+
+  // With a different weight for each edge.
+  for (size_t e = 0; e < weights.size(); ++e) {
+    weights[e] = static_cast<double>(e % 7) / 7;
+  }
+  using Encoding = BIBS::CompressedGraph::WeightEncoding;
+  BIBS::CompressedGraph exact(nA, from, to, weights);
+  BIBS::CompressedGraph single(nA, from, to, weights,
+                               BIBS::CompressedGraph::defaultBlockSize,
+                               nullptr, Encoding::single);
+  BIBS::CompressedGraph quantised(nA, from, to, weights,
+                                  BIBS::CompressedGraph::defaultBlockSize,
+                                  nullptr, Encoding::quantised);
+  EXPECT_LT(exact.memoryBytes(), csrBytes);
+  EXPECT_LT(single.memoryBytes() * 3, csrBytes * 2);
+  EXPECT_LT(quantised.memoryBytes() * 2, csrBytes);
+}
+
+TEST(CompressedGraph, weightEncodings) {
+  using Encoding = BIBS::CompressedGraph::WeightEncoding;
+  const auto s = BIBS::testing::randomScenario(1000, 2, 2, 12, false);
+  const auto sorted = sortedFriends(s);
+  EXPECT_THROW(BIBS::CompressedGraph(2, {0, 0}, {0, 1}, {1.0, NAN}, 4,
+                                     nullptr, Encoding::quantised),
+               std::invalid_argument);
+
+  std::vector<BIBS::index_t> from, to;
+  std::vector<double> weights;
+  BIBS::ThreadPool threads(4);
+  for (auto encoding :
+       {Encoding::exact, Encoding::single, Encoding::quantised}) {
+    const auto g =
+        BIBS::CompressedGraph::fromScenario(s, 5, &threads, encoding);
+    EXPECT_EQ(g.getWeightEncoding(), encoding);
+    EXPECT_TRUE(g.isWeighted());
+    g.toEdges(from, to, weights);
+    EXPECT_EQ(to, sorted.friends);
+    for (size_t i = 0; i < s.nAgents; ++i) {
+      const auto begin = sorted.friendWeights.begin() + s.friendOffsets[i];
+      const auto end = sorted.friendWeights.begin() + s.friendOffsets[i + 1];
+      const auto [least, greatest] = std::minmax_element(begin, end);
+      for (auto e = s.friendOffsets[i]; e < s.friendOffsets[i + 1]; ++e) {
+        const double w = sorted.friendWeights[e];
+        switch (encoding) {
+        case Encoding::exact:
+          EXPECT_EQ(weights[e], w);
+          break;
+        case Encoding::single:
+          EXPECT_EQ(weights[e], static_cast<float>(w));
+          break;
+        case Encoding::quantised:
+          EXPECT_NEAR(weights[e], w, (*greatest - *least) / 131070 + 1e-15);
+          break;
+        }
+      }
+    }
+  }
+}
+
+TEST(CompressedGraph, vectorisedSimulation) {
+  auto s = std::make_shared<const BIBS::Scenario>(
+      sortedFriends(BIBS::testing::randomScenario(500, 4, 3, 6, false)));
+  const auto activations = BIBS::testing::randomActivations(*s);
+  auto g = std::make_shared<const BIBS::CompressedGraph>(
+      BIBS::CompressedGraph::fromScenario(*s, 4));
+
+  // The scenario's graph may be left empty.
+  auto empty = std::make_shared<BIBS::Scenario>(*s);
+  empty->setEdges({}, {}, {});
+
+  BIBS::VectorisedSimulation csr(s, activations, {}, 3);
+  BIBS::VectorisedSimulation compressed(empty, activations, {}, 3);
+  compressed.setCompressedGraph(g);
+  csr.run(5);
+  compressed.run(5);
+  for (BIBS::sim_time_t t = 0; t <= 5; ++t) {
+    EXPECT_EQ(compressed.digest(t), csr.digest(t));
+  }
+
+  EXPECT_THROW(compressed.setCompressedGraph(
+                   std::make_shared<const BIBS::CompressedGraph>(
+                       1, std::vector<BIBS::index_t>(),
+                       std::vector<BIBS::index_t>(), std::vector<double>())),
+               std::invalid_argument);
+  compressed.setCompressedGraph(nullptr);
+  compressed.run(1);
+  EXPECT_EQ(compressed.time(), 6);
+}
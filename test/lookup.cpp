@@ -0,0 +1,99 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/lookup.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/uuid.hpp>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST(UuidIndex, empty) {
+  BIBS::UuidIndex index;
+  auto uuidGen = boost::uuids::random_generator_mt19937();
+  EXPECT_EQ(index.size(), 0);
+  EXPECT_EQ(index.find(uuidGen()), BIBS::HashIndex::notFound);
+  EXPECT_THROW(index.at(uuidGen()), std::out_of_range);
+}
+
+TEST(UuidIndex, shardedParallelBuild) {
+  // Large enough to be split into shards.
+  const size_t n = 200000;
+  auto uuidGen = boost::uuids::random_generator_mt19937();
+  std::vector<boost::uuids::uuid> keys(n);
+  for (auto &k : keys) {
+    k = uuidGen();
+  }
+
+  BIBS::ThreadPool threads(4);
+  BIBS::UuidIndex index(keys, &threads);
+  BIBS::UuidIndex serial(keys);
+  EXPECT_EQ(index.size(), n);
+  EXPECT_GT(index.nShards(), 1);
+  EXPECT_EQ(serial.nShards(), index.nShards());
+  EXPECT_FALSE(index.hasDuplicates());
+
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(index.find(keys[i]), i);
+    ASSERT_EQ(serial.at(keys[i]), i);
+  }
+  EXPECT_EQ(index.key(17), keys[17]);
+  EXPECT_EQ(index.find(uuidGen()), BIBS::HashIndex::notFound);
+}
+
+TEST(UuidIndex, repeated) {
+  auto uuidGen = boost::uuids::random_generator_mt19937();
+  const auto u = uuidGen();
+  EXPECT_THROW(BIBS::UuidIndex({uuidGen(), u, uuidGen(), u}),
+               std::invalid_argument);
+}
+
+TEST(NameIndex, find) {
+  BIBS::NameIndex index({"a", "b", "c", "b", ""});
+  EXPECT_EQ(index.size(), 5);
+  EXPECT_TRUE(index.hasDuplicates());
+  EXPECT_EQ(index.find("a"), 0);
+  EXPECT_EQ(index.find("c"), 2);
+  EXPECT_EQ(index.find(""), 4);
+  EXPECT_EQ(index.find("b"), BIBS::HashIndex::ambiguous);
+  EXPECT_EQ(index.find("d"), BIBS::HashIndex::notFound);
+  EXPECT_EQ(index.at("c"), 2);
+  EXPECT_THROW(index.at("b"), std::invalid_argument);
+  EXPECT_THROW(index.at("d"), std::out_of_range);
+  EXPECT_EQ(index.key(3), "b");
+}
+
+TEST(NameIndex, shardedParallelBuild) {
+  const size_t n = 100000;
+  std::vector<std::string> keys(n);
+  for (size_t i = 0; i < n; ++i) {
+    keys[i] = "agent" + std::to_string(i);
+  }
+  keys.push_back("agent5");
+
+  BIBS::ThreadPool threads(4);
+  BIBS::NameIndex index(keys, &threads);
+  EXPECT_GT(index.nShards(), 1);
+  for (size_t i = 0; i < n; ++i) {
+    ASSERT_EQ(index.find(keys[i]),
+              i == 5 ? BIBS::HashIndex::ambiguous : i);
+  }
+}
@@ -0,0 +1,59 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/mapping.hpp"
+
+#include "temp.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <string>
+#include <sys/mman.h>
+#include <system_error>
+
+TEST(ReadOnlyMapping, maps) {
+  const std::string path = BIBS::testing::tempPath("mapping");
+  std::ofstream(path, std::ios::binary) << "BIBS";
+
+  BIBS::ReadOnlyMapping mapping(path);
+  ASSERT_EQ(mapping.size(), 4);
+  EXPECT_EQ(std::string(mapping.data(), mapping.size()), "BIBS");
+  mapping.advise(0, mapping.size(), MADV_WILLNEED);
+  std::remove(path.c_str());
+}
+
+TEST(ReadOnlyMapping, empty) {
+  const std::string path = BIBS::testing::tempPath("mapping-empty");
+  std::ofstream(path, std::ios::binary);
+
+  BIBS::ReadOnlyMapping mapping(path);
+  EXPECT_EQ(mapping.size(), 0);
+  EXPECT_EQ(mapping.data(), nullptr);
+  std::remove(path.c_str());
+}
+
+TEST(ReadOnlyMapping, errors) {
+  const std::string missing = BIBS::testing::tempPath("mapping-missing");
+  EXPECT_THROW(BIBS::ReadOnlyMapping{missing}, std::system_error);
+  try {
+    BIBS::throwErrno(ENOENT, "open");
+    FAIL();
+  } catch (const std::system_error &e) {
+    EXPECT_EQ(e.code().value(), ENOENT);
+  }
+}
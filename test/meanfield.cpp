@@ -0,0 +1,165 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/meanfield.hpp"
+#include "bibs/behaviour.hpp"
+#include "bibs/belief.hpp"
+#include "bibs/bibs.hpp"
+
+#include <cmath>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+class MeanFieldTest : public ::testing::Test {
+protected:
+  BIBS::Belief b1{"b1"};
+  BIBS::Behaviour beh1{"beh1"};
+  BIBS::Behaviour beh2{"beh2"};
+
+  void SetUp() override {
+    b1.setBeliefRelationship(&b1, 0.1);
+    b1.setObservedBehaviourRelationship(&beh1, 0.5);
+    b1.setObservedBehaviourRelationship(&beh2, 0.0);
+    b1.setPerformingBehaviourRelationship(&beh1, 1.0);
+    b1.setPerformingBehaviourRelationship(&beh2, -1.0);
+  }
+
+  BIBS::MeanFieldSimulation makeSim() {
+    return BIBS::MeanFieldSimulation({&b1}, {&beh1, &beh2});
+  }
+};
+
+TEST_F(MeanFieldTest, addCohortWrongSize) {
+  auto sim = makeSim();
+
+  EXPECT_THROW(sim.addCohort(10, {0.5, 0.5}, {1.0}, {0.0}),
+               std::invalid_argument);
+  EXPECT_THROW(sim.addCohort(10, {0.5}, {}, {0.0}), std::invalid_argument);
+  EXPECT_EQ(sim.nCohorts(), 0);
+}
+
+TEST_F(MeanFieldTest, addCohortAfterRun) {
+  auto sim = makeSim();
+  sim.addCohort(10, {0.5}, {1.0}, {0.0});
+  sim.run(1);
+
+  EXPECT_THROW(sim.addCohort(10, {0.5}, {1.0}, {0.0}), std::invalid_argument);
+}
+
+TEST_F(MeanFieldTest, notFound) {
+  auto sim = makeSim();
+  BIBS::Belief other("other");
+  sim.addCohort(10, {0.5}, {1.0}, {0.0});
+
+  EXPECT_THROW(sim.activationMean(1, 0, &b1), std::out_of_range);
+  EXPECT_THROW(sim.activationMean(0, 1, &b1), std::out_of_range);
+  EXPECT_THROW(sim.activationMean(0, 0, &other), std::out_of_range);
+  EXPECT_THROW(sim.contact(0, 1), std::out_of_range);
+  EXPECT_THROW(sim.cohortSize(1), std::out_of_range);
+}
+
+TEST_F(MeanFieldTest, step) {
+  auto sim = makeSim();
+  auto c = sim.addCohort(1e8, {0.5}, {1.0}, {0.0});
+  sim.setContact(c, c, 2.0);
+
+  EXPECT_EQ(sim.cohortSize(c), 1e8);
+  EXPECT_EQ(sim.contact(c, c), 2.0);
+  EXPECT_DOUBLE_EQ(sim.behaviourShare(0, c, &beh1), 1.0);
+  EXPECT_DOUBLE_EQ(sim.behaviourShare(0, c, &beh2), 0.0);
+
+  sim.run(1);
+
+  EXPECT_EQ(sim.time(), 1);
+  // observed = 2 * 0.5, contextualise = exp(0.1 * 1)
+  EXPECT_DOUBLE_EQ(sim.activationMean(1, c, &b1), 0.5 + std::exp(0.1));
+  EXPECT_DOUBLE_EQ(sim.activationVariance(1, c, &b1), 0.0);
+  EXPECT_DOUBLE_EQ(sim.behaviourShare(1, c, &beh1), 1.0);
+}
+
+TEST_F(MeanFieldTest, varianceDecay) {
+  auto sim = makeSim();
+  auto c = sim.addCohort(100, {0.5}, {1.0}, {0.4});
+
+  sim.run(2);
+
+  EXPECT_DOUBLE_EQ(sim.activationMean(2, c, &b1), 0.25);
+  EXPECT_DOUBLE_EQ(sim.activationVariance(2, c, &b1), 0.4 / 16);
+}
+
+TEST_F(MeanFieldTest, proportionalShares) {
+  b1.setPerformingBehaviourRelationship(&beh2, 3.0);
+  auto sim = makeSim();
+  auto c = sim.addCohort(100, {0.5}, {1.0}, {0.0});
+
+  EXPECT_DOUBLE_EQ(sim.behaviourShare(0, c, &beh1), 0.25);
+  EXPECT_DOUBLE_EQ(sim.behaviourShare(0, c, &beh2), 0.75);
+}
+
+TEST_F(MeanFieldTest, externalShares) {
+  auto sim = makeSim();
+  auto c = sim.addCohort(100, {0.5}, {1.0}, {0.0});
+  auto d = sim.addCohort(100, {0.5}, {1.0}, {0.0});
+  sim.setContact(c, d, 1.0);
+  sim.setExternal(d, true);
+  sim.setBehaviourShares(0, d, {0.0, 1.0});
+
+  EXPECT_THROW(sim.setBehaviourShares(0, d, {1.0}), std::invalid_argument);
+
+  sim.run(1);
+
+  // Cohort c observes only beh2, which is not relevant to b1.
+  EXPECT_DOUBLE_EQ(sim.activationMean(1, c, &b1), 0.5);
+  EXPECT_DOUBLE_EQ(sim.activationMean(1, d, &b1), 1.0);
+  EXPECT_DOUBLE_EQ(sim.behaviourShare(1, d, &beh2), 1.0);
+  EXPECT_THROW(sim.compareWithSample(10, 1, 0), std::invalid_argument);
+}
+
+TEST_F(MeanFieldTest, compareWithSampleDeterministic) {
+  auto sim = makeSim();
+  auto c = sim.addCohort(1e8, {0.5}, {1.0}, {0.0});
+  auto d = sim.addCohort(1e8, {0.9}, {0.2}, {0.0});
+  sim.setContact(c, d, 1.0);
+  sim.setContact(d, c, 0.5);
+  sim.run(5);
+
+  auto errors = sim.compareWithSample(20, 3, 1);
+
+  ASSERT_EQ(errors.size(), 6);
+  for (const auto &e : errors) {
+    EXPECT_NEAR(e.shareError, 0.0, 1e-12);
+    EXPECT_NEAR(e.activationError, 0.0, 1e-9);
+  }
+  EXPECT_EQ(errors[5].t, 5);
+}
+
+TEST_F(MeanFieldTest, compareWithSampleBounds) {
+  auto sim = makeSim();
+  auto c = sim.addCohort(1e8, {0.8}, {0.5}, {0.2});
+  sim.setContact(c, c, 1.0);
+  sim.run(5);
+
+  auto errors = sim.compareWithSample(200, 5, 1);
+
+  EXPECT_THROW(sim.compareWithSample(1, 5, 1), std::invalid_argument);
+  for (const auto &e : errors) {
+    EXPECT_GE(e.shareErrorBound, e.shareError);
+    EXPECT_GE(e.activationErrorBound, e.activationError);
+    EXPECT_LT(e.activationErrorBound, 0.5);
+  }
+}
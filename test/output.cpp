@@ -0,0 +1,166 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/output.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/vectorised.hpp"
+
+#include "scenario.hpp"
+#include <atomic>
+#include <future>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST(ChunkQueue, multipleProducers) {
+  const size_t nProducers = 4;
+  const size_t nEach = 10000;
+  std::vector<BIBS::OutputChunk> chunks(nProducers * nEach);
+  BIBS::ChunkQueue queue;
+
+  EXPECT_EQ(queue.pop(), nullptr);
+
+  std::vector<std::thread> producers;
+  for (size_t p = 0; p < nProducers; ++p) {
+    producers.emplace_back([&, p] {
+      for (size_t i = 0; i < nEach; ++i) {
+        auto &c = chunks[p * nEach + i];
+        c.t = static_cast<BIBS::sim_time_t>(p);
+        c.begin = static_cast<BIBS::index_t>(i);
+        queue.push(&c);
+      }
+    });
+  }
+
+  // Each producer's chunks come out in the order they were pushed.
+  std::vector<size_t> next(nProducers, 0);
+  size_t popped = 0;
+  while (popped < chunks.size()) {
+    if (auto *c = queue.pop()) {
+      EXPECT_EQ(c->begin, next[c->t]);
+      ++next[c->t];
+      ++popped;
+    }
+  }
+  for (auto &p : producers) {
+    p.join();
+  }
+  EXPECT_EQ(queue.pop(), nullptr);
+}
+
+TEST(HistoryWriter, constructor) {
+  BIBS::MemoryHistorySink sink;
+  EXPECT_THROW(BIBS::HistoryWriter(10, 2, sink, 0), std::invalid_argument);
+}
+
+TEST(HistoryWriter, assemblesTicks) {
+  BIBS::MemoryHistorySink sink;
+  BIBS::HistoryWriter writer(5, 2, sink, 2);
+  const double a[] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  const BIBS::index_t p[] = {0, 1, 2, 3, 4};
+
+  // Out of agent order, and with tick 1 started before tick 0 is finished.
+  writer.write(0, 3, 5, a + 6, p + 3);
+  writer.write(1, 0, 5, a, p);
+  writer.write(0, 0, 3, a, p);
+  writer.flush();
+
+  ASSERT_EQ(sink.ticks.size(), 2);
+  EXPECT_EQ(sink.ticks[0].t, 1);
+  EXPECT_EQ(sink.ticks[1].t, 0);
+  for (const auto &tick : sink.ticks) {
+    EXPECT_EQ(tick.activations, std::vector<double>(a, a + 10));
+    EXPECT_EQ(tick.performed, std::vector<BIBS::index_t>(p, p + 5));
+  }
+}
+
+TEST(HistoryWriter, vectorisedSimulation) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(5000, 3, 3, 4, false));
+  BIBS::ThreadPool threads(4);
+  BIBS::MemoryHistorySink sink;
+  BIBS::HistoryWriter writer(5000, 3, sink, 100);
+  BIBS::VectorisedSimulation sim(s, BIBS::testing::randomActivations(*s), {},
+                                 1, true, nullptr, &threads);
+
+  BIBS::HistoryWriter wrong(5000, 2, sink);
+  EXPECT_THROW(sim.setHistoryWriter(&wrong), std::invalid_argument);
+
+  sim.setHistoryWriter(&writer);
+  sim.run(5);
+  writer.flush();
+
+  ASSERT_EQ(sink.ticks.size(), 6);
+  for (BIBS::sim_time_t t = 0; t <= 5; ++t) {
+    EXPECT_EQ(sink.ticks[t].t, t);
+    EXPECT_EQ(sink.ticks[t].activations, sim.frame(t).activations);
+    EXPECT_EQ(sink.ticks[t].performed, sim.frame(t).performed);
+  }
+}
+
+TEST(HistoryWriter, neverBlocks) {
+  // A sink which blocks until released.
+  class BlockingSink : public BIBS::IHistorySink {
+  public:
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<int> writes{0};
+
+    void write(BIBS::sim_time_t, const std::vector<double> &,
+               const std::vector<BIBS::index_t> &) override {
+      released.wait();
+      ++writes;
+    }
+  };
+
+  BlockingSink sink;
+  BIBS::HistoryWriter writer(10, 1, sink, 5);
+  std::vector<double> a(10, 1.0);
+  std::vector<BIBS::index_t> p(10, 0);
+
+  for (BIBS::sim_time_t t = 0; t < 100; ++t) {
+    writer.write(t, 0, 10, a.data(), p.data());
+  }
+  // The writer thread is stuck on the first tick, so chunks were allocated.
+  EXPECT_GE(writer.nChunks(), 100);
+  EXPECT_EQ(sink.writes, 0);
+
+  sink.release.set_value();
+  writer.flush();
+  EXPECT_EQ(sink.writes, 100);
+}
+
+TEST(HistoryWriter, sinkErrors) {
+  class FailingSink : public BIBS::IHistorySink {
+  public:
+    void write(BIBS::sim_time_t, const std::vector<double> &,
+               const std::vector<BIBS::index_t> &) override {
+      throw std::runtime_error("disk full");
+    }
+  };
+
+  FailingSink sink;
+  BIBS::HistoryWriter writer(2, 1, sink);
+  const double a[] = {1, 2};
+  const BIBS::index_t p[] = {0, 0};
+  writer.write(0, 0, 2, a, p);
+
+  EXPECT_THROW(writer.flush(), std::runtime_error);
+}
@@ -0,0 +1,98 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/parallel.hpp"
+
+#include <atomic>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+TEST(ThreadPool, size) {
+  BIBS::ThreadPool one(1);
+  BIBS::ThreadPool four(4);
+  BIBS::ThreadPool hardware;
+
+  EXPECT_EQ(one.size(), 1);
+  EXPECT_EQ(four.size(), 4);
+  EXPECT_GE(hardware.size(), 1);
+}
+
+TEST(ThreadPool, parallelForCoversAll) {
+  BIBS::ThreadPool pool(4);
+
+  for (size_t n : {0, 1, 7, 1000, 12345}) {
+    std::vector<std::atomic<int>> counts(n);
+    pool.parallelFor(n, 16, [&](size_t begin, size_t end) {
+      EXPECT_LE(end - begin, 16);
+      for (size_t i = begin; i < end; ++i) {
+        ++counts[i];
+      }
+    });
+    for (const auto &c : counts) {
+      EXPECT_EQ(c.load(), 1);
+    }
+  }
+}
+
+TEST(ThreadPool, forChunksWithoutPool) {
+  std::vector<std::pair<size_t, size_t>> chunks;
+  BIBS::forChunks(nullptr, 10, 4, [&](size_t begin, size_t end) {
+    chunks.emplace_back(begin, end);
+  });
+  const std::vector<std::pair<size_t, size_t>> expected = {
+      {0, 4}, {4, 8}, {8, 10}};
+  EXPECT_EQ(chunks, expected);
+
+  BIBS::ThreadPool pool(4);
+  std::atomic<size_t> total{0};
+  BIBS::forChunks(&pool, 1000, 16,
+                  [&](size_t begin, size_t end) { total += end - begin; });
+  EXPECT_EQ(total.load(), 1000);
+}
+
+TEST(ThreadPool, nested) {
+  BIBS::ThreadPool pool(4);
+  std::atomic<size_t> total{0};
+
+  pool.parallelFor(8, 1, [&](size_t, size_t) {
+    pool.parallelFor(10, 1, [&](size_t begin, size_t end) {
+      total += end - begin;
+    });
+  });
+
+  EXPECT_EQ(total.load(), 80);
+}
+
+TEST(ThreadPool, exception) {
+  BIBS::ThreadPool pool(4);
+
+  EXPECT_THROW(pool.parallelFor(100, 1,
+                                [&](size_t begin, size_t) {
+                                  if (begin == 50) {
+                                    throw std::runtime_error("fail");
+                                  }
+                                }),
+               std::runtime_error);
+
+  // The pool is still usable.
+  std::atomic<size_t> total{0};
+  pool.parallelFor(100, 1,
+                   [&](size_t begin, size_t end) { total += end - begin; });
+  EXPECT_EQ(total.load(), 100);
+}
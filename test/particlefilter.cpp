@@ -0,0 +1,124 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/particlefilter.hpp"
+#include "bibs/scenario.hpp"
+
+#include "scenario.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+class ParticleFilterTest : public ::testing::Test {
+protected:
+  std::shared_ptr<BIBS::Scenario> scenario;
+  std::vector<double> activations;
+
+  void SetUp() override {
+    scenario = std::make_shared<BIBS::Scenario>(
+        BIBS::testing::randomScenario(500, 3, 3, 4, false));
+    activations = BIBS::testing::randomActivations(*scenario);
+  }
+};
+
+TEST_F(ParticleFilterTest, constructor) {
+  EXPECT_THROW(BIBS::ParticleFilter(scenario, activations, {}, 0),
+               std::invalid_argument);
+
+  BIBS::ParticleFilter pf(scenario, activations, {}, 16, 1, 2);
+
+  EXPECT_EQ(pf.nParticles(), 16);
+  EXPECT_EQ(pf.time(), 0);
+  EXPECT_DOUBLE_EQ(pf.effectiveSampleSize(), 16);
+  EXPECT_EQ(pf.nResamples(), 0);
+  EXPECT_EQ(pf.logMarginalLikelihood(), 0.0);
+  // The particles share the initial frame.
+  EXPECT_EQ(&pf.particle(0).current(), &pf.particle(15).current());
+  EXPECT_THROW(pf.particle(16), std::out_of_range);
+}
+
+TEST_F(ParticleFilterTest, advanceDiverges) {
+  BIBS::ParticleFilter pf(scenario, activations, {}, 4, 1, 2);
+
+  pf.advance(3);
+
+  EXPECT_EQ(pf.time(), 3);
+  EXPECT_NE(pf.particle(0).current().performed,
+            pf.particle(1).current().performed);
+}
+
+TEST_F(ParticleFilterTest, assimilate) {
+  BIBS::ParticleFilter pf(scenario, activations, {}, 32, 1, 4);
+  pf.advance(3);
+
+  EXPECT_THROW(pf.assimilate({0.5, 0.5}, 100), std::invalid_argument);
+
+  auto prior = pf.behaviourShares();
+  pf.assimilate(prior, 100);
+
+  double total = 0.0;
+  for (const auto &w : pf.weights()) {
+    total += w;
+  }
+  EXPECT_NEAR(total, 1.0, 1e-12);
+  EXPECT_LT(pf.logMarginalLikelihood(), 0.0);
+
+  auto posterior = pf.behaviourShares();
+  for (size_t k = 0; k < prior.size(); ++k) {
+    EXPECT_NEAR(posterior[k], prior[k], 0.05);
+  }
+}
+
+TEST_F(ParticleFilterTest, resample) {
+  BIBS::ParticleFilter pf(scenario, activations, {}, 32, 1, 4);
+  pf.advance(2);
+
+  // A very informative observation leaves few particles with weight.
+  auto shares = pf.particle(5).behaviourShares(2);
+  pf.assimilate(shares, 1e6);
+
+  EXPECT_EQ(pf.nResamples(), 1);
+  EXPECT_DOUBLE_EQ(pf.effectiveSampleSize(), 32);
+
+  auto resampled = pf.behaviourShares();
+  for (size_t k = 0; k < shares.size(); ++k) {
+    EXPECT_DOUBLE_EQ(resampled[k], shares[k]);
+  }
+
+  // The clones diverge.
+  pf.advance(2);
+  EXPECT_NE(pf.particle(0).current().performed,
+            pf.particle(1).current().performed);
+}
+
+TEST_F(ParticleFilterTest, threadsMatch) {
+  BIBS::ParticleFilter pf1(scenario, activations, {}, 16, 3, 1);
+  BIBS::ParticleFilter pf4(scenario, activations, {}, 16, 3, 4);
+
+  for (int i = 0; i < 3; ++i) {
+    pf1.advance(2);
+    pf4.advance(2);
+    auto shares = pf1.particle(0).behaviourShares(pf1.time());
+    pf1.assimilate(shares, 1000);
+    pf4.assimilate(shares, 1000);
+  }
+
+  EXPECT_EQ(pf1.weights(), pf4.weights());
+  EXPECT_EQ(pf1.behaviourShares(), pf4.behaviourShares());
+  EXPECT_EQ(pf1.logMarginalLikelihood(), pf4.logMarginalLikelihood());
+}
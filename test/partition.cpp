@@ -0,0 +1,156 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/partition.hpp"
+#include "bibs/choice.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/simulation.hpp"
+
+#include "scenario.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+/**
+ * A scenario of nClusters clusters of agents, whose friends are in their own
+ * cluster except for one in 50.
+ */
+BIBS::Scenario clusteredScenario(size_t nAgents, size_t nClusters) {
+  auto s = BIBS::testing::randomScenario(nAgents, 3, 4, 1, false);
+  std::mt19937_64 eng(5);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  const size_t size = nAgents / nClusters;
+  std::vector<BIBS::index_t> from, to;
+  std::vector<double> weights;
+  for (size_t i = 0; i < nAgents; ++i) {
+    const size_t base = i / size * size;
+    for (size_t d = 0; d < 5; ++d) {
+      from.push_back(static_cast<BIBS::index_t>(i));
+      to.push_back(static_cast<BIBS::index_t>(
+          eng() % 50 == 0 ? eng() % nAgents : base + eng() % size));
+      weights.push_back(unit(eng) / 5);
+    }
+  }
+  s.setEdges(from, to, weights);
+  return s;
+}
+
+/**
+ * Checks that a PartitionedSimulation matches a VectorisedSimulation of the
+ * whole scenario after every exchange.
+ */
+void expectMatches(BIBS::PartitionedSimulation &partitioned,
+                   BIBS::VectorisedSimulation &whole, BIBS::sim_time_t nDays,
+                   BIBS::sim_time_t every) {
+  for (BIBS::sim_time_t t = 0; t < nDays; t += every) {
+    partitioned.run(every);
+    whole.run(every);
+    ASSERT_EQ(partitioned.time(), whole.time());
+    EXPECT_EQ(partitioned.current().digest, whole.current().digest)
+        << "at " << whole.time();
+    EXPECT_EQ(partitioned.current().activations, whole.current().activations);
+    EXPECT_EQ(partitioned.current().contexts, whole.current().contexts);
+    EXPECT_EQ(partitioned.current().performed, whole.current().performed);
+  }
+}
+} // namespace
+
+TEST(PartitionedSimulation, constructor) {
+  auto s = std::make_shared<BIBS::Scenario>(clusteredScenario(400, 4));
+  const auto activations = BIBS::testing::randomActivations(*s);
+  const auto blocks = BIBS::PartitionedSimulation::blockPartitions(400, 4);
+  EXPECT_EQ(blocks[99], 0);
+  EXPECT_EQ(blocks[100], 1);
+  EXPECT_EQ(blocks[399], 3);
+  EXPECT_THROW(BIBS::PartitionedSimulation::blockPartitions(400, 0),
+               std::invalid_argument);
+  EXPECT_THROW(BIBS::PartitionedSimulation(s, activations, {}, 3, {0, 1}, 2),
+               std::invalid_argument);
+  EXPECT_THROW(BIBS::PartitionedSimulation(s, activations, {}, 3, blocks, 0),
+               std::invalid_argument);
+
+  // Partition 1 has no agents, and is skipped.
+  std::vector<BIBS::index_t> uneven(400, 0);
+  std::fill(uneven.begin() + 300, uneven.end(), 2);
+  BIBS::PartitionedSimulation sim(s, activations, {}, 3, uneven, 2);
+  EXPECT_EQ(sim.nPartitions(), 2);
+  EXPECT_EQ(sim.nOwned(0), 300);
+  EXPECT_EQ(sim.nOwned(1), 100);
+  EXPECT_EQ(sim.getHaloDepth(), 2);
+  EXPECT_EQ(sim.time(), 0);
+  EXPECT_EQ(sim.nExchanges(), 0);
+
+  // Deeper halos hold more agents.
+  BIBS::PartitionedSimulation shallow(s, activations, {}, 3, blocks, 1);
+  BIBS::PartitionedSimulation deep(s, activations, {}, 3, blocks, 3);
+  for (size_t p = 0; p < 4; ++p) {
+    EXPECT_GT(shallow.nHalo(p), 0);
+    EXPECT_LT(shallow.nHalo(p), deep.nHalo(p));
+  }
+}
+
+TEST(PartitionedSimulation, matchesVectorised) {
+  auto s = std::make_shared<BIBS::Scenario>(clusteredScenario(2000, 8));
+  const auto activations = BIBS::testing::randomActivations(*s);
+  const auto blocks = BIBS::PartitionedSimulation::blockPartitions(2000, 8);
+
+  for (BIBS::sim_time_t depth : {1, 2, 3, 5}) {
+    BIBS::PartitionedSimulation partitioned(s, activations, {}, 7, blocks,
+                                            depth);
+    BIBS::VectorisedSimulation whole(s, activations, {}, 7, false);
+    expectMatches(partitioned, whole, 12, depth);
+    EXPECT_EQ(partitioned.nExchanges(), (12 + depth - 1) / depth);
+  }
+}
+
+TEST(PartitionedSimulation, partialBlocksAndThreads) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(1000, 3, 4, 3, false));
+  const auto activations = BIBS::testing::randomActivations(*s);
+
+  // Agents assigned to partitions at random, run 7 days at a time with a
+  // depth of 3, so every run ends with a shorter block.
+  std::mt19937_64 eng(2);
+  std::vector<BIBS::index_t> partitionOf(1000);
+  for (auto &p : partitionOf) {
+    p = static_cast<BIBS::index_t>(eng() % 5);
+  }
+  BIBS::ThreadPool threads(4);
+  BIBS::PartitionedSimulation partitioned(s, activations, {}, 9, partitionOf,
+                                          3, &threads);
+  BIBS::VectorisedSimulation whole(s, activations, {}, 9, false);
+  expectMatches(partitioned, whole, 21, 7);
+  EXPECT_EQ(partitioned.nExchanges(), 9);
+}
+
+TEST(PartitionedSimulation, choicePolicy) {
+  auto s = std::make_shared<BIBS::Scenario>(clusteredScenario(600, 3));
+  const auto activations = BIBS::testing::randomActivations(*s);
+  auto policy = std::make_shared<BIBS::SoftmaxPolicy>(0.5);
+
+  BIBS::PartitionedSimulation partitioned(
+      s, activations, {}, 4,
+      BIBS::PartitionedSimulation::blockPartitions(600, 3), 4);
+  BIBS::VectorisedSimulation whole(s, activations, {}, 4, false);
+  partitioned.setChoicePolicy(policy);
+  whole.setChoicePolicy(policy);
+  expectMatches(partitioned, whole, 8, 4);
+}
@@ -0,0 +1,132 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/scenario.hpp"
+#include "bibs/agent.hpp"
+#include "bibs/bibs.hpp"
+
+#include "scenario.hpp"
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+
+TEST(Scenario, constructor) {
+  BIBS::Scenario s(10, 3, 2);
+
+  EXPECT_EQ(s.nAgents, 10);
+  EXPECT_EQ(s.nBeliefs, 3);
+  EXPECT_EQ(s.nBehaviours, 2);
+  EXPECT_EQ(s.beliefRelationships.size(), 9);
+  EXPECT_EQ(s.observedRelationships.size(), 6);
+  EXPECT_EQ(s.performingRelationships.size(), 6);
+  EXPECT_EQ(s.timeDeltas.size(), 30);
+  EXPECT_EQ(s.friendOffsets.size(), 11);
+  EXPECT_EQ(s.nEdges(), 0);
+  EXPECT_NO_THROW(s.validate());
+}
+
+TEST(Scenario, setEdges) {
+  BIBS::Scenario s(4, 1, 1);
+
+  s.setEdges({2, 0, 2, 3, 0}, {1, 3, 0, 2, 1}, {0.1, 0.2, 0.3, 0.4, 0.5});
+
+  std::vector<uint64_t> offsets{0, 2, 2, 4, 5};
+  std::vector<BIBS::index_t> friends{3, 1, 1, 0, 2};
+  std::vector<double> weights{0.2, 0.5, 0.1, 0.3, 0.4};
+  EXPECT_EQ(s.nEdges(), 5);
+  EXPECT_EQ(s.friendOffsets, offsets);
+  EXPECT_EQ(s.friends, friends);
+  EXPECT_EQ(s.friendWeights, weights);
+  EXPECT_NO_THROW(s.validate());
+}
+
+TEST(Scenario, setEdgesInvalid) {
+  BIBS::Scenario s(4, 1, 1);
+
+  EXPECT_THROW(s.setEdges({0, 1}, {1}, {0.1, 0.2}), std::invalid_argument);
+  EXPECT_THROW(s.setEdges({0}, {4}, {0.1}), std::out_of_range);
+}
+
+TEST(Scenario, validate) {
+  BIBS::Scenario s(4, 2, 2);
+
+  s.timeDeltas.pop_back();
+  EXPECT_THROW(s.validate(), std::invalid_argument);
+  s.timeDeltas.push_back(0.0);
+
+  s.beliefRelationships.push_back(0.0);
+  EXPECT_THROW(s.validate(), std::invalid_argument);
+  s.beliefRelationships.pop_back();
+
+  s.friends.push_back(4);
+  s.friendWeights.push_back(1.0);
+  s.friendOffsets[4] = 1;
+  EXPECT_THROW(s.validate(), std::invalid_argument);
+  s.friends[0] = 3;
+  EXPECT_NO_THROW(s.validate());
+}
+
+TEST(Scenario, fromAgents) {
+  auto s = BIBS::testing::randomScenario(20, 3, 2, 4, false);
+  auto activations = BIBS::testing::randomActivations(s);
+  BIBS::testing::ScenarioObjects objects(s, activations);
+
+  auto s2 = BIBS::Scenario::fromAgents(
+      objects.constAgents, objects.constBeliefs, objects.constBehaviours);
+
+  EXPECT_EQ(s2.nAgents, 20);
+  EXPECT_EQ(s2.beliefRelationships, s.beliefRelationships);
+  EXPECT_EQ(s2.observedRelationships, s.observedRelationships);
+  EXPECT_EQ(s2.performingRelationships, s.performingRelationships);
+  EXPECT_EQ(s2.timeDeltas, s.timeDeltas);
+
+  for (size_t i = 0; i < s.nAgents; ++i) {
+    double total = 0.0;
+    double total2 = 0.0;
+    for (auto e = s.friendOffsets[i]; e < s.friendOffsets[i + 1]; ++e) {
+      total += s.friendWeights[e];
+    }
+    for (auto e = s2.friendOffsets[i]; e < s2.friendOffsets[i + 1]; ++e) {
+      total2 += s2.friendWeights[e];
+      if (e > s2.friendOffsets[i]) {
+        EXPECT_LT(s2.friends[e - 1], s2.friends[e]);
+      }
+    }
+    EXPECT_NEAR(total, total2, 1e-12);
+  }
+
+  EXPECT_EQ(BIBS::activationsOf(objects.constIAgents, objects.constBeliefs, 0),
+            activations);
+  EXPECT_THROW(
+      BIBS::activationsOf(objects.constIAgents, objects.constBeliefs, 1),
+      std::out_of_range);
+}
+
+TEST(Scenario, performedOf) {
+  auto s = BIBS::testing::randomScenario(20, 3, 2, 4, true);
+  BIBS::testing::ScenarioObjects objects(s,
+                                         BIBS::testing::randomActivations(s));
+
+  objects.run(0);
+
+  auto performed =
+      BIBS::performedOf(objects.constIAgents, objects.constBehaviours, 0);
+  EXPECT_EQ(performed, std::vector<BIBS::index_t>(20, 0));
+  EXPECT_THROW(
+      BIBS::performedOf(objects.constIAgents, {objects.constBehaviours[1]}, 0),
+      std::out_of_range);
+}
@@ -0,0 +1,262 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      scenario.hpp<test>
+ * @brief     Header of random scenarios for testing
+ * @date      Sun Oct 18 12:41:26 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains random scenarios, and their equivalent Agents.
+ */
+
+#ifndef BIBS_TESTING_SCENARIO_H
+#define BIBS_TESTING_SCENARIO_H
+
+#include "bibs/agent.hpp"
+#include "bibs/behaviour.hpp"
+#include "bibs/belief.hpp"
+#include "bibs/bibs.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/vectorised.hpp"
+
+#include <algorithm>
+#include <boost/format.hpp>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace BIBS::testing {
+/**
+ * Creates a random scenario, in which every agent has degree friends.
+ *
+ * If deterministic, behaviour 0 is the only behaviour with positive utility
+ * for every agent at every time, so no random choices are made.
+ */
+inline Scenario randomScenario(size_t nAgents, size_t nBeliefs,
+                               size_t nBehaviours, size_t degree,
+                               bool deterministic, unsigned seed = 1) {
+  std::mt19937_64 eng(seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::uniform_int_distribution<index_t> agent(0, nAgents - 1);
+
+  Scenario s(nAgents, nBeliefs, nBehaviours);
+
+  for (auto &r : s.beliefRelationships) {
+    r = 0.2 * unit(eng) - 0.1;
+  }
+  for (auto &o : s.observedRelationships) {
+    o = 0.5 * unit(eng);
+  }
+  for (size_t b = 0; b < nBeliefs; ++b) {
+    for (size_t k = 0; k < nBehaviours; ++k) {
+      const double p = 0.1 + unit(eng);
+      s.performingRelationships[b * nBehaviours + k] =
+          deterministic && k > 0 ? -p : p;
+    }
+  }
+  for (auto &td : s.timeDeltas) {
+    td = 0.5 + 0.45 * unit(eng);
+  }
+
+  std::vector<index_t> from;
+  std::vector<index_t> to;
+  std::vector<double> weights;
+  for (size_t i = 0; i < nAgents; ++i) {
+    for (size_t d = 0; d < degree; ++d) {
+      from.push_back(static_cast<index_t>(i));
+      to.push_back(agent(eng));
+      weights.push_back(unit(eng) / degree);
+    }
+  }
+  s.setEdges(from, to, weights);
+
+  return s;
+}
+
+/**
+ * Creates random activations for a scenario.
+ */
+inline std::vector<double> randomActivations(const Scenario &s,
+                                             unsigned seed = 2) {
+  std::mt19937_64 eng(seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+  std::vector<double> activations(s.nAgents * s.nBeliefs);
+  for (auto &a : activations) {
+    a = unit(eng);
+  }
+
+  return activations;
+}
+
+/**
+ * Creates belief relationships made of clusters: dense blocks of
+ * clusterSize on the diagonal, and crossLinks random links between
+ * clusters.
+ */
+inline std::vector<double> clusteredRelationships(size_t nBeliefs,
+                                                  size_t clusterSize,
+                                                  size_t crossLinks,
+                                                  unsigned seed = 3) {
+  std::mt19937_64 eng(seed);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  std::uniform_int_distribution<size_t> belief(0, nBeliefs - 1);
+
+  std::vector<double> r(nBeliefs * nBeliefs, 0.0);
+  for (size_t b = 0; b < nBeliefs; ++b) {
+    const size_t first = b / clusterSize * clusterSize;
+    const size_t last = std::min(first + clusterSize, nBeliefs);
+    for (size_t b2 = first; b2 < last; ++b2) {
+      r[b * nBeliefs + b2] = 0.2 * unit(eng) - 0.1;
+    }
+  }
+  for (size_t l = 0; l < crossLinks; ++l) {
+    r[belief(eng) * nBeliefs + belief(eng)] = 0.2 * unit(eng) - 0.1;
+  }
+
+  return r;
+}
+
+/**
+ * An Agent whose random choices are those of agent index in a
+ * VectorisedSimulation with the given seed and stream 0.
+ */
+class SeededAgent : public Agent {
+private:
+  uint64_t seed;
+  index_t index;
+
+public:
+  SeededAgent(
+      const std::map<sim_time_t, std::map<const IBelief *, double>> &a,
+      uint64_t seed, index_t index)
+      : Agent(a), seed(seed), index(index) {}
+
+protected:
+  double choiceUniform(const sim_time_t t) const override {
+    return VectorisedSimulation::uniform(seed, 0, t, index);
+  }
+};
+
+/**
+ * The Agents, Beliefs and Behaviours equivalent to a Scenario. If a seed is
+ * given, the Agents are SeededAgents. The initial activations are at time
+ * start.
+ */
+class ScenarioObjects {
+public:
+  std::vector<std::unique_ptr<Belief>> beliefs;
+  std::vector<std::unique_ptr<Behaviour>> behaviours;
+  std::vector<std::unique_ptr<Agent>> agents;
+
+  std::vector<const IBelief *> constBeliefs;
+  std::vector<const IBehaviour *> constBehaviours;
+  std::vector<const Agent *> constAgents;
+  std::vector<const IAgent *> constIAgents;
+  std::vector<IAgent *> ptrAgents;
+  std::vector<IBelief *> ptrBeliefs;
+  std::vector<IBehaviour *> ptrBehaviours;
+
+  ScenarioObjects(const Scenario &s, const std::vector<double> &activations,
+                  std::optional<uint64_t> seed = std::nullopt,
+                  sim_time_t start = 0) {
+    for (size_t b = 0; b < s.nBeliefs; ++b) {
+      beliefs.push_back(
+          std::make_unique<Belief>(boost::str(boost::format("b%1%") % b)));
+      constBeliefs.push_back(beliefs.back().get());
+      ptrBeliefs.push_back(beliefs.back().get());
+    }
+    for (size_t k = 0; k < s.nBehaviours; ++k) {
+      behaviours.push_back(
+          std::make_unique<Behaviour>(boost::str(boost::format("k%1%") % k)));
+      constBehaviours.push_back(behaviours.back().get());
+      ptrBehaviours.push_back(behaviours.back().get());
+    }
+
+    for (size_t b = 0; b < s.nBeliefs; ++b) {
+      for (size_t b2 = 0; b2 < s.nBeliefs; ++b2) {
+        beliefs[b]->setBeliefRelationship(
+            beliefs[b2].get(), s.beliefRelationships[b * s.nBeliefs + b2]);
+      }
+      for (size_t k = 0; k < s.nBehaviours; ++k) {
+        beliefs[b]->setObservedBehaviourRelationship(
+            behaviours[k].get(),
+            s.observedRelationships[b * s.nBehaviours + k]);
+        beliefs[b]->setPerformingBehaviourRelationship(
+            behaviours[k].get(),
+            s.performingRelationships[b * s.nBehaviours + k]);
+      }
+    }
+
+    for (size_t i = 0; i < s.nAgents; ++i) {
+      std::map<const IBelief *, double> initial;
+      for (size_t b = 0; b < s.nBeliefs; ++b) {
+        initial.emplace(beliefs[b].get(), activations[i * s.nBeliefs + b]);
+      }
+      const std::map<sim_time_t, std::map<const IBelief *, double>> a{
+          {start, initial}};
+      if (seed) {
+        agents.push_back(std::make_unique<SeededAgent>(
+            a, *seed, static_cast<index_t>(i)));
+      } else {
+        agents.push_back(std::make_unique<Agent>(a));
+      }
+      for (size_t b = 0; b < s.nBeliefs; ++b) {
+        agents.back()->setTimeDelta(beliefs[b].get(),
+                                    s.timeDeltas[i * s.nBeliefs + b]);
+      }
+      constAgents.push_back(agents.back().get());
+      constIAgents.push_back(agents.back().get());
+      ptrAgents.push_back(agents.back().get());
+    }
+
+    for (size_t i = 0; i < s.nAgents; ++i) {
+      for (auto e = s.friendOffsets[i]; e < s.friendOffsets[i + 1]; ++e) {
+        const auto *f = agents[s.friends[e]].get();
+        // Agent has at most one weight per friend.
+        double w = s.friendWeights[e];
+        try {
+          w += agents[i]->friendWeight(f);
+        } catch (const std::out_of_range &) {
+        }
+        agents[i]->setFriendWeight(f, w);
+      }
+    }
+  }
+
+  /**
+   * Runs the Agents from time 0 to nDays, as in Agent::tick.
+   */
+  void run(sim_time_t nDays) {
+    for (auto &a : agents) {
+      a->perform(0, constBehaviours);
+    }
+    for (sim_time_t t = 1; t <= nDays; ++t) {
+      for (auto &a : agents) {
+        a->tick(t, constBehaviours, constBeliefs);
+      }
+    }
+  }
+};
+} // namespace BIBS::testing
+
+#endif // BIBS_TESTING_SCENARIO_H
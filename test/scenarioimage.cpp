@@ -0,0 +1,147 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/scenarioimage.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/vectorised.hpp"
+
+#include "scenario.hpp"
+#include "temp.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+TEST(ScenarioImage, roundTrip) {
+  const std::string path = BIBS::testing::tempPath("image");
+  const auto s = BIBS::testing::randomScenario(300, 5, 3, 4, false);
+  BIBS::ScenarioImage::write(path, s);
+
+  const BIBS::ScenarioImage image(path);
+  EXPECT_EQ(image.nEdges(), s.nEdges());
+  const auto &v = image.view();
+  EXPECT_EQ(v.nAgents, 300);
+  EXPECT_EQ(v.nBeliefs, 5);
+  EXPECT_EQ(v.nBehaviours, 3);
+  for (const void *p : {static_cast<const void *>(v.beliefRelationships),
+                        static_cast<const void *>(v.timeDeltas),
+                        static_cast<const void *>(v.friendOffsets),
+                        static_cast<const void *>(v.friends),
+                        static_cast<const void *>(v.friendWeights)}) {
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(p) % 64, 0);
+  }
+  EXPECT_GE(image.size(), 300 * 5 * sizeof(double));
+
+  const auto copy = image.toScenario();
+  EXPECT_EQ(copy.beliefRelationships, s.beliefRelationships);
+  EXPECT_EQ(copy.observedRelationships, s.observedRelationships);
+  EXPECT_EQ(copy.performingRelationships, s.performingRelationships);
+  EXPECT_EQ(copy.timeDeltas, s.timeDeltas);
+  EXPECT_EQ(copy.friendOffsets, s.friendOffsets);
+  EXPECT_EQ(copy.friends, s.friends);
+  EXPECT_EQ(copy.friendWeights, s.friendWeights);
+
+  // An empty scenario.
+  BIBS::ScenarioImage::write(path, BIBS::Scenario(0, 0, 0));
+  const BIBS::ScenarioImage empty(path);
+  EXPECT_EQ(empty.view().nAgents, 0);
+  EXPECT_EQ(empty.nEdges(), 0);
+  std::remove(path.c_str());
+}
+
+TEST(ScenarioImage, simulation) {
+  const std::string path = BIBS::testing::tempPath("image-simulation");
+  const auto s = std::make_shared<const BIBS::Scenario>(
+      BIBS::testing::randomScenario(300, 6, 3, 4, false));
+  const auto activations = BIBS::testing::randomActivations(*s);
+  BIBS::ScenarioImage::write(path, *s);
+  const auto image = std::make_shared<const BIBS::ScenarioImage>(path);
+
+  BIBS::VectorisedSimulation fromScenario(s, activations, {}, 3);
+  BIBS::VectorisedSimulation fromImage(image, activations, {}, 3);
+  EXPECT_EQ(fromImage.getScenario().nAgents, 300);
+  EXPECT_EQ(fromImage.getArrays().timeDeltas, image->view().timeDeltas);
+  fromScenario.run(5);
+  fromImage.run(5);
+  EXPECT_EQ(fromImage.current().digest, fromScenario.current().digest);
+  EXPECT_EQ(fromImage.current().activations,
+            fromScenario.current().activations);
+
+  // The other kernels read the image too.
+  fromScenario.setBlockSparse(2);
+  fromImage.setBlockSparse(2);
+  fromScenario.setIncremental(1e-12, 4);
+  fromImage.setIncremental(1e-12, 4);
+  fromScenario.run(5);
+  fromImage.run(5);
+  EXPECT_EQ(fromImage.current().digest, fromScenario.current().digest);
+
+  // Copies share the image.
+  auto copy = fromImage;
+  copy.run(1);
+  EXPECT_EQ(copy.getArrays().friends, image->view().friends);
+  std::remove(path.c_str());
+}
+
+TEST(ScenarioImage, errors) {
+  EXPECT_THROW(BIBS::ScenarioImage("/nonexistent/bibs-image"),
+               std::system_error);
+
+  const std::string path = BIBS::testing::tempPath("not-image");
+  auto s = BIBS::testing::randomScenario(50, 2, 2, 3, false);
+  s.friends[0] = 50;
+  EXPECT_THROW(BIBS::ScenarioImage::write(path, s), std::invalid_argument);
+
+  std::FILE *f = std::fopen(path.c_str(), "w");
+  std::fputs("not a scenario image", f);
+  std::fclose(f);
+  EXPECT_THROW(BIBS::ScenarioImage{path}, std::runtime_error);
+
+  // A friend out of range is found when a simulation is created. The
+  // offset of the friends is the sixth of the array offsets, which start
+  // at byte 48.
+  s.friends[0] = 0;
+  BIBS::ScenarioImage::write(path, s);
+  uint64_t friends;
+  const BIBS::index_t outOfRange = 50;
+  {
+    std::fstream io(path, std::ios::binary | std::ios::in | std::ios::out);
+    io.seekg(48 + 5 * sizeof(uint64_t));
+    io.read(reinterpret_cast<char *>(&friends), sizeof(friends));
+    io.seekp(friends);
+    io.write(reinterpret_cast<const char *>(&outOfRange),
+             sizeof(outOfRange));
+  }
+  const auto image = std::make_shared<const BIBS::ScenarioImage>(path);
+  EXPECT_EQ(image->view().friends[0], outOfRange);
+  EXPECT_THROW(BIBS::VectorisedSimulation(
+                   image, BIBS::testing::randomActivations(s)),
+               std::invalid_argument);
+
+  // A file cut short of its last array.
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  const auto size = static_cast<off_t>(in.tellg());
+  ASSERT_EQ(truncate(path.c_str(), size - 8), 0);
+  EXPECT_THROW(BIBS::ScenarioImage{path}, std::runtime_error);
+  std::remove(path.c_str());
+}
@@ -0,0 +1,137 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/sensitivity.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/vectorised.hpp"
+
+#include "scenario.hpp"
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+class SensitivityTest : public ::testing::Test {
+protected:
+  std::shared_ptr<BIBS::Scenario> scenario;
+  std::vector<double> activations;
+  std::vector<BIBS::SensitivityParameter> parameters;
+
+  void SetUp() override {
+    scenario = std::make_shared<BIBS::Scenario>(
+        BIBS::testing::randomScenario(20, 2, 2, 3, false));
+    activations = BIBS::testing::randomActivations(*scenario);
+    parameters = {BIBS::timeDeltaParameter(0, 0, 1),
+                  BIBS::timeDeltaParameter(1, 0, 1),
+                  BIBS::friendWeightScaling(0, 2)};
+  }
+
+  // 2 x1 + x2, so that S = (0.8, 0.2, 0).
+  static double linear(const BIBS::VectorisedSimulation &sim) {
+    const auto &s = sim.getScenario();
+    return 2 * s.timeDeltas[0] + s.timeDeltas[1];
+  }
+};
+
+TEST_F(SensitivityTest, parameters) {
+  BIBS::Scenario s = *scenario;
+
+  BIBS::timeDeltaParameter(1, 0, 1).apply(s, *scenario, 0.25);
+  for (size_t i = 0; i < s.nAgents; ++i) {
+    EXPECT_EQ(s.timeDeltas[i * 2 + 1], 0.25);
+    EXPECT_EQ(s.timeDeltas[i * 2], scenario->timeDeltas[i * 2]);
+  }
+
+  BIBS::beliefRelationshipScaling(0, 1, 0, 2).apply(s, *scenario, 2);
+  EXPECT_EQ(s.beliefRelationships[1], 2 * scenario->beliefRelationships[1]);
+
+  BIBS::observedRelationshipScaling(1, 0, 2).apply(s, *scenario, 3);
+  EXPECT_EQ(s.observedRelationships[2], 3 * scenario->observedRelationships[2]);
+  EXPECT_EQ(s.observedRelationships[0], scenario->observedRelationships[0]);
+
+  BIBS::performingRelationshipScaling(0, 0, 2).apply(s, *scenario, 0.5);
+  EXPECT_EQ(s.performingRelationships[1],
+            0.5 * scenario->performingRelationships[1]);
+
+  BIBS::friendWeightScaling(0, 2).apply(s, *scenario, 0);
+  for (double w : s.friendWeights) {
+    EXPECT_EQ(w, 0.0);
+  }
+
+  EXPECT_THROW(BIBS::timeDeltaParameter(2, 0, 1).apply(s, *scenario, 0),
+               std::out_of_range);
+  EXPECT_THROW(
+      BIBS::beliefRelationshipScaling(0, 2, 0, 2).apply(s, *scenario, 1),
+      std::out_of_range);
+  EXPECT_THROW(
+      BIBS::observedRelationshipScaling(2, 0, 2).apply(s, *scenario, 1),
+      std::out_of_range);
+  EXPECT_THROW(
+      BIBS::performingRelationshipScaling(2, 0, 2).apply(s, *scenario, 1),
+      std::out_of_range);
+}
+
+TEST_F(SensitivityTest, constructor) {
+  EXPECT_THROW(BIBS::SensitivityAnalysis(scenario, activations, {}, linear, 1),
+               std::invalid_argument);
+
+  BIBS::SensitivityAnalysis sa(scenario, activations, parameters, linear, 1);
+
+  EXPECT_EQ(sa.nSamples(), 0);
+  EXPECT_EQ(sa.nRuns(), 0);
+  EXPECT_EQ(sa.variance(), 0.0);
+  EXPECT_EQ(sa.firstOrder(), std::vector<double>(3, 0.0));
+}
+
+TEST_F(SensitivityTest, linearIndices) {
+  BIBS::SensitivityAnalysis sa(scenario, activations, parameters, linear, 1,
+                               1, 4);
+
+  sa.run(2000);
+
+  EXPECT_EQ(sa.nSamples(), 2000);
+  EXPECT_EQ(sa.nRuns(), 10000);
+  EXPECT_NEAR(sa.mean(), 1.5, 0.05);
+  EXPECT_NEAR(sa.variance(), 5.0 / 12, 0.05);
+
+  const auto first = sa.firstOrder();
+  const auto total = sa.totalOrder();
+  EXPECT_NEAR(first[0], 0.8, 0.1);
+  EXPECT_NEAR(first[1], 0.2, 0.1);
+  EXPECT_NEAR(first[2], 0.0, 0.1);
+  EXPECT_NEAR(total[0], 0.8, 0.1);
+  EXPECT_NEAR(total[1], 0.2, 0.1);
+  EXPECT_EQ(total[2], 0.0);
+}
+
+TEST_F(SensitivityTest, independentOfThreadsAndWaves) {
+  const auto output = BIBS::finalShareOutput(0);
+  BIBS::SensitivityAnalysis one(scenario, activations, parameters, output, 3,
+                                7, 1);
+  BIBS::SensitivityAnalysis many(scenario, activations, parameters, output,
+                                 3, 7, 4);
+
+  one.run(50);
+  many.run(20);
+  many.run(30);
+
+  EXPECT_EQ(one.nSamples(), many.nSamples());
+  EXPECT_EQ(one.mean(), many.mean());
+  EXPECT_EQ(one.variance(), many.variance());
+  EXPECT_EQ(one.firstOrder(), many.firstOrder());
+  EXPECT_EQ(one.totalOrder(), many.totalOrder());
+}
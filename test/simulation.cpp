@@ -23,10 +23,21 @@
 #include "bibs/behaviour.hpp"
 #include "bibs/belief.hpp"
 #include "bibs/bibs.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/state.hpp"
+#include "bibs/vectorised.hpp"
+#include "scenario.hpp"
 #include <boost/format.hpp>
 #include <boost/uuid/random_generator.hpp>
+#include <cmath>
 #include <gtest/gtest.h>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 class SequentialSimulationConstructorTest : public BIBS::SequentialSimulation {
 public:
@@ -94,6 +105,60 @@ TEST(SequentialSimulation, constructor) {
   EXPECT_EQ(sim.getConstBehaviours(), constPtrBehaviours);
 }
 
+TEST(SequentialSimulation, lookup) {
+  std::vector<std::unique_ptr<BIBS::IAgent>> agents;
+  std::vector<BIBS::IAgent *> ptrAgents;
+  std::vector<std::unique_ptr<BIBS::testing::MockBelief>> beliefs;
+  std::vector<BIBS::IBelief *> ptrBeliefs;
+  std::vector<std::unique_ptr<BIBS::testing::MockBehaviour>> behaviours;
+  std::vector<BIBS::IBehaviour *> ptrBehaviours;
+
+  auto uuidGen = boost::uuids::random_generator_mt19937();
+
+  for (size_t i = 0; i < 1000; ++i) {
+    agents.push_back(std::make_unique<BIBS::testing::MockAgent>(uuidGen()));
+    ptrAgents.push_back(agents[i].get());
+  }
+  for (size_t i = 0; i < 20; ++i) {
+    beliefs.push_back(std::make_unique<BIBS::testing::MockBelief>(
+        boost::str(boost::format("b%1%") % i)));
+    ptrBeliefs.push_back(beliefs[i].get());
+  }
+  for (size_t i = 0; i < 10; ++i) {
+    behaviours.push_back(std::make_unique<BIBS::testing::MockBehaviour>(
+        i < 9 ? boost::str(boost::format("b%1%") % i) : "b0"));
+    ptrBehaviours.push_back(behaviours[i].get());
+  }
+
+  BIBS::ThreadPool threads(4);
+  BIBS::SequentialSimulation sim(ptrAgents, ptrBeliefs, ptrBehaviours,
+                                 &threads);
+
+  for (size_t i = 0; i < agents.size(); ++i) {
+    EXPECT_EQ(sim.agentIndex(agents[i]->uuid), i);
+    EXPECT_EQ(sim.agent(agents[i]->uuid), agents[i].get());
+  }
+  for (size_t i = 0; i < beliefs.size(); ++i) {
+    EXPECT_EQ(sim.beliefIndex(beliefs[i]->uuid), i);
+    EXPECT_EQ(sim.beliefIndex(beliefs[i]->name), i);
+    EXPECT_EQ(sim.belief(beliefs[i]->uuid), beliefs[i].get());
+  }
+  for (size_t i = 0; i < behaviours.size(); ++i) {
+    EXPECT_EQ(sim.behaviourIndex(behaviours[i]->uuid), i);
+    EXPECT_EQ(sim.behaviour(behaviours[i]->uuid), behaviours[i].get());
+  }
+  EXPECT_EQ(sim.behaviourIndex("b8"), 8);
+  EXPECT_THROW(sim.behaviourIndex("b0"), std::invalid_argument);
+  EXPECT_THROW(sim.behaviourIndex("b10"), std::out_of_range);
+  EXPECT_THROW(sim.agent(uuidGen()), std::out_of_range);
+  EXPECT_THROW(sim.beliefIndex(behaviours[0]->uuid), std::out_of_range);
+
+  ptrAgents.push_back(ptrAgents[3]);
+  EXPECT_THROW(
+      BIBS::SequentialSimulation(ptrAgents, ptrBeliefs, ptrBehaviours),
+      std::invalid_argument);
+}
+
 class AgentSequentialSimTest : public BIBS::testing::MockAgent {
 public:
   using MockAgent::MockAgent;
@@ -146,3 +211,409 @@ TEST(SequentialSimulation, run) {
   BIBS::SequentialSimulation sim(ptrAgents, ptrBeliefs, ptrBehaviours);
   sim.run(t);
 }
+
+TEST(VectorisedSimulation, constructorInvalid) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(10, 3, 2, 2, false));
+
+  EXPECT_THROW(BIBS::VectorisedSimulation(s, std::vector<double>(29)),
+               std::invalid_argument);
+  EXPECT_THROW(BIBS::VectorisedSimulation(s, std::vector<double>(30),
+                                          std::vector<BIBS::index_t>(9)),
+               std::invalid_argument);
+  EXPECT_THROW(BIBS::VectorisedSimulation(s, std::vector<double>(30),
+                                          std::vector<BIBS::index_t>(10, 2)),
+               std::invalid_argument);
+
+  s->timeDeltas.pop_back();
+  EXPECT_THROW(BIBS::VectorisedSimulation(s, std::vector<double>(30)),
+               std::invalid_argument);
+}
+
+TEST(VectorisedSimulation, matchesAgents) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(50, 4, 3, 5, true));
+  auto activations = BIBS::testing::randomActivations(*s);
+  BIBS::testing::ScenarioObjects objects(*s, activations);
+
+  BIBS::VectorisedSimulation sim(s, activations);
+  sim.run(10);
+  objects.run(10);
+
+  EXPECT_EQ(sim.time(), 10);
+  for (BIBS::sim_time_t t = 0; t <= 10; ++t) {
+    for (BIBS::index_t i = 0; i < s->nAgents; ++i) {
+      for (BIBS::index_t b = 0; b < s->nBeliefs; ++b) {
+        const double expected =
+            objects.agents[i]->activation(t, objects.constBeliefs[b]);
+        EXPECT_NEAR(sim.activation(t, i, b), expected,
+                    1e-12 * std::abs(expected));
+      }
+      EXPECT_EQ(objects.constBehaviours[sim.performed(t, i)],
+                objects.agents[i]->performed(t));
+    }
+  }
+}
+
+TEST(VectorisedSimulation, initialPerformed) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(10, 3, 2, 2, true));
+  std::vector<BIBS::index_t> performed(10, 1);
+
+  BIBS::VectorisedSimulation sim(s, BIBS::testing::randomActivations(*s),
+                                 performed);
+
+  EXPECT_EQ(sim.current().performed, performed);
+  EXPECT_EQ(sim.behaviourShares(0), (std::vector<double>{0.0, 1.0}));
+}
+
+TEST(VectorisedSimulation, proportionalChoice) {
+  auto s = std::make_shared<BIBS::Scenario>(20000, 1, 2);
+  s->performingRelationships = {1.0, 3.0};
+
+  BIBS::VectorisedSimulation sim(s, std::vector<double>(20000, 1.0));
+  auto shares = sim.behaviourShares(0);
+
+  EXPECT_NEAR(shares[0], 0.25, 0.02);
+  EXPECT_NEAR(shares[1], 0.75, 0.02);
+}
+
+TEST(VectorisedSimulation, uniform) {
+  double total = 0.0;
+  for (BIBS::index_t i = 0; i < 10000; ++i) {
+    const double u = BIBS::VectorisedSimulation::uniform(1, 2, 3, i);
+    EXPECT_GE(u, 0.0);
+    EXPECT_LT(u, 1.0);
+    total += u;
+  }
+
+  EXPECT_NEAR(total / 10000, 0.5, 0.02);
+  EXPECT_EQ(BIBS::VectorisedSimulation::uniform(1, 2, 3, 4),
+            BIBS::VectorisedSimulation::uniform(1, 2, 3, 4));
+  EXPECT_NE(BIBS::VectorisedSimulation::uniform(1, 2, 3, 4),
+            BIBS::VectorisedSimulation::uniform(1, 3, 3, 4));
+}
+
+TEST(VectorisedSimulation, threadsMatch) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(3000, 4, 3, 8, false));
+  auto activations = BIBS::testing::randomActivations(*s);
+  BIBS::ThreadPool threads(4);
+
+  BIBS::VectorisedSimulation sequential(s, activations, {}, 7);
+  BIBS::VectorisedSimulation parallel(s, activations, {}, 7, true, nullptr,
+                                      &threads);
+  sequential.run(5);
+  parallel.run(5);
+
+  for (BIBS::sim_time_t t = 0; t <= 5; ++t) {
+    EXPECT_EQ(sequential.frame(t).activations, parallel.frame(t).activations);
+    EXPECT_EQ(sequential.frame(t).performed, parallel.frame(t).performed);
+  }
+}
+
+TEST(VectorisedSimulation, copyOnWrite) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(1000, 3, 3, 4, false));
+  BIBS::VectorisedSimulation sim(s, BIBS::testing::randomActivations(*s));
+  sim.run(2);
+
+  auto copy = sim;
+  EXPECT_EQ(&copy.frame(2), &sim.frame(2));
+
+  copy.setStream(1);
+  EXPECT_EQ(copy.getStream(), 1);
+  copy.run(3);
+  sim.run(3);
+
+  EXPECT_EQ(&copy.frame(2), &sim.frame(2));
+  EXPECT_NE(&copy.frame(3), &sim.frame(3));
+  EXPECT_NE(copy.frame(5).performed, sim.frame(5).performed);
+}
+
+TEST(VectorisedSimulation, noHistory) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(100, 3, 3, 4, false));
+  auto pool = std::make_shared<BIBS::FramePool>();
+  BIBS::VectorisedSimulation sim(s, BIBS::testing::randomActivations(*s), {},
+                                 0, false, pool);
+
+  sim.run(4);
+
+  EXPECT_EQ(sim.time(), 4);
+  EXPECT_EQ(sim.current().t, 4);
+  EXPECT_NO_THROW(sim.frame(4));
+  EXPECT_THROW(sim.frame(3), std::out_of_range);
+  EXPECT_THROW(sim.frame(5), std::out_of_range);
+  // Only the latest frame is in use; the others were recycled.
+  EXPECT_EQ(pool->nFree(), 1);
+}
+
+TEST(VectorisedSimulation, sharedFrame) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(100, 3, 3, 4, false));
+  auto pool = std::make_shared<BIBS::FramePool>();
+  auto sim = std::make_unique<BIBS::VectorisedSimulation>(
+      s, BIBS::testing::randomActivations(*s), std::vector<BIBS::index_t>{},
+      0, false, pool);
+
+  sim->run(1);
+  auto kept = sim->sharedFrame(1);
+  EXPECT_EQ(kept.get(), &sim->frame(1));
+  EXPECT_THROW(sim->sharedFrame(0), std::out_of_range);
+
+  // The frame is not recycled while it is shared.
+  const auto performed = kept->performed;
+  sim->run(3);
+  EXPECT_EQ(kept->t, 1);
+  EXPECT_EQ(kept->performed, performed);
+  sim.reset();
+  EXPECT_EQ(kept->t, 1);
+}
+
+TEST(VectorisedSimulation, incrementalInvalid) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(10, 3, 2, 2, false));
+  BIBS::VectorisedSimulation sim(s, BIBS::testing::randomActivations(*s));
+
+  EXPECT_FALSE(sim.isIncremental());
+  EXPECT_THROW(sim.setIncremental(-1, 10), std::invalid_argument);
+  EXPECT_THROW(sim.setIncremental(0, 0), std::invalid_argument);
+  sim.setIncremental(0, 10);
+  EXPECT_TRUE(sim.isIncremental());
+  sim.setExact();
+  EXPECT_FALSE(sim.isIncremental());
+  EXPECT_EQ(sim.nRankOneUpdates(), 0);
+}
+
+TEST(VectorisedSimulation, incrementalMatchesExact) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(2000, 6, 4, 5, false));
+  const auto activations = BIBS::testing::randomActivations(*s);
+  BIBS::VectorisedSimulation exact(s, activations, {}, 5);
+  BIBS::VectorisedSimulation incremental(s, activations, {}, 5);
+  incremental.setIncremental(0, 1000);
+
+  exact.run(20);
+  incremental.run(20);
+
+  // With no tolerance, only rounding differs.
+  size_t nDifferent = 0;
+  for (BIBS::sim_time_t t = 0; t <= 20; ++t) {
+    const auto &a = exact.frame(t);
+    const auto &b = incremental.frame(t);
+    for (size_t i = 0; i < a.activations.size(); ++i) {
+      ASSERT_NEAR(a.activations[i], b.activations[i], 1e-9);
+    }
+    for (size_t i = 0; i < a.performed.size(); ++i) {
+      nDifferent += a.performed[i] != b.performed[i];
+    }
+  }
+  EXPECT_LE(nDifferent, 2);
+}
+
+TEST(VectorisedSimulation, incrementalTolerance) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(2000, 6, 4, 5, false));
+  const auto activations = BIBS::testing::randomActivations(*s);
+  BIBS::ThreadPool threads(4);
+  BIBS::VectorisedSimulation exact(s, activations, {}, 5);
+  BIBS::VectorisedSimulation loose(s, activations, {}, 5);
+  BIBS::VectorisedSimulation parallel(s, activations, {}, 5, true, nullptr,
+                                      &threads);
+  loose.setIncremental(1e-2, 4);
+  parallel.setIncremental(1e-2, 4);
+
+  // The first tick is a full computation.
+  exact.run(1);
+  loose.run(1);
+  EXPECT_EQ(loose.nRankOneUpdates(), 0);
+  EXPECT_EQ(loose.current().performed, exact.current().performed);
+
+  loose.run(1);
+  const uint64_t all = 2000 * 6 * 2;
+  EXPECT_GT(loose.nRankOneUpdates(), 0);
+  EXPECT_LT(loose.nRankOneUpdates(), all);
+
+  // Every refreshInterval ticks the utilities are exact again.
+  loose.run(2);
+  EXPECT_GT(loose.nRankOneUpdates(), 0);
+  loose.run(1);
+  EXPECT_EQ(loose.nRankOneUpdates(), 0);
+
+  // The updates do not depend on the threads.
+  parallel.run(10);
+  loose.run(5);
+  EXPECT_EQ(parallel.current().activations, loose.current().activations);
+  EXPECT_EQ(parallel.current().performed, loose.current().performed);
+}
+
+namespace {
+/**
+ * Counts the agents performing behaviour 0 at each time, per chunk.
+ */
+struct PerformingCounter : BIBS::TickObserver {
+  std::vector<size_t> perChunk;
+  std::vector<size_t> counts;
+  std::mutex mutex;
+  size_t chunks = 0;
+
+  void tickStart(const BIBS::Frame &previous) {
+    perChunk.assign(previous.performed.size(), 0);
+  }
+
+  void afterBehaviours(const BIBS::Frame &previous,
+                       const BIBS::Frame &current, size_t begin,
+                       size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      perChunk[i] = current.performed[i] == 0;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    ++chunks;
+  }
+
+  void tickEnd(const BIBS::Frame &current) {
+    size_t n = 0;
+    for (auto c : perChunk) {
+      n += c;
+    }
+    counts.push_back(n);
+  }
+};
+
+/**
+ * Records the order in which the hooks are called, from one thread.
+ */
+class RecordingObserver : public BIBS::ITickObserver {
+public:
+  std::string name;
+  std::vector<std::string> *calls;
+
+  RecordingObserver(std::string name, std::vector<std::string> *calls)
+      : name(std::move(name)), calls(calls) {}
+
+  void tickStart(const BIBS::Frame &previous) override {
+    calls->push_back(name + " start " + std::to_string(previous.t));
+  }
+
+  void afterActivations(const BIBS::Frame &previous,
+                        const BIBS::Frame &current, size_t begin,
+                        size_t end) override {
+    EXPECT_EQ(current.t, previous.t + 1);
+    calls->push_back(name + " activations " + std::to_string(end - begin));
+  }
+
+  void tickEnd(const BIBS::Frame &current) override {
+    calls->push_back(name + " end " + std::to_string(current.t));
+  }
+};
+
+/**
+ * Keeps a copy of each frame at the end of a tick.
+ */
+class FrameRecorder : public BIBS::ITickObserver {
+public:
+  std::vector<BIBS::Frame> frames;
+
+  void tickEnd(const BIBS::Frame &current) override {
+    frames.push_back(current);
+  }
+};
+} // namespace
+
+TEST(VectorisedSimulation, compileTimeObserver) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(1000, 3, 3, 4, false));
+  const auto activations = BIBS::testing::randomActivations(*s);
+  BIBS::ThreadPool threads(3);
+
+  BIBS::VectorisedSimulation plain(s, activations, {}, 2);
+  BIBS::VectorisedSimulation observed(s, activations, {}, 2, true, nullptr,
+                                      &threads);
+  PerformingCounter counter;
+  plain.run(5);
+  observed.run(5, counter);
+
+  // The hooks do not change the simulation, and see every agent.
+  EXPECT_EQ(observed.current().digest, plain.current().digest);
+  ASSERT_EQ(counter.counts.size(), 5);
+  EXPECT_EQ(counter.chunks, 5 * ((1000 + 255) / 256));
+  for (BIBS::sim_time_t t = 1; t <= 5; ++t) {
+    EXPECT_DOUBLE_EQ(counter.counts[t - 1] / 1000.0,
+                     plain.behaviourShares(t)[0]);
+  }
+}
+
+TEST(VectorisedSimulation, runtimeObservers) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(10, 3, 3, 4, false));
+  BIBS::VectorisedSimulation sim(s, BIBS::testing::randomActivations(*s));
+  std::vector<std::string> calls;
+  RecordingObserver a("a", &calls);
+  RecordingObserver b("b", &calls);
+
+  EXPECT_THROW(sim.addObserver(nullptr), std::invalid_argument);
+  EXPECT_THROW(sim.removeObserver(&a), std::out_of_range);
+  sim.addObserver(&a);
+  sim.addObserver(&b);
+  sim.run(1);
+  EXPECT_EQ(calls, (std::vector<std::string>{
+                       "a start 0", "b start 0", "a activations 10",
+                       "b activations 10", "a end 1", "b end 1"}));
+
+  // A compile-time observer is called first.
+  calls.clear();
+  sim.removeObserver(&a);
+  PerformingCounter counter;
+  sim.run(1, counter);
+  EXPECT_EQ(calls, (std::vector<std::string>{"b start 1",
+                                             "b activations 10", "b end 2"}));
+  EXPECT_EQ(counter.counts.size(), 1);
+
+  calls.clear();
+  sim.removeObserver(&b);
+  sim.run(1);
+  EXPECT_TRUE(calls.empty());
+}
+
+TEST(SequentialSimulation, runtimeObservers) {
+  auto s = std::make_shared<BIBS::Scenario>(
+      BIBS::testing::randomScenario(10, 3, 3, 4, false));
+  // SequentialSimulation starts at time 0, so the initial state is at time
+  // -1.
+  const BIBS::sim_time_t first = std::numeric_limits<BIBS::sim_time_t>::max();
+  BIBS::testing::ScenarioObjects o(*s, BIBS::testing::randomActivations(*s),
+                                   std::nullopt, first);
+  for (auto &a : o.agents) {
+    a->perform(first, o.constBehaviours);
+  }
+  BIBS::SequentialSimulation sim(o.ptrAgents, o.ptrBeliefs, o.ptrBehaviours);
+  std::vector<std::string> calls;
+  RecordingObserver a("a", &calls);
+  FrameRecorder recorder;
+
+  EXPECT_THROW(sim.addObserver(nullptr), std::invalid_argument);
+  EXPECT_THROW(sim.removeObserver(&a), std::out_of_range);
+  sim.addObserver(&a);
+  sim.addObserver(&recorder);
+  sim.run(2);
+  EXPECT_EQ(calls, (std::vector<std::string>{
+                       "a start " + std::to_string(first), "a activations 10",
+                       "a end 0", "a start 0", "a activations 10",
+                       "a end 1"}));
+
+  // The frames are the state of the agents.
+  ASSERT_EQ(recorder.frames.size(), 2);
+  for (BIBS::sim_time_t t = 0; t < 2; ++t) {
+    const auto &f = recorder.frames[t];
+    EXPECT_EQ(f.t, t);
+    EXPECT_EQ(f.activations,
+              BIBS::activationsOf(o.constIAgents, o.constBeliefs, t));
+    EXPECT_EQ(f.performed,
+              BIBS::performedOf(o.constIAgents, o.constBehaviours, t));
+  }
+
+  sim.removeObserver(&a);
+  sim.removeObserver(&recorder);
+  EXPECT_THROW(sim.removeObserver(&a), std::out_of_range);
+}
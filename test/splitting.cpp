@@ -0,0 +1,133 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/splitting.hpp"
+#include "bibs/parallel.hpp"
+#include "bibs/scenario.hpp"
+#include "bibs/vectorised.hpp"
+
+#include "scenario.hpp"
+#include <cmath>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+/**
+ * A random scenario of two behaviours, in which about 18% of agents
+ * perform behaviour 0 at first, and rarely more than 45% in 10 days.
+ */
+std::shared_ptr<const BIBS::Scenario> scenario() {
+  auto s = BIBS::testing::randomScenario(100, 3, 2, 4, false);
+  for (size_t b = 0; b < s.nBeliefs; ++b) {
+    s.performingRelationships[b * s.nBehaviours] -= 0.4;
+  }
+  return std::make_shared<const BIBS::Scenario>(std::move(s));
+}
+} // namespace
+
+TEST(ImportanceSplitting, constructor) {
+  const auto s = scenario();
+  const auto activations = BIBS::testing::randomActivations(*s);
+  EXPECT_THROW(BIBS::ImportanceSplitting(s, activations, 2, {0.5}, 10, 10),
+               std::invalid_argument);
+  EXPECT_THROW(BIBS::ImportanceSplitting(s, activations, 0, {}, 10, 10),
+               std::invalid_argument);
+  EXPECT_THROW(
+      BIBS::ImportanceSplitting(s, activations, 0, {0.3, 0.3}, 10, 10),
+      std::invalid_argument);
+  EXPECT_THROW(BIBS::ImportanceSplitting(s, activations, 0, {0.0}, 10, 10),
+               std::invalid_argument);
+  EXPECT_THROW(BIBS::ImportanceSplitting(s, activations, 0, {1.5}, 10, 10),
+               std::invalid_argument);
+  EXPECT_THROW(BIBS::ImportanceSplitting(s, activations, 0, {0.5}, 10, 0),
+               std::invalid_argument);
+
+  // A level reached at time 0 is certain, and one that cannot be reached
+  // by the deadline is impossible.
+  BIBS::ImportanceSplitting certain(s, activations, 0, {0.01}, 10, 10);
+  EXPECT_EQ(certain.estimate().probability, 1);
+  EXPECT_EQ(certain.estimate().nTicks, 0);
+  EXPECT_EQ(certain.estimate().relativeError, 0);
+  BIBS::ImportanceSplitting impossible(s, activations, 0, {0.01, 0.9}, 0, 10);
+  const auto e = impossible.estimate();
+  EXPECT_EQ(e.probability, 0);
+  EXPECT_EQ(e.levelProbabilities, (std::vector<double>{1, 0}));
+  EXPECT_TRUE(std::isinf(e.relativeError));
+}
+
+TEST(ImportanceSplitting, deterministic) {
+  const auto s = scenario();
+  const auto activations = BIBS::testing::randomActivations(*s);
+  BIBS::ThreadPool threads(3);
+  const std::vector<double> levels{0.3, 0.38, 0.42, 0.45};
+
+  BIBS::ImportanceSplitting serial(s, activations, 0, levels, 10, 50, 4);
+  BIBS::ImportanceSplitting parallel(s, activations, 0, levels, 10, 50, 4,
+                                     &threads);
+  EXPECT_EQ(parallel.getLevels(), levels);
+  for (uint64_t r = 0; r < 3; ++r) {
+    const auto a = serial.estimate(r);
+    const auto b = parallel.estimate(r);
+    EXPECT_EQ(a.probability, b.probability);
+    EXPECT_EQ(a.levelProbabilities, b.levelProbabilities);
+    EXPECT_EQ(a.nTicks, b.nTicks);
+  }
+}
+
+TEST(ImportanceSplitting, unbiased) {
+  const auto s = scenario();
+  const auto activations = BIBS::testing::randomActivations(*s);
+  const double level = 0.45;
+  const BIBS::sim_time_t nDays = 10;
+  BIBS::ThreadPool threads(2);
+
+  // Plain Monte Carlo.
+  const size_t nRuns = 4000;
+  BIBS::VectorisedSimulation origin(s, activations, {}, 4, false);
+  size_t hits = 0;
+  for (size_t r = 0; r < nRuns; ++r) {
+    auto sim = origin;
+    sim.setStream(1000000 + r);
+    while (sim.behaviourShares(sim.time())[0] < level &&
+           sim.time() < nDays) {
+      sim.run(1);
+    }
+    hits += sim.behaviourShares(sim.time())[0] >= level;
+  }
+  const double p = static_cast<double>(hits) / nRuns;
+  const double variance = p * (1 - p) / nRuns;
+
+  BIBS::ImportanceSplitting splitting(s, activations, 0, {0.3, 0.38, level},
+                                      nDays, 100, 4, &threads);
+  const size_t nReplicates = 20;
+  double sum = 0.0;
+  double sumSquares = 0.0;
+  for (uint64_t r = 0; r < nReplicates; ++r) {
+    const double q = splitting.estimate(r).probability;
+    sum += q;
+    sumSquares += q * q;
+  }
+  const double q = sum / nReplicates;
+  const double qVariance =
+      (sumSquares / nReplicates - q * q) / (nReplicates - 1);
+
+  EXPECT_GT(p, 0.01);
+  EXPECT_LT(p, 0.1);
+  EXPECT_NEAR(q, p, 4 * std::sqrt(variance + qVariance));
+}
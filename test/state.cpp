@@ -0,0 +1,68 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "bibs/state.hpp"
+
+#include <gtest/gtest.h>
+#include <memory>
+
+TEST(Frame, resize) {
+  BIBS::Frame f;
+  f.resize(10, 3);
+
+  EXPECT_EQ(f.activations.size(), 30);
+  EXPECT_EQ(f.contexts.size(), 30);
+  EXPECT_EQ(f.performed.size(), 10);
+}
+
+TEST(FramePool, recycles) {
+  auto pool = std::make_shared<BIBS::FramePool>();
+
+  auto f1 = pool->acquire(10, 3);
+  const auto *address = f1.get();
+  EXPECT_EQ(pool->nFree(), 0);
+
+  f1.reset();
+  EXPECT_EQ(pool->nFree(), 1);
+
+  auto f2 = pool->acquire(20, 2);
+  EXPECT_EQ(f2.get(), address);
+  EXPECT_EQ(f2->activations.size(), 40);
+  EXPECT_EQ(f2->performed.size(), 20);
+  EXPECT_EQ(pool->nFree(), 0);
+}
+
+TEST(FramePool, sharedFrameReleasedOnce) {
+  auto pool = std::make_shared<BIBS::FramePool>();
+
+  auto f1 = pool->acquire(10, 3);
+  std::shared_ptr<const BIBS::Frame> f2 = f1;
+  f1.reset();
+  EXPECT_EQ(pool->nFree(), 0);
+
+  f2.reset();
+  EXPECT_EQ(pool->nFree(), 1);
+}
+
+TEST(FramePool, frameOutlivesPool) {
+  auto pool = std::make_shared<BIBS::FramePool>();
+  auto f = pool->acquire(10, 3);
+
+  pool.reset();
+  f->performed[0] = 1;
+  f.reset();
+}
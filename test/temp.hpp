@@ -0,0 +1,46 @@
+/* BIBS, the belief-induced behaviour simulation
+ * Copyright (C) 2021 Robert Greener
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file      temp.hpp<test>
+ * @brief     Header of temporary files for testing
+ * @date      Mon Oct 19 18:04:12 2026
+ * @author    Robert Greener
+ * @copyright GPL-3.0-or-later
+ *
+ * This module contains the paths of temporary files written by tests.
+ */
+
+#ifndef BIBS_TESTING_TEMP_H
+#define BIBS_TESTING_TEMP_H
+
+#include <gtest/gtest.h>
+#include <string>
+
+namespace BIBS::testing {
+/**
+ * The path of a temporary file of a test.
+ *
+ * @param name The name of the file, which is prefixed with "bibs-".
+ * @return The path, in the temporary directory of the tests.
+ */
+inline std::string tempPath(const std::string &name) {
+  return ::testing::TempDir() + "bibs-" + name;
+}
+} // namespace BIBS::testing
+
+#endif // BIBS_TESTING_TEMP_H